@@ -0,0 +1,487 @@
+/**
+ * @file communication.c
+ * @author Paul Götzinger
+ * @brief Communication module, handles commands received over usb
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#include "communication.h"
+#include "config.h"
+#include "usb.h"
+#include "trace.h"
+#include "record.h"
+#include "memory.h"
+#include "location.h"
+#include "ble_interface.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define RX_LEN      64  //receive ring buffer (power of 2)
+#define LINE_LEN    48
+#define REPLY_LEN   64
+#define SEND_TIMEOUT 10  //ms, transmit buffer stays full (host not reading)
+#define DUMP_LINE   48  //bytes per line of the dump pattern (Host/Usb)
+#define DUMP_MAX    65536UL
+
+static uint8_t rx[RX_LEN];
+static volatile uint16_t rxHead;
+static uint16_t rxTail;
+
+static char line[LINE_LEN];
+static uint8_t lineLen;
+
+static char replyBuf[REPLY_LEN];    //copied to the usb transmit buffer
+
+static char phoneLine[LINE_LEN];    //command line received from the phone app over ble
+static uint8_t phoneLen;
+
+MEM_BUFFER("com", rx);
+MEM_BUFFER("com", line);
+MEM_BUFFER("com", replyBuf);
+MEM_BUFFER("com", phoneLine);
+
+/**
+ * @brief Callback for data received over usb (interrupt context)
+ * 
+ * @param buf received data
+ * @param len length of data
+ */
+static void receiveCallback(uint8_t *buf, uint16_t len);
+
+/**
+ * @brief Callback for data received from the phone app over ble (transparent mode)
+ * 
+ * @param buf received data
+ * @param len length of data
+ */
+static void phoneCallback(const uint8_t *buf, uint16_t len);
+
+/**
+ * @brief Execute command line received from the phone app, replies over ble
+ * 
+ * @param cmd command line (0 terminated)
+ */
+static void phoneExecute(char *cmd);
+
+/**
+ * @brief Execute command line
+ * 
+ * @param cmd command line (0 terminated)
+ */
+static void execute(char *cmd);
+
+/**
+ * @brief Execute dump command, test pattern for the usb throughput (Host/Usb)
+ * 
+ * @param args size of pattern in bytes
+ */
+static void dumpCommand(char *args);
+
+/**
+ * @brief Execute configuration command
+ * 
+ * @param args command arguments (may be 0)
+ */
+static void configCommand(char *args);
+
+/**
+ * @brief Execute trace command
+ * 
+ * @param args command arguments (may be 0)
+ */
+static void traceCommand(char *args);
+
+/**
+ * @brief Execute input recording command
+ * 
+ * @param args command arguments (may be 0)
+ */
+static void recordCommand(char *args);
+
+/**
+ * @brief Execute memory report command
+ * 
+ */
+static void memoryCommand(void);
+
+/**
+ * @brief Execute nmea statistics command
+ * 
+ * @param args command arguments (may be 0)
+ */
+static void nmeaCommand(char *args);
+
+/**
+ * @brief Execute satellite table command
+ * 
+ */
+static void skyCommand(void);
+
+/**
+ * @brief Send printf formatted reply over usb
+ * 
+ * @param format format of data (printf style)
+ * @param ... data
+ */
+static void reply(const char *format, ...);
+
+void COM_Init(void) {
+    rxHead = 0;
+    rxTail = 0;
+    lineLen = 0;
+
+#if LOG_DEST != LOG_USB
+    USB_Init();
+#endif
+    USB_SetReceiveCallback(receiveCallback);
+
+    phoneLen = 0;
+    ble_interface_init();
+    ble_interface_set_receive_callback(phoneCallback);
+}
+
+void COM_Process(void) {
+    while (rxTail != rxHead) {
+        char c = rx[rxTail];
+        rxTail = (rxTail + 1) % RX_LEN;
+        REC_BYTE(REC_Source_Usb, c);
+
+        if (c == '\r' || c == '\n') {
+            if (lineLen > 0) {
+                line[lineLen] = 0;
+                execute(line);
+                lineLen = 0;
+            }
+        } else if (lineLen < LINE_LEN - 1) {
+            line[lineLen++] = c;
+        }
+    }
+
+    ble_interface_process();
+}
+
+static void receiveCallback(uint8_t *buf, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint16_t next = (rxHead + 1) % RX_LEN;
+        if (next == rxTail) {
+            //buffer full, drop remaining data
+            break;
+        }
+        rx[rxHead] = buf[i];
+        rxHead = next;
+    }
+}
+
+static void phoneCallback(const uint8_t *buf, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        char c = buf[i];
+
+        if (c == '\r' || c == '\n') {
+            if (phoneLen > 0) {
+                phoneLine[phoneLen] = 0;
+                phoneExecute(phoneLine);
+                phoneLen = 0;
+            }
+        } else if (phoneLen < LINE_LEN - 1) {
+            phoneLine[phoneLen++] = c;
+        }
+    }
+}
+
+static void phoneExecute(char *cmd) {
+    const char *result = "error: unknown command\n";
+    char *args = strchr(cmd, ' ');
+    if (args != 0) {
+        *args++ = 0;
+    }
+
+    //pos <lat 1e-7 deg> <lon 1e-7 deg> <accuracy m> <utc hhmmss> <age s>
+    if (strcmp(cmd, "pos") == 0 && args != 0) {
+        long v[5] = { 0 };
+        uint8_t count = 0;
+        char *end = args;
+        for (char *p = args; count < 5; p = end) {
+            v[count] = strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            count++;
+        }
+
+        int32_t lat = v[0];
+        int32_t lon = v[1];
+        uint32_t accuracy = v[2];
+        uint32_t utc = v[3];
+        uint32_t age = v[4];
+        POS_Time time = { utc / 10000, utc / 100 % 100, utc % 100, 0 };
+        //accuracy and age are scaled to mm and ms below, larger values would wrap around
+        if (count < 5 || *end != 0 || v[2] < 0 || v[3] < 0 || v[4] < 0
+                || (unsigned long)v[2] > UINT32_MAX / 1000 || (unsigned long)v[4] > UINT32_MAX / 1000 || lat < -900000000 || lat > 900000000 || lon < -1800000000 || lon > 1800000000
+                || time.hour > 23 || time.minute > 59 || time.second > 59) {
+            result = "error: invalid arguments\n";
+        } else if (LOC_ExternalPosition(lat, lon, &time, accuracy * 1000, age * 1000) != 0) {
+            result = "ok\n";
+        } else {
+            result = "ignored\n";
+        }
+    }
+    ble_interface_send((uint8_t*)result, strlen(result));
+}
+
+static void execute(char *cmd) {
+    char *args = strchr(cmd, ' ');
+    if (args != 0) {
+        *args++ = 0;
+    }
+
+    if (strcmp(cmd, "cfg") == 0) {
+        configCommand(args);
+    } else if (strcmp(cmd, "trace") == 0) {
+        traceCommand(args);
+    } else if (strcmp(cmd, "record") == 0) {
+        recordCommand(args);
+    } else if (strcmp(cmd, "mem") == 0) {
+        memoryCommand();
+    } else if (strcmp(cmd, "nmea") == 0) {
+        nmeaCommand(args);
+    } else if (strcmp(cmd, "sky") == 0) {
+        skyCommand();
+    } else if (strcmp(cmd, "dump") == 0) {
+        dumpCommand(args);
+    } else if (strcmp(cmd, "reset") == 0) {
+        reply("ok\n");
+        STORAGE_Flush();
+        HAL_Delay(10);
+        NVIC_SystemReset();
+    } else {
+        reply("error: unknown command\n");
+    }
+}
+
+static void configCommand(char *args) {
+    if (args == 0 || *args == 0) {
+        //list pending and active values
+        for (uint8_t i = 0; i < CFG_GetEntryCount(); i++) {
+            const CFG_Entry *entry = CFG_GetEntry(i);
+            reply("%s=%lu (active %lu)\n", entry->name,
+                    CFG_GetValue(CFG_GetPending(), entry), CFG_GetValue(CFG_Get(), entry));
+        }
+        reply("load time %lu us\n", CFG_GetLoadTime());
+        return;
+    }
+
+    char *value = strchr(args, ' ');
+    if (value != 0) {
+        *value++ = 0;
+    }
+
+    if (value == 0 && strcmp(args, "save") == 0) {
+        reply(CFG_Save() == HAL_OK ? "ok\n" : "error: eeprom\n");
+    } else if (value == 0 && strcmp(args, "default") == 0) {
+        CFG_SetDefaults();
+        reply("ok\n");
+    } else if (value != 0) {
+        const CFG_Entry *entry = CFG_FindEntry(args);
+        char *end;
+        uint32_t val = strtoul(value, &end, 0);
+
+        if (entry == 0) {
+            reply("error: unknown entry\n");
+        } else if (end == value || *end != 0 || !CFG_Set(entry, val)) {
+            reply("error: invalid value\n");
+        } else {
+            reply("ok\n");
+        }
+    } else {
+        reply("error: invalid arguments\n");
+    }
+}
+
+static void traceCommand(char *args) {
+    if (args == 0 || *args == 0) {
+        //dump event names and entries (hex: time tick event arg), recording stops meanwhile
+        uint8_t crash = TRACE_IsCrashDump();
+        TRACE_Freeze(1);
+        reply("trace %u entries, mask 0x%08lx%s\n", TRACE_GetCount(), TRACE_GetMask(), crash ? ", crash" : "");
+        for (uint16_t i = 0; i < TRACE_Event_Count; i++) {
+            reply("event %u %s\n", i, TRACE_GetName(i));
+        }
+        TRACE_Entry entry;
+        for (uint16_t i = 0; TRACE_GetEntry(i, &entry); i++) {
+            reply("%04x %04x %04x %04x\n", entry.time, entry.tick, entry.event, entry.arg);
+        }
+        //interrupt latency in SysTick cycles: count, clock, min, avg, max and the log2 bins
+        TRACE_Latency lat;
+        TRACE_GetLatency(&lat);
+        reply("latency %lu %lu %lu %lu %lu", lat.count, SystemCoreClock, lat.min,
+                lat.count > 0 ? (uint32_t)(lat.sum / lat.count) : 0, lat.max);
+        for (uint8_t i = 0; i < TRACE_LATENCY_BINS; i++) {
+            reply(" %lu", lat.hist[i]);
+        }
+        reply("\n");
+        reply("end\n");
+        //a crash trace is kept until restarted
+        TRACE_Freeze(crash);
+        return;
+    }
+
+    char *value = strchr(args, ' ');
+    if (value != 0) {
+        *value++ = 0;
+    }
+
+    if (value == 0 && strcmp(args, "start") == 0) {
+        TRACE_Restart();
+        reply("ok\n");
+    } else if (value != 0 && strcmp(args, "mask") == 0) {
+        TRACE_SetMask(strtoul(value, 0, 16));
+        reply("ok\n");
+    } else {
+        reply("error: invalid arguments\n");
+    }
+}
+
+static void recordCommand(char *args) {
+    if (args == 0 || *args == 0) {
+        //dump recording (hex, 16 bytes per line with offset), input for the replay in the simulator
+        uint16_t len;
+        const uint8_t *data = REC_GetData(&len);
+        reply("record %u bytes, start %lu, mask 0x%02lx, %lu dropped%s%s\n", len, REC_GetStartTick(), REC_GetMask(),
+                REC_GetDropped(), REC_IsRunning() ? "" : ", stopped", REC_IsFull() ? ", full" : "");
+        for (uint16_t i = 0; i < len; i += 16) {
+            char hex[33];
+            uint8_t n = len - i < 16 ? len - i : 16;
+            for (uint8_t j = 0; j < n; j++) {
+                sprintf(hex + 2 * j, "%02x", data[i + j]);
+            }
+            reply("%04x %s\n", i, hex);
+        }
+        reply("end\n");
+        return;
+    }
+
+    char *value = strchr(args, ' ');
+    if (value != 0) {
+        *value++ = 0;
+    }
+
+    if (value == 0 && strcmp(args, "start") == 0) {
+        REC_Restart();
+        reply("ok\n");
+    } else if (value == 0 && strcmp(args, "stop") == 0) {
+        REC_Stop();
+        reply("ok\n");
+    } else if (value == 0 && strcmp(args, "save") == 0) {
+        reply(REC_Save() ? "ok\n" : "error: eeprom\n");
+    } else if (value == 0 && strcmp(args, "load") == 0) {
+        reply(REC_Load() ? "ok\n" : "error: nothing saved\n");
+    } else if (value != 0 && strcmp(args, "mask") == 0) {
+        REC_SetMask(strtoul(value, 0, 16));
+        reply("ok\n");
+    } else {
+        reply("error: invalid arguments\n");
+    }
+}
+
+static void memoryCommand(void) {
+    uint16_t data, bss, noinit;
+    MEM_Module module;
+    const MEM_Buffer *buf;
+
+    MEM_GetStatic(&data, &bss, &noinit);
+    reply("data %u bss %u noinit %u ramfunc %u\n", data, bss, noinit, MEM_GetRamCode());
+    reply("stack %u of %u guard %s\n", MEM_GetStackUsage(), MEM_GetStackSize(), MEM_GuardIntact() ? "ok" : "violated");
+    for (uint8_t i = 0; MEM_GetModule(i, &module); i++) {
+        reply("module %s %u of %u\n", module.name, module.used, module.budget);
+    }
+    for (uint8_t i = 0; (buf = MEM_GetBuffer(i)) != 0; i++) {
+        reply("buffer %s %s %u\n", buf->module, buf->name, buf->size);
+    }
+    reply("end\n");
+}
+
+static void nmeaCommand(char *args) {
+    NMEA_Instance *nmea = LOC_GetNmea();
+
+    if (args == 0 || *args == 0) {
+        //sentences per type: accepted, checksum failures, overlength
+        for (uint8_t type = 0; type < NMEA_Type_Count; type++) {
+            NMEA_Counter *cnt = &nmea->counter[type];
+            reply("%s %lu %lu %lu\n", NMEA_GetTypeName(type), cnt->accepted, cnt->checksum, cnt->overlength);
+        }
+        reply("framing %lu\n", nmea->framing);
+        reply("end\n");
+    } else if (strcmp(args, "reset") == 0) {
+        NMEA_ResetCounters(nmea);
+        reply("ok\n");
+    } else {
+        reply("error: invalid arguments\n");
+    }
+}
+
+static void skyCommand(void) {
+    SAT_Table *sky = LOC_GetSatellites();
+    SAT_Prediction *p = SAT_GetPrediction(sky);
+
+    if (p->ttff == SAT_TTFF_NEVER) {
+        reply("sky %s ttff never %u %u %u\n", SAT_GetSkyName(p->sky), p->visible, p->decodable, p->used);
+    } else {
+        reply("sky %s ttff %u %u %u %u\n", SAT_GetSkyName(p->sky), p->ttff, p->visible, p->decodable, p->used);
+    }
+    //prn, elevation, C/N0, used in fix
+    for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+        SAT_Entry *sv = &sky->sv[i];
+        if (sv->prn != 0) {
+            reply("sv %u %d %u %u\n", sv->prn, sv->elevation, sv->cn0, sv->used);
+        }
+    }
+    reply("end\n");
+}
+
+static void dumpCommand(char *args) {
+    char *end = args;
+    unsigned long size = args != 0 ? strtoul(args, &end, 10) : 0;
+
+    if (args == 0 || end == args || *end != 0 || size > DUMP_MAX) {
+        reply("error: invalid arguments\n");
+        return;
+    }
+
+    //lines of DUMP_LINE bytes: offset (hex) and the alphabet rotated by the line number, the last line is cut
+    char pattern[DUMP_LINE];
+    for (unsigned long offset = 0; offset < size; offset += DUMP_LINE) {
+        uint8_t len = snprintf(pattern, DUMP_LINE, "%08lx ", offset);
+        for (uint8_t i = len; i < DUMP_LINE - 1; i++) {
+            pattern[i] = 'a' + (offset / DUMP_LINE + i) % 26;
+        }
+        pattern[DUMP_LINE - 1] = 0;
+        if (size - offset < DUMP_LINE) {
+            pattern[size - offset - 1] = 0;
+        }
+        reply("%s\n", pattern);
+    }
+    reply("end\n");
+}
+
+static void reply(const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    uint16_t len = vsnprintf(replyBuf, REPLY_LEN, format, args);
+    va_end(args);
+    if (len >= REPLY_LEN) {
+        len = REPLY_LEN - 1;
+    }
+
+    //wait while the transmit buffer is full, the transfers continue from the usb interrupt
+    uint32_t start = HAL_GetTick();
+    while (USB_SendData((uint8_t*)replyBuf, len) == HAL_BUSY && HAL_GetTick() - start <= SEND_TIMEOUT) {
+    }
+}
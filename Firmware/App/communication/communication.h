@@ -0,0 +1,41 @@
+/**
+ * @file communication.h
+ * @author Paul Götzinger
+ * @brief Communication module, handles commands received over usb
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#ifndef COMMUNICATION_H
+#define COMMUNICATION_H
+
+/**
+ * @brief Communication initialization
+ * 
+ */
+void COM_Init(void);
+
+/**
+ * @brief Communication processing, executes received commands
+ * 
+ * Commands (one per line):
+ * - cfg                  list pending configuration
+ * - cfg <name> <value>   set configuration entry (dec, 0x hex)
+ * - cfg default          reset configuration to defaults
+ * - cfg save             store configuration in eeprom
+ * - reset                restart beacon (activates stored configuration)
+ * - dump <bytes>         test pattern of the given size, lines of 48 bytes and "end" (usb throughput, Host/Usb)
+ */
+void COM_Process(void);
+
+/*
+ * Phone app commands over ble (transparent mode, one per line):
+ * - pos <lat> <lon> <accuracy> <utc> <age>
+ *   position of the phone: latitude and longitude in 1e-7 deg, accuracy in m, utc time of the fix (hhmmss),
+ *   age of the fix in s; replies ok (published), ignored (own fix or better position available) or error
+ */
+
+#endif //!COMMUNICATION_H
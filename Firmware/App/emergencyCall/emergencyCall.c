@@ -11,67 +11,135 @@
 
 #include "emergencyCall.h"
 #include "spi_driver.h"
+#include "board.h"
 #include "location.h"
 #include "plb.h"
+#include "config.h"
+#include "sgb.h"
+#include "homer.h"
 #include "radio.h"
+#include "memory.h"
+#include "logbook.h"
+#include "storage.h"
 #include <string.h>
 
 #define FRAME_SIZE 144
 
-#define MSG_INTERVAL 0
+#define MSG_INTERVAL 50000 //ms, C/S T.001 repetition period (the fix for the next burst is selected meanwhile)
+#define MSG_JITTER   2500  //ms, C/S T.001 randomization of the repetition period (+-2.5 s)
+
+#define GENERATION_FIRST  1 //C/S T.001 frames (biphase-L)
+#define GENERATION_SECOND 2 //C/S T.018 messages (DSSS-OQPSK)
+
+//build option, make BEACON_GENERATION=2 sends second generation messages
+#ifndef BEACON_GENERATION
+#define BEACON_GENERATION GENERATION_FIRST
+#endif
+
+#if BEACON_GENERATION != GENERATION_FIRST && BEACON_GENERATION != GENERATION_SECOND
+#error "BEACON_GENERATION has to be 1 or 2"
+#endif
+
+#define HOMING_GUARD  20    //ms, homing ends this long before a burst is due and resumes after its end
+#define HOMING_HOMER  0b01  //radio-locating device of the identification: 121.5 MHz homer
 
 static EMC_State emergencyState;
-static uint8_t dataFrame[FRAME_SIZE];
+static uint8_t dataFrame[FRAME_SIZE];  //static: the first burst must not depend on free memory
 static uint16_t frameLength;
 
 static SPI_Init_Struct spi;
 static POS_Time lastPosUpdate;
+static POS_Subscriber posSub;
 static RADIO_Instance radio;
 static uint32_t lastMsgSent;
+static uint32_t jitterState;
+
+MEM_BUFFER("emc", radio);
+MEM_BUFFER("emc", dataFrame);
+
+/**
+ * @brief Gate of the storage writer: no eeprom operation overlaps a burst (from transmitter warm
+ * up to the end) or starts too late to end before the next scheduled burst
+ * 
+ * @return uint32_t ms the bus may be stalled
+ */
+static uint32_t storageGate(void) {
+    if (emergencyState != EMC_State_Emergency) {
+        return UINT32_MAX;
+    }
+    if (RADIO_GetState(&radio) != RADIO_STATE_IDLE) {
+        return 0;
+    }
+    //without frame the first burst waits for a fix, it may start at any time
+    if (frameLength == 0) {
+        return UINT32_MAX;
+    }
+    uint32_t now = HAL_GetTick();
+    return lastMsgSent > now ? lastMsgSent - now : 0;
+}
+
+/**
+ * @brief Randomized repetition period: beacons activated together must not stay synchronized and
+ * collide burst after burst. xorshift32 seeded from the beacon id, uniform within MSG_INTERVAL +-MSG_JITTER
+ * 
+ * @return uint32_t ms until the next burst
+ */
+static uint32_t nextInterval(void) {
+    jitterState ^= jitterState << 13;
+    jitterState ^= jitterState >> 17;
+    jitterState ^= jitterState << 5;
+    return MSG_INTERVAL - MSG_JITTER + jitterState % (2 * MSG_JITTER + 1);
+}
+
+/**
+ * @brief Homing signal between the bursts: on while the radio is idle, off from HOMING_GUARD
+ * before a burst is due until the burst has ended
+ * 
+ */
+static void scheduleHoming(void) {
+    uint32_t now = HAL_GetTick();
+    uint8_t burstNear = frameLength != 0 && (int32_t)(lastMsgSent - now) <= HOMING_GUARD;
+
+    if (RADIO_GetState(&radio) == RADIO_STATE_IDLE && !burstNear
+            && CFG_Get()->plb.radiolocating == HOMING_HOMER) {
+        HOMER_Start();
+    } else {
+        HOMER_Stop();
+    }
+}
+
+#if BEACON_GENERATION == GENERATION_SECOND
+static SGB_ChipStream chipStream;
+
+/**
+ * @brief Chip source for radio, streams current second generation message
+ * 
+ * @param buf buffer to fill
+ * @param len length of buffer
+ * @return uint16_t count of bytes written
+ */
+static uint16_t chipSource(uint8_t *buf, uint16_t len) {
+    return SGB_GetChips(&chipStream, buf, len);
+}
+#endif
 
 void EMC_Init(void) {
     //init spi for radio module
-    SPI_GPIO_Pair miso;
-    miso.bank = GPIOC;
-    miso.pin = GPIO_PIN_2;
-
-    SPI_GPIO_Pair mosi;
-    mosi.bank = GPIOC;
-    mosi.pin = GPIO_PIN_3;
-    
-    SPI_GPIO_Pair slclk;
-    slclk.bank = GPIOB;
-    slclk.pin = GPIO_PIN_10;
-    
-    SPI_GPIO_Pair cs;
-    cs.bank = GPIOC;
-    cs.pin = GPIO_PIN_1;
-    
-    spi.SPI.Instance = SPI2;
-    spi.SPI.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64;
-    spi.SPI.Init.Mode = SPI_MODE_MASTER;
-    spi.SPI.Init.NSS = SPI_NSS_SOFT;
-    spi.SPI.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
-    spi.SPI.Init.CRCPolynomial = 7;
-    spi.SPI.Init.TIMode = SPI_TIMODE_DISABLE;
-    spi.SPI.Init.Direction = SPI_DIRECTION_2LINES;
-    spi.SPI.Init.DataSize = SPI_DATASIZE_8BIT;
-    spi.SPI.Init.FirstBit = SPI_FIRSTBIT_MSB;
-    
-    spi.SPI.Init.CLKPolarity = SPI_POLARITY_LOW;
-    spi.SPI.Init.CLKPhase = SPI_PHASE_1EDGE;
-    
-    spi.CS = cs;
-    spi.MISO = miso;
-    spi.MOSI = mosi;
-    spi.SCLK = slclk;
-    
-    SPI_Init(&spi);
+    SPI_Init(&spi, &BOARD_RadioSpi);
 
     //init radio with spi
     RADIO_Init(&radio, &spi);
+    HOMER_Init(BOARD_HOMER_CONFIG);
+
+    //precompute identification part of frame
+    PLB_Init(&CFG_Get()->plb);
+
+    uint64_t id = PLB_GetBeaconId(&CFG_Get()->plb);
+    jitterState = (uint32_t)(id ^ (id >> 32)) | 1;
 
     memset(&lastPosUpdate, 0, sizeof(POS_Time));
+    POS_BusSubscribe(LOC_GetPositionBus(), &posSub, 0);
+    STORAGE_SetGate(storageGate);
     emergencyState = EMC_State_Idle;
     frameLength = 0;
     lastMsgSent = 0;
@@ -82,34 +150,65 @@ void EMC_Process(void) {
     if (emergencyState == EMC_State_Emergency) {
         //if next message should be sent        
         if (RADIO_GetState(&radio) == RADIO_STATE_IDLE && HAL_GetTick() > lastMsgSent) {
-            POS_Position* locPos = LOC_GetLastPosition();
+            POS_Position locPos;
 
-            if (locPos != 0 && locPos->valid == POS_Valid_Flag_Valid
-                    && POS_CmpTime(&locPos->time, &lastPosUpdate) > 0) {
-                memcpy(&lastPosUpdate, &locPos->time, sizeof(POS_Time));
+            if (POS_BusChanged(LOC_GetPositionBus(), &posSub)
+                    && POS_BusFetch(LOC_GetPositionBus(), &posSub, &locPos) != 0
+                    && locPos.valid == POS_Valid_Flag_Valid
+                    && POS_CmpTime(&locPos.time, &lastPosUpdate) > 0) {
+                memcpy(&lastPosUpdate, &locPos.time, sizeof(POS_Time));
 
                 LOG("[EMC] Found new Position:\n");
-                LOG_POS(locPos);
+                LOG_POS(&locPos);
 
-                frameLength = PLB_CreateFrame(dataFrame, FRAME_SIZE, locPos);
+#if BEACON_GENERATION == GENERATION_SECOND
+                frameLength = SGB_CreateMessage(dataFrame, FRAME_SIZE, &CFG_Get()->sgb, &locPos);
+
+                LOG("[EMC] SGB message with %u bits\n", frameLength);
+#else
+                frameLength = PLB_CreateFrame(dataFrame, FRAME_SIZE, &locPos);
 
                 LOG("[EMC] Frame: \n");
                 LOG_BITARRAY(dataFrame, frameLength);
+#endif
             }
             
             if (frameLength != 0) {
                 LOG("[EMC] Start Frame\n");
 
+#if BEACON_GENERATION == GENERATION_SECOND
+                SGB_StartStream(&chipStream, dataFrame);
+                RADIO_SetChipStream(&radio, chipSource);
+#else
                 RADIO_SetFrame(&radio, dataFrame, frameLength);
-                lastMsgSent = HAL_GetTick() + MSG_INTERVAL;
+#endif
+                lastMsgSent = HAL_GetTick() + nextInterval();
+
+                //receiver sleeps until the fix for the next burst is selected
+                LOC_RequestFix(lastMsgSent);
             }
         }
 
+        scheduleHoming();
+
         //Process radio
         RADIO_Process(&radio);
     }
 }
 
 void EMC_SetEmergency(EMC_State emc) {
+    if (emc == emergencyState) {
+        return;
+    }
+
+    if (emc != EMC_State_Emergency) {
+        //emergency ended: homing off, the next emergency builds its frame from a new position
+        HOMER_Stop();
+        frameLength = 0;
+        memset(&lastPosUpdate, 0, sizeof(POS_Time));
+        posSub.seen = 0;
+        LOC_CancelFix();
+    }
     emergencyState = emc;
+    LBK_LogEvent(emc == EMC_State_Emergency ? LBK_Type_EmergencyStart : LBK_Type_EmergencyStop, 0);
 }
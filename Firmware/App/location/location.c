@@ -13,9 +13,54 @@
 #include "nmea.h"
 #include "ubx.h"
 #include "uart.h"
+#include "board.h"
+#include "rlm.h"
+#include "satellite.h"
+#include "plb.h"
+#include "config.h"
+#include "memory.h"
+#include "record.h"
+#include "thread.h"
 #include <string.h>
 
-#define BUF_LEN 32
+#define BUF_LEN 40    //largest frame: CFG-GNSS with three systems
+
+#define UBX_ID_CFG_MSG  0x01
+#define UBX_ID_CFG_NMEA 0x17
+#define UBX_ID_CFG_GNSS 0x3E
+
+#define CFG_ACK_TIMEOUT 1000    //ms, UBX-ACK of a configuration message
+#define CFG_TRIES       3       //sent at most this often, no answer counts as NAK
+
+//fix quality, the window closes once this many consecutive epochs meet it
+#define FIX_MIN_SATELLITES  6       //satellites used in the solution
+#define FIX_MAX_HDOP        200     //hdop * 100
+#define FIX_MAX_ACCURACY    10000   //mm, estimated horizontal accuracy
+#define FIX_STABLE_EPOCHS   3       //consecutive epochs meeting the quality
+#define FIX_STABLE_DISTANCE 10      //m, maximum movement between stable epochs
+#define FIX_UERE            5       //m, range error for the accuracy estimate from hdop (no NAV-PVT)
+
+#define WINDOW_LEAD   15000     //ms, window opens before the deadline (hot start and stable epochs)
+#define WINDOW_MARGIN 500       //ms, the fix is published before the deadline
+#define WAKE_LEN      4         //bytes sent to wake the receiver from backup (are lost)
+
+#define ACQ_ATTEMPT   60000     //ms without fix before the sky view decides about a backoff
+#define BACKOFF_MIN   30000     //ms, first acquisition pause with poor sky view, doubled each time
+#define BACKOFF_MAX   480000    //ms
+
+//constellation profiles: all systems to acquire fast, GPS only to track with less current
+#define PROFILE_ACQUIRE       (UBX_GNSS_MASK(UBX_GnssId_GPS) | UBX_GNSS_MASK(UBX_GnssId_Galileo) \
+                                | UBX_GNSS_MASK(UBX_GnssId_GLONASS))
+#define PROFILE_TRACK         UBX_GNSS_MASK(UBX_GnssId_GPS)
+#define PROFILE_TRACK_RLM     (UBX_GNSS_MASK(UBX_GnssId_GPS) | UBX_GNSS_MASK(UBX_GnssId_Galileo))
+#define PROFILE_TRACK_EPOCHS  10    //good epochs before switching to the tracking profile
+#define PROFILE_LOST_EPOCHS   5     //epochs without fix before switching back to acquisition
+
+//external positions: the own receiver has priority, errors grow with the age of a position
+#define EXTERNAL_MAX_AGE      600000    //ms, older external positions are ignored
+#define EXTERNAL_MAX_ACCURACY 500000    //mm
+#define INTERNAL_PRIORITY     120000    //ms, own fixes are not replaced by external positions
+#define POSITION_DRIFT        1500      //mm/s, assumed movement of the user (walking)
 
 typedef enum {
     No,
@@ -23,15 +68,122 @@ typedef enum {
     Yes
 } Configured;
 
+/**
+ * @brief Configuration message
+ * 
+ */
+typedef enum {
+    Command_Nmea,       //CFG-NMEA
+    Command_Sfrbx,      //CFG-MSG, raw galileo subframes
+    Command_Pvt,        //CFG-MSG, navigation solution
+    Command_Gnss        //CFG-GNSS, constellation profile
+} Command;
+
+/**
+ * @brief Fix selection window
+ * 
+ */
+typedef enum {
+    Window_Continuous,  //gnss on, every fix is published
+    Window_Sleep,       //gnss in backup mode
+    Window_Open,        //gnss on, best fix is selected until the quality is met or the deadline
+    Window_Backoff      //gnss in backup mode, sky view too poor to acquire a fix
+} Window;
+
+/**
+ * @brief Fix evaluated in the selection window
+ * 
+ */
+typedef struct {
+    POS_Position pos;
+    POS_Quality quality;
+    uint32_t error;     //estimated horizontal error in mm
+} Candidate;
+
 static NMEA_Instance nmea;
 static UBX_Instance ubx;
 static UART_Instance uart;
+static RLM_Instance rlm;
+
+static POS_Bus bus;
+static THREAD_Context cfgThread;    //configuration sequence
+static THREAD_Context cmdThread;    //configuration message until acknowledged
+static Configured cmdState;         //acknowledge of the current configuration message
+static uint8_t cmdTries;
+static uint8_t receiverSeen;        //receiver outputs its default sentences
+static Configured pvtState;
+static uint8_t rlmAck;
 
-static POS_Position position;
-static Configured cfgState;
+static Window window;
+static uint8_t fixPending;          //deadline requested, window not yet closed
+static uint8_t backupPending;       //backup mode requested, sent once the configuration is done
+static uint32_t fixDeadline;        //tick the selected fix is published at the latest
+static uint32_t windowStart;
+static Candidate best;
+static uint8_t bestValid;
+static POS_Position lastFix;        //previous epoch, for the stability check
+static uint8_t stableEpochs;
+static POS_Quality dop;             //satellites and hdop from GSA of the current epoch
+
+static SAT_Table sky;
+static uint32_t acquireStart;       //receiver on without fix since
+static uint32_t backoff;            //next acquisition pause
+static uint32_t backoffEnd;
+static Window resume;               //state after the acquisition pause
+
+static uint8_t profile;             //enabled systems (UBX_GNSS_MASK), 0 until configured
+static uint8_t profileWanted;
+static uint8_t profileSent;
+static uint32_t publishedTick;      //tick of the published fix
+static uint32_t publishedError;     //estimated error of the published fix in mm, UINT32_MAX if none
+static uint32_t internalTick;       //tick of the last own fix
+static uint8_t internalValid;
+
+static uint8_t goodEpochs;          //consecutive epochs with a good fix
+static uint8_t lostEpochs;          //consecutive epochs without fix
 
 static uint8_t buf[BUF_LEN];
 
+MEM_BUFFER("gnss", nmea);
+MEM_BUFFER("gnss", ubx);
+MEM_BUFFER("gnss", uart);
+MEM_BUFFER("gnss", rlm);
+MEM_BUFFER("gnss", buf);
+MEM_BUFFER("gnss", sky);
+
+/**
+ * @brief Configuration sequence of the receiver: NMEA output, raw galileo subframes and navigation
+ * solution once it runs, then constellation profile changes
+ * 
+ * @return THREAD_Status thread status
+ */
+static THREAD_Status configure(void);
+
+/**
+ * @brief Send configuration message until it is acknowledged or rejected, result in cmdState
+ * 
+ * @param msg configuration message
+ * @return THREAD_Status thread status
+ */
+static THREAD_Status command(Command msg);
+
+/**
+ * @brief Create configuration message in buf
+ * 
+ * @param msg configuration message
+ * @param id UBX-CFG id of the message
+ * @return uint16_t length of message, 0 on failure
+ */
+static uint16_t createCommand(Command msg, uint8_t *id);
+
+/**
+ * @brief Retrieve acknowledge name for the log
+ * 
+ * @param state acknowledge
+ * @return const char* name
+ */
+static const char* ackName(Configured state);
+
 /**
  * @brief Callback function for received position
  * 
@@ -39,6 +191,109 @@ static uint8_t buf[BUF_LEN];
  */
 static void positionCallback(POS_Position *pos);
 
+/**
+ * @brief Callback function for fix quality (GSA)
+ * 
+ * @param quality satellites used and hdop
+ */
+static void qualityCallback(POS_Quality *quality);
+
+/**
+ * @brief Callback function for satellites in view (GSV) and used in fix (GSA)
+ * 
+ * @param sv satellites
+ * @param count number of satellites
+ */
+static void satellitesCallback(NMEA_Satellite *sv, uint8_t count);
+
+/**
+ * @brief UBX-NAV-PVT callback function
+ * 
+ * @param msgClass message class
+ * @param id message id
+ * @param data parsed solution
+ */
+static void pvtCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data);
+
+/**
+ * @brief Handle fix of an epoch: publish it or evaluate it in the selection window
+ * 
+ * @param pos position
+ * @param quality quality of the fix
+ */
+static void epoch(POS_Position *pos, POS_Quality *quality);
+
+/**
+ * @brief Open selection window
+ * 
+ * @param wake 1 if the receiver is in backup mode
+ */
+static void openWindow(uint8_t wake);
+
+/**
+ * @brief Publish best candidate, put receiver in backup mode until the next window
+ * 
+ * @param met 1 if the quality was met, 0 if the deadline passed
+ */
+static void closeWindow(uint8_t met);
+
+/**
+ * @brief Pause acquisition, the sky view is too poor for a fix
+ * 
+ * @param now current tick
+ */
+static void startBackoff(uint32_t now);
+
+/**
+ * @brief Select constellation profile from the fix history, applied while the receiver is acquiring
+ * 
+ * @param valid 1 if the epoch has a fix
+ * @param good 1 if the fix meets the quality
+ */
+static void selectProfile(uint8_t valid, uint8_t good);
+
+/**
+ * @brief Retrieve profile name for the log
+ * 
+ * @param mask enabled systems
+ * @return const char* name
+ */
+static const char* profileName(uint8_t mask);
+
+/**
+ * @brief Publish position on the bus
+ * 
+ * @param pos position
+ * @param error estimated horizontal error in mm
+ * @param tick time of the fix
+ */
+static void publish(POS_Position *pos, uint32_t error, uint32_t tick);
+
+/**
+ * @brief Estimated error of a fix grown with its age
+ * 
+ * @param error error at the time of the fix in mm
+ * @param tick time of the fix
+ * @return uint32_t error in mm, UINT32_MAX if unknown
+ */
+static uint32_t agedError(uint32_t error, uint32_t tick);
+
+/**
+ * @brief Convert latitude and longitude to degree and minute
+ * 
+ * @param pos position
+ * @param lat latitude in 1e-7 deg, north positive
+ * @param lon longitude in 1e-7 deg, east positive
+ */
+static void fromDegrees(POS_Position *pos, int32_t lat, int32_t lon);
+
+/**
+ * @brief Put receiver in backup mode, it wakes up on uart activity
+ * (deferred while a configuration message awaits its acknowledge, it would wake the receiver up and get lost)
+ * 
+ */
+static void powerDown(void);
+
 /**
  * @brief callback function for other nmea messages
  * 
@@ -57,90 +312,514 @@ static void unknownCallback(NMEA_Type type, uint8_t* data, uint16_t len);
  */
 static void ackCallback(UBX_Class msgClass, uint8_t id, UBX_Id_Ack ack);
 
+/**
+ * @brief UBX-RXM-SFRBX callback function, forwards galileo pages to rlm decoder
+ * 
+ * @param msgClass message class
+ * @param id message id
+ * @param data parsed subframe
+ */
+static void sfrbxCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data);
+
+/**
+ * @brief Callback for return link messages addressed to this beacon
+ * 
+ * @param code message code
+ * @param param message parameters
+ */
+static void rlmCallback(RLM_Code code, uint16_t param);
+
 void LOC_Init() {
-    position.valid = POS_Valid_Flag_Invalid;
-    cfgState = No;
+    POS_BusInit(&bus);
+    cmdState = No;
+    receiverSeen = 0;
+    pvtState = No;
+    rlmAck = 0;
+    window = Window_Continuous;
+    fixPending = 0;
+    backupPending = 0;
+    bestValid = 0;
+    stableEpochs = 0;
+    memset(&dop, 0, sizeof(POS_Quality));
+    SAT_Init(&sky);
+    acquireStart = 0;
+    backoff = BACKOFF_MIN;
+    profile = 0;
+    profileWanted = PROFILE_ACQUIRE;
+    publishedError = UINT32_MAX;
+    internalValid = 0;
+    goodEpochs = 0;
+    lostEpochs = 0;
 
     //configure uart
-    UART_Config uart_conf;
-    
-    uart_conf.uart = USART4;
-    uart_conf.baud = UART_BaudRate_9600;
-    uart_conf.rxDmaChannel = DMA1_Channel6;
-    uart_conf.rxBoard = GPIOC;
-    uart_conf.rxPin = GPIO_PIN_11;
-    uart_conf.rxAF = GPIO_AF6_USART4;
-    uart_conf.txDmaChannel = DMA1_Channel7;
-    uart_conf.txBoard = GPIOC;
-    uart_conf.txPin = GPIO_PIN_10;
-    uart_conf.txAF = GPIO_AF6_USART4;
-    
-    UART_Init(&uart, &uart_conf);
+    UART_Init(&uart, &BOARD_GnssUart);
 
     //configure nmea interface
     NMEA_Init(&nmea);
     NMEA_SetPositionCallback(&nmea, positionCallback);
+    NMEA_SetQualityCallback(&nmea, qualityCallback);
+    NMEA_SetSatellitesCallback(&nmea, satellitesCallback);
     NMEA_SetUnknownCallback(&nmea, unknownCallback);
 
     //configure ubx interface
     UBX_Init(&ubx);
-    UBX_SetAckCallback(&ubx, ackCallback, UBX_Class_CFG, 0x17);
+    UBX_SetCallback(&ubx, sfrbxCallback, UBX_Class_RXM, UBX_Id_Rxm_Sfrbx);
+    UBX_SetCallback(&ubx, pvtCallback, UBX_Class_NAV, UBX_Id_Nav_Pvt);
+
+    //configure return link decoder
+    RLM_Init(&rlm, PLB_GetBeaconId(&CFG_Get()->plb), rlmCallback);
+
+    //configuration runs in LOC_Process
+    THREAD_INIT(&cfgThread);
 }
 
 void LOC_Process() {
     while (UART_GetAvailableBytes(&uart) > 0) {
         uint8_t byte = UART_GetByte(&uart);
+        REC_BYTE(REC_Source_Gnss, byte);
         NMEA_Process(&nmea, byte);
         UBX_Process(&ubx, byte);
     }
+
+    if (backupPending != 0 && cmdState != InProgress) {
+        uint16_t cnt = UBX_CreatePowerDownFrame(&ubx, buf, BUF_LEN, 0);
+        UART_SendData(&uart, cnt, buf);
+        backupPending = 0;
+    }
+
+    uint32_t now = HAL_GetTick();
+    if (window == Window_Sleep && fixPending != 0 && (int32_t)(now - (fixDeadline - WINDOW_LEAD)) >= 0) {
+        openWindow(1);
+    } else if (window == Window_Open && bestValid != 0 && (int32_t)(now - fixDeadline) >= 0) {
+        closeWindow(0);
+    } else if (window == Window_Backoff && (int32_t)(now - backoffEnd) >= 0) {
+        if (resume == Window_Open) {
+            openWindow(1);
+        } else {
+            memset(buf, 0xFF, WAKE_LEN);
+            UART_SendData(&uart, WAKE_LEN, buf);
+            window = Window_Continuous;
+        }
+        acquireStart = now;
+    }
+
+    configure();
+
+    //no fix for a while: keep searching only if the sky view promises one
+    if ((window == Window_Continuous || window == Window_Open) && (int32_t)(now - acquireStart) >= ACQ_ATTEMPT) {
+        SAT_Sky view = SAT_GetPrediction(&sky)->sky;
+        if (view == SAT_Sky_Unknown || view == SAT_Sky_Blocked
+                || (view == SAT_Sky_Weak && (int32_t)(now - acquireStart) >= 2 * ACQ_ATTEMPT)) {
+            startBackoff(now);
+        }
+    }
+}
+
+void LOC_RequestFix(uint32_t deadline) {
+    fixDeadline = deadline - WINDOW_MARGIN;
+    fixPending = 1;
+
+    //an open window keeps searching with the new deadline, so does a receiver without own fix
+    //(an external position was published, backup mode would discard the acquisition)
+    if (window == Window_Continuous) {
+        if (internalValid != 0 && (int32_t)(fixDeadline - WINDOW_LEAD - HAL_GetTick()) > 0) {
+            powerDown();
+            window = Window_Sleep;
+        } else {
+            openWindow(0);
+        }
+    } else if (window == Window_Backoff) {
+        resume = Window_Open;
+    }
+}
+
+void LOC_CancelFix() {
+    if (backupPending != 0) {
+        backupPending = 0;
+    } else if (window == Window_Sleep || window == Window_Backoff) {
+        //wake receiver, hot start
+        memset(buf, 0xFF, WAKE_LEN);
+        UART_SendData(&uart, WAKE_LEN, buf);
+    }
+    window = Window_Continuous;
+    fixPending = 0;
+    acquireStart = HAL_GetTick();
+}
+
+SAT_Table* LOC_GetSatellites() {
+    return &sky;
 }
 
 uint8_t LOC_PositionAvailable() {
-    return position.valid;
+    POS_Position pos;
+    return POS_BusRead(&bus, &pos) != 0 && pos.valid == POS_Valid_Flag_Valid;
+}
+
+POS_Bus* LOC_GetPositionBus() {
+    return &bus;
+}
+
+NMEA_Instance* LOC_GetNmea() {
+    return &nmea;
 }
 
-POS_Position* LOC_GetLastPosition() {
-    return &position;
+uint8_t LOC_ReturnLinkAcknowledged() {
+    return rlmAck;
+}
+
+uint8_t LOC_ExternalPosition(int32_t lat, int32_t lon, POS_Time *time, uint32_t accuracy, uint32_t age) {
+    uint32_t now = HAL_GetTick();
+
+    if (time == 0 || age > EXTERNAL_MAX_AGE || accuracy > EXTERNAL_MAX_ACCURACY
+            || (internalValid != 0 && now - internalTick < INTERNAL_PRIORITY)) {
+        return 0;
+    }
+
+    uint32_t tick = now - age;
+    if (agedError(accuracy, tick) >= agedError(publishedError, publishedTick)) {
+        return 0;
+    }
+
+    POS_Position pos;
+    pos.time = *time;
+    fromDegrees(&pos, lat, lon);
+    pos.valid = POS_Valid_Flag_Valid;
+    pos.source = POS_Source_Flag_External;
+    publish(&pos, accuracy, tick);
+    LOG("\n[LOC] External position published: %lu mm, %lu ms old\n", accuracy, age);
+    return 1;
 }
 
 void LOC_InjectPosition(POS_Position* pos) {
     if (pos != 0) {
-        memcpy(&position, pos, sizeof(POS_Position));
+        POS_BusPublish(&bus, pos);
         LOG("\n[LOC] Position injected\n");
     }
 }
 
 static void positionCallback(POS_Position *pos) {
-    if (pos != 0 && pos->valid != 0) {
-        memcpy(&position, pos, sizeof(POS_Position));
+    //NAV-PVT replaces GLL once enabled, it carries the accuracy estimate
+    if (pos != 0 && pvtState != Yes) {
+        POS_Quality quality = dop;
+        memset(&dop, 0, sizeof(POS_Quality));
+        epoch(pos, &quality);
     }
 }
 
-static void unknownCallback(NMEA_Type type, uint8_t* data, uint16_t len) {
-    if (cfgState == No) {
-        LOG("\n[LOC] Configure NMEA\n");
-        cfgState = InProgress;
+static void qualityCallback(POS_Quality *quality) {
+    //one GSA per constellation, satellites add up
+    dop.satellites += quality->satellites;
+    dop.hdop = quality->hdop;
+}
 
-        //configure gps module 
-        uint16_t cnt = UBX_CreateNMEAConfigFrame(&ubx, buf, BUF_LEN);
-        UART_SendData(&uart, cnt, buf);
+static void satellitesCallback(NMEA_Satellite *sv, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (sv[i].used != 0) {
+            SAT_MarkUsed(&sky, sv[i].prn);
+        } else {
+            SAT_Report(&sky, sv[i].prn, sv[i].elevation, sv[i].cn0);
+        }
     }
 }
 
+static void pvtCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data) {
+    UBX_NavPvt *pvt = data.pvt;
+    POS_Position pos;
+    POS_Quality quality;
+
+    pos.time.hour = pvt->hour;
+    pos.time.minute = pvt->minute;
+    pos.time.second = pvt->second;
+    pos.time.split = 0;
+
+    fromDegrees(&pos, pvt->lat, pvt->lon);
+
+    pos.valid = (pvt->flags & 0x01) != 0 && pvt->fixType >= 2 ? POS_Valid_Flag_Valid : POS_Valid_Flag_Invalid;
+    pos.source = POS_Source_Flag_Internal;
+
+    quality.satellites = pvt->numSV;
+    quality.hdop = dop.hdop;
+    quality.accuracy = pvt->hAcc;
+    memset(&dop, 0, sizeof(POS_Quality));
+
+    if (pvtState == Yes) {
+        epoch(&pos, &quality);
+    }
+}
+
+static void epoch(POS_Position *pos, POS_Quality *quality) {
+    SAT_EndEpoch(&sky);
+
+    if (pos->valid != POS_Valid_Flag_Valid) {
+        stableEpochs = 0;
+        selectProfile(0, 0);
+        return;
+    }
+    acquireStart = HAL_GetTick();
+    backoff = BACKOFF_MIN;
+
+    //estimate error from hdop if the receiver gives no accuracy
+    uint32_t error = quality->accuracy;
+    if (error == 0) {
+        error = quality->hdop != 0 ? (uint32_t)quality->hdop * FIX_UERE * 10 : UINT32_MAX;
+    }
+
+    uint8_t good = quality->satellites >= FIX_MIN_SATELLITES && quality->hdop <= FIX_MAX_HDOP
+            && error <= FIX_MAX_ACCURACY;
+    selectProfile(1, good);
+
+    internalTick = HAL_GetTick();
+    internalValid = 1;
+
+    if (window == Window_Continuous) {
+        publish(pos, error, internalTick);
+        return;
+    }
+    if (window != Window_Open) {
+        return;
+    }
+
+    if (good && stableEpochs > 0 && POS_Distance(pos, &lastFix) <= FIX_STABLE_DISTANCE) {
+        stableEpochs++;
+    } else {
+        stableEpochs = good;
+    }
+    memcpy(&lastFix, pos, sizeof(POS_Position));
+
+    if (bestValid == 0 || error < best.error) {
+        memcpy(&best.pos, pos, sizeof(POS_Position));
+        best.quality = *quality;
+        best.error = error;
+        bestValid = 1;
+    }
+
+    if (stableEpochs >= FIX_STABLE_EPOCHS) {
+        closeWindow(1);
+    }
+}
+
+static void openWindow(uint8_t wake) {
+    if (backupPending != 0) {
+        //receiver did not go to sleep
+        backupPending = 0;
+    } else if (wake != 0) {
+        //receiver wakes on uart activity, hot start
+        memset(buf, 0xFF, WAKE_LEN);
+        UART_SendData(&uart, WAKE_LEN, buf);
+    }
+    bestValid = 0;
+    stableEpochs = 0;
+    windowStart = HAL_GetTick();
+    acquireStart = windowStart;
+    window = Window_Open;
+}
+
+static void closeWindow(uint8_t met) {
+    publish(&best.pos, best.error, HAL_GetTick());
+    LOG("\n[LOC] Fix selected after %lu ms (%s): %u satellites, hdop %u, %lu mm\n",
+            HAL_GetTick() - windowStart, met ? "quality met" : "deadline", best.quality.satellites,
+            best.quality.hdop, best.error);
+
+    //quality missed: acquire with all systems in the next window
+    if (met == 0) {
+        profileWanted = PROFILE_ACQUIRE;
+        goodEpochs = 0;
+    }
+
+    powerDown();
+    window = Window_Sleep;
+    fixPending = 0;
+}
+
+static void startBackoff(uint32_t now) {
+    SAT_Prediction *p = SAT_GetPrediction(&sky);
+    LOG("\n[LOC] Sky view %s (%u visible, %u decodable): acquisition paused for %lu s\n",
+            SAT_GetSkyName(p->sky), p->visible, p->decodable, backoff / 1000);
+
+    profileWanted = PROFILE_ACQUIRE;
+    goodEpochs = 0;
+    powerDown();
+    resume = window;
+    window = Window_Backoff;
+    backoffEnd = now + backoff;
+    backoff = backoff * 2 < BACKOFF_MAX ? backoff * 2 : BACKOFF_MAX;
+}
+
+static void selectProfile(uint8_t valid, uint8_t good) {
+    //the epochs of a hot start have no fix yet, they do not count as lost fix
+    if (valid == 0) {
+        lostEpochs += lostEpochs < PROFILE_LOST_EPOCHS;
+    } else {
+        lostEpochs = 0;
+        goodEpochs = good ? goodEpochs + (goodEpochs < PROFILE_TRACK_EPOCHS) : 0;
+    }
+
+    if (lostEpochs >= PROFILE_LOST_EPOCHS) {
+        profileWanted = PROFILE_ACQUIRE;
+        goodEpochs = 0;
+    } else if (goodEpochs >= PROFILE_TRACK_EPOCHS) {
+        //galileo carries the return link, keep it until the acknowledgement is received
+        profileWanted = rlmAck != 0 ? PROFILE_TRACK : PROFILE_TRACK_RLM;
+    }
+}
+
+static const char* profileName(uint8_t mask) {
+    switch (mask) {
+        case PROFILE_ACQUIRE:
+            return "acquire (GPS, Galileo, GLONASS)";
+        case PROFILE_TRACK:
+            return "track (GPS)";
+        case PROFILE_TRACK_RLM:
+            return "track (GPS, Galileo)";
+        default:
+            return "unknown";
+    }
+}
+
+static void publish(POS_Position *pos, uint32_t error, uint32_t tick) {
+    POS_BusPublish(&bus, pos);
+    publishedTick = tick;
+    publishedError = error;
+}
+
+static uint32_t agedError(uint32_t error, uint32_t tick) {
+    if (error == UINT32_MAX) {
+        return UINT32_MAX;
+    }
+    uint32_t drift = (HAL_GetTick() - tick) / 1000 * POSITION_DRIFT;
+    return error + drift >= error ? error + drift : UINT32_MAX;
+}
+
+static void fromDegrees(POS_Position *pos, int32_t lat, int32_t lon) {
+    //1e-7 deg to degree and minute
+    pos->latitude.direction = lat < 0 ? POS_Latitude_Flag_S : POS_Latitude_Flag_N;
+    lat = lat < 0 ? -lat : lat;
+    pos->latitude.degree = lat / 10000000;
+    pos->latitude.minute = (lat % 10000000) * 6e-6f;
+
+    pos->longitude.direction = lon < 0 ? POS_Longitude_Flag_W : POS_Longitude_Flag_E;
+    lon = lon < 0 ? -lon : lon;
+    pos->longitude.degree = lon / 10000000;
+    pos->longitude.minute = (lon % 10000000) * 6e-6f;
+}
+
+static void powerDown(void) {
+    backupPending = 1;
+}
+
+static void unknownCallback(NMEA_Type type, uint8_t* data, uint16_t len) {
+    receiverSeen = 1;
+}
+
 static void ackCallback(UBX_Class msgClass, uint8_t id, UBX_Id_Ack ack) {
-    switch (msgClass) {
-        case UBX_Class_CFG:
-            if (id == 0x17) {
-                if (ack == UBX_Id_Ack_Ack) {
-                    cfgState = Yes;
-                    LOG("\n[LOC] NMEA config ACK\n");
-                } else {
-                    LOG("\n[LOC] NMEA config NAK\n");
-                }
-                
-            }
+    if (cmdState == InProgress) {
+        cmdState = ack == UBX_Id_Ack_Ack ? Yes : No;
+    }
+}
+
+static THREAD_Status configure(void) {
+    THREAD_Context *t = &cfgThread;
+
+    THREAD_BEGIN(t);
+
+    THREAD_WAIT_UNTIL(t, receiverSeen != 0);
+    LOG("\n[LOC] Configure NMEA\n");
+    THREAD_SPAWN(t, &cmdThread, command(Command_Nmea));
+    LOG("\n[LOC] NMEA config %s\n", ackName(cmdState));
+    if (cmdState != Yes) {
+        //start over with the next default sentence
+        receiverSeen = 0;
+        THREAD_RESTART(t);
+    }
+
+    //enable raw subframe output for return link messages
+    THREAD_SPAWN(t, &cmdThread, command(Command_Sfrbx));
+    LOG("\n[LOC] SFRBX config %s\n", ackName(cmdState));
+
+    //enable navigation solution with accuracy estimate
+    pvtState = InProgress;
+    THREAD_SPAWN(t, &cmdThread, command(Command_Pvt));
+    pvtState = cmdState;
+    LOG("\n[LOC] NAV-PVT config %s\n", ackName(cmdState));
+
+    //switch constellations, an open window only until the first candidate (the receiver restarts acquisition)
+    while (1) {
+        THREAD_WAIT_UNTIL(t, profileWanted != profile && backupPending == 0
+                && (window == Window_Continuous || (window == Window_Open && bestValid == 0)));
+        profileSent = profileWanted;
+        THREAD_SPAWN(t, &cmdThread, command(Command_Gnss));
+        LOG("\n[LOC] GNSS profile %s %s\n", profileName(profileSent), ackName(cmdState));
+        if (cmdState != Yes) {
+            //a receiver rejecting CFG-GNSS keeps its default systems
+            THREAD_EXIT(t);
+        }
+        profile = profileSent;
+    }
+
+    THREAD_END(t);
+}
+
+static THREAD_Status command(Command msg) {
+    THREAD_Context *t = &cmdThread;
+    uint8_t id;
+    uint16_t cnt;
+
+    THREAD_BEGIN(t);
+
+    for (cmdTries = 0; cmdTries < CFG_TRIES; cmdTries++) {
+        cnt = createCommand(msg, &id);
+        if (cnt == 0) {
             break;
+        }
+
+        //acknowledge callbacks are single shot
+        cmdState = InProgress;
+        UBX_SetAckCallback(&ubx, ackCallback, UBX_Class_CFG, id);
+        UART_SendData(&uart, cnt, buf);
+        THREAD_WAIT_UNTIL_TIMEOUT(t, cmdState != InProgress, CFG_ACK_TIMEOUT);
+        if (cmdState != InProgress) {
+            THREAD_EXIT(t);
+        }
+    }
+    cmdState = No;
+
+    THREAD_END(t);
+}
+
+static uint16_t createCommand(Command msg, uint8_t *id) {
+    switch (msg) {
+        case Command_Nmea:
+            *id = UBX_ID_CFG_NMEA;
+            return UBX_CreateNMEAConfigFrame(&ubx, buf, BUF_LEN);
+        case Command_Sfrbx:
+            *id = UBX_ID_CFG_MSG;
+            return UBX_CreateMsgRateFrame(&ubx, buf, BUF_LEN, UBX_Class_RXM, UBX_Id_Rxm_Sfrbx, 1);
+        case Command_Pvt:
+            *id = UBX_ID_CFG_MSG;
+            return UBX_CreateMsgRateFrame(&ubx, buf, BUF_LEN, UBX_Class_NAV, UBX_Id_Nav_Pvt, 1);
+        case Command_Gnss:
+            *id = UBX_ID_CFG_GNSS;
+            return UBX_CreateGnssConfigFrame(&ubx, buf, BUF_LEN, profileSent);
         default:
-            break;
+            return 0;
+    }
+}
+
+static const char* ackName(Configured state) {
+    return state == Yes ? "ACK" : "NAK";
+}
+
+static void sfrbxCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data) {
+    if (data.sfrbx != 0 && data.sfrbx->gnssId == UBX_GnssId_Galileo) {
+        RLM_ProcessPage(&rlm, data.sfrbx->svId, data.sfrbx->words, data.sfrbx->numWords, HAL_GetTick());
+    }
+}
+
+static void rlmCallback(RLM_Code code, uint16_t param) {
+    if (code == RLM_Code_Ack) {
+        if (rlmAck == 0) {
+            LOG("\n[LOC] Return link acknowledgement received\n");
+        }
+        rlmAck = 1;
     }
 }
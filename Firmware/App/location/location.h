@@ -13,6 +13,9 @@
 #define LOCATION_H
 
 #include "position.h"
+#include "posbus.h"
+#include "nmea.h"
+#include "satellite.h"
 
 /**
  * @brief Location initialization
@@ -34,11 +37,60 @@ void LOC_Process();
 uint8_t LOC_PositionAvailable();
 
 /**
- * @brief Retrieve last position
+ * @brief Retrieve bus of the last position, consumers read snapshots or subscribe
  * 
- * @return POS_Position* Pointer to last position
+ * @return POS_Bus* position bus
  */
-POS_Position* LOC_GetLastPosition();
+POS_Bus* LOC_GetPositionBus();
+
+/**
+ * @brief Retrieve nmea parser (sentence counters)
+ * 
+ * @return NMEA_Instance* nmea parser
+ */
+NMEA_Instance* LOC_GetNmea();
+
+/**
+ * @brief Retrieve satellite table and time to fix prediction
+ * 
+ * @return SAT_Table* satellite table
+ */
+SAT_Table* LOC_GetSatellites();
+
+/**
+ * @brief Returns if an acknowledgement was received over the galileo return link
+ * 
+ * @return uint8_t '1' when acknowledged, '0' otherwise
+ */
+uint8_t LOC_ReturnLinkAcknowledged();
+
+/**
+ * @brief Request a fix for a deadline: the receiver sleeps until the selection window opens,
+ * the best fix of the window is published once its quality is met or before the deadline,
+ * then the receiver sleeps again
+ * 
+ * @param deadline tick (ms) the position is needed at
+ */
+void LOC_RequestFix(uint32_t deadline);
+
+/**
+ * @brief End fix requests, the receiver stays on and every fix is published
+ * 
+ */
+void LOC_CancelFix();
+
+/**
+ * @brief Offer position of an external source (phone), published while the own receiver has no
+ * recent fix and the aged external position is more accurate than the last published one
+ * 
+ * @param lat latitude in 1e-7 deg, north positive
+ * @param lon longitude in 1e-7 deg, east positive
+ * @param time utc time of the fix
+ * @param accuracy horizontal accuracy in mm
+ * @param age age of the fix in ms
+ * @return uint8_t '1' if published, '0' if ignored
+ */
+uint8_t LOC_ExternalPosition(int32_t lat, int32_t lon, POS_Time *time, uint32_t accuracy, uint32_t age);
 
 /**
  * @brief Allows injecting a position (mainly for test purposes)
@@ -16,7 +16,14 @@
 #include "ui.h"
 #include "emergencyCall.h"
 #include "location.h"
+#include "communication.h"
+#include "config.h"
+#include "logbook.h"
+#include "storage.h"
 #include "sysclock_driver.h"
+#include "trace.h"
+#include "record.h"
+#include "memory.h"
 
 /* Private variables ---------------------------------------------------------*/
 
@@ -32,20 +39,44 @@
 
 int main(void)
 {
+	MEM_PaintStack();
 	HAL_Init();
 	SystemClock_Config();
 	LOG_Init();
+	TRACE_Init();
+	REC_Init();
 	
 	HAL_Delay(1000);
 	
+	CFG_Init();
+	COM_Init();
 	LOC_Init();
 	EMC_Init();
+	LBK_Init();
   	UI_Init();
+	MEM_LogReport();
 
 	while (1) {
+		TRACE_BEGIN(TRACE_Event_Loc, 0);
 		LOC_Process();
+		TRACE_END(TRACE_Event_Loc, 0);
+
+		TRACE_BEGIN(TRACE_Event_Emc, 0);
 		EMC_Process();
+		TRACE_END(TRACE_Event_Emc, 0);
+
+		TRACE_BEGIN(TRACE_Event_Com, 0);
+		COM_Process();
+		TRACE_END(TRACE_Event_Com, 0);
+
+		LBK_Process();
+		STORAGE_Process();
+
+		TRACE_BEGIN(TRACE_Event_Ui, 0);
 	 	UI_Update();
+		TRACE_END(TRACE_Event_Ui, 0);
+
+		MEM_Check();
 	}
 }
 
@@ -59,6 +59,13 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* start address for the initialization values of the .RamFunc section
+(functions executed from RAM). defined in linker script */
+.word  _siramfunc
+/* start address for the .RamFunc section. defined in linker script */
+.word  _sramfunc
+/* end address for the .RamFunc section. defined in linker script */
+.word  _eramfunc
 
     .section  .text.Reset_Handler
   .weak  Reset_Handler
@@ -67,6 +74,22 @@ Reset_Handler:
    ldr   r0, =_estack
    mov   sp, r0          /* set stack pointer */
 
+/* Copy the functions executed from RAM from flash to SRAM */
+  ldr  r0, =_sramfunc
+  ldr  r1, =_eramfunc
+  ldr  r2, =_siramfunc
+  b  LoopCopyRamFunc
+
+CopyRamFunc:
+  ldr  r3, [r2]
+  str  r3, [r0]
+  adds  r0, r0, #4
+  adds  r2, r2, #4
+
+LoopCopyRamFunc:
+  cmp  r0, r1
+  bcc  CopyRamFunc
+
 /* Copy the data segment initializers from flash to SRAM */
   movs  r1, #0
   b  LoopCopyDataInit
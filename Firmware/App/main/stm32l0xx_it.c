@@ -33,6 +33,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32l0xx_hal.h"
 #include "stm32l0xx.h"
+#include "trace.h"
+#include "memory.h"
 
 /* USER CODE BEGIN 0 */
 
@@ -63,7 +65,9 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  //keep trace for readout after reset (.noinit), restart beacon
+  TRACE_Crash();
+  NVIC_SystemReset();
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -104,9 +108,10 @@ void PendSV_Handler(void)
 /**
 * @brief This function handles System tick timer.
 */
-void SysTick_Handler(void)
+MEM_RAMFUNC void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
+  TRACE_TICK();
 
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
@@ -0,0 +1,355 @@
+/**
+ * @file config.c
+ * @author Paul Götzinger
+ * @brief Beacon configuration store (data eeprom)
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#include "config.h"
+#include "eeprom.h"
+#include "logbook.h"
+#include "storage.h"
+#include <string.h>
+#include <stddef.h>
+
+#define CFG_EEPROM_OFFSET 0     //offset of configuration in data eeprom
+#define BANK_COUNT        2     //banks are written alternately
+#define BANK_SIZE         64
+#define HEADER_SIZE       8
+#define RECORD_HEADER     2     //key, length
+
+#define POS_MAGIC         0
+#define POS_VERSION       2
+#define POS_LENGTH        3
+#define POS_SEQUENCE      4
+#define POS_CRC           6
+
+#define MAGIC             0xC5F1
+#define CRC16_INIT        0xFFFF
+#define CRC16_POLY        0x1021
+
+#define US_PER_S          1000000
+
+#define ENTRY(KEY, NAME, MEMBER, BITS, DEF) \
+    { KEY, NAME, BITS, offsetof(CFG_Config, MEMBER), sizeof(((CFG_Config*)0)->MEMBER), DEF }
+
+/**
+ * @brief Default configuration (flash), used for entries not stored in eeprom
+ * 
+ */
+static const CFG_Entry entries[] = {
+    ENTRY(CFG_Key_ProtocolFlag,  "protocol",      plb.protocolFlag,  1,  0b1),
+    ENTRY(CFG_Key_CountryCode,   "country",       plb.countryCode,   10, 0b0011001011), //Austria 203
+    ENTRY(CFG_Key_TestProtocol,  "test_protocol", plb.testProtocol,  3,  0b111),
+    ENTRY(CFG_Key_BeaconType,    "type",          plb.beaconType,    3,  0b110), //plb
+    ENTRY(CFG_Key_Certif,        "certif",        plb.certif,        1,  0b1),
+    ENTRY(CFG_Key_SerialNumber,  "serial",        plb.serialNumber,  20, 0b11010000111011100101),
+    ENTRY(CFG_Key_NationalUse,   "national_use",  plb.nationalUse,   10, 0b0000000000),
+    ENTRY(CFG_Key_CertifNumber,  "certif_number", plb.certifNumber,  10, 0b1111111111),
+    ENTRY(CFG_Key_Radiolocating, "radiolocating", plb.radiolocating, 2,  0b01), //121,5MHz
+    ENTRY(CFG_Key_SgbTacNumber,  "sgb_tac",       sgb.tacNumber,     16, 0b1111111111111111),
+    ENTRY(CFG_Key_SgbSerialNumber, "sgb_serial",  sgb.serialNumber,  14, 0b11010000111011),
+    ENTRY(CFG_Key_SgbCountryCode, "sgb_country",  sgb.countryCode,   10, 0b0011001011), //Austria 203
+    ENTRY(CFG_Key_SgbHoming,     "sgb_homing",    sgb.homing,        1,  0b1), //121,5MHz
+    ENTRY(CFG_Key_SgbRls,        "sgb_rls",       sgb.rls,           1,  0b0)
+};
+
+#define ENTRY_COUNT (sizeof(entries) / sizeof(entries[0]))
+
+static CFG_Config config;
+static CFG_Config pending;
+static uint8_t activeBank;
+static uint16_t sequence;
+static uint8_t savingBank;          //bank and sequence of the queued save
+static uint16_t savingSeq;
+static uint32_t loadTime;
+
+/**
+ * @brief Load configuration from newest valid bank
+ * 
+ * @param cfg configuration to fill, has to contain defaults
+ */
+static void load(CFG_Config *cfg);
+
+/**
+ * @brief Read and validate bank
+ * 
+ * @param bank bank index
+ * @param data buffer for bank content (BANK_SIZE)
+ * @return uint8_t '1' if bank is valid
+ */
+static uint8_t readBank(uint8_t bank, uint8_t *data);
+
+/**
+ * @brief Bank written by the storage writer, it becomes the active one
+ * 
+ * @param ctx unused
+ * @param status result of write
+ */
+static void saved(void *ctx, HAL_StatusTypeDef status);
+
+/**
+ * @brief Write value of entry into configuration
+ * 
+ * @param cfg configuration
+ * @param entry configuration entry
+ * @param value value
+ */
+static void setValue(CFG_Config *cfg, const CFG_Entry *entry, uint32_t value);
+
+/**
+ * @brief Calculate crc16 (CCITT)
+ * 
+ * @param data data
+ * @param len length of data
+ * @param crc initial value
+ * @return uint16_t crc
+ */
+static uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc);
+
+/**
+ * @brief Retrieve cpu cycles since start (SysTick based)
+ * 
+ * @return uint32_t cycles
+ */
+static uint32_t getCycles(void);
+
+void CFG_Init(void) {
+    uint32_t start = getCycles();
+
+    for (uint8_t i = 0; i < ENTRY_COUNT; i++) {
+        setValue(&config, &entries[i], entries[i].def);
+    }
+    load(&config);
+    memcpy(&pending, &config, sizeof(CFG_Config));
+
+    uint32_t cycles = getCycles() - start;
+    loadTime = (uint32_t)((uint64_t)cycles * US_PER_S / SystemCoreClock);
+
+    LOG("[CFG] Loaded from bank %u (seq %u) in %lu us\n", activeBank, sequence, loadTime);
+}
+
+const CFG_Config* CFG_Get(void) {
+    return &config;
+}
+
+const CFG_Config* CFG_GetPending(void) {
+    return &pending;
+}
+
+uint32_t CFG_GetLoadTime(void) {
+    return loadTime;
+}
+
+uint8_t CFG_GetEntryCount(void) {
+    return ENTRY_COUNT;
+}
+
+const CFG_Entry* CFG_GetEntry(uint8_t idx) {
+    return idx < ENTRY_COUNT ? &entries[idx] : 0;
+}
+
+const CFG_Entry* CFG_FindEntry(const char *name) {
+    if (name != 0) {
+        for (uint8_t i = 0; i < ENTRY_COUNT; i++) {
+            if (strcmp(entries[i].name, name) == 0) {
+                return &entries[i];
+            }
+        }
+    }
+    return 0;
+}
+
+uint32_t CFG_GetValue(const CFG_Config *cfg, const CFG_Entry *entry) {
+    if (cfg == 0 || entry == 0) {
+        return 0;
+    }
+
+    const uint8_t *member = (const uint8_t*)cfg + entry->offset;
+    switch (entry->size) {
+        case sizeof(uint8_t):
+            return *member;
+        case sizeof(uint16_t):
+            return *(const uint16_t*)member;
+        case sizeof(uint32_t):
+            return *(const uint32_t*)member;
+        default:
+            return 0;
+    }
+}
+
+uint8_t CFG_Set(const CFG_Entry *entry, uint32_t value) {
+    if (entry == 0 || (entry->bits < 32 && (value >> entry->bits) != 0)) {
+        return 0;
+    }
+
+    setValue(&pending, entry, value);
+    return 1;
+}
+
+void CFG_SetDefaults(void) {
+    for (uint8_t i = 0; i < ENTRY_COUNT; i++) {
+        setValue(&pending, &entries[i], entries[i].def);
+    }
+}
+
+HAL_StatusTypeDef CFG_Save(void) {
+    uint8_t data[BANK_SIZE];
+    uint8_t len = HEADER_SIZE;
+
+    //only values differing from defaults are stored
+    for (uint8_t i = 0; i < ENTRY_COUNT; i++) {
+        uint32_t value = CFG_GetValue(&pending, &entries[i]);
+        if (value != entries[i].def) {
+            uint8_t size = (entries[i].bits + 7) / 8;
+            data[len++] = entries[i].key;
+            data[len++] = size;
+            for (uint8_t j = 0; j < size; j++) {
+                data[len++] = value >> (j * 8);
+            }
+        }
+    }
+
+    //write to other bank, the active bank stays valid until the new one is complete
+    uint8_t bank = (activeBank + 1) % BANK_COUNT;
+    uint16_t seq = sequence + 1;
+    data[POS_MAGIC] = MAGIC & 0xFF;
+    data[POS_MAGIC + 1] = MAGIC >> 8;
+    data[POS_VERSION] = CFG_VERSION;
+    data[POS_LENGTH] = len - HEADER_SIZE;
+    data[POS_SEQUENCE] = seq & 0xFF;
+    data[POS_SEQUENCE + 1] = seq >> 8;
+    uint16_t crc = crc16(data, POS_CRC, CRC16_INIT);
+    crc = crc16(data + HEADER_SIZE, len - HEADER_SIZE, crc);
+    data[POS_CRC] = crc & 0xFF;
+    data[POS_CRC + 1] = crc >> 8;
+
+    //a second save before the first one is written goes to the same bank with the same sequence
+    HAL_StatusTypeDef status = STORAGE_Write(CFG_EEPROM_OFFSET + bank * BANK_SIZE, data, len,
+            STORAGE_Flag_None, saved, 0);
+    if (status == HAL_OK) {
+        savingBank = bank;
+        savingSeq = seq;
+    } else {
+        LOG("[CFG] Save failed\n");
+    }
+    return status;
+}
+
+static void saved(void *ctx, HAL_StatusTypeDef status) {
+    if (status == HAL_OK) {
+        activeBank = savingBank;
+        sequence = savingSeq;
+        LOG("[CFG] Saved to bank %u (seq %u)\n", savingBank, savingSeq);
+        LBK_LogEvent(LBK_Type_ConfigSaved, savingBank);
+    } else {
+        LOG("[CFG] Save failed\n");
+    }
+}
+
+static void load(CFG_Config *cfg) {
+    uint8_t data[BANK_SIZE];
+    int8_t bank = -1;
+
+    //search newest valid bank
+    for (uint8_t i = 0; i < BANK_COUNT; i++) {
+        if (readBank(i, data)) {
+            uint16_t seq = data[POS_SEQUENCE] | (data[POS_SEQUENCE + 1] << 8);
+            if (bank < 0 || (int16_t)(seq - sequence) > 0) {
+                bank = i;
+                sequence = seq;
+            }
+        }
+    }
+    if (bank < 0) {
+        activeBank = 0;
+        sequence = 0;
+        LOG("[CFG] No valid configuration, using defaults\n");
+        return;
+    }
+    activeBank = bank;
+    readBank(bank, data);
+
+    //apply records, unknown keys are skipped
+    uint8_t end = HEADER_SIZE + data[POS_LENGTH];
+    for (uint8_t pos = HEADER_SIZE; pos + RECORD_HEADER <= end; pos += RECORD_HEADER + data[pos + 1]) {
+        uint8_t key = data[pos];
+        uint8_t size = data[pos + 1];
+        if (size > sizeof(uint32_t) || pos + RECORD_HEADER + size > end) {
+            break;
+        }
+
+        uint32_t value = 0;
+        for (uint8_t j = 0; j < size; j++) {
+            value |= (uint32_t)data[pos + RECORD_HEADER + j] << (j * 8);
+        }
+        for (uint8_t i = 0; i < ENTRY_COUNT; i++) {
+            if (entries[i].key == key && (value >> entries[i].bits) == 0) {
+                setValue(cfg, &entries[i], value);
+            }
+        }
+    }
+}
+
+static uint8_t readBank(uint8_t bank, uint8_t *data) {
+    if (EEPROM_Read(CFG_EEPROM_OFFSET + bank * BANK_SIZE, data, HEADER_SIZE) != HAL_OK) {
+        return 0;
+    }
+
+    uint16_t magic = data[POS_MAGIC] | (data[POS_MAGIC + 1] << 8);
+    uint8_t len = data[POS_LENGTH];
+    if (magic != MAGIC || data[POS_VERSION] > CFG_VERSION || len > BANK_SIZE - HEADER_SIZE) {
+        return 0;
+    }
+    if (EEPROM_Read(CFG_EEPROM_OFFSET + bank * BANK_SIZE + HEADER_SIZE, data + HEADER_SIZE, len) != HAL_OK) {
+        return 0;
+    }
+
+    uint16_t crc = crc16(data, POS_CRC, CRC16_INIT);
+    crc = crc16(data + HEADER_SIZE, len, crc);
+    return crc == (data[POS_CRC] | (data[POS_CRC + 1] << 8));
+}
+
+static void setValue(CFG_Config *cfg, const CFG_Entry *entry, uint32_t value) {
+    uint8_t *member = (uint8_t*)cfg + entry->offset;
+    switch (entry->size) {
+        case sizeof(uint8_t):
+            *member = value;
+            break;
+        case sizeof(uint16_t):
+            *(uint16_t*)member = value;
+            break;
+        case sizeof(uint32_t):
+            *(uint32_t*)member = value;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc) {
+    for (uint16_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ CRC16_POLY : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t getCycles(void) {
+    uint32_t tick;
+    uint32_t val;
+
+    //read again if systick wrapped in between
+    do {
+        tick = HAL_GetTick();
+        val = SysTick->VAL;
+    } while (tick != HAL_GetTick());
+
+    return tick * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file config.h
+ * @author Paul Götzinger
+ * @brief Beacon configuration store (data eeprom)
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "plb.h"
+#include "sgb.h"
+
+#define CFG_VERSION 1   //version of stored record format
+
+/**
+ * @brief Configuration keys (stored in eeprom, never reuse a key)
+ * 
+ */
+typedef enum {
+    CFG_Key_ProtocolFlag = 1,
+    CFG_Key_CountryCode = 2,
+    CFG_Key_TestProtocol = 3,
+    CFG_Key_BeaconType = 4,
+    CFG_Key_Certif = 5,
+    CFG_Key_SerialNumber = 6,
+    CFG_Key_NationalUse = 7,
+    CFG_Key_CertifNumber = 8,
+    CFG_Key_Radiolocating = 9,
+    CFG_Key_SgbTacNumber = 10,
+    CFG_Key_SgbSerialNumber = 11,
+    CFG_Key_SgbCountryCode = 12,
+    CFG_Key_SgbHoming = 13,
+    CFG_Key_SgbRls = 14
+} CFG_Key;
+
+/**
+ * @brief Beacon configuration
+ * 
+ */
+typedef struct {
+    PLB_Identity plb;   //beacon identification
+    SGB_Identity sgb;   //second generation beacon identification
+} CFG_Config;
+
+/**
+ * @brief Description of one configuration entry
+ * 
+ */
+typedef struct {
+    CFG_Key key;        //key in eeprom
+    const char *name;   //name used for provisioning
+    uint8_t bits;       //count of valid bits
+    uint8_t offset;     //offset in configuration structure
+    uint8_t size;       //size of member in configuration structure
+    uint32_t def;       //default value
+} CFG_Entry;
+
+/**
+ * @brief Load configuration from eeprom (missing or invalid entries are taken from defaults)
+ * 
+ */
+void CFG_Init(void);
+
+/**
+ * @brief Retrieve active configuration (loaded at boot)
+ * 
+ * @return const CFG_Config* active configuration
+ */
+const CFG_Config* CFG_Get(void);
+
+/**
+ * @brief Retrieve pending configuration (modified by provisioning, active after restart)
+ * 
+ * @return const CFG_Config* pending configuration
+ */
+const CFG_Config* CFG_GetPending(void);
+
+/**
+ * @brief Retrieve time needed to load the configuration at boot
+ * 
+ * @return uint32_t load time in us
+ */
+uint32_t CFG_GetLoadTime(void);
+
+/**
+ * @brief Retrieve count of configuration entries
+ * 
+ * @return uint8_t count of entries
+ */
+uint8_t CFG_GetEntryCount(void);
+
+/**
+ * @brief Retrieve configuration entry
+ * 
+ * @param idx index of entry
+ * @return const CFG_Entry* entry, 0 if index is invalid
+ */
+const CFG_Entry* CFG_GetEntry(uint8_t idx);
+
+/**
+ * @brief Search configuration entry by name
+ * 
+ * @param name name of entry
+ * @return const CFG_Entry* entry, 0 if not found
+ */
+const CFG_Entry* CFG_FindEntry(const char *name);
+
+/**
+ * @brief Read value of configuration entry
+ * 
+ * @param cfg configuration
+ * @param entry configuration entry
+ * @return uint32_t value
+ */
+uint32_t CFG_GetValue(const CFG_Config *cfg, const CFG_Entry *entry);
+
+/**
+ * @brief Set value of pending configuration
+ * 
+ * @param entry configuration entry
+ * @param value new value
+ * @return uint8_t '1' on success, '0' if value is out of range
+ */
+uint8_t CFG_Set(const CFG_Entry *entry, uint32_t value);
+
+/**
+ * @brief Reset pending configuration to defaults
+ * 
+ */
+void CFG_SetDefaults(void);
+
+/**
+ * @brief Store pending configuration in eeprom, the write is queued for the storage writer and
+ * the new bank becomes active once it is written
+ * 
+ * @return HAL_StatusTypeDef HAL_OK if queued
+ */
+HAL_StatusTypeDef CFG_Save(void);
+
+#endif //!CONFIG_H
@@ -0,0 +1,269 @@
+/**
+ * @file logbook.c
+ * @author Paul Götzinger
+ * @brief Event log and track log, rings of fixed size binary records in data eeprom
+ * @version 1.0
+ * @date 2019-04-01
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "logbook.h"
+#include "eeprom.h"
+#include "record.h"
+#include "location.h"
+#include "storage.h"
+#include <string.h>
+
+#define EVENT_OFFSET    LBK_EEPROM_OFFSET
+#define FIX_OFFSET      (EVENT_OFFSET + LBK_EVENTS * sizeof(LBK_Event))
+#define END_OFFSET      (FIX_OFFSET + LBK_FIXES * sizeof(LBK_Fix))
+
+#define FIRST_FIX_MAX   255         //s, saturation of the first fix event argument
+#define E7_PER_MINUTE   (10000000.0f / 60)
+
+_Static_assert(sizeof(LBK_Event) == 8 && sizeof(LBK_Fix) == 16, "record size changed");
+_Static_assert(LBK_EEPROM_OFFSET >= REC_EEPROM_OFFSET + REC_SIZE + 16, "logbook overlaps the saved recording");
+_Static_assert(END_OFFSET <= EEPROM_SIZE, "logbook exceeds the data eeprom");
+
+/**
+ * @brief Ring of records, the slot of a record follows from the sequence numbers. Records are
+ * queued for the storage writer, readers see them once they are written.
+ *
+ */
+typedef struct {
+    uint16_t offset;        //offset in data eeprom
+    uint16_t size;          //bytes per record
+    uint16_t capacity;      //records
+    uint16_t head;          //slot of the next written record
+    uint16_t count;         //written records
+    uint16_t queued;        //slot of the next queued record
+    uint16_t seq;           //sequence number of the newest queued record
+} Ring;
+
+static Ring events = { EVENT_OFFSET, sizeof(LBK_Event), LBK_EVENTS, 0, 0, 0, 0 };
+static Ring fixes = { FIX_OFFSET, sizeof(LBK_Fix), LBK_FIXES, 0, 0, 0, 0 };
+
+static POS_Subscriber posSub;
+static POS_Position lastFix;        //last logged track point
+static uint32_t lastFixTick;
+static uint16_t bootSeq;            //sequence number of this boot's event
+static uint8_t firstFixSeen;
+
+static const char *typeNames[LBK_Type_Count] = {
+    "boot",
+    "emergency_start",
+    "emergency_stop",
+    "first_fix",
+    "config_saved"
+};
+
+/**
+ * @brief Find head and count of a ring from the sequence numbers
+ *
+ * @param ring ring
+ */
+static void scan(Ring *ring);
+
+/**
+ * @brief Read sequence number of a slot
+ *
+ * @param ring ring
+ * @param slot slot
+ * @return uint16_t sequence number, 0 if empty
+ */
+static uint16_t readSeq(Ring *ring, uint16_t slot);
+
+/**
+ * @brief Queue record, the sequence number is assigned here
+ *
+ * @param ring ring
+ * @param record record, starts with the sequence number
+ * @return uint16_t sequence number, 0 if the storage queue is full
+ */
+static uint16_t append(Ring *ring, void *record);
+
+/**
+ * @brief Record written, make it visible to the readers
+ *
+ * @param ctx ring
+ * @param status result of write
+ */
+static void written(void *ctx, HAL_StatusTypeDef status);
+
+/**
+ * @brief Read record by age
+ *
+ * @param ring ring
+ * @param idx index, 0 is the oldest
+ * @param record record to fill
+ * @return uint8_t '1' on success
+ */
+static uint8_t readRecord(Ring *ring, uint16_t idx, void *record);
+
+/**
+ * @brief Sequence number following another one (0 marks empty slots and is skipped)
+ *
+ * @param seq sequence number
+ * @return uint16_t next sequence number
+ */
+static uint16_t nextSeq(uint16_t seq);
+
+/**
+ * @brief Convert degree and minute to 1e-7 deg
+ *
+ * @param degree degree
+ * @param minute minute
+ * @param negative south or west
+ * @return int32_t 1e-7 deg
+ */
+static int32_t toE7(uint16_t degree, float minute, uint8_t negative);
+
+void LBK_Init(void) {
+    scan(&events);
+    scan(&fixes);
+
+    POS_BusSubscribe(LOC_GetPositionBus(), &posSub, 0);
+    lastFixTick = 0;
+    firstFixSeen = 0;
+
+    LBK_LogEvent(LBK_Type_Boot, RCC->CSR >> 24);
+    bootSeq = events.seq;
+
+    LOG("[LBK] %u events, %u track points\n", events.count, fixes.count);
+}
+
+void LBK_Process(void) {
+    POS_Position pos;
+
+    if (!POS_BusChanged(LOC_GetPositionBus(), &posSub)
+            || POS_BusFetch(LOC_GetPositionBus(), &posSub, &pos) == 0
+            || pos.valid != POS_Valid_Flag_Valid) {
+        return;
+    }
+
+    uint32_t tick = HAL_GetTick();
+    if (!firstFixSeen) {
+        uint32_t s = tick / 1000;
+        LBK_LogEvent(LBK_Type_FirstFix, s > FIRST_FIX_MAX ? FIRST_FIX_MAX : s);
+        firstFixSeen = 1;
+    } else if (tick - lastFixTick < LBK_TRACK_INTERVAL || POS_Distance(&pos, &lastFix) < LBK_TRACK_DISTANCE) {
+        return;
+    }
+
+    LBK_Fix fix = {
+        .boot = bootSeq,
+        .hour = pos.time.hour,
+        .minute = pos.time.minute,
+        .second = pos.time.second,
+        .source = pos.source,
+        .lat = toE7(pos.latitude.degree, pos.latitude.minute, pos.latitude.direction == POS_Latitude_Flag_S),
+        .lon = toE7(pos.longitude.degree, pos.longitude.minute, pos.longitude.direction == POS_Longitude_Flag_W)
+    };
+    if (append(&fixes, &fix) != 0) {
+        memcpy(&lastFix, &pos, sizeof(POS_Position));
+        lastFixTick = tick;
+    }
+}
+
+void LBK_LogEvent(LBK_Type type, uint8_t arg) {
+    LBK_Event event = {
+        .type = type,
+        .arg = arg,
+        .uptime = HAL_GetTick() / 1000
+    };
+    append(&events, &event);
+}
+
+const char* LBK_GetTypeName(uint8_t type) {
+    return type < LBK_Type_Count ? typeNames[type] : "unknown";
+}
+
+uint16_t LBK_GetEventCount(void) {
+    return events.count;
+}
+
+uint8_t LBK_ReadEvent(uint16_t idx, LBK_Event *event) {
+    return readRecord(&events, idx, event);
+}
+
+uint16_t LBK_GetFixCount(void) {
+    return fixes.count;
+}
+
+uint8_t LBK_ReadFix(uint16_t idx, LBK_Fix *fix) {
+    return readRecord(&fixes, idx, fix);
+}
+
+static void scan(Ring *ring) {
+    //records are written in slot order, the newest is followed by an empty slot or a gap in the sequence
+    uint16_t prev = 0;
+    ring->head = 0;
+    for (uint16_t slot = 0; slot < ring->capacity; slot++) {
+        uint16_t seq = readSeq(ring, slot);
+        if (seq == 0 || (slot != 0 && seq != nextSeq(prev))) {
+            ring->head = slot;
+            break;
+        }
+        prev = seq;
+    }
+    ring->seq = prev;
+    ring->count = readSeq(ring, ring->head) == 0 ? ring->head : ring->capacity;
+    ring->queued = ring->head;
+}
+
+static uint16_t readSeq(Ring *ring, uint16_t slot) {
+    uint16_t seq;
+    if (EEPROM_Read(ring->offset + slot * ring->size, (uint8_t*)&seq, sizeof(seq)) != HAL_OK) {
+        return 0;
+    }
+    return seq;
+}
+
+static uint16_t append(Ring *ring, void *record) {
+    uint16_t seq = nextSeq(ring->seq);
+    uint16_t offset = ring->offset + ring->queued * ring->size;
+
+    //the first word with the sequence number goes last, a record torn by a reset keeps the
+    //empty or stale sequence number of the slot
+    memcpy(record, &seq, sizeof(seq));
+    if (STORAGE_Write(offset, record, ring->size, STORAGE_Flag_CommitFirst, written, ring) != HAL_OK) {
+        return 0;
+    }
+
+    ring->seq = seq;
+    ring->queued = ring->queued + 1 < ring->capacity ? ring->queued + 1 : 0;
+    return seq;
+}
+
+static void written(void *ctx, HAL_StatusTypeDef status) {
+    Ring *ring = ctx;
+
+    //a failed slot is passed as well, the queued records behind it keep their slots
+    ring->head = ring->head + 1 < ring->capacity ? ring->head + 1 : 0;
+    if (status == HAL_OK && ring->count < ring->capacity) {
+        ring->count++;
+    }
+}
+
+static uint8_t readRecord(Ring *ring, uint16_t idx, void *record) {
+    uint16_t count = ring->count;
+    if (idx >= count) {
+        return 0;
+    }
+    uint16_t slot = (count < ring->capacity ? 0 : ring->head) + idx;
+    if (slot >= ring->capacity) {
+        slot -= ring->capacity;
+    }
+    return EEPROM_Read(ring->offset + slot * ring->size, record, ring->size) == HAL_OK;
+}
+
+static uint16_t nextSeq(uint16_t seq) {
+    return seq == UINT16_MAX ? 1 : seq + 1;
+}
+
+static int32_t toE7(uint16_t degree, float minute, uint8_t negative) {
+    int32_t value = degree * 10000000L + (int32_t)(minute * E7_PER_MINUTE + 0.5f);
+    return negative ? -value : value;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file logbook.h
+ * @author Paul Götzinger
+ * @brief Event log and track log, rings of fixed size binary records in data eeprom
+ * (behind the saved recording), read record by record for the usb mass storage volume
+ * @version 1.0
+ * @date 2019-04-01
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef LOGBOOK_H
+#define LOGBOOK_H
+
+#include <stdint.h>
+
+#define LBK_EEPROM_OFFSET   2560    //offset in data eeprom (behind the saved recording)
+#define LBK_EVENTS          64      //records of the event ring
+#define LBK_FIXES           192     //records of the track ring
+#define LBK_TRACK_INTERVAL  60000   //ms between track points
+#define LBK_TRACK_DISTANCE  25      //m a position has to move to be logged again
+
+/**
+ * @brief Logged events (never reorder, the type is stored)
+ *
+ */
+typedef enum {
+    LBK_Type_Boot = 0,          //arg: reset flags (RCC CSR >> 24)
+    LBK_Type_EmergencyStart,
+    LBK_Type_EmergencyStop,
+    LBK_Type_FirstFix,          //arg: seconds from boot to the first fix (saturated)
+    LBK_Type_ConfigSaved,
+    LBK_Type_Count
+} LBK_Type;
+
+/**
+ * @brief Event record (8 bytes)
+ *
+ */
+typedef struct {
+    uint16_t seq;       //sequence number, 0 for an empty slot
+    uint8_t type;       //LBK_Type
+    uint8_t arg;
+    uint32_t uptime;    //s since boot
+} LBK_Event;
+
+/**
+ * @brief Track point record (16 bytes)
+ *
+ */
+typedef struct {
+    uint16_t seq;       //sequence number, 0 for an empty slot
+    uint16_t boot;      //sequence number of the boot event the point belongs to
+    uint8_t hour;       //utc time of the fix
+    uint8_t minute;
+    uint8_t second;
+    uint8_t source;     //POS_Source_Flag
+    int32_t lat;        //1e-7 deg, north positive
+    int32_t lon;        //1e-7 deg, east positive
+} LBK_Fix;
+
+/**
+ * @brief Find the heads of both rings, log the boot event and follow the position bus
+ *
+ */
+void LBK_Init(void);
+
+/**
+ * @brief Log a track point if the position moved and the interval passed
+ *
+ */
+void LBK_Process(void);
+
+/**
+ * @brief Append event to the event ring
+ *
+ * @param type event
+ * @param arg argument of event
+ */
+void LBK_LogEvent(LBK_Type type, uint8_t arg);
+
+/**
+ * @brief Retrieve name of an event type
+ *
+ * @param type event
+ * @return const char* name, "unknown" for an invalid type
+ */
+const char* LBK_GetTypeName(uint8_t type);
+
+/**
+ * @brief Retrieve count of stored events
+ *
+ * @return uint16_t count (at most LBK_EVENTS)
+ */
+uint16_t LBK_GetEventCount(void);
+
+/**
+ * @brief Read stored event (interrupt safe)
+ *
+ * @param idx index, 0 is the oldest
+ * @param event event to fill
+ * @return uint8_t '1' on success, '0' if the index is invalid
+ */
+uint8_t LBK_ReadEvent(uint16_t idx, LBK_Event *event);
+
+/**
+ * @brief Retrieve count of stored track points
+ *
+ * @return uint16_t count (at most LBK_FIXES)
+ */
+uint16_t LBK_GetFixCount(void);
+
+/**
+ * @brief Read stored track point (interrupt safe)
+ *
+ * @param idx index, 0 is the oldest
+ * @param fix track point to fill
+ * @return uint8_t '1' on success, '0' if the index is invalid
+ */
+uint8_t LBK_ReadFix(uint16_t idx, LBK_Fix *fix);
+
+#endif //!LOGBOOK_H
@@ -0,0 +1,457 @@
+/**
+ * @file volume.c
+ * @author Paul Götzinger
+ * @brief Read-only FAT12 volume of the logbook and configuration. The files consist of a header,
+ * lines of fixed width (one per record) and a footer, so the record behind any file offset is
+ * found by a division and a sector costs the same at the start and at the end of a file.
+ * @version 1.0
+ * @date 2019-04-01
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "volume.h"
+#include "logbook.h"
+#include "config.h"
+#include <string.h>
+
+//layout: boot sector, two FATs, root directory, data (one sector per cluster)
+#define RESERVED_SECTORS    1
+#define FAT_COUNT           2
+#define FAT_SECTORS         6
+#define ROOT_ENTRIES        16
+#define DIR_ENTRY_SIZE      32
+#define ROOT_SECTORS        (ROOT_ENTRIES * DIR_ENTRY_SIZE / VOL_SECTOR_SIZE)
+#define FAT_START           RESERVED_SECTORS
+#define ROOT_START          (FAT_START + FAT_COUNT * FAT_SECTORS)
+#define DATA_START          (ROOT_START + ROOT_SECTORS)
+#define CLUSTERS            (VOL_SECTORS - DATA_START)
+#define FIRST_CLUSTER       2
+
+#define FAT12_MAX_CLUSTERS  4084
+#define FAT_MEDIA           0xFF8
+#define FAT_END             0xFFF
+
+#define ATTR_READ_ONLY      0x01
+#define ATTR_VOLUME_ID      0x08
+#define FAT_DATE            (((2019 - 1980) << 9) | (4 << 5) | 1)   //no clock, all files are dated 2019-04-01
+
+_Static_assert(CLUSTERS <= FAT12_MAX_CLUSTERS, "volume too large for FAT12");
+_Static_assert((CLUSTERS + FIRST_CLUSTER) * 3 / 2 <= FAT_SECTORS * VOL_SECTOR_SIZE, "FAT too small");
+
+//line widths, each line function writes exactly this many bytes
+#define EVENT_LINE          38      //"00001,0000000012,emergency_start,000\r\n"
+#define CSV_FIX_LINE        45      //"00001,12:34:56,+47.0712345,+015.4376543,int\r\n"
+#define GPX_FIX_LINE        75      //"<trkpt lat=\"+47.0712345\" lon=\"+015.4376543\"><name>12:34:56</name></trkpt>\r\n"
+#define CONFIG_LINE         25      //"country       =     203\r\n"
+#define LINE_MAX            80
+#define CONFIG_LINES        16      //room for configuration entries
+#define EVENT_NAME_WIDTH    15
+#define CONFIG_NAME_WIDTH   13
+#define CONFIG_VALUE_WIDTH  7
+#define E7_DIGITS           7
+
+#define TEXT(S)             S, sizeof(S) - 1
+
+/**
+ * @brief File of fixed width lines
+ *
+ */
+typedef struct {
+    char name[11];                                  //8.3 name, space padded
+    const char *header;
+    uint16_t headerLen;
+    const char *footer;
+    uint16_t footerLen;
+    uint8_t lineLen;
+    uint16_t maxLines;                              //reserves the clusters of the file
+    uint16_t (*count)(void);                        //lines available
+    void (*line)(uint16_t idx, char *dst);          //write line idx (lineLen bytes)
+} File;
+
+static uint16_t configCount(void);
+static void eventLine(uint16_t idx, char *dst);
+static void csvFixLine(uint16_t idx, char *dst);
+static void gpxFixLine(uint16_t idx, char *dst);
+static void configLine(uint16_t idx, char *dst);
+
+static const File files[] = {
+    {
+        "EVENTS  CSV",
+        TEXT("seq,uptime_s,event,arg\r\n"),
+        TEXT(""),
+        EVENT_LINE, LBK_EVENTS, LBK_GetEventCount, eventLine
+    },
+    {
+        "TRACK   CSV",
+        TEXT("boot,utc,lat,lon,source\r\n"),
+        TEXT(""),
+        CSV_FIX_LINE, LBK_FIXES, LBK_GetFixCount, csvFixLine
+    },
+    {
+        "TRACK   GPX",
+        TEXT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+             "<gpx version=\"1.1\" creator=\"WatchPLB\" xmlns=\"http://www.topografix.com/GPX/1/1\">\r\n"
+             "<trk><name>WatchPLB track</name><trkseg>\r\n"),
+        TEXT("</trkseg></trk></gpx>\r\n"),
+        GPX_FIX_LINE, LBK_FIXES, LBK_GetFixCount, gpxFixLine
+    },
+    {
+        "CONFIG  TXT",
+        TEXT("# active beacon configuration\r\n"),
+        TEXT(""),
+        CONFIG_LINE, CONFIG_LINES, configCount, configLine
+    }
+};
+
+#define FILE_COUNT (sizeof(files) / sizeof(files[0]))
+
+_Static_assert(FILE_COUNT + 1 <= ROOT_ENTRIES, "root directory too small");
+
+/**
+ * @brief Position of a file on the volume
+ *
+ */
+typedef struct {
+    uint16_t cluster;       //first cluster, 0 if the file is empty
+    uint16_t used;          //clusters holding the file
+    uint32_t size;          //bytes
+} Extent;
+
+/**
+ * @brief Locate file: clusters are reserved for the maximum size in the order of the table,
+ * the size follows from the current count of records
+ *
+ * @param idx index of file
+ * @param extent extent to fill
+ */
+static void locate(uint8_t idx, Extent *extent);
+
+static void bootSector(uint8_t *data);
+static void fatSector(uint32_t sector, uint8_t *data);
+static void rootSector(uint8_t *data);
+static void dataSector(uint32_t cluster, uint8_t *data);
+
+/**
+ * @brief Write range of a file
+ *
+ * @param file file
+ * @param count lines of the file (sampled once per sector)
+ * @param offset offset in file
+ * @param dst destination
+ * @param len bytes, within the file
+ */
+static void readFile(const File *file, uint16_t count, uint32_t offset, uint8_t *dst, uint16_t len);
+
+/**
+ * @brief Retrieve FAT entry of a cluster
+ *
+ * @param extents extents of all files
+ * @param cluster cluster
+ * @return uint16_t entry (12 bit)
+ */
+static uint16_t fatEntry(const Extent *extents, uint16_t cluster);
+
+//fixed width formatting, each returns the position behind the written text
+static char* putDecimal(char *dst, uint32_t value, uint8_t width, char pad);
+static char* putText(char *dst, const char *text, uint8_t width);
+static char* putCoordinate(char *dst, int32_t e7, uint8_t digits);
+static char* putTime(char *dst, const LBK_Fix *fix);
+
+static void put16(uint8_t *dst, uint16_t value);
+static void put32(uint8_t *dst, uint32_t value);
+
+uint8_t VOL_Read(uint32_t lba, uint8_t *data) {
+    if (lba >= VOL_SECTORS) {
+        return 0;
+    }
+
+    if (lba < FAT_START) {
+        bootSector(data);
+    } else if (lba < ROOT_START) {
+        fatSector((lba - FAT_START) % FAT_SECTORS, data);
+    } else if (lba < DATA_START) {
+        rootSector(data);
+    } else {
+        dataSector(lba - DATA_START + FIRST_CLUSTER, data);
+    }
+    return 1;
+}
+
+static void locate(uint8_t idx, Extent *extent) {
+    uint16_t cluster = FIRST_CLUSTER;
+    for (uint8_t i = 0; i < idx; i++) {
+        uint32_t max = files[i].headerLen + (uint32_t)files[i].maxLines * files[i].lineLen + files[i].footerLen;
+        cluster += (max + VOL_SECTOR_SIZE - 1) / VOL_SECTOR_SIZE;
+    }
+
+    const File *file = &files[idx];
+    extent->size = file->headerLen + (uint32_t)file->count() * file->lineLen + file->footerLen;
+    extent->used = (extent->size + VOL_SECTOR_SIZE - 1) / VOL_SECTOR_SIZE;
+    extent->cluster = extent->used != 0 ? cluster : 0;
+}
+
+static void bootSector(uint8_t *data) {
+    memset(data, 0, VOL_SECTOR_SIZE);
+    data[0] = 0xEB;                         //jump over the parameter block
+    data[1] = 0x3C;
+    data[2] = 0x90;
+    memcpy(&data[3], "WATCHPLB", 8);        //oem name
+    put16(&data[11], VOL_SECTOR_SIZE);
+    data[13] = 1;                           //sectors per cluster
+    put16(&data[14], RESERVED_SECTORS);
+    data[16] = FAT_COUNT;
+    put16(&data[17], ROOT_ENTRIES);
+    put16(&data[19], VOL_SECTORS);
+    data[21] = FAT_MEDIA & 0xFF;
+    put16(&data[22], FAT_SECTORS);
+    put16(&data[24], 32);                   //sectors per track
+    put16(&data[26], 2);                    //heads
+    data[36] = 0x80;                        //drive number
+    data[38] = 0x29;                        //extended boot signature
+    put32(&data[39], CFG_Get()->plb.serialNumber);
+    memcpy(&data[43], "WATCHPLB   ", 11);   //volume label
+    memcpy(&data[54], "FAT12   ", 8);
+    data[510] = 0x55;
+    data[511] = 0xAA;
+}
+
+static void fatSector(uint32_t sector, uint8_t *data) {
+    Extent extents[FILE_COUNT];
+    for (uint8_t i = 0; i < FILE_COUNT; i++) {
+        locate(i, &extents[i]);
+    }
+
+    //two entries in three bytes; the entries end with the last cluster of the last file
+    const Extent *last = &extents[FILE_COUNT - 1];
+    uint32_t end = ((uint32_t)last->cluster + last->used + 1) * 3 / 2 + 1;
+    uint32_t offset = sector * VOL_SECTOR_SIZE;
+
+    memset(data, 0, VOL_SECTOR_SIZE);
+    for (uint16_t i = 0; i < VOL_SECTOR_SIZE && offset + i < end; i++) {
+        uint32_t byte = offset + i;
+        uint16_t pair = byte / 3 * 2;
+        switch (byte % 3) {
+            case 0:
+                data[i] = fatEntry(extents, pair) & 0xFF;
+                break;
+            case 1:
+                data[i] = (fatEntry(extents, pair) >> 8) | ((fatEntry(extents, pair + 1) & 0x0F) << 4);
+                break;
+            default:
+                data[i] = fatEntry(extents, pair + 1) >> 4;
+                break;
+        }
+    }
+}
+
+static void rootSector(uint8_t *data) {
+    memset(data, 0, VOL_SECTOR_SIZE);
+
+    memcpy(data, "WATCHPLB   ", 11);
+    data[11] = ATTR_VOLUME_ID;
+    put16(&data[24], FAT_DATE);
+
+    for (uint8_t i = 0; i < FILE_COUNT; i++) {
+        uint8_t *entry = &data[(i + 1) * DIR_ENTRY_SIZE];
+        Extent extent;
+        locate(i, &extent);
+
+        memcpy(entry, files[i].name, 11);
+        entry[11] = ATTR_READ_ONLY;
+        put16(&entry[16], FAT_DATE);        //creation date
+        put16(&entry[18], FAT_DATE);        //last access date
+        put16(&entry[24], FAT_DATE);        //write date
+        put16(&entry[26], extent.cluster);
+        put32(&entry[28], extent.size);
+    }
+}
+
+static void dataSector(uint32_t cluster, uint8_t *data) {
+    for (uint8_t i = 0; i < FILE_COUNT; i++) {
+        Extent extent;
+        locate(i, &extent);
+        if (extent.cluster != 0 && cluster >= extent.cluster && cluster < extent.cluster + extent.used) {
+            //count is sampled once, a record appended meanwhile does not shift the lines of this sector
+            uint16_t count = (extent.size - files[i].headerLen - files[i].footerLen) / files[i].lineLen;
+            uint32_t offset = (cluster - extent.cluster) * VOL_SECTOR_SIZE;
+            uint16_t len = extent.size - offset < VOL_SECTOR_SIZE ? extent.size - offset : VOL_SECTOR_SIZE;
+            readFile(&files[i], count, offset, data, len);
+            memset(data + len, 0, VOL_SECTOR_SIZE - len);
+            return;
+        }
+    }
+    memset(data, 0, VOL_SECTOR_SIZE);
+}
+
+static void readFile(const File *file, uint16_t count, uint32_t offset, uint8_t *dst, uint16_t len) {
+    uint32_t linesEnd = file->headerLen + (uint32_t)count * file->lineLen;
+    char line[LINE_MAX];
+
+    while (len != 0) {
+        const char *src;
+        uint16_t n;
+        if (offset < file->headerLen) {
+            src = file->header + offset;
+            n = file->headerLen - offset;
+        } else if (offset < linesEnd) {
+            uint16_t idx = (offset - file->headerLen) / file->lineLen;
+            uint8_t col = (offset - file->headerLen) % file->lineLen;
+            n = file->lineLen - col;
+            if (col == 0 && len >= file->lineLen) {
+                //whole line, written in place
+                file->line(idx, (char*)dst);
+                dst += n;
+                offset += n;
+                len -= n;
+                continue;
+            }
+            file->line(idx, line);
+            src = line + col;
+        } else {
+            src = file->footer + (offset - linesEnd);
+            n = file->footerLen - (offset - linesEnd);
+        }
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dst, src, n);
+        dst += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+static uint16_t fatEntry(const Extent *extents, uint16_t cluster) {
+    if (cluster == 0) {
+        return FAT_MEDIA;
+    }
+    if (cluster == 1) {
+        return FAT_END;
+    }
+    for (uint8_t i = 0; i < FILE_COUNT; i++) {
+        const Extent *extent = &extents[i];
+        if (extent->cluster != 0 && cluster >= extent->cluster && cluster < extent->cluster + extent->used) {
+            return cluster + 1 < extent->cluster + extent->used ? cluster + 1 : FAT_END;
+        }
+    }
+    return 0;
+}
+
+static uint16_t configCount(void) {
+    uint8_t count = CFG_GetEntryCount();
+    return count < CONFIG_LINES ? count : CONFIG_LINES;
+}
+
+static void eventLine(uint16_t idx, char *dst) {
+    LBK_Event event;
+    if (!LBK_ReadEvent(idx, &event)) {
+        memset(&event, 0, sizeof(event));
+        event.type = LBK_Type_Count;
+    }
+
+    dst = putDecimal(dst, event.seq, 5, '0');
+    *dst++ = ',';
+    dst = putDecimal(dst, event.uptime, 10, '0');
+    *dst++ = ',';
+    dst = putText(dst, LBK_GetTypeName(event.type), EVENT_NAME_WIDTH);
+    *dst++ = ',';
+    dst = putDecimal(dst, event.arg, 3, '0');
+    *dst++ = '\r';
+    *dst = '\n';
+}
+
+static void csvFixLine(uint16_t idx, char *dst) {
+    LBK_Fix fix;
+    if (!LBK_ReadFix(idx, &fix)) {
+        memset(&fix, 0, sizeof(fix));
+    }
+
+    dst = putDecimal(dst, fix.boot, 5, '0');
+    *dst++ = ',';
+    dst = putTime(dst, &fix);
+    *dst++ = ',';
+    dst = putCoordinate(dst, fix.lat, 2);
+    *dst++ = ',';
+    dst = putCoordinate(dst, fix.lon, 3);
+    *dst++ = ',';
+    dst = putText(dst, fix.source == POS_Source_Flag_External ? "ext" : "int", 3);
+    *dst++ = '\r';
+    *dst = '\n';
+}
+
+static void gpxFixLine(uint16_t idx, char *dst) {
+    LBK_Fix fix;
+    if (!LBK_ReadFix(idx, &fix)) {
+        memset(&fix, 0, sizeof(fix));
+    }
+
+    //no date is known, the utc time goes into the name of the point
+    dst = putText(dst, "<trkpt lat=\"", 12);
+    dst = putCoordinate(dst, fix.lat, 2);
+    dst = putText(dst, "\" lon=\"", 7);
+    dst = putCoordinate(dst, fix.lon, 3);
+    dst = putText(dst, "\"><name>", 8);
+    dst = putTime(dst, &fix);
+    dst = putText(dst, "</name></trkpt>", 15);
+    *dst++ = '\r';
+    *dst = '\n';
+}
+
+static void configLine(uint16_t idx, char *dst) {
+    const CFG_Entry *entry = CFG_GetEntry(idx);
+
+    dst = putText(dst, entry != 0 ? entry->name : "", CONFIG_NAME_WIDTH);
+    dst = putText(dst, " = ", 3);
+    dst = putDecimal(dst, CFG_GetValue(CFG_Get(), entry), CONFIG_VALUE_WIDTH, ' ');
+    *dst++ = '\r';
+    *dst = '\n';
+}
+
+static char* putDecimal(char *dst, uint32_t value, uint8_t width, char pad) {
+    //right aligned, digits which do not fit are cut
+    for (uint8_t i = width; i > 0; i--) {
+        dst[i - 1] = (value != 0 || i == width) ? '0' + value % 10 : pad;
+        value /= 10;
+    }
+    return dst + width;
+}
+
+static char* putText(char *dst, const char *text, uint8_t width) {
+    //left aligned, padded with spaces
+    uint8_t i = 0;
+    for (; i < width && text[i] != 0; i++) {
+        dst[i] = text[i];
+    }
+    for (; i < width; i++) {
+        dst[i] = ' ';
+    }
+    return dst + width;
+}
+
+static char* putCoordinate(char *dst, int32_t e7, uint8_t digits) {
+    uint32_t value = e7 < 0 ? -(uint32_t)e7 : (uint32_t)e7;
+    *dst++ = e7 < 0 ? '-' : '+';
+    dst = putDecimal(dst, value / 10000000, digits, '0');
+    *dst++ = '.';
+    return putDecimal(dst, value % 10000000, E7_DIGITS, '0');
+}
+
+static char* putTime(char *dst, const LBK_Fix *fix) {
+    dst = putDecimal(dst, fix->hour, 2, '0');
+    *dst++ = ':';
+    dst = putDecimal(dst, fix->minute, 2, '0');
+    *dst++ = ':';
+    return putDecimal(dst, fix->second, 2, '0');
+}
+
+static void put16(uint8_t *dst, uint16_t value) {
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+static void put32(uint8_t *dst, uint32_t value) {
+    put16(dst, value & 0xFFFF);
+    put16(dst + 2, value >> 16);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file volume.h
+ * @author Paul Götzinger
+ * @brief Read-only FAT12 volume of the logbook and configuration for usb mass storage, every
+ * sector is generated on request from the stored records (no image in RAM)
+ * @version 1.0
+ * @date 2019-04-01
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <stdint.h>
+
+#define VOL_SECTOR_SIZE 512
+#define VOL_SECTORS     2048    //1 MB, one sector per cluster keeps it FAT12
+
+/**
+ * @brief Generate sector of the volume (interrupt safe, the time does not depend on the
+ * position of the sector in a file)
+ *
+ * @param lba sector number
+ * @param data buffer of VOL_SECTOR_SIZE bytes
+ * @return uint8_t '1' on success, '0' if the sector is out of range
+ */
+uint8_t VOL_Read(uint32_t lba, uint8_t *data);
+
+#endif //!VOLUME_H
@@ -16,6 +16,7 @@
 #include "vibrator_driver.h"
 #include "key.h"
 #include "emergencyCall.h"
+#include "location.h"
 #include "battery.h"
 #include "adc.h"
 #include <stdbool.h>
@@ -29,6 +30,8 @@ UIstates UIstate = UI_Idle;
 static bool isSleepmode = false;
 static const TIME ledtimercd = 10;
 static REGISTER ledreg = 0x0F;
+static REGISTER ackreg = 0x55;
+static bool isAcknowledged = false;
 
 const uint8_t battery_100 = 80;
 const uint8_t battery_80 = 60;
@@ -128,6 +131,12 @@ HAL_StatusTypeDef UI_Update() {
 	}
 	counter++;
 
+	// indicate acknowledgement received over the galileo return link
+	if (isAcknowledged != true && LOC_ReturnLinkAcknowledged()) {
+		isAcknowledged = true;
+		led_timer_start();
+		led_action_time(led_pb2, ackreg);
+	}
 
 	switch (UIstate) {
 	case UI_Idle: {
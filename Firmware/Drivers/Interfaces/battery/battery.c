@@ -13,6 +13,7 @@
 /*Includes*/
 #include "battery.h"
 #include "adc.h"
+#include "record.h"
 
 /*Module Internal Constats*/
 const uint32_t timeout = 10000;
@@ -46,5 +47,7 @@ uint8_t battery_convert(const int32_t value) {
   * @retval Percent
 */
 uint8_t battery_status() {
-	return battery_convert(Adc_GetValue(timeout));
+	int32_t value = Adc_GetValue(timeout);
+	REC_ADC(value);
+	return battery_convert(value);
 }
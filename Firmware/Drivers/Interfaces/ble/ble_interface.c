@@ -14,6 +14,10 @@
 #include "ble_interface.h"
 #include "../CRC/crc8.h"
 #include "uart.h"
+#include "board.h"
+#include "memory.h"
+#include "record.h"
+#include "thread.h"
 
 /*@brief Define Block*/
 #define UART_START_SEQ 0xAA
@@ -77,6 +81,11 @@
 #define LEAVE_CFG_MODE 0x52
 #define ENTER_CFG_MODE 0x0B
 
+/*@brief BLEDK3 Events*/
+#define EVT_COMMAND_COMPLETE 0x80
+#define EVT_STATUS_REPORT 0x81
+#define EVT_RECEIVED_TRANSPARENT_DATA 0x9A
+
 /*@brief BLEDK3 ERROR*/
 #define SUCCEED 0x00
 #define FAIL_LWR 0x01
@@ -86,8 +95,17 @@
 #define DEF_ENABLE_TRANSPARENT_PARAM 0x01
 #define DEF_DISABLE_TRANSPARENT_PARAM 0x00
 
+/*@brief Timeouts in ms*/
+#define RESPONSE_TIMEOUT 100	//command complete event
+#define RESET_TIMEOUT 500		//status report after the module restarted
+
+/*@brief Configuration Requests*/
+#define NAME_MAX 16
+#define ADV_NONE 0
+#define ADV_DISABLE 1
+#define ADV_ENABLE 2
+
 /*@brief Global Variables*/
-static UART_Config conf;
 static UART_Instance inst;
 
 #define maxbuffer 255
@@ -95,6 +113,25 @@ static uint8_t send_buffer[maxbuffer] = {0};
 static uint8_t rec_buffer[maxbuffer] = {0};
 static uint8_t connhdl = 0x01;
 
+/*@brief Event Parser*/
+static uint16_t rec_len = 0;
+static uint16_t rec_idx = 0;
+static ble_receive_callback_t rec_cb = 0;
+
+/*@brief Configuration Sequences*/
+static THREAD_Context seq_thread;
+static THREAD_Context cmd_thread;
+static bool ready = false;			//reset done, transparent data may be sent
+static uint8_t cmd_pending = 0;		//command waiting for its command complete event, 0 if none
+static bool status_reported = false;
+static uint8_t name_buffer[NAME_MAX];
+static uint8_t name_length = 0;		//device name to write, 0 if none
+static uint8_t adv_request = ADV_NONE;
+
+MEM_BUFFER("ble", inst);
+MEM_BUFFER("ble", send_buffer);
+MEM_BUFFER("ble", rec_buffer);
+
 /**
   * @brief Calculate CRC
   * @param data: The Data to use
@@ -106,27 +143,59 @@ static uint8_t ble_crc_hack(uint8_t * data, uint8_t data_length) {
 }
 
 /**
-  * @brief Zeros the Buffer
+  * @brief Sends the Frame whose Parameters are in send_buffer from index 4 on
+  * @param command: The Command to be sent
+  * @param data_length: Length of the Parameters
+  * @retval Result of Operation
+*/
+static bool ble_write_frame(const uint8_t command, const uint8_t data_length);
+
+/**
+  * @brief Send a Command and wait for its Command Complete Event
+  * @param t: Thread Context
+  * @param command: The Command to be sent
+  * @param data: The Data to use (only read at the first call)
+  * @param data_length: Length of the Data to use
+  * @retval Thread Status
+*/
+static THREAD_Status ble_command(THREAD_Context * t, const uint8_t command, const uint8_t * data, const uint8_t data_length);
+
+/**
+  * @brief Configuration Sequences: Reset at Init, then requested Name and Advertizing Changes
   * @param None
+  * @retval Thread Status
+*/
+static THREAD_Status ble_sequence();
+
+/**
+  * @brief Handle complete Event Frame
+  * @param frame: Start Sequence, Length, Opcode, Parameters, Checksum
+  * @param frame_length: Length of the Frame
   * @retval None
 */
-static void zero_arr(){
-	for(int i = 0; i < maxbuffer; i++){
-		send_buffer[i] = 0;
+static void ble_event(const uint8_t * frame, uint16_t frame_length){
+	//length, opcode, parameters and checksum add up to 0
+	uint8_t sum = 0;
+	for(uint16_t i = 1; i < frame_length; i++){
+		sum += frame[i];
 	}
-}
-
-void ble_receive(){
-	if(!ble_interface_get_buffer_length()){
+	if(sum != 0){
 		return;
 	}
-	uint8_t buf[3] = {0};
-	ble_interface_get_buffer_length(&buf, 3);
 
-	if(buf[2] != SUCCEED){
-		return;
+	//opcode, connection handle, data
+	if(frame[3] == EVT_RECEIVED_TRANSPARENT_DATA && frame_length > 6 && rec_cb != 0){
+		rec_cb(&frame[5], frame_length - 6);
+	}
+	//opcode, command, status
+	else if(frame[3] == EVT_COMMAND_COMPLETE && frame_length > 6 && frame[4] == cmd_pending){
+		cmd_pending = 0;
+	}
+	else if(frame[3] == EVT_STATUS_REPORT){
+		status_reported = true;
 	}
 }
+
 /**
   * @brief Sends the Data
   * @param command: The Command to be sent
@@ -135,35 +204,31 @@ void ble_receive(){
   * @retval Result of Operation
 */
 static bool ble_write(const uint8_t command, const uint8_t * data, const uint8_t data_length){
-		zero_arr();
-
 		if((int16_t)(data_length+5) >= (int16_t)maxbuffer)
 			return false;
 
-		uint8_t * to_send = send_buffer;
+		for(uint16_t i = 0; i < data_length; i++){
+			send_buffer[i+4] = data[i];
+		}
+		return ble_write_frame(command, data_length);
+}
 
+static bool ble_write_frame(const uint8_t command, const uint8_t data_length){
 	//https://github.com/Iclario/BM70-BLEDK3/blob/master/BM70.cpp
 		uint8_t lengthH  = (uint8_t) ((1 + data_length) >> 8);
 		uint8_t lengthL  = (uint8_t) (1 + data_length);
 		uint8_t checksum = 0 - lengthH - lengthL - command;
 
-
 		for (uint16_t i = 0; i < data_length; i++)
-			checksum -= data[i];
-
-		to_send[0] = UART_START_SEQ;
-		to_send[1] = lengthH;
-		to_send[2] = lengthL;
-		to_send[3] = command;
-
-		uint16_t i = 0;
-		for(;i < data_length; i++){
-			to_send[i+4] = data[i];
-		}
+			checksum -= send_buffer[i+4];
 
-		to_send[++i] = checksum;
+		send_buffer[0] = UART_START_SEQ;
+		send_buffer[1] = lengthH;
+		send_buffer[2] = lengthL;
+		send_buffer[3] = command;
+		send_buffer[data_length+4] = checksum;
 
-		UART_SendData(&inst, data_length+3, to_send);
+		UART_SendData(&inst, data_length+5, send_buffer);
 
 		return true;
 }
@@ -175,23 +240,14 @@ static bool ble_write(const uint8_t command, const uint8_t * data, const uint8_t
 */
 void ble_interface_init() {
 	//READY
-	conf.baud = UART_BaudRate_115200;
-	conf.uart = USART1;
-	conf.rxBoard = GPIOA;
-	conf.rxPin = GPIO_PIN_9;
-	conf.rxAF = GPIO_AF4_USART1;
-	conf.rxDmaChannel = DMA1_Channel3;
-	conf.txBoard = GPIOA;
-	conf.txPin = GPIO_PIN_10;
-	conf.txAF = GPIO_AF4_USART1;
-	conf.txDmaChannel = DMA1_Channel2;
-
-	UART_Init(&inst, &conf);
-
-	ble_write(ENTER_CFG_MODE, 0, 0);
-	ble_receive();
-	ble_write(RESET, 0, 0);
-	ble_receive();
+	UART_Init(&inst, &BOARD_BleUart);
+
+	//reset runs in ble_interface_process
+	ready = false;
+	name_length = 0;
+	adv_request = ADV_NONE;
+	THREAD_INIT(&seq_thread);
+	ble_sequence();
 }
 /**
   * @brief Send Data in Transparent Mode
@@ -200,45 +256,55 @@ void ble_interface_init() {
   * @retval None
 */
 void ble_interface_send(uint8_t * tx_buffer, uint8_t tx_buffer_length) {
-	if(tx_buffer_length >= 50 || tx_buffer_length == 0){
+	if(tx_buffer_length >= 50 || tx_buffer_length == 0 || !ready){
 		return;
 	}
 
-	uint8_t to_write[maxbuffer] = {0};
-	to_write[0] = connhdl;
-
+	//connection handle and data go straight into the frame
+	send_buffer[4] = connhdl;
 	for(int i = 0; i < tx_buffer_length;i++){
-		to_write[i+1] = tx_buffer[i];
+		send_buffer[i+5] = tx_buffer[i];
 	}
-
-	ble_receive();
-	ble_write(SEND_TRANSPARENT_DATA, to_write, tx_buffer_length+1);
+	ble_write_frame(SEND_TRANSPARENT_DATA, tx_buffer_length+1);
 }
 
 /**
-  * @brief Get Length of Received Data
-  * @param None
-  * @retval Length of Data
+  * @brief Set Callback for Data received in Transparent Mode
+  * @param cb: Callback, called from ble_interface_process
+  * @retval None
 */
-uint16_t ble_interface_get_buffer_length(){
-	uint16_t bytes = 0;
-	if((bytes=UART_GetAvailableBytes(&inst))==0 || bytes <= 3) return 0;
-	return bytes - 3;
+void ble_interface_set_receive_callback(ble_receive_callback_t cb){
+	rec_cb = cb;
 }
 
 /**
-  * @brief Get Received Data
-  * @param rx_buffer: Pointer to where the Data shall be stored  
-  * @param rx_buffer_length: Length of the Buffer
-  * @retval Remaining Bytes
+  * @brief Parse received Event Frames, delivers Transparent Data
+  * @param None
+  * @retval None
 */
-uint16_t ble_interface_get_buffer(uint8_t *rx_buffer, uint8_t rx_buffer_length){
-	if(rx_buffer_length +3 >= maxbuffer) return 0;
-	uint16_t len = UART_GetData(&inst, rx_buffer_length+3, rec_buffer)-3;
-	for(int i = 2; i < rx_buffer_length; i++){
-		rx_buffer[i] = rec_buffer[i];
+void ble_interface_process(){
+	while(UART_GetAvailableBytes(&inst) > 0){
+		uint8_t byte = UART_GetByte(&inst);
+		REC_BYTE(REC_Source_Ble, byte);
+
+		if(rec_idx == 0 && byte != UART_START_SEQ){
+			continue;
+		}
+		rec_buffer[rec_idx++] = byte;
+
+		if(rec_idx == 3){
+			rec_len = ((uint16_t)rec_buffer[1] << 8) | rec_buffer[2];
+			if(rec_len == 0 || rec_len + 4 > maxbuffer){
+				rec_idx = 0;
+			}
+		}
+		else if(rec_idx > 3 && rec_idx == rec_len + 4){
+			ble_event(rec_buffer, rec_idx);
+			rec_idx = 0;
+		}
 	}
-	return len;
+
+	ble_sequence();
 }
 
 /**
@@ -247,9 +313,7 @@ uint16_t ble_interface_get_buffer(uint8_t *rx_buffer, uint8_t rx_buffer_length){
   * @retval None
 */
 void ble_interface_connect(bool rd_addr, uint64_t address){
-	ble_receive();
-
-	uint8_t * to_send = malloc(8);
+	uint8_t to_send[8];
 
 	to_send[0] = 0;
 	to_send[1] = (uint8_t)rd_addr;
@@ -259,7 +323,6 @@ void ble_interface_connect(bool rd_addr, uint64_t address){
 	}
 
 	ble_write(0x17, to_send, 8);
-	ble_receive();
 }
 
 /**
@@ -269,7 +332,6 @@ void ble_interface_connect(bool rd_addr, uint64_t address){
 */
 void ble_interface_disconnect(){
 	uint8_t buffer = 0;
-	ble_receive();
 	ble_write(DC, &buffer, 1);
 }
 
@@ -289,21 +351,16 @@ void ble_interface_deinit(){
   * @retval None
 */
 void ble_interface_set_name(const uint8_t * ble_name, const uint8_t ble_name_len){
-	if(ble_name_len > 16){
+	if(ble_name_len > NAME_MAX || ble_name_len == 0){
 		return;
 	}
 
-	ble_write(ENTER_CFG_MODE, 0, 0);
-
-	uint8_t to_write[maxbuffer] = {0};
-
-	to_write[0] = 0;
+	//written by ble_sequence
+	name_buffer[0] = 0;
 	for(int i = 0; i < ble_name_len-1; i++){
-		to_write[i+1] = ble_name[i];
+		name_buffer[i+1] = ble_name[i];
 	}
-
-	ble_write(W_DEV_NAME, to_write, ble_name_len);
-	ble_write(LEAVE_CFG_MODE, 0, 0);
+	name_length = ble_name_len;
 }
 
 /**
@@ -312,15 +369,52 @@ void ble_interface_set_name(const uint8_t * ble_name, const uint8_t ble_name_len
   * @retval None
 */
 void ble_interface_advertize(const bool ble_advertize){
+	//written by ble_sequence
+	adv_request = ble_advertize ? ADV_ENABLE : ADV_DISABLE;
+}
 
-	ble_write(ENTER_CFG_MODE, 0, 0);
-	if(ble_advertize){
-		uint8_t adv = 0x01;
-		ble_write(SET_ADV_ENABLE, &adv,1);
-	}
-	else{
-		uint8_t adv = 0x00;
-		ble_write(SET_ADV_ENABLE, &adv,1);
+static THREAD_Status ble_command(THREAD_Context * t, const uint8_t command, const uint8_t * data, const uint8_t data_length){
+	THREAD_BEGIN(t);
+
+	cmd_pending = command;
+	ble_write(command, data, data_length);
+	THREAD_WAIT_UNTIL_TIMEOUT(t, cmd_pending == 0, RESPONSE_TIMEOUT);
+	cmd_pending = 0;
+
+	THREAD_END(t);
+}
+
+static THREAD_Status ble_sequence(){
+	//kept across waits
+	static uint8_t length;
+	static uint8_t adv;
+
+	THREAD_BEGIN(&seq_thread);
+
+	//the module reports its status once it runs again after the reset
+	THREAD_SPAWN(&seq_thread, &cmd_thread, ble_command(&cmd_thread, ENTER_CFG_MODE, 0, 0));
+	status_reported = false;
+	ble_write(RESET, 0, 0);
+	THREAD_WAIT_UNTIL_TIMEOUT(&seq_thread, status_reported, RESET_TIMEOUT);
+	ready = true;
+
+	while(1){
+		THREAD_WAIT_UNTIL(&seq_thread, name_length != 0 || adv_request != ADV_NONE);
+
+		THREAD_SPAWN(&seq_thread, &cmd_thread, ble_command(&cmd_thread, ENTER_CFG_MODE, 0, 0));
+		if(name_length != 0){
+			//a request arriving meanwhile stays pending for the next round
+			length = name_length;
+			name_length = 0;
+			THREAD_SPAWN(&seq_thread, &cmd_thread, ble_command(&cmd_thread, W_DEV_NAME, name_buffer, length));
+		}
+		if(adv_request != ADV_NONE){
+			adv = adv_request == ADV_ENABLE ? 0x01 : 0x00;
+			adv_request = ADV_NONE;
+			THREAD_SPAWN(&seq_thread, &cmd_thread, ble_command(&cmd_thread, SET_ADV_ENABLE, &adv, 1));
+		}
+		THREAD_SPAWN(&seq_thread, &cmd_thread, ble_command(&cmd_thread, LEAVE_CFG_MODE, 0, 0));
 	}
-	ble_write(LEAVE_CFG_MODE, 0, 0);
+
+	THREAD_END(&seq_thread);
 }
@@ -12,6 +12,15 @@
 #define INTERFACE_BLE_INTERFACE_H
   
 #include <stdbool.h>
+#include <stdint.h>
+
+/**
+  * @brief Callback for Data received in Transparent Mode
+  * @param data: Received Data
+  * @param data_length: Length of the Data
+  * @retval None
+*/
+typedef void (*ble_receive_callback_t)(const uint8_t * data, uint16_t data_length);
 
 /**
   * @brief Initialize the BLE- Module
@@ -36,26 +45,25 @@ void ble_interface_init();
 void ble_interface_send(uint8_t * tx_buffer, uint8_t tx_buffer_length);
 
 /**
-  * @brief Get Length of Received Data
+  * @brief Free Bytes of Internal Buffers
   * @param None
-  * @retval Length of Data
+  * @retval None
 */
-uint16_t ble_interface_get_buffer_length();
+void ble_interface_deinit();
 
 /**
-  * @brief Get Received Data
-  * @param rx_buffer: Pointer to where the Data shall be stored  
-  * @param rx_buffer_length: Length of the Buffer
-  * @retval Remaining Bytes
+  * @brief Set Callback for Data received in Transparent Mode
+  * @param cb: Callback, called from ble_interface_process
+  * @retval None
 */
-uint16_t ble_interface_get_buffer(uint8_t *rx_buffer, uint8_t rx_buffer_length);
+void ble_interface_set_receive_callback(ble_receive_callback_t cb);
 
 /**
-  * @brief Free Bytes of Internal Buffers
+  * @brief Parse received Event Frames, delivers Transparent Data
   * @param None
   * @retval None
 */
-void ble_interface_deinit();
+void ble_interface_process();
 
 /**
   * @brief Connect - Empty
@@ -0,0 +1,95 @@
+/**
+ * @file homing.c
+ * @author Paul Götzinger
+ * @brief 121.5 MHz homing signal: swept tone amplitude modulation as a precomputed table of audio
+ * cycles, loaded cycle by cycle into the keying timer of the homing transmitter
+ * @version 1.0
+ * @date 2019-04-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "homing.h"
+
+/**
+ * @brief One sweep of the keyed carrier (ICAO Annex 10: downward sweep of at least 700 Hz within
+ * 1600 .. 300 Hz, 2 .. 4 sweeps per second, modulation duty cycle 33 .. 55 %).
+ * The tone falls linearly in time from 1600 Hz to 400 Hz over HOM_SWEEP_TICKS. Cycle n starting
+ * at t has the period round(1 MHz / f(t)) us, the sweep ends with the last whole cycle at 409 Hz
+ * and the remaining 9 us stretch the last cycles by 1 us each. The carrier is on for the first
+ * round(0.45 * period) us of each cycle (44.9 .. 45.1 %).
+ * The tone moves in steps: by 0.16 % per cycle at 1600 Hz and by 2.1 % at 409 Hz, the sweep
+ * itself. Periods of whole us add at most 0.08 % to that. A keyed sample stream at 8 ksample/s
+ * has periods of whole 125 us samples instead, only 16 tones between 1600 Hz and 400 Hz
+ * (8000 Hz / 5 .. 20 samples) with 17 % steps at the top (1600, 1333, 1143, 1000 Hz).
+ */
+const HOM_Cycle HOM_Sweep[HOM_SWEEP_CYCLES] = {
+    { 624, 0,  281}, { 625, 0,  282}, { 626, 0,  282}, { 627, 0,  283}, { 628, 0,  283},
+    { 628, 0,  283}, { 629, 0,  284}, { 630, 0,  284}, { 631, 0,  284}, { 632, 0,  285},
+    { 633, 0,  285}, { 634, 0,  286}, { 635, 0,  286}, { 636, 0,  287}, { 637, 0,  287},
+    { 638, 0,  288}, { 639, 0,  288}, { 639, 0,  288}, { 640, 0,  288}, { 641, 0,  289},
+    { 642, 0,  289}, { 643, 0,  290}, { 644, 0,  290}, { 645, 0,  291}, { 646, 0,  291},
+    { 647, 0,  292}, { 648, 0,  292}, { 649, 0,  292}, { 650, 0,  293}, { 651, 0,  293},
+    { 652, 0,  294}, { 653, 0,  294}, { 654, 0,  295}, { 655, 0,  295}, { 656, 0,  296},
+    { 657, 0,  296}, { 658, 0,  297}, { 659, 0,  297}, { 660, 0,  297}, { 661, 0,  298},
+    { 662, 0,  298}, { 663, 0,  299}, { 665, 0,  300}, { 666, 0,  300}, { 667, 0,  301},
+    { 668, 0,  301}, { 669, 0,  302}, { 670, 0,  302}, { 671, 0,  302}, { 672, 0,  303},
+    { 673, 0,  303}, { 674, 0,  304}, { 675, 0,  304}, { 676, 0,  305}, { 678, 0,  306},
+    { 679, 0,  306}, { 680, 0,  306}, { 681, 0,  307}, { 682, 0,  307}, { 683, 0,  308},
+    { 684, 0,  308}, { 686, 0,  309}, { 687, 0,  310}, { 688, 0,  310}, { 689, 0,  310},
+    { 690, 0,  311}, { 692, 0,  312}, { 693, 0,  312}, { 694, 0,  313}, { 695, 0,  313},
+    { 696, 0,  314}, { 698, 0,  315}, { 699, 0,  315}, { 700, 0,  315}, { 701, 0,  316},
+    { 703, 0,  317}, { 704, 0,  317}, { 705, 0,  318}, { 706, 0,  318}, { 708, 0,  319},
+    { 709, 0,  320}, { 710, 0,  320}, { 711, 0,  320}, { 713, 0,  321}, { 714, 0,  322},
+    { 715, 0,  322}, { 717, 0,  323}, { 718, 0,  324}, { 719, 0,  324}, { 721, 0,  325},
+    { 722, 0,  325}, { 723, 0,  326}, { 725, 0,  327}, { 726, 0,  327}, { 728, 0,  328},
+    { 729, 0,  328}, { 730, 0,  329}, { 732, 0,  330}, { 733, 0,  330}, { 735, 0,  331},
+    { 736, 0,  332}, { 738, 0,  333}, { 739, 0,  333}, { 740, 0,  333}, { 742, 0,  334},
+    { 743, 0,  335}, { 745, 0,  336}, { 746, 0,  336}, { 748, 0,  337}, { 749, 0,  338},
+    { 751, 0,  338}, { 752, 0,  339}, { 754, 0,  340}, { 756, 0,  341}, { 757, 0,  341},
+    { 759, 0,  342}, { 760, 0,  342}, { 762, 0,  343}, { 763, 0,  344}, { 765, 0,  345},
+    { 767, 0,  346}, { 768, 0,  346}, { 770, 0,  347}, { 772, 0,  348}, { 773, 0,  348},
+    { 775, 0,  349}, { 777, 0,  350}, { 778, 0,  351}, { 780, 0,  351}, { 782, 0,  352},
+    { 783, 0,  353}, { 785, 0,  354}, { 787, 0,  355}, { 789, 0,  356}, { 791, 0,  356},
+    { 792, 0,  357}, { 794, 0,  358}, { 796, 0,  359}, { 798, 0,  360}, { 800, 0,  360},
+    { 801, 0,  361}, { 803, 0,  362}, { 805, 0,  363}, { 807, 0,  364}, { 809, 0,  364},
+    { 811, 0,  365}, { 813, 0,  366}, { 815, 0,  367}, { 817, 0,  368}, { 819, 0,  369},
+    { 821, 0,  370}, { 823, 0,  371}, { 825, 0,  372}, { 827, 0,  373}, { 829, 0,  374},
+    { 831, 0,  374}, { 833, 0,  375}, { 835, 0,  376}, { 837, 0,  377}, { 839, 0,  378},
+    { 841, 0,  379}, { 844, 0,  380}, { 846, 0,  381}, { 848, 0,  382}, { 850, 0,  383},
+    { 852, 0,  384}, { 855, 0,  385}, { 857, 0,  386}, { 859, 0,  387}, { 861, 0,  388},
+    { 864, 0,  389}, { 866, 0,  390}, { 868, 0,  391}, { 871, 0,  392}, { 873, 0,  393},
+    { 876, 0,  395}, { 878, 0,  396}, { 881, 0,  397}, { 883, 0,  398}, { 885, 0,  399},
+    { 888, 0,  400}, { 891, 0,  401}, { 893, 0,  402}, { 896, 0,  404}, { 898, 0,  405},
+    { 901, 0,  406}, { 904, 0,  407}, { 906, 0,  408}, { 909, 0,  410}, { 912, 0,  411},
+    { 914, 0,  412}, { 917, 0,  413}, { 920, 0,  414}, { 923, 0,  416}, { 926, 0,  417},
+    { 928, 0,  418}, { 931, 0,  419}, { 934, 0,  421}, { 937, 0,  422}, { 940, 0,  423},
+    { 943, 0,  425}, { 946, 0,  426}, { 949, 0,  428}, { 952, 0,  429}, { 956, 0,  431},
+    { 959, 0,  432}, { 962, 0,  433}, { 965, 0,  435}, { 968, 0,  436}, { 972, 0,  438},
+    { 975, 0,  439}, { 978, 0,  441}, { 982, 0,  442}, { 985, 0,  444}, { 989, 0,  446},
+    { 992, 0,  447}, { 996, 0,  449}, { 999, 0,  450}, {1003, 0,  452}, {1007, 0,  454},
+    {1010, 0,  455}, {1014, 0,  457}, {1018, 0,  459}, {1022, 0,  460}, {1026, 0,  462},
+    {1029, 0,  464}, {1033, 0,  465}, {1037, 0,  467}, {1041, 0,  469}, {1045, 0,  471},
+    {1050, 0,  473}, {1054, 0,  475}, {1058, 0,  477}, {1062, 0,  478}, {1067, 0,  481},
+    {1071, 0,  482}, {1076, 0,  485}, {1080, 0,  486}, {1085, 0,  489}, {1089, 0,  490},
+    {1094, 0,  493}, {1099, 0,  495}, {1104, 0,  497}, {1108, 0,  499}, {1113, 0,  501},
+    {1118, 0,  504}, {1123, 0,  506}, {1130, 0,  509}, {1135, 0,  511}, {1140, 0,  513},
+    {1145, 0,  516}, {1151, 0,  518}, {1156, 0,  521}, {1162, 0,  523}, {1168, 0,  526},
+    {1173, 0,  528}, {1179, 0,  531}, {1185, 0,  534}, {1191, 0,  536}, {1197, 0,  539},
+    {1203, 0,  542}, {1210, 0,  545}, {1216, 0,  548}, {1223, 0,  551}, {1229, 0,  554},
+    {1236, 0,  557}, {1243, 0,  560}, {1250, 0,  563}, {1257, 0,  566}, {1264, 0,  569},
+    {1271, 0,  572}, {1279, 0,  576}, {1286, 0,  579}, {1294, 0,  583}, {1302, 0,  586},
+    {1310, 0,  590}, {1318, 0,  594}, {1326, 0,  597}, {1335, 0,  601}, {1343, 0,  605},
+    {1352, 0,  609}, {1361, 0,  613}, {1370, 0,  617}, {1380, 0,  621}, {1389, 0,  626},
+    {1399, 0,  630}, {1409, 0,  634}, {1419, 0,  639}, {1429, 0,  644}, {1440, 0,  648},
+    {1451, 0,  653}, {1462, 0,  658}, {1473, 0,  663}, {1485, 0,  669}, {1497, 0,  674},
+    {1509, 0,  680}, {1521, 0,  685}, {1534, 0,  691}, {1547, 0,  697}, {1561, 0,  703},
+    {1574, 0,  709}, {1589, 0,  716}, {1603, 0,  722}, {1618, 0,  729}, {1634, 0,  736},
+    {1649, 0,  742}, {1666, 0,  750}, {1683, 0,  758}, {1700, 0,  765}, {1718, 0,  774},
+    {1736, 0,  782}, {1755, 0,  790}, {1775, 0,  799}, {1795, 0,  808}, {1816, 0,  818},
+    {1838, 0,  828}, {1861, 0,  838}, {1884, 0,  848}, {1909, 0,  860}, {1934, 0,  871},
+    {1960, 0,  882}, {1988, 0,  895}, {2017, 0,  908}, {2047, 0,  922}, {2078, 0,  936},
+    {2111, 0,  950}, {2145, 0,  966}, {2181, 0,  982}, {2219, 0,  999}, {2259, 0, 1017},
+    {2302, 0, 1036}, {2346, 0, 1056}, {2394, 0, 1078}, {2444, 0, 1100}
+};
@@ -0,0 +1,38 @@
+/**
+ * @file homing.h
+ * @author Paul Götzinger
+ * @brief 121.5 MHz homing signal: swept tone amplitude modulation as a precomputed table of audio
+ * cycles, loaded cycle by cycle into the keying timer of the homing transmitter
+ * @version 1.0
+ * @date 2019-04-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef HOMING_H
+#define HOMING_H
+
+#include <stdint.h>
+
+#define HOM_TICK_RATE      1000000  //timer ticks per second, the cycles are whole us
+#define HOM_SWEEP_TICKS    333333   //one downward sweep from 1600 Hz to 409 Hz (3.0 sweeps per second)
+#define HOM_SWEEP_CYCLES   334      //audio cycles of one sweep
+
+/**
+ * @brief Audio cycle in the register layout of a timer DMA burst from ARR to CCR1
+ *
+ */
+typedef struct {
+    uint16_t arr;       //period - 1 in ticks
+    uint16_t reserved;  //register gap between ARR and CCR1, written as 0
+    uint16_t on;        //ticks the carrier is on at the start of the cycle
+} HOM_Cycle;
+
+/**
+ * @brief One sweep, repeated endlessly
+ *
+ */
+extern const HOM_Cycle HOM_Sweep[HOM_SWEEP_CYCLES];
+
+#endif //!HOMING_H
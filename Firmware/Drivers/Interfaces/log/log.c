@@ -10,16 +10,21 @@
   */
 #include "log.h"
 #include "usb.h"
+#include "memory.h"
 #include <stdio.h>
 #include <stdarg.h>
 
 #if LOG_DEST == LOG_UART || LOG_DEST == LOG_GPS
 #include "uart.h"
+#include "board.h"
 #endif
 
 #define BUFFER_LEN 256
 
+#if LOG_DEST != LOG_NONE
 static uint8_t buffer[BUFFER_LEN];
+MEM_BUFFER("log", buffer);
+#endif
 
 static uint8_t init = 0;
 
@@ -36,36 +41,10 @@ void LOG_Init()
 	USB_Init();
 #elif LOG_DEST == LOG_UART
 	//init uart for logging
-    UART_Config uart_conf;
-    
-    uart_conf.uart = USART2;
-    uart_conf.baud = UART_BaudRate_9600;
-    uart_conf.rxDmaChannel = DMA1_Channel5;
-    uart_conf.rxBoard = GPIOA;
-    uart_conf.rxPin = GPIO_PIN_2;
-    uart_conf.rxAF = GPIO_AF4_USART2;
-    uart_conf.txDmaChannel = DMA1_Channel4;
-    uart_conf.txBoard = GPIOA;
-    uart_conf.txPin = GPIO_PIN_3;
-    uart_conf.txAF = GPIO_AF4_USART2;
-    
-    UART_Init(&uart, &uart_conf);
+    UART_Init(&uart, &BOARD_LogUart);
 #elif LOG_DEST == LOG_GPS
 	//init uart for logging
-    UART_Config uart_conf;
-    
-    uart_conf.uart = USART4;
-    uart_conf.baud = UART_BaudRate_9600;
-    uart_conf.rxDmaChannel = DMA1_Channel6;
-    uart_conf.rxBoard = GPIOC;
-    uart_conf.rxPin = GPIO_PIN_11;
-    uart_conf.rxAF = GPIO_AF6_USART4;
-    uart_conf.txDmaChannel = DMA1_Channel7;
-    uart_conf.txBoard = GPIOC;
-    uart_conf.txPin = GPIO_PIN_10;
-    uart_conf.txAF = GPIO_AF6_USART4;
-    
-    UART_Init(&uart, &uart_conf);
+    UART_Init(&uart, &BOARD_GnssUart);
 #endif
 	init = 1;
 }
@@ -73,6 +52,10 @@ void LOG_Init()
 
 void LOG_Log(const char * format, ...)
 {
+#if LOG_DEST == LOG_NONE
+	//no logging, no buffer
+	return;
+#else
 	if (init == 0) {
 		return;
 	}
@@ -82,9 +65,7 @@ void LOG_Log(const char * format, ...)
 	
 	uint16_t len = vsnprintf ((char*)buffer, BUFFER_LEN, format, args);
 
-#if LOG_DEST == LOG_NONE
-	//no logging, should skipped becaus no init
-#elif LOG_DEST == LOG_USB
+#if LOG_DEST == LOG_USB
 	USB_SendData (buffer, len);
 	HAL_Delay(2);
 #elif LOG_DEST == LOG_UART || LOG_DEST == LOG_GPS
@@ -93,9 +74,14 @@ void LOG_Log(const char * format, ...)
 #endif
 
 	va_end (args); 
+#endif
 }
 
 void LOG_BitArray(uint8_t *array, uint16_t len) {
+#if LOG_DEST == LOG_NONE
+	//no logging, no buffer
+	return;
+#else
 	if (array != 0 && len >= BUFFER_LEN-1) {
 		return;
 	}
@@ -104,14 +90,12 @@ void LOG_BitArray(uint8_t *array, uint16_t len) {
 	}
 	buffer[len] = '\n';
 	
-#if LOG_DEST == LOG_NONE
-	//no logging, should skipped becaus no init
-#elif LOG_DEST == LOG_USB
+#if LOG_DEST == LOG_USB
 	USB_SendData(buffer, len+1);
 	HAL_Delay(2);
 #elif LOG_DEST == LOG_UART || LOG_DEST == LOG_GPS
 	//send data  via uart
 	UART_SendData(&uart, len, buffer);
 #endif
-
+#endif
 }
@@ -27,13 +27,18 @@
 #define NMEA_TYPE_STR_GNVTG "GNVTG"
 #define NMEA_TYPE_STR_GNRMC "GNRMC"
 
-#define NMEA_GPGLL_LENGTH 60    // TODO: check real length
+#define NMEA_HEX_INVALID 0xFF   //never matches a checksum nibble
+
+static const char* const typeNames[NMEA_Type_Count] = {
+    "unknown", NMEA_TYPE_STR_GPGLL, NMEA_TYPE_STR_GNGLL, NMEA_TYPE_STR_GLGSB, NMEA_TYPE_STR_GPGSV,
+    NMEA_TYPE_STR_GNGSA, NMEA_TYPE_STR_GNGGA, NMEA_TYPE_STR_GNVTG, NMEA_TYPE_STR_GNRMC
+};
 
 /**
  * @brief Parses character as hex digit
  * 
- * @param ch 
- * @return uint8_t 
+ * @param ch character
+ * @return uint8_t value, NMEA_HEX_INVALID if not a hex digit
  */
 static uint8_t charToHex(uint8_t ch);
 
@@ -51,12 +56,38 @@ static void parse(NMEA_Instance* nmea);
  */
 static void parseGPGLL(NMEA_Instance* nmea);
 
+/**
+ * @brief parse GNGSA message (satellites used and dilution of precision)
+ * 
+ * @param nmea nmea instance structure
+ */
+static void parseGNGSA(NMEA_Instance* nmea);
+
+/**
+ * @brief parse GPGSV message (satellites in view)
+ * 
+ * @param nmea nmea instance structure
+ */
+static void parseGPGSV(NMEA_Instance* nmea);
+
+/**
+ * @brief Read numeric field
+ * 
+ * @param buf start of field
+ * @param value parsed value
+ * @return uint8_t 1 if the field is not empty
+ */
+static uint8_t readField(const char *buf, uint16_t *value);
+
 void NMEA_Init(NMEA_Instance* nmea) {
     if (nmea != 0) {
         //init state and callback
         nmea->state = NMEA_State_IDLE;
         nmea->cb_pos = 0;
+        nmea->cb_qual = 0;
+        nmea->cb_sat = 0;
         nmea->cb_unk = 0;
+        NMEA_ResetCounters(nmea);
     }
 }
 
@@ -64,6 +95,10 @@ void NMEA_Process(NMEA_Instance* nmea, uint8_t byte) {
     if (nmea != 0) {
         //check for start byte
         if (byte == '$') {
+            if (nmea->state != NMEA_State_IDLE) {
+                //previous sentence was cut off
+                nmea->framing++;
+            }
             //init message and set next state
             nmea->state = NMEA_State_TYPE;
             nmea->idx = 0;
@@ -104,11 +139,13 @@ void NMEA_Process(NMEA_Instance* nmea, uint8_t byte) {
                         } else {
                             //cancel message
                             nmea->state = NMEA_State_IDLE;
+                            nmea->framing++;
                         }
                     //check if index is out of range
                     } else if (nmea->idx >= NMEA_TYPE_STR_LENGTH) {
                         //cancel message
                         nmea->state = NMEA_State_IDLE;
+                        nmea->framing++;
                     } else {
                         //save character
                         nmea->data[nmea->idx++] = byte;
@@ -117,16 +154,16 @@ void NMEA_Process(NMEA_Instance* nmea, uint8_t byte) {
                     nmea->cs = nmea->cs ^ byte;
                     break;
                 case NMEA_State_DATA:
-                    //check fro delimiter character
+                    //check for delimiter character, not part of the checksum
                     if (byte == '*') {
                         //set next state
                         nmea->state = NMEA_State_CS0;
-                        nmea->data[nmea->idx++] = 0;
-                    }
+                        nmea->data[nmea->idx] = 0;
                     //check if index is out of range
-                    if (nmea->idx >= NMEA_DATA_LENGTH) {
+                    } else if (nmea->idx >= NMEA_DATA_LENGTH) {
                         //cancel message
                         nmea->state = NMEA_State_IDLE;
+                        nmea->counter[nmea->type].overlength++;
                     } else {
                         //store byte
                         nmea->data[nmea->idx++] = byte;
@@ -134,22 +171,41 @@ void NMEA_Process(NMEA_Instance* nmea, uint8_t byte) {
                     }
                     break;
                 case NMEA_State_CS0:
-                    nmea->state = charToHex(byte) & nmea->cs >> 4 ? NMEA_State_CS1 : NMEA_State_IDLE;
+                    //checksum is compared nibble by nibble, it was accumulated while receiving
+                    if (charToHex(byte) == nmea->cs >> 4) {
+                        nmea->state = NMEA_State_CS1;
+                    } else {
+                        nmea->state = NMEA_State_IDLE;
+                        nmea->counter[nmea->type].checksum++;
+                    }
                     break;
                 case NMEA_State_CS1:
-                    nmea->state = charToHex(byte) & nmea->cs ? NMEA_State_CR : NMEA_State_IDLE;
+                    if (charToHex(byte) == (nmea->cs & 0x0F)) {
+                        nmea->state = NMEA_State_CR;
+                    } else {
+                        nmea->state = NMEA_State_IDLE;
+                        nmea->counter[nmea->type].checksum++;
+                    }
                     break;
                 case NMEA_State_CR:
                     //check for carriage return
                     // true:  next state
                     // false: cancel message
-                    nmea->state = byte == '\r' ? NMEA_State_LF : NMEA_State_IDLE;
+                    if (byte == '\r') {
+                        nmea->state = NMEA_State_LF;
+                    } else {
+                        nmea->state = NMEA_State_IDLE;
+                        nmea->framing++;
+                    }
                     break;
                 case NMEA_State_LF:
                     //check for linefeed
                     if (byte == '\n') {
                         //parse message
+                        nmea->counter[nmea->type].accepted++;
                         parse(nmea);
+                    } else {
+                        nmea->framing++;
                     }
                     //set idle state
                     nmea->state = NMEA_State_IDLE;
@@ -168,6 +224,20 @@ void NMEA_SetPositionCallback(NMEA_Instance* nmea, NMEA_Callback_Position cb) {
     }
 }
 
+void NMEA_SetQualityCallback(NMEA_Instance* nmea, NMEA_Callback_Quality cb) {
+    if (nmea != 0) {
+        //set callback
+        nmea->cb_qual = cb;
+    }
+}
+
+void NMEA_SetSatellitesCallback(NMEA_Instance* nmea, NMEA_Callback_Satellites cb) {
+    if (nmea != 0) {
+        //set callback
+        nmea->cb_sat = cb;
+    }
+}
+
 void NMEA_SetUnknownCallback(NMEA_Instance* nmea, NMEA_Callback_Unknown cb) {
     if (nmea != 0) {
         //set callback
@@ -175,13 +245,24 @@ void NMEA_SetUnknownCallback(NMEA_Instance* nmea, NMEA_Callback_Unknown cb) {
     }
 }
 
+void NMEA_ResetCounters(NMEA_Instance* nmea) {
+    if (nmea != 0) {
+        memset(nmea->counter, 0, sizeof(nmea->counter));
+        nmea->framing = 0;
+    }
+}
+
+const char* NMEA_GetTypeName(NMEA_Type type) {
+    return type < NMEA_Type_Count ? typeNames[type] : 0;
+}
+
 static uint8_t charToHex(uint8_t ch) {
     if (ch >= '0' && ch <= '9') {
         return ch - '0';
     } else if (tolower(ch) >= 'a' && tolower(ch) <= 'f') {
         return 10 + tolower(ch) - 'a';
     }
-    return 0;
+    return NMEA_HEX_INVALID;
 }
 
 static void parse(NMEA_Instance* nmea) {
@@ -191,6 +272,16 @@ static void parse(NMEA_Instance* nmea) {
             case NMEA_Type_GPGLL:
                 parseGPGLL(nmea);
                 break;
+            case NMEA_Type_GNGSA:
+                parseGNGSA(nmea);
+                break;
+            case NMEA_Type_GPGSV:
+                parseGPGSV(nmea);
+                //configuration is triggered by unknown sentences
+                if (nmea->cb_unk != 0) {
+                    nmea->cb_unk(nmea->type, nmea->data, nmea->idx);
+                }
+                break;
             default:
                 if (nmea->cb_unk != 0) {
                     nmea->cb_unk(nmea->type, nmea->data, nmea->idx);
@@ -201,23 +292,20 @@ static void parse(NMEA_Instance* nmea) {
 }
 
 static void parseGPGLL(NMEA_Instance* nmea) {
-    if (nmea != 0 && nmea->type == NMEA_Type_GPGLL && nmea->idx >= NMEA_GPGLL_LENGTH) {
+    if (nmea != 0 && nmea->type == NMEA_Type_GPGLL && nmea->cb_pos != 0) {
         POS_Position pos;
-        uint8_t *buf = nmea->data;
-
-        //read latitude
+        char *buf = (char*)nmea->data;
+        char *end;
 
-        //read degree
-        pos.latitude.degree = strtol((char*)buf, 0, 10);
-        if (pos.latitude.degree > 90) {
+        //read latitude (ddmm.mmmm)
+        uint32_t value = strtoul(buf, &end, 10);
+        if (end - buf != 4 || value / 100 > 90) {
             return;
         }
-        buf += 2;
+        pos.latitude.degree = value / 100;
+        pos.latitude.minute = strtod(buf + 2, &end);
+        buf = end + 1; //skip delimiter ','
 
-        //read minute
-        pos.latitude.minute = strtod((char*)buf, 0);
-        buf += 6; //skip delimiter ','
-        
         //read flag
         if (*buf == 'N') {
             pos.latitude.direction = POS_Latitude_Flag_N;
@@ -228,58 +316,44 @@ static void parseGPGLL(NMEA_Instance* nmea) {
         }
         buf += 2;
 
-        //read longitude
-
-        //read degree
-        pos.longitude.degree = strtol((char*)buf, 0, 10);
-        if (pos.longitude.degree > 180) {
+        //read longitude (dddmm.mmmm)
+        value = strtoul(buf, &end, 10);
+        if (end - buf != 5 || value / 100 > 180) {
             return;
         }
-        buf += 2;
+        pos.longitude.degree = value / 100;
+        pos.longitude.minute = strtod(buf + 3, &end);
+        buf = end + 1; //skip delimiter ','
 
-        //read minute
-        pos.longitude.minute = strtod((char*)buf, 0);
-        buf += 6; //skip delimiter ','
-        
         //read flag
         if (*buf == 'E') {
             pos.longitude.direction = POS_Longitude_Flag_E;
         } else if (*buf == 'W') {
-            pos.longitude.direction = POS_Longitude_Flag_E;
+            pos.longitude.direction = POS_Longitude_Flag_W;
         } else {
             return;
         }
         buf += 2;
-        
-        //read time
-
-        //read hour
-        pos.time.hour = strtol((char*)buf, 0, 10);
-        if (pos.time.hour > 23) {
-            return;
-        }
-        buf += 2;
 
-        //read minute
-        pos.time.minute = strtol((char*)buf, 0, 10);
-        if (pos.time.minute > 59) {
+        //read time (hhmmss.ss)
+        value = strtoul(buf, &end, 10);
+        if (end - buf != 6 || *end != '.') {
             return;
         }
-        buf += 2;
-        
-        //read second
-        pos.time.second = strtol((char*)buf, 0, 10);
-        if (pos.time.second > 59) {
+        pos.time.hour = value / 10000;
+        pos.time.minute = value / 100 % 100;
+        pos.time.second = value % 100;
+        if (pos.time.hour > 23 || pos.time.minute > 59 || pos.time.second > 59) {
             return;
         }
-        buf += 3;   //also skip decimal point
+        buf = end + 1;  //also skip decimal point
 
         //read split-second
-        pos.time.split = strtol((char*)buf, 0, 10);
+        pos.time.split = strtoul(buf, &end, 10);
         if (pos.time.split > 99) {
             return;
         }
-        buf += 2;
+        buf = end;
 
         //read valid flag
         if (*buf == ',' && *(buf+1) == 'A') {
@@ -287,8 +361,129 @@ static void parseGPGLL(NMEA_Instance* nmea) {
         } else {
             pos.valid = POS_Valid_Flag_Invalid;
         }
+        pos.source = POS_Source_Flag_Internal;
         
         //execute callback
         nmea->cb_pos(&pos);
     }
 }
+
+static void parseGNGSA(NMEA_Instance* nmea) {
+    if (nmea != 0 && nmea->type == NMEA_Type_GNGSA && (nmea->cb_qual != 0 || nmea->cb_sat != 0)) {
+        POS_Quality quality;
+        NMEA_Satellite sv[NMEA_SV_PER_SENTENCE];
+        char *buf = (char*)nmea->data;
+        char *end;
+        uint16_t prn;
+
+        memset(&quality, 0, sizeof(POS_Quality));
+
+        //skip selection mode, read fix type (1: no fix, 2: 2D, 3: 3D)
+        buf = strchr(buf, ',');
+        if (buf == 0) {
+            return;
+        }
+        uint8_t fix = strtoul(buf + 1, &end, 10);
+
+        //count used satellites, 12 fields
+        for (uint8_t i = 0; i < 12; i++) {
+            buf = strchr(buf + 1, ',');
+            if (buf == 0) {
+                return;
+            }
+            if (readField(buf + 1, &prn) && prn <= UINT8_MAX) {
+                sv[quality.satellites].prn = prn;
+                sv[quality.satellites].elevation = -128;
+                sv[quality.satellites].cn0 = 0;
+                sv[quality.satellites].used = 1;
+                quality.satellites++;
+            }
+        }
+
+        //skip pdop, read hdop
+        buf = strchr(buf + 1, ',');
+        if (buf == 0) {
+            return;
+        }
+        buf = strchr(buf + 1, ',');
+        if (buf == 0) {
+            return;
+        }
+        float hdop = strtod(buf + 1, &end);
+        if (end == buf + 1 || hdop < 0 || hdop > 99.99f) {
+            return;
+        }
+        quality.hdop = hdop * 100 + 0.5f;
+
+        //satellites of a sentence without fix are not used in a solution
+        if (fix < 2) {
+            quality.satellites = 0;
+            quality.hdop = 0;
+        }
+
+        //execute callbacks
+        if (nmea->cb_sat != 0 && quality.satellites > 0) {
+            nmea->cb_sat(sv, quality.satellites);
+        }
+        if (nmea->cb_qual != 0) {
+            nmea->cb_qual(&quality);
+        }
+    }
+}
+
+static void parseGPGSV(NMEA_Instance* nmea) {
+    if (nmea != 0 && nmea->type == NMEA_Type_GPGSV && nmea->cb_sat != 0) {
+        NMEA_Satellite sv[4];
+        uint8_t count = 0;
+        uint16_t value;
+        char *buf = (char*)nmea->data;
+
+        //skip number of sentences, sentence number and satellites in view
+        for (uint8_t i = 0; i < 3; i++) {
+            buf = strchr(buf, ',');
+            if (buf == 0) {
+                return;
+            }
+            buf++;
+        }
+
+        //blocks of prn, elevation, azimuth, C/N0 (an odd trailing field is the signal id)
+        while (count < 4 && buf != 0) {
+            NMEA_Satellite *s = &sv[count];
+            char *field[4];
+
+            for (uint8_t i = 0; i < 4; i++) {
+                field[i] = buf;
+                buf = buf != 0 ? strchr(buf, ',') : 0;
+                buf = buf != 0 ? buf + 1 : 0;
+                if (buf == 0 && i < 3) {
+                    field[3] = 0;
+                    break;
+                }
+            }
+            if (field[3] == 0 || !readField(field[0], &value) || value == 0 || value > UINT8_MAX) {
+                break;
+            }
+            s->prn = value;
+            s->elevation = readField(field[1], &value) && value <= 90 ? (int8_t)value : -128;
+            s->cn0 = readField(field[3], &value) && value <= 99 ? value : 0;
+            s->used = 0;
+            count++;
+        }
+
+        //execute callback
+        if (count > 0) {
+            nmea->cb_sat(sv, count);
+        }
+    }
+}
+
+static uint8_t readField(const char *buf, uint16_t *value) {
+    char *end;
+
+    if (buf == 0) {
+        return 0;
+    }
+    *value = strtoul(buf, &end, 10);
+    return end != buf;
+}
\ No newline at end of file
@@ -15,6 +15,7 @@
 #include "position.h"
 
 #define NMEA_DATA_LENGTH 72 //length of nmea paylaod buffer
+#define NMEA_SV_PER_SENTENCE 12 //satellites of one GSA sentence (GSV: 4)
 
 /**
  * @brief Nmea message state
@@ -43,9 +44,20 @@ typedef enum {
     NMEA_Type_GNGSA,
     NMEA_Type_GNGGA,
     NMEA_Type_GNVTG,
-    NMEA_Type_GNRMC
+    NMEA_Type_GNRMC,
+    NMEA_Type_Count
 } NMEA_Type;
 
+/**
+ * @brief Nmea sentence counters of one type (NMEA_Type_NONE: unknown types)
+ * 
+ */
+typedef struct {
+    uint32_t accepted;      //complete sentences with valid checksum
+    uint32_t checksum;      //checksum mismatch
+    uint32_t overlength;    //payload longer than NMEA_DATA_LENGTH
+} NMEA_Counter;
+
 /**
  * @brief Nmea position callback
  * 
@@ -54,6 +66,34 @@ typedef enum {
  */
 typedef void (*NMEA_Callback_Position)(POS_Position *pos);
 
+/**
+ * @brief Satellite reported by GSV (in view) or GSA (used in fix)
+ * 
+ */
+typedef struct {
+    uint8_t prn;            //satellite number
+    int8_t elevation;       //deg, -128 if not reported (always for GSA)
+    uint8_t cn0;            //C/N0 in dBHz, 0 if not tracked (always for GSA)
+    uint8_t used;           //1: reported by GSA
+} NMEA_Satellite;
+
+/**
+ * @brief Nmea fix quality callback (GSA, one sentence per constellation)
+ * 
+ * @param quality satellites used and hdop, accuracy is not reported
+ * 
+ */
+typedef void (*NMEA_Callback_Quality)(POS_Quality *quality);
+
+/**
+ * @brief Nmea satellites callback (GSV and GSA)
+ * 
+ * @param sv satellites of the sentence
+ * @param count number of satellites
+ * 
+ */
+typedef void (*NMEA_Callback_Satellites)(NMEA_Satellite *sv, uint8_t count);
+
 /**
  * @brief Nmea unknown callback
  * 
@@ -70,10 +110,14 @@ typedef struct {
     NMEA_State state;
     NMEA_Type type;
     NMEA_Callback_Position cb_pos;
+    NMEA_Callback_Quality  cb_qual;
+    NMEA_Callback_Satellites cb_sat;
     NMEA_Callback_Unknown  cb_unk;
     uint8_t cs;
     uint8_t data[NMEA_DATA_LENGTH+1];
     uint8_t idx;
+    NMEA_Counter counter[NMEA_Type_Count];
+    uint32_t framing;       //malformed or truncated sentences (type field, line end, new start)
 } NMEA_Instance;
 
 /**
@@ -91,6 +135,22 @@ void NMEA_Init(NMEA_Instance* nmea);
  */
 void NMEA_SetPositionCallback(NMEA_Instance* nmea, NMEA_Callback_Position cb);
 
+/**
+ * @brief Set callback for fix quality
+ * 
+ * @param nmea nmea instance structure
+ * @param cb callback function
+ */
+void NMEA_SetQualityCallback(NMEA_Instance* nmea, NMEA_Callback_Quality cb);
+
+/**
+ * @brief Set callback for satellites in view and used in fix
+ * 
+ * @param nmea nmea instance structure
+ * @param cb callback function
+ */
+void NMEA_SetSatellitesCallback(NMEA_Instance* nmea, NMEA_Callback_Satellites cb);
+
 /**
  * @brief Set callback for unknown types
  * 
@@ -107,4 +167,19 @@ void NMEA_SetUnknownCallback(NMEA_Instance* nmea, NMEA_Callback_Unknown cb);
  */
 void NMEA_Process(NMEA_Instance* nmea, uint8_t byte);
 
+/**
+ * @brief Reset sentence counters
+ * 
+ * @param nmea nmea instance structure
+ */
+void NMEA_ResetCounters(NMEA_Instance* nmea);
+
+/**
+ * @brief Retrieve name of sentence type
+ * 
+ * @param type sentence type
+ * @return const char* name ("unknown" for NMEA_Type_NONE)
+ */
+const char* NMEA_GetTypeName(NMEA_Type type);
+
 #endif //NMEA_H
\ No newline at end of file
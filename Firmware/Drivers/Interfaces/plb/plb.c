@@ -1,5 +1,5 @@
 /**
- * @file plb.h
+ * @file plb.c
  * @author Paul Götzinger, Olia Sviridova
  * @brief PLB frame creation
  * @version 1.0
@@ -27,23 +27,15 @@ static uint16_t const sync_bit = 0b111111111111111; //from 1-15
 static uint16_t const frame_sync = 0b000101111; //from 16-24
 
 //PDF1
-static uint8_t  const format_flag = 0b1; //25 -> begin pdf1
-static uint8_t  const protocol_flag = 0b1; //26
-static uint16_t const country_code = 0b0011001011; //from 27-36; for Austria 203 in dec
-static uint8_t  const test_protocol = 0b111; //from 37-39; type of protocol
-static uint8_t  const typeplb = 0b110; //from 40-42; type->plb
-static uint8_t  const certif = 0b1; //43; Cospas-Sarsat Certif
-static uint32_t const serial_number = 0b11010000111011100101; //from 44-63; random
-static uint16_t const national_use = 0b0000000000; //from 64-73, if national not used all 10 bits should be '0'
-static uint16_t const certif_number = 0b1111111111; //from 74-83, random
-static uint8_t  const radiolocating = 0b01; //from 84-85; 121,5MHz
+static uint8_t  const format_flag = 0b1; //25 -> begin pdf1; bits 26-85 see PLB_Identity
 
-//BCH polynoms were generated with matlab function bchgenpoly
-static uint8_t  bch1_poly[22] = {1,0,0,1,1,0,1,1,0,1,1,0,0,1,1,1,1,0,0,0,1,1};
-static uint8_t bch2_poly[13] = {1,0,1,0,1,0,0,1,1,1,0,0,1};
+//precomputed pdf1 + bch1, identification does not change during runtime
+static uint8_t pdf1_bch1[LENPDF1_WITH_BCH1];
+static uint8_t initialized = 0;
 
-//PDF2
-static uint8_t const position_data_source = 0b1; //107; GPS internal
+//BCH polynoms were generated with matlab function bchgenpoly
+static const uint8_t bch1_poly[22] = {1,0,0,1,1,0,1,1,0,1,1,0,0,1,1,1,1,0,0,0,1,1};
+static const uint8_t bch2_poly[13] = {1,0,1,0,1,0,0,1,1,1,0,0,1};
 
 /**
  * @brief Encode data using bch algorithm
@@ -53,10 +45,40 @@ static uint8_t const position_data_source = 0b1; //107; GPS internal
  * @param n      data array length (length of output)
  * @param k      payload length (length of input)
  */
-static void bch_encode(uint8_t* data, uint8_t* g_poly, uint16_t n, uint16_t k);
+static void bch_encode(uint8_t* data, const uint8_t* g_poly, uint16_t n, uint16_t k);
+
+void PLB_Init(const PLB_Identity* id) {
+    if (id == 0) {
+        return;
+    }
+
+    //add bits into array for pdf1 and calculate the bch_code for pdf1
+    BitArray_t data1;
+    BITARRAY_Init(&data1, pdf1_bch1, LENPDF1);
+    BITARRAY_AddBits(&data1, format_flag, 1);
+    BITARRAY_AddBits(&data1, id->protocolFlag, 1);
+    BITARRAY_AddBits(&data1, id->countryCode, 10);
+    BITARRAY_AddBits(&data1, id->testProtocol, 3);
+    BITARRAY_AddBits(&data1, id->beaconType, 3);
+    BITARRAY_AddBits(&data1, id->certif, 1);
+    BITARRAY_AddBits(&data1, id->serialNumber, 20);
+    BITARRAY_AddBits(&data1, id->nationalUse, 10);
+    BITARRAY_AddBits(&data1, id->certifNumber, 10);
+    BITARRAY_AddBits(&data1, id->radiolocating, 2);
+
+    LOG("[PLB] PDF1: ");
+    LOG_BITARRAY(pdf1_bch1, LENPDF1);
+    
+    bch_encode(pdf1_bch1, bch1_poly, LENPDF1_WITH_BCH1, LENPDF1);
+
+    LOG("[PLB] PDF1 + BCH: ");
+    LOG_BITARRAY(pdf1_bch1, LENPDF1_WITH_BCH1);
+
+    initialized = 1;
+}
 
 uint16_t PLB_CreateFrame(uint8_t *frame, uint8_t len, POS_Position* pos) {
-    if (frame == 0 || len == 0 || len < LENALL 
+    if (frame == 0 || len == 0 || len < LENALL || initialized == 0
             || pos == 0 || pos->valid == POS_Valid_Flag_Invalid) {
         return 0;
     }
@@ -70,34 +92,14 @@ uint16_t PLB_CreateFrame(uint8_t *frame, uint8_t len, POS_Position* pos) {
     LOG("[PLB] Protocol sync bits: ");
     LOG_BITARRAY(frame, LENSYNC);
     
-    //add bits into array for pdf1 and calculate the bch_code for pdf1
-    uint8_t *pdf1 = frame+LENSYNC;
-    BitArray_t data1;
-    BITARRAY_Init(&data1, pdf1, LENPDF1);
-    BITARRAY_AddBits(&data1, format_flag, 1);
-    BITARRAY_AddBits(&data1, protocol_flag, 1);
-    BITARRAY_AddBits(&data1, country_code, 10);
-    BITARRAY_AddBits(&data1, test_protocol, 3);
-    BITARRAY_AddBits(&data1, typeplb, 3);
-    BITARRAY_AddBits(&data1, certif, 1);
-    BITARRAY_AddBits(&data1, serial_number, 20);
-    BITARRAY_AddBits(&data1, national_use, 10);
-    BITARRAY_AddBits(&data1, certif_number, 10);
-    BITARRAY_AddBits(&data1, radiolocating, 2);
-
-    LOG("[PLB] PDF1: ");
-    LOG_BITARRAY(pdf1, LENPDF1);
-    
-    bch_encode(pdf1, bch1_poly, LENPDF1_WITH_BCH1, LENPDF1);
-
-    LOG("[PLB] PDF1 + BCH: ");
-    LOG_BITARRAY(pdf1, LENPDF1_WITH_BCH1);
+    //pdf1 and bch1 are precomputed
+    memcpy(frame+LENSYNC, pdf1_bch1, LENPDF1_WITH_BCH1);
     
     //add bits into array for pdf2 and calculate the bch_code for pdf2
     uint8_t *pdf2 = frame+LENSYNC+LENPDF1_WITH_BCH1;
     BitArray_t data2;
     BITARRAY_Init(&data2, pdf2, LENPDF2);
-    BITARRAY_AddBits(&data2, position_data_source, 1);
+    BITARRAY_AddBits(&data2, pos->source == POS_Source_Flag_Internal, 1);   //107; 1: internal, 0: external
     BITARRAY_AddBits(&data2, pos->latitude.direction, 1);
     BITARRAY_AddBits(&data2, pos->latitude.degree, 7);
     BITARRAY_AddBits(&data2, pos->latitude.minute/MIN_DIV, 4);
@@ -116,7 +118,25 @@ uint16_t PLB_CreateFrame(uint8_t *frame, uint8_t len, POS_Position* pos) {
     return LENALL;
 }
 
-static void bch_encode(uint8_t* data, uint8_t* g_poly, uint16_t n, uint16_t k){
+uint64_t PLB_GetBeaconId(const PLB_Identity* id) {
+    if (id == 0) {
+        return 0;
+    }
+
+    //15 hex id: pdf1 bits 26-85
+    uint64_t hexId = id->protocolFlag & 0x1;
+    hexId = (hexId << 10) | (id->countryCode & 0x3FF);
+    hexId = (hexId << 3) | (id->testProtocol & 0x7);
+    hexId = (hexId << 3) | (id->beaconType & 0x7);
+    hexId = (hexId << 1) | (id->certif & 0x1);
+    hexId = (hexId << 20) | (id->serialNumber & 0xFFFFF);
+    hexId = (hexId << 10) | (id->nationalUse & 0x3FF);
+    hexId = (hexId << 10) | (id->certifNumber & 0x3FF);
+    hexId = (hexId << 2) | (id->radiolocating & 0x3);
+    return hexId;
+}
+
+static void bch_encode(uint8_t* data, const uint8_t* g_poly, uint16_t n, uint16_t k){
     uint8_t feedback;
     
     for (uint16_t i = 0; i < n - k; i++)
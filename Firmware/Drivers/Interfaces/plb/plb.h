@@ -14,6 +14,29 @@
 
 #include "position.h"
 
+/**
+ * @brief Beacon identification (pdf1 bits 26-85)
+ * 
+ */
+typedef struct {
+    uint8_t  protocolFlag;  //26; user protocol
+    uint16_t countryCode;   //27-36; country code
+    uint8_t  testProtocol;  //37-39; type of protocol
+    uint8_t  beaconType;    //40-42; type of beacon
+    uint8_t  certif;        //43; Cospas-Sarsat certification
+    uint32_t serialNumber;  //44-63; serial number
+    uint16_t nationalUse;   //64-73; national use
+    uint16_t certifNumber;  //74-83; certificate number
+    uint8_t  radiolocating; //84-85; auxiliary radio-locating device
+} PLB_Identity;
+
+/**
+ * @brief PLB initialization, precomputes pdf1 and bch1 of identification
+ * 
+ * @param id beacon identification
+ */
+void PLB_Init(const PLB_Identity* id);
+
 /**
  * @brief Create PLB frame
  * 
@@ -24,4 +47,12 @@
  */
 uint16_t PLB_CreateFrame(uint8_t *frame, uint8_t len, POS_Position* pos);
 
+/**
+ * @brief Retrieve beacon identification (15 hex id, pdf1 bits 26-85)
+ * 
+ * @param id beacon identification
+ * @return uint64_t 60 bit beacon id
+ */
+uint64_t PLB_GetBeaconId(const PLB_Identity* id);
+
 #endif /* PLB_H */
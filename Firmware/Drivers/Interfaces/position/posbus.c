@@ -0,0 +1,91 @@
+/**
+ * @file posbus.c
+ * @author Paul Götzinger
+ * @brief Position bus, versioned snapshots of the last position (seqlock)
+ * @version 1.0
+ * @date 2019-03-23
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "posbus.h"
+#include <string.h>
+
+//orders the sequence counter against the position copy
+#ifdef __ARM_ARCH
+#define BARRIER() __DMB()
+#else
+#define BARRIER() __sync_synchronize()
+#endif
+
+void POS_BusInit(POS_Bus *bus) {
+    memset(bus, 0, sizeof(POS_Bus));
+    bus->pos.valid = POS_Valid_Flag_Invalid;
+}
+
+void POS_BusPublish(POS_Bus *bus, POS_Position *pos) {
+    if (bus == 0 || pos == 0) {
+        return;
+    }
+
+    bus->seq++;     //odd: readers retry
+    BARRIER();
+    memcpy(&bus->pos, pos, sizeof(POS_Position));
+    BARRIER();
+    bus->seq++;
+
+    for (uint8_t i = 0; i < bus->subscriberCount; i++) {
+        if (bus->subscribers[i]->notify != 0) {
+            bus->subscribers[i]->notify();
+        }
+    }
+}
+
+uint32_t POS_BusRead(POS_Bus *bus, POS_Position *pos) {
+    if (bus == 0 || pos == 0) {
+        return 0;
+    }
+
+    //a reader interrupting the producer cannot wait for it, the attempts are limited
+    for (uint8_t i = 0; i < POS_BUS_RETRIES; i++) {
+        uint32_t seq = bus->seq;
+        if ((seq & 1) == 0) {
+            BARRIER();
+            memcpy(pos, &bus->pos, sizeof(POS_Position));
+            BARRIER();
+            if (bus->seq == seq) {
+                return seq / 2;
+            }
+        }
+        bus->retries++;
+    }
+    return 0;
+}
+
+uint32_t POS_BusGetVersion(POS_Bus *bus) {
+    return bus != 0 ? bus->seq / 2 : 0;
+}
+
+uint8_t POS_BusSubscribe(POS_Bus *bus, POS_Subscriber *sub, void (*notify)(void)) {
+    if (bus == 0 || sub == 0 || bus->subscriberCount >= POS_BUS_SUBSCRIBERS) {
+        return 0;
+    }
+
+    sub->seen = 0;
+    sub->notify = notify;
+    bus->subscribers[bus->subscriberCount++] = sub;
+    return 1;
+}
+
+uint8_t POS_BusChanged(POS_Bus *bus, POS_Subscriber *sub) {
+    return bus != 0 && sub != 0 && POS_BusGetVersion(bus) != sub->seen;
+}
+
+uint32_t POS_BusFetch(POS_Bus *bus, POS_Subscriber *sub, POS_Position *pos) {
+    uint32_t version = POS_BusRead(bus, pos);
+    if (version != 0 && sub != 0) {
+        sub->seen = version;
+    }
+    return version;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file posbus.h
+ * @author Paul Götzinger
+ * @brief Position bus, versioned snapshots of the last position (seqlock)
+ * @version 1.0
+ * @date 2019-03-23
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef POSBUS_H
+#define POSBUS_H
+
+#include <stdint.h>
+#include "position.h"
+
+#define POS_BUS_SUBSCRIBERS 4   //maximum subscribers per bus
+#define POS_BUS_RETRIES     4   //read attempts while the producer writes
+
+/**
+ * @brief Subscriber, remembers the last version it has seen
+ * (set seen to 0 to receive the current position again)
+ *
+ */
+typedef struct {
+    uint32_t seen;              //version of last fetched position
+    void (*notify)(void);       //called by the producer after publishing (may be 0)
+} POS_Subscriber;
+
+/**
+ * @brief Position bus with one producer, readers never block the producer
+ *
+ */
+typedef struct {
+    volatile uint32_t seq;      //odd while the producer writes, version = seq / 2
+    POS_Position pos;
+    POS_Subscriber *subscribers[POS_BUS_SUBSCRIBERS];
+    uint8_t subscriberCount;
+    volatile uint32_t retries;  //reads repeated because of a concurrent publish
+} POS_Bus;
+
+/**
+ * @brief Initialize bus, no position published yet (version 0)
+ *
+ * @param bus bus
+ */
+void POS_BusInit(POS_Bus *bus);
+
+/**
+ * @brief Publish position (single producer, may run in interrupt context)
+ *
+ * @param bus bus
+ * @param pos position, copied
+ */
+void POS_BusPublish(POS_Bus *bus, POS_Position *pos);
+
+/**
+ * @brief Read consistent snapshot of the last position
+ *
+ * @param bus bus
+ * @param pos copy of position
+ * @return uint32_t version, 0 if nothing published or the producer kept writing
+ */
+uint32_t POS_BusRead(POS_Bus *bus, POS_Position *pos);
+
+/**
+ * @brief Retrieve version of the last position
+ *
+ * @param bus bus
+ * @return uint32_t version, 0 if nothing published
+ */
+uint32_t POS_BusGetVersion(POS_Bus *bus);
+
+/**
+ * @brief Register subscriber (not interrupt safe, call during initialization)
+ *
+ * @param bus bus
+ * @param sub subscriber
+ * @param notify wake-up function called after each publish (may be 0)
+ * @return uint8_t 1 on success, 0 if all slots are taken
+ */
+uint8_t POS_BusSubscribe(POS_Bus *bus, POS_Subscriber *sub, void (*notify)(void));
+
+/**
+ * @brief Check if a position was published since the subscriber fetched the last one
+ *
+ * @param bus bus
+ * @param sub subscriber
+ * @return uint8_t 1 if changed
+ */
+uint8_t POS_BusChanged(POS_Bus *bus, POS_Subscriber *sub);
+
+/**
+ * @brief Read snapshot and mark it as seen by the subscriber
+ *
+ * @param bus bus
+ * @param sub subscriber
+ * @param pos copy of position
+ * @return uint32_t version, 0 if nothing published or the producer kept writing
+ */
+uint32_t POS_BusFetch(POS_Bus *bus, POS_Subscriber *sub, POS_Position *pos);
+
+#endif //!POSBUS_H
@@ -13,6 +13,7 @@
 #include "stdio.h"
 
 #define POS_STRLEN 61
+#define POS_M_PER_MINUTE 1852.0f	//one arc minute of latitude (nautical mile)
 
 int16_t POS_CmpTime(POS_Time *left, POS_Time *right) {
 	if (left == 0 || right == 0) {
@@ -35,4 +36,21 @@ int16_t POS_CmpTime(POS_Time *left, POS_Time *right) {
 	} else {
 		return ((int16_t)left->hour) - ((int16_t)right->hour);
 	}
+}
+
+uint32_t POS_Distance(POS_Position *left, POS_Position *right) {
+	if (left == 0 || right == 0) {
+		return UINT32_MAX;
+	}
+
+	//signed minutes, north and east positive
+	float lat = (left->latitude.degree * 60 + left->latitude.minute) * (left->latitude.direction == POS_Latitude_Flag_S ? -1 : 1)
+			- (right->latitude.degree * 60 + right->latitude.minute) * (right->latitude.direction == POS_Latitude_Flag_S ? -1 : 1);
+	float lon = (left->longitude.degree * 60 + left->longitude.minute) * (left->longitude.direction == POS_Longitude_Flag_W ? -1 : 1)
+			- (right->longitude.degree * 60 + right->longitude.minute) * (right->longitude.direction == POS_Longitude_Flag_W ? -1 : 1);
+
+	//larger of both axes, no square root on the m0+
+	lat = lat < 0 ? -lat : lat;
+	lon = lon < 0 ? -lon : lon;
+	return (lat > lon ? lat : lon) * POS_M_PER_MINUTE;
 }
\ No newline at end of file
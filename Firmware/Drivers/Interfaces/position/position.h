@@ -39,6 +39,15 @@ typedef enum {
 	POS_Valid_Flag_Valid
 } POS_Valid_Flag;
 
+/**
+ * @brief Position source flag
+ * 
+ */
+typedef enum {
+	POS_Source_Flag_Internal = 0,	//own gnss receiver
+	POS_Source_Flag_External		//external navigation device (phone)
+} POS_Source_Flag;
+
 /**
  * @brief Position timestamp
  * 
@@ -79,10 +88,31 @@ typedef struct {
 	POS_Latitude latitude;
 	POS_Longitude longitude;
 	POS_Valid_Flag valid;
+	POS_Source_Flag source;
 } POS_Position;
 
+/**
+ * @brief Quality of a fix, 0 if the receiver did not report the value
+ * 
+ */
+typedef struct {
+	uint8_t satellites;		//satellites used in the solution
+	uint16_t hdop;			//horizontal dilution of precision * 100
+	uint32_t accuracy;		//estimated horizontal accuracy in mm
+} POS_Quality;
+
 int16_t POS_CmpTime(POS_Time *left, POS_Time *right);
 
+/**
+ * @brief Approximate distance between two positions, larger of the north and east offsets
+ * (longitude minutes are not scaled by the latitude)
+ * 
+ * @param left position
+ * @param right position
+ * @return uint32_t distance in m
+ */
+uint32_t POS_Distance(POS_Position *left, POS_Position *right);
+
 uint16_t POS_ToString(POS_Position *pos, uint8_t* str, uint16_t len);
 
 #endif //!POSITION_H
\ No newline at end of file
@@ -0,0 +1,203 @@
+/**
+ * @file rlm.c
+ * @author Paul Götzinger
+ * @brief Galileo Return Link Message (RLM) decoder for I/NAV pages
+ * @version 1.0
+ * @date 2019-03-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include "rlm.h"
+
+#define INAV_WORDS        8     //data words of one I/NAV page pair
+#define ODD_PART          128   //bit offset of odd page part
+
+#define POS_EVEN_ODD      0     //even/odd flag
+#define POS_PAGE_TYPE     1     //page type (0: nominal, 1: alert)
+#define POS_SAR_START     (ODD_PART + 58) //SAR start bit
+#define POS_SAR_LONG      (ODD_PART + 59) //SAR long RLM flag
+#define POS_SAR_DATA      (ODD_PART + 60) //SAR RLM data
+#define POS_CRC           (ODD_PART + 82) //CRC-24Q
+
+#define EVEN_CRC_BITS     114   //even page part covered by CRC
+#define ODD_CRC_BITS      82    //odd page part covered by CRC
+
+#define CRC24Q_POLY       0x1864CFBUL
+#define CRC24Q_MASK       0xFFFFFFUL
+
+#define ID_BITS           60    //beacon id bits
+#define CODE_BITS         4     //message code bits
+#define PARAM_BITS        16    //short message parameter bits
+
+/**
+ * @brief Read bits of page pair (MSB first, bit 0 is MSB of word 0)
+ *
+ * @param words data words
+ * @param pos position of first bit
+ * @param cnt count of bits (max 32)
+ * @return uint32_t bits
+ */
+static uint32_t getBits(const uint8_t *words, uint16_t pos, uint8_t cnt);
+
+/**
+ * @brief Read bits of assembled message (MSB first)
+ *
+ * @param data message data
+ * @param pos position of first bit
+ * @param cnt count of bits (max 32)
+ * @return uint32_t bits
+ */
+static uint32_t getMsgBits(const uint8_t *data, uint16_t pos, uint8_t cnt);
+
+/**
+ * @brief Check CRC-24Q of page pair
+ *
+ * @param words data words
+ * @return uint8_t 1 if valid, 0 otherwise
+ */
+static uint8_t checkCrc(const uint8_t *words);
+
+/**
+ * @brief Evaluate completely assembled message
+ *
+ * @param rlm rlm instance structure
+ * @param slot assembly slot
+ */
+static void processMsg(RLM_Instance* rlm, RLM_Slot *slot);
+
+void RLM_Init(RLM_Instance* rlm, uint64_t beaconId, RLM_Callback cb) {
+    if (rlm != 0) {
+        memset(rlm, 0, sizeof(RLM_Instance));
+        rlm->beaconId = beaconId;
+        rlm->cb = cb;
+    }
+}
+
+void RLM_ProcessPage(RLM_Instance* rlm, uint8_t svId, const uint8_t *words, uint8_t numWords, uint32_t tick) {
+    if (rlm == 0 || words == 0 || numWords < INAV_WORDS || svId == 0) {
+        return;
+    }
+
+    //only nominal even/odd page pairs carry SAR data
+    if (getBits(words, POS_EVEN_ODD, 1) != 0 || getBits(words, ODD_PART + POS_EVEN_ODD, 1) != 1
+            || getBits(words, POS_PAGE_TYPE, 1) != 0) {
+        return;
+    }
+    if (!checkCrc(words)) {
+        rlm->crcErrors++;
+        return;
+    }
+    rlm->pages++;
+
+    //search assembly slot of satellite
+    RLM_Slot *slot = 0;
+    for (uint8_t i = 0; i < RLM_SLOT_COUNT; i++) {
+        if (rlm->slot[i].svId == svId) {
+            slot = &rlm->slot[i];
+            break;
+        }
+    }
+
+    //pages carry no sequence number: after a lost page the rest would join the wrong message
+    if (slot != 0 && slot->pages != 0 && tick - slot->last > RLM_PAGE_GAP) {
+        slot->pages = 0;
+    }
+
+    if (getBits(words, POS_SAR_START, 1)) {
+        //first page of new message; take free or oldest slot if satellite is unknown
+        if (slot == 0) {
+            for (uint8_t i = 0; i < RLM_SLOT_COUNT && slot == 0; i++) {
+                if (rlm->slot[i].svId == 0) {
+                    slot = &rlm->slot[i];
+                }
+            }
+            if (slot == 0) {
+                slot = &rlm->slot[rlm->next];
+                rlm->next = (rlm->next + 1) % RLM_SLOT_COUNT;
+            }
+        }
+        slot->svId = svId;
+        slot->pages = 0;
+        slot->longMsg = getBits(words, POS_SAR_LONG, 1);
+        memset(slot->data, 0, sizeof(slot->data));
+    } else if (slot == 0 || slot->pages == 0) {
+        //start of message missed
+        return;
+    }
+
+    //append page data
+    uint32_t bits = getBits(words, POS_SAR_DATA, RLM_PAGE_BITS);
+    uint16_t pos = slot->pages * RLM_PAGE_BITS;
+    for (uint8_t i = 0; i < RLM_PAGE_BITS; i++, pos++) {
+        if ((bits >> (RLM_PAGE_BITS - 1 - i)) & 1) {
+            slot->data[pos >> 3] |= 0x80 >> (pos & 7);
+        }
+    }
+    slot->pages++;
+    slot->last = tick;
+
+    //check if message is complete
+    if (slot->pages * RLM_PAGE_BITS >= (slot->longMsg ? RLM_MAX_BITS : RLM_SHORT_BITS)) {
+        processMsg(rlm, slot);
+        slot->svId = 0;
+        slot->pages = 0;
+    }
+}
+
+static uint32_t getBits(const uint8_t *words, uint16_t pos, uint8_t cnt) {
+    uint32_t bits = 0;
+
+    for (uint8_t i = 0; i < cnt; i++, pos++) {
+        const uint8_t *word = words + (pos >> 5) * 4;
+        uint8_t bit = 31 - (pos & 31);
+        //words are little endian
+        bits = (bits << 1) | ((word[bit >> 3] >> (bit & 7)) & 1);
+    }
+
+    return bits;
+}
+
+static uint32_t getMsgBits(const uint8_t *data, uint16_t pos, uint8_t cnt) {
+    uint32_t bits = 0;
+
+    for (uint8_t i = 0; i < cnt; i++, pos++) {
+        bits = (bits << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+    }
+
+    return bits;
+}
+
+static uint8_t checkCrc(const uint8_t *words) {
+    uint32_t crc = 0;
+
+    //crc over even page part and odd page part up to the crc field
+    for (uint16_t i = 0; i < EVEN_CRC_BITS + ODD_CRC_BITS; i++) {
+        uint16_t pos = i < EVEN_CRC_BITS ? i : ODD_PART + i - EVEN_CRC_BITS;
+        uint32_t bit = getBits(words, pos, 1);
+        crc = ((crc << 1) ^ ((((crc >> 23) & 1) ^ bit) ? CRC24Q_POLY : 0)) & CRC24Q_MASK;
+    }
+
+    return crc == getBits(words, POS_CRC, 24);
+}
+
+static void processMsg(RLM_Instance* rlm, RLM_Slot *slot) {
+    //beacon id is transmitted in the first 60 bits
+    uint64_t id = getMsgBits(slot->data, 0, ID_BITS - 32);
+    id = (id << 32) | getMsgBits(slot->data, ID_BITS - 32, 32);
+
+    if (id != rlm->beaconId) {
+        return;
+    }
+
+    RLM_Code code = (RLM_Code)getMsgBits(slot->data, ID_BITS, CODE_BITS);
+    uint16_t param = getMsgBits(slot->data, ID_BITS + CODE_BITS, PARAM_BITS);
+
+    LOG("[RLM] Message code %u param 0x%04x from SV %u\n", code, param, slot->svId);
+
+    if (rlm->cb != 0) {
+        rlm->cb(code, param);
+    }
+}
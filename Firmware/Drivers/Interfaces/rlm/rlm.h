@@ -0,0 +1,85 @@
+/**
+ * @file rlm.h
+ * @author Paul Götzinger
+ * @brief Galileo Return Link Message (RLM) decoder for I/NAV pages
+ * @version 1.0
+ * @date 2019-03-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef RLM_H
+#define RLM_H
+
+#define RLM_SLOT_COUNT   4      //count of satellites assembled in parallel
+#define RLM_MAX_BITS     160    //length of long return link message
+#define RLM_SHORT_BITS   80     //length of short return link message
+#define RLM_PAGE_BITS    20     //RLM data bits per I/NAV page
+#define RLM_PAGE_GAP     3000   //ms, a satellite sends a page pair every 2 s; a longer gap lost one
+
+/**
+ * @brief RLM message codes
+ *
+ */
+typedef enum {
+    RLM_Code_Ack = 0x1,         //acknowledgement service
+    RLM_Code_Command = 0x2,     //command service
+    RLM_Code_Message = 0x3,     //message service
+    RLM_Code_Test = 0xF         //test service
+} RLM_Code;
+
+/**
+ * @brief Callback for received return link message addressed to this beacon
+ *
+ * @param code message code
+ * @param param message parameters (short RLM bits 65-80)
+ */
+typedef void (*RLM_Callback)(RLM_Code code, uint16_t param);
+
+/**
+ * @brief Assembly slot for one satellite
+ *
+ */
+typedef struct {
+    uint8_t svId;               //satellite id, 0 if unused
+    uint8_t pages;              //count of received pages
+    uint8_t longMsg;            //long RLM flag
+    uint32_t last;              //tick of the last page
+    uint8_t data[RLM_MAX_BITS / 8]; //received RLM bits (MSB first)
+} RLM_Slot;
+
+/**
+ * @brief RLM decoder instance structure
+ *
+ */
+typedef struct {
+    uint64_t beaconId;          //15 hex id of this beacon
+    RLM_Callback cb;            //message callback
+    RLM_Slot slot[RLM_SLOT_COUNT];  //assembly slots
+    uint8_t next;               //next slot to replace
+    uint16_t pages;             //count of valid pages
+    uint16_t crcErrors;         //count of pages with wrong CRC
+} RLM_Instance;
+
+/**
+ * @brief RLM decoder initialization
+ *
+ * @param rlm rlm instance structure
+ * @param beaconId 60 bit beacon id (15 hex id) to listen for
+ * @param cb callback for messages addressed to beacon id
+ */
+void RLM_Init(RLM_Instance* rlm, uint64_t beaconId, RLM_Callback cb);
+
+/**
+ * @brief Process Galileo E1-B I/NAV page as delivered by UBX-RXM-SFRBX
+ *
+ * @param rlm rlm instance structure
+ * @param svId satellite id
+ * @param words 8 data words (4 bytes little endian each; even page part in words 0-3, odd page part in words 4-7)
+ * @param numWords count of data words
+ * @param tick ms tick at reception, an assembly is dropped if a page pair of its satellite is missing
+ */
+void RLM_ProcessPage(RLM_Instance* rlm, uint8_t svId, const uint8_t *words, uint8_t numWords, uint32_t tick);
+
+#endif /* RLM_H */
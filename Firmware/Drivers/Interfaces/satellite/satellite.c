@@ -0,0 +1,158 @@
+/**
+ * @file satellite.c
+ * @author Paul Götzinger
+ * @brief Satellite visibility table and time to fix prediction
+ * @version 1.0
+ * @date 2019-03-25
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "satellite.h"
+#include <string.h>
+
+#define WEAK_BROADCASTS 3   //ephemeris broadcasts needed with weak signals (lost data bits)
+
+static const char* const skyNames[] = {
+    "unknown", "blocked", "weak", "good", "fix"
+};
+
+/**
+ * @brief Search entry of satellite, allocate free or oldest entry if not found
+ *
+ * @param table table
+ * @param prn satellite number
+ * @return SAT_Entry* entry
+ */
+static SAT_Entry* findEntry(SAT_Table *table, uint8_t prn);
+
+/**
+ * @brief Clear flags of the previous epoch with the first report of a new epoch
+ *
+ * @param table table
+ */
+static void startEpoch(SAT_Table *table);
+
+void SAT_Init(SAT_Table *table) {
+    memset(table, 0, sizeof(SAT_Table));
+    table->prediction.sky = SAT_Sky_Unknown;
+    table->prediction.ttff = SAT_TTFF_NEVER;
+}
+
+void SAT_Report(SAT_Table *table, uint8_t prn, int8_t elevation, uint8_t cn0) {
+    if (table == 0 || prn == 0) {
+        return;
+    }
+    startEpoch(table);
+
+    SAT_Entry *sv = findEntry(table, prn);
+    sv->elevation = elevation;
+    sv->cn0 = cn0;
+    sv->seen = 1;
+    sv->age = 0;
+}
+
+void SAT_MarkUsed(SAT_Table *table, uint8_t prn) {
+    if (table == 0 || prn == 0) {
+        return;
+    }
+    startEpoch(table);
+
+    SAT_Entry *sv = findEntry(table, prn);
+    sv->used = 1;
+    sv->seen = 1;
+    sv->age = 0;
+}
+
+void SAT_EndEpoch(SAT_Table *table) {
+    if (table == 0) {
+        return;
+    }
+    //epoch without any report: flags of the previous epoch must not count again
+    startEpoch(table);
+
+    SAT_Prediction *p = &table->prediction;
+    uint8_t trackable = 0;
+
+    p->visible = 0;
+    p->decodable = 0;
+    p->used = 0;
+    for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+        SAT_Entry *sv = &table->sv[i];
+        if (sv->prn == 0) {
+            continue;
+        }
+        if (sv->seen == 0 && ++sv->age > SAT_MAX_AGE) {
+            sv->prn = 0;
+            continue;
+        }
+
+        p->visible++;
+        p->decodable += sv->cn0 >= SAT_CN0_DECODE;
+        trackable += sv->cn0 >= SAT_CN0_TRACK;
+        p->used += sv->used;
+    }
+
+    //epochs are 1 s apart, each satellite repeats its ephemeris every SAT_EPHEMERIS_TIME
+    if (p->used >= SAT_FIX_MIN) {
+        p->sky = SAT_Sky_Fix;
+        p->ttff = 0;
+    } else if (p->decodable >= SAT_FIX_MIN) {
+        table->decodeEpochs += table->decodeEpochs < UINT16_MAX;
+        p->sky = SAT_Sky_Good;
+        p->ttff = table->decodeEpochs < SAT_EPHEMERIS_TIME ? SAT_EPHEMERIS_TIME - table->decodeEpochs : 1;
+    } else if (trackable >= SAT_FIX_MIN) {
+        table->decodeEpochs = 0;
+        p->sky = SAT_Sky_Weak;
+        p->ttff = SAT_EPHEMERIS_TIME * WEAK_BROADCASTS;
+    } else {
+        table->decodeEpochs = 0;
+        p->sky = SAT_Sky_Blocked;
+        p->ttff = SAT_TTFF_NEVER;
+    }
+    table->epochOpen = 0;
+}
+
+SAT_Prediction* SAT_GetPrediction(SAT_Table *table) {
+    return table != 0 ? &table->prediction : 0;
+}
+
+const char* SAT_GetSkyName(SAT_Sky sky) {
+    return sky <= SAT_Sky_Fix ? skyNames[sky] : 0;
+}
+
+static SAT_Entry* findEntry(SAT_Table *table, uint8_t prn) {
+    SAT_Entry *free = 0;
+    SAT_Entry *oldest = &table->sv[0];
+
+    for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+        SAT_Entry *sv = &table->sv[i];
+        if (sv->prn == prn) {
+            return sv;
+        }
+        if (sv->prn == 0 && free == 0) {
+            free = sv;
+        }
+        if (sv->age > oldest->age || (sv->age == oldest->age && sv->cn0 < oldest->cn0)) {
+            oldest = sv;
+        }
+    }
+
+    //full table: replace entry not reported for longest time, weakest first
+    SAT_Entry *sv = free != 0 ? free : oldest;
+    memset(sv, 0, sizeof(SAT_Entry));
+    sv->prn = prn;
+    sv->elevation = SAT_ELEVATION_UNKNOWN;
+    return sv;
+}
+
+static void startEpoch(SAT_Table *table) {
+    if (table->epochOpen == 0) {
+        for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+            table->sv[i].seen = 0;
+            table->sv[i].used = 0;
+        }
+        table->epochOpen = 1;
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file satellite.h
+ * @author Paul Götzinger
+ * @brief Satellite visibility table and time to fix prediction
+ * @version 1.0
+ * @date 2019-03-25
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef SATELLITE_H
+#define SATELLITE_H
+
+#include <stdint.h>
+
+#define SAT_TABLE_SIZE     24   //satellites tracked at the same time
+#define SAT_MAX_AGE        3    //epochs an entry is kept without being reported
+#define SAT_CN0_DECODE     30   //dBHz, navigation data can be decoded
+#define SAT_CN0_TRACK      20   //dBHz, signal can be tracked, data bits get lost
+#define SAT_EPHEMERIS_TIME 30   //s, ephemeris of a satellite is repeated every 30 s
+#define SAT_FIX_MIN        4    //satellites needed for a fix
+#define SAT_TTFF_NEVER     0xFFFF
+
+#define SAT_ELEVATION_UNKNOWN (-128)
+
+/**
+ * @brief Sky view classification
+ *
+ */
+typedef enum {
+    SAT_Sky_Unknown = 0,    //no epoch reported yet
+    SAT_Sky_Blocked,        //too few satellites can be tracked, no fix expected
+    SAT_Sky_Weak,           //enough satellites tracked, too few decodable
+    SAT_Sky_Good,           //enough satellites decodable, fix after ephemeris download
+    SAT_Sky_Fix             //enough satellites used in a fix
+} SAT_Sky;
+
+/**
+ * @brief Satellite table entry
+ *
+ */
+typedef struct {
+    uint8_t prn;            //satellite number (NMEA numbering), 0 if entry is free
+    int8_t elevation;       //deg, SAT_ELEVATION_UNKNOWN if not reported
+    uint8_t cn0;            //carrier to noise density in dBHz, 0 if not tracked
+    uint8_t used : 1;       //used in fix of the current epoch
+    uint8_t seen : 1;       //reported in the current epoch
+    uint8_t age : 6;        //epochs without report
+} SAT_Entry;
+
+/**
+ * @brief Prediction of the time to fix
+ *
+ */
+typedef struct {
+    SAT_Sky sky;
+    uint16_t ttff;          //s, estimated time to fix, SAT_TTFF_NEVER if no fix is expected
+    uint8_t visible;        //satellites in table
+    uint8_t decodable;      //satellites with C/N0 >= SAT_CN0_DECODE
+    uint8_t used;           //satellites used in fix
+} SAT_Prediction;
+
+/**
+ * @brief Satellite table
+ *
+ */
+typedef struct {
+    SAT_Entry sv[SAT_TABLE_SIZE];
+    uint16_t decodeEpochs;  //consecutive epochs with enough decodable satellites
+    uint8_t epochOpen;      //reports of the current epoch received
+    SAT_Prediction prediction;
+} SAT_Table;
+
+/**
+ * @brief Initialize table
+ *
+ * @param table table
+ */
+void SAT_Init(SAT_Table *table);
+
+/**
+ * @brief Report satellite in view (GSV)
+ *
+ * @param table table
+ * @param prn satellite number
+ * @param elevation elevation in deg, SAT_ELEVATION_UNKNOWN if not reported
+ * @param cn0 C/N0 in dBHz, 0 if not tracked
+ */
+void SAT_Report(SAT_Table *table, uint8_t prn, int8_t elevation, uint8_t cn0);
+
+/**
+ * @brief Mark satellite used in the fix (GSA)
+ *
+ * @param table table
+ * @param prn satellite number
+ */
+void SAT_MarkUsed(SAT_Table *table, uint8_t prn);
+
+/**
+ * @brief End of epoch: age entries which were not reported, update prediction
+ *
+ * @param table table
+ */
+void SAT_EndEpoch(SAT_Table *table);
+
+/**
+ * @brief Retrieve prediction of the last epoch
+ *
+ * @param table table
+ * @return SAT_Prediction* prediction
+ */
+SAT_Prediction* SAT_GetPrediction(SAT_Table *table);
+
+/**
+ * @brief Retrieve sky view name
+ *
+ * @param sky sky view
+ * @return const char* name
+ */
+const char* SAT_GetSkyName(SAT_Sky sky);
+
+#endif //!SATELLITE_H
@@ -0,0 +1,243 @@
+/**
+ * @file sgb.c
+ * @author Paul Götzinger
+ * @brief Second generation beacon (C/S T.018) message and chip stream creation
+ * @version 1.0
+ * @date 2019-03-04
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include "sgb.h"
+#include "memory.h"
+
+#define MIN_PER_DEG      60
+#define LOC_FRAC_SCALE   32768  //location decimal part in 1/2^15 degree
+
+#define BCH_POLY         0x1C7EB85DF3C97ULL //BCH(250,202) generator polynom g(x) (degree 48)
+#define BCH_MSB          (1ULL << (SGB_BCH_BITS - 1))
+#define BCH_MASK         ((1ULL << SGB_BCH_BITS) - 1)
+
+#define PRN_BITS         23     //PRN generator length; G(x) = x^23 + x^18 + 1
+#define PRN_TAP          18
+#define PRN_MASK         ((1UL << PRN_BITS) - 1)
+#define CHIP_BYTES       (SGB_CHIPS_PER_BIT / 8)    //chip bytes per bit and channel
+
+//identification (1-42 from configuration)
+static uint8_t  const test_protocol = 0b0; //43; normal operation
+
+//location defaults (no position available)
+static uint8_t  const lat_default_deg = 0b1111111;
+static uint16_t const lat_default_frac = 0b000001111100000;
+static uint8_t  const lon_default_deg = 0b11111111;
+static uint16_t const lon_default_frac = 0b111110000011111;
+
+//vessel id, beacon type
+static uint8_t  const vessel_id_type = 0b000; //91-93; no aircraft or maritime identity, 94-137 are 0
+static uint8_t  const beacon_type = 0b010; //138-140; PLB
+static uint16_t const spare = 0b11111111111111; //141-154
+
+//rotating field #0 (C/S G.008 objective requirements)
+static uint8_t  const rot_id = 0b0000; //155-158
+static uint16_t const rot_altitude = 0b1111111111; //altitude not available
+static uint8_t  const rot_dop = 0b11111111; //HDOP/VDOP not available
+static uint8_t  const rot_activation = 0b00; //manual activation by user
+static uint8_t  const rot_battery = 0b111; //battery capacity not available
+
+/**
+ * @brief I/Q interleave table: LSB first chip byte to MSB first chip pair positions.
+ * Chip j of the I channel is placed at bit (15 - 2j), Q is inserted one bit below.
+ */
+static uint16_t const interleave[256] = {
+#define IL1(b) ((((b) & 0x01) << 15) | (((b) & 0x02) << 12) | (((b) & 0x04) << 9) | (((b) & 0x08) << 6) \
+              | (((b) & 0x10) << 3) | (((b) & 0x20) << 0) | (((b) & 0x40) >> 3) | (((b) & 0x80) >> 6))
+#define IL4(b)  IL1(b), IL1(b + 1), IL1(b + 2), IL1(b + 3)
+#define IL16(b) IL4(b), IL4(b + 4), IL4(b + 8), IL4(b + 12)
+#define IL64(b) IL16(b), IL16(b + 16), IL16(b + 32), IL16(b + 48)
+    IL64(0), IL64(64), IL64(128), IL64(192)
+#undef IL64
+#undef IL16
+#undef IL4
+#undef IL1
+};
+
+/**
+ * @brief Add bits to packed bit buffer (MSB first)
+ *
+ * @param buf buffer
+ * @param idx current bit index, is advanced
+ * @param bits variable containing bits
+ * @param cnt count of bits to add (max 32)
+ */
+static void putBits(uint8_t *buf, uint16_t *idx, uint32_t bits, uint8_t cnt);
+
+/**
+ * @brief Read one bit of packed bit buffer (MSB first)
+ *
+ * @param buf buffer
+ * @param idx bit index
+ * @return uint8_t bit value
+ */
+static uint8_t getBit(const uint8_t *buf, uint16_t idx);
+
+/**
+ * @brief Calculate BCH(250,202) parity of information field
+ *
+ * @param msg packed information field
+ * @return uint64_t 48 bit parity
+ */
+static uint64_t bch_parity(const uint8_t *msg);
+
+/**
+ * @brief Advance PRN generator by 8 chips. The generators run on the fly instead of a table: both
+ * channels run through 38400 chips per burst, a table would take 9600 bytes of flash to save
+ * about 13 cycles per call, 4 ms of the 1 s burst at 32 MHz
+ *
+ * @param state generator state, bit 0 is next chip
+ * @return uint8_t next 8 chips, first chip in bit 0
+ */
+static uint8_t prn_next8(uint32_t *state);
+
+uint16_t SGB_CreateMessage(uint8_t *msg, uint16_t len, const SGB_Identity *id, POS_Position* pos) {
+    if (msg == 0 || id == 0 || len < SGB_MSG_LENGTH) {
+        return 0;
+    }
+
+    memset(msg, 0, SGB_MSG_LENGTH);
+    uint16_t idx = 0;
+
+    //identification
+    putBits(msg, &idx, id->tacNumber, 16);
+    putBits(msg, &idx, id->serialNumber, 14);
+    putBits(msg, &idx, id->countryCode, 10);
+    putBits(msg, &idx, id->homing, 1);
+    putBits(msg, &idx, id->rls, 1);
+    putBits(msg, &idx, test_protocol, 1);
+
+    //encoded gnss location (44-90)
+    uint8_t located = pos != 0 && pos->valid == POS_Valid_Flag_Valid;
+    if (located) {
+        uint32_t frac = (uint32_t)(pos->latitude.minute * LOC_FRAC_SCALE / MIN_PER_DEG + 0.5f);
+        putBits(msg, &idx, pos->latitude.direction, 1);
+        putBits(msg, &idx, pos->latitude.degree, 7);
+        putBits(msg, &idx, frac >= LOC_FRAC_SCALE ? LOC_FRAC_SCALE - 1 : frac, 15);
+
+        frac = (uint32_t)(pos->longitude.minute * LOC_FRAC_SCALE / MIN_PER_DEG + 0.5f);
+        putBits(msg, &idx, pos->longitude.direction, 1);
+        putBits(msg, &idx, pos->longitude.degree, 8);
+        putBits(msg, &idx, frac >= LOC_FRAC_SCALE ? LOC_FRAC_SCALE - 1 : frac, 15);
+    } else {
+        putBits(msg, &idx, POS_Latitude_Flag_N, 1);
+        putBits(msg, &idx, lat_default_deg, 7);
+        putBits(msg, &idx, lat_default_frac, 15);
+        putBits(msg, &idx, POS_Longitude_Flag_W, 1);
+        putBits(msg, &idx, lon_default_deg, 8);
+        putBits(msg, &idx, lon_default_frac, 15);
+    }
+
+    //vessel id (91-137), beacon type, spare
+    putBits(msg, &idx, vessel_id_type, 3);
+    putBits(msg, &idx, 0, 12);
+    putBits(msg, &idx, 0, 32);
+    putBits(msg, &idx, beacon_type, 3);
+    putBits(msg, &idx, spare, 14);
+
+    //rotating field #0 (155-202)
+    putBits(msg, &idx, rot_id, 4);
+    putBits(msg, &idx, 0, 6);   //elapsed time since activation
+    putBits(msg, &idx, 0, 11);  //time from last encoded location
+    putBits(msg, &idx, rot_altitude, 10);
+    putBits(msg, &idx, rot_dop, 8);
+    putBits(msg, &idx, rot_activation, 2);
+    putBits(msg, &idx, rot_battery, 3);
+    putBits(msg, &idx, located ? 0b01 : 0b00, 2); //gnss status
+    putBits(msg, &idx, 0, 2);
+
+    //append BCH(250,202) parity
+    uint64_t parity = bch_parity(msg);
+    putBits(msg, &idx, (uint32_t)(parity >> 32), SGB_BCH_BITS - 32);
+    putBits(msg, &idx, (uint32_t)parity, 32);
+
+    return idx;
+}
+
+void SGB_StartStream(SGB_ChipStream *stream, const uint8_t *msg) {
+    if (stream != 0) {
+        stream->msg = msg;
+        stream->prnI = SGB_PRN_SEED_I;
+        stream->prnQ = SGB_PRN_SEED_Q;
+        stream->bit = 0;
+        stream->chip = 0;
+    }
+}
+
+MEM_RAMFUNC uint16_t SGB_GetChips(SGB_ChipStream *stream, uint8_t *buf, uint16_t len) {
+    if (stream == 0 || stream->msg == 0 || buf == 0) {
+        return 0;
+    }
+
+    uint16_t cnt = 0;
+    while (cnt + 2 <= len && stream->bit < SGB_BURST_BITS) {
+        //odd burst bits are sent on I, even burst bits on Q; preamble bits are '0'
+        uint8_t maskI = 0;
+        uint8_t maskQ = 0;
+        if (stream->bit >= SGB_PREAMBLE_BITS) {
+            maskI = getBit(stream->msg, stream->bit - SGB_PREAMBLE_BITS) ? 0xFF : 0x00;
+            maskQ = getBit(stream->msg, stream->bit + 1 - SGB_PREAMBLE_BITS) ? 0xFF : 0x00;
+        }
+
+        //spread 8 chips of each channel and interleave them to 4 chip pairs per byte
+        uint16_t pairs = interleave[prn_next8(&stream->prnI) ^ maskI]
+                | (interleave[prn_next8(&stream->prnQ) ^ maskQ] >> 1);
+        buf[cnt++] = pairs >> 8;
+        buf[cnt++] = pairs & 0xFF;
+
+        if (++stream->chip >= CHIP_BYTES) {
+            stream->chip = 0;
+            stream->bit += 2;
+        }
+    }
+
+    return cnt;
+}
+
+static void putBits(uint8_t *buf, uint16_t *idx, uint32_t bits, uint8_t cnt) {
+    for (uint8_t i = 1; i <= cnt; i++) {
+        if ((bits >> (cnt - i)) & 1) {
+            buf[*idx >> 3] |= 0x80 >> (*idx & 7);
+        }
+        (*idx)++;
+    }
+}
+
+MEM_RAMFUNC static uint8_t getBit(const uint8_t *buf, uint16_t idx) {
+    return (buf[idx >> 3] >> (7 - (idx & 7))) & 1;
+}
+
+static uint64_t bch_parity(const uint8_t *msg) {
+    uint64_t reg = 0;
+
+    //polynomial division of m(x) * x^48 by g(x)
+    for (uint16_t i = 0; i < SGB_INFO_BITS; i++) {
+        uint8_t feedback = getBit(msg, i) ^ ((reg & BCH_MSB) != 0);
+        reg = (reg << 1) & BCH_MASK;
+        if (feedback) {
+            reg ^= BCH_POLY & BCH_MASK;
+        }
+    }
+
+    return reg;
+}
+
+MEM_RAMFUNC static uint8_t prn_next8(uint32_t *state) {
+    uint32_t s = *state;
+
+    //a(n+23) = a(n+18) ^ a(n); the first 5 new chips only depend on the current state
+    uint32_t fb = (s ^ (s >> PRN_TAP)) & 0x1F;
+    fb |= ((fb ^ (s >> 5)) & 0x07) << 5;
+
+    *state = ((s >> 8) | (fb << (PRN_BITS - 8))) & PRN_MASK;
+    return s & 0xFF;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file sgb.h
+ * @author Paul Götzinger
+ * @brief Second generation beacon (C/S T.018) message and chip stream creation
+ * @version 1.0
+ * @date 2019-03-04
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef SGB_H
+#define SGB_H
+
+#include "position.h"
+
+#define SGB_INFO_BITS      202  //length of information field
+#define SGB_BCH_BITS       48   //length of BCH(250,202) parity
+#define SGB_MSG_BITS       (SGB_INFO_BITS + SGB_BCH_BITS)
+#define SGB_PREAMBLE_BITS  50   //all-zero preamble bits (166.7ms)
+#define SGB_BURST_BITS     (SGB_PREAMBLE_BITS + SGB_MSG_BITS)
+#define SGB_MSG_LENGTH     ((SGB_MSG_BITS + 7) / 8) //packed message length in bytes
+
+#define SGB_CHIPS_PER_BIT  256  //spreading factor per channel
+#define SGB_CHIP_RATE      38400    //chips per second and channel
+
+/**
+ * @brief Length of the chip stream in radio fifo bytes.
+ * Every fifo byte holds 4 interleaved I/Q chip pairs
+ */
+#define SGB_STREAM_LENGTH  ((SGB_BURST_BITS / 2) * SGB_CHIPS_PER_BIT / 4)
+
+/**
+ * @brief PRN generator initial states (normal mode) of the I and Q channel
+ *
+ */
+#define SGB_PRN_SEED_I     0x000001UL
+#define SGB_PRN_SEED_Q     0x1AC1FCUL
+
+/**
+ * @brief Beacon identification of the message (bits 1-42)
+ *
+ */
+typedef struct {
+    uint16_t tacNumber;     //1-16; type approval certificate
+    uint16_t serialNumber;  //17-30; serial number within TAC
+    uint16_t countryCode;   //31-40; country code
+    uint8_t  homing;        //41; 121,5MHz homing device present
+    uint8_t  rls;           //42; return link service requested
+} SGB_Identity;
+
+/**
+ * @brief Chip stream state
+ *
+ */
+typedef struct {
+    const uint8_t *msg; //packed message (MSB first)
+    uint32_t prnI;      //PRN generator state of I channel
+    uint32_t prnQ;      //PRN generator state of Q channel
+    uint16_t bit;       //current burst bit (pair index * 2)
+    uint8_t  chip;      //current chip byte within bit (0 .. SGB_CHIPS_PER_BIT/8-1)
+} SGB_ChipStream;
+
+/**
+ * @brief Create second generation beacon message (202 bit information + 48 bit BCH)
+ *
+ * @param msg pointer to memory, receives packed message (MSB first)
+ * @param len length of available memory in bytes
+ * @param id beacon identification
+ * @param pos position (invalid positions are encoded as default location)
+ * @return uint16_t length of message in bits, 0 on error
+ */
+uint16_t SGB_CreateMessage(uint8_t *msg, uint16_t len, const SGB_Identity *id, POS_Position* pos);
+
+/**
+ * @brief Start a chip stream for a created message
+ *
+ * @param stream stream state
+ * @param msg packed message created by \ref SGB_CreateMessage
+ */
+void SGB_StartStream(SGB_ChipStream *stream, const uint8_t *msg);
+
+/**
+ * @brief Retrieve next interleaved I/Q chip bytes of burst
+ *
+ * @param stream stream state
+ * @param buf buffer to fill with radio fifo bytes
+ * @param len length of buffer
+ * @return uint16_t count of bytes written, 0 at end of burst
+ */
+uint16_t SGB_GetChips(SGB_ChipStream *stream, uint8_t *buf, uint16_t len);
+
+#endif /* SGB_H */
@@ -26,6 +26,58 @@
 #define MSG_CFG_NMEA_LEN 0x14
 #define MSG_CFG_NMEA_ID  0x17
 
+#define MSG_CFG_MSG_LEN  0x03
+#define MSG_CFG_MSG_ID   0x01
+
+#define MSG_CFG_GNSS_ID          0x3E
+#define MSG_CFG_GNSS_HEADER_LEN  0x04
+#define MSG_CFG_GNSS_BLOCK_LEN   0x08
+#define MSG_CFG_GNSS_ENABLE      0x00000001
+#define MSG_CFG_GNSS_SIG_L1      0x00010000     //sigCfgMask: GPS L1C/A, Galileo E1, GLONASS L1
+
+#define MSG_SFRBX_HEADER_LEN 0x08
+#define MSG_SFRBX_POS_GNSS   0x00
+#define MSG_SFRBX_POS_SV     0x01
+#define MSG_SFRBX_POS_SIG    0x02
+#define MSG_SFRBX_POS_WORDS  0x04
+
+#define MSG_PMREQ_LEN          0x10
+#define MSG_PMREQ_FLAG_BACKUP  0x02
+#define MSG_PMREQ_FLAG_FORCE   0x04
+#define MSG_PMREQ_WAKE_UARTRX  0x08
+
+#define MSG_PVT_LEN          0x5C
+#define MSG_PVT_POS_ITOW     0x00
+#define MSG_PVT_POS_HOUR     0x08
+#define MSG_PVT_POS_MIN      0x09
+#define MSG_PVT_POS_SEC      0x0A
+#define MSG_PVT_POS_FIXTYPE  0x14
+#define MSG_PVT_POS_FLAGS    0x15
+#define MSG_PVT_POS_NUMSV    0x17
+#define MSG_PVT_POS_LON      0x18
+#define MSG_PVT_POS_LAT      0x1C
+#define MSG_PVT_POS_HACC     0x28
+#define MSG_PVT_POS_PDOP     0x4C
+
+/**
+ * @brief Tracking channel allocation of a system configured by CFG-GNSS
+ * 
+ */
+typedef struct {
+    uint8_t gnssId;
+    uint8_t resTrkCh;   //reserved channels
+    uint8_t maxTrkCh;   //maximum channels
+} GnssBlock;
+
+//receiver default channel allocation (32 channels)
+static const GnssBlock gnssBlocks[] = {
+    { UBX_GnssId_GPS, 8, 16 },
+    { UBX_GnssId_Galileo, 4, 8 },
+    { UBX_GnssId_GLONASS, 8, 14 }
+};
+
+#define GNSS_BLOCK_COUNT (sizeof(gnssBlocks) / sizeof(GnssBlock))
+
 /**
  * @brief Process/parse message
  * 
@@ -40,6 +92,45 @@ static void processMsg(UBX_Instance* ubx);
  */
 static void processAck(UBX_Instance* ubx);
 
+/**
+ * @brief Process/parse receiver manager message
+ * 
+ * @param ubx ubx instance structure
+ */
+static void processRxm(UBX_Instance* ubx);
+
+/**
+ * @brief Process/parse navigation message
+ * 
+ * @param ubx ubx instance structure
+ */
+static void processNav(UBX_Instance* ubx);
+
+/**
+ * @brief Read little endian value from payload
+ * 
+ * @param data first byte
+ * @param len count of bytes (1 to 4)
+ * @return uint32_t value
+ */
+static uint32_t readLE(const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Write 32 bit little endian value to frame
+ * 
+ * @param data first byte
+ * @param value value
+ */
+static void writeLE32(uint8_t *data, uint32_t value);
+
+/**
+ * @brief Search general message callback for current message
+ * 
+ * @param ubx ubx instance structure
+ * @return UBX_Callback callback function, 0 if not configured
+ */
+static UBX_Callback findCallback(UBX_Instance* ubx);
+
 static void createChecksum(uint8_t *data, uint16_t len);
 
 void UBX_Init(UBX_Instance* ubx) {
@@ -101,11 +192,11 @@ void UBX_SetCallback(UBX_Instance* ubx, UBX_Callback cb, uint8_t msgClass, uint8
 
 void UBX_Process(UBX_Instance* ubx, uint8_t byte) {
     if (ubx != 0) {
-        //check for message start
-        if (byte == SYNC_CHAR_1) {
+        //check for message start; inside a message 0xB5 is payload or checksum
+        if (byte == SYNC_CHAR_1 && (ubx->state == UBX_State_IDLE || ubx->state == UBX_State_Sync2)) {
             //set next state
             ubx->state = UBX_State_Sync2;
-        } else {
+        } else if (ubx->state != UBX_State_IDLE) {
             //check if new byte needs to be added to checksum 
             if (ubx->state != UBX_State_CK_A && ubx->state != UBX_State_CK_B) {
                 //add byte to checksum
@@ -249,6 +340,123 @@ uint16_t UBX_CreateNMEAConfigFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t l
     return idx;
 }
 
+uint16_t UBX_CreateMsgRateFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len,
+        UBX_Class msgClass, uint8_t id, uint8_t rate) {
+    if (frame == 0 || len < (MSG_CFG_MSG_LEN + HEADER_LEN + CK_LEN)) {
+        return 0;
+    }
+
+    uint16_t idx = 0;
+
+    //sync
+    frame[idx++] = SYNC_CHAR_1;
+    frame[idx++] = SYNC_CHAR_2;
+
+    //class
+    frame[idx++] = UBX_Class_CFG;
+
+    //id
+    frame[idx++] = MSG_CFG_MSG_ID;
+
+    //length
+    frame[idx++] = MSG_CFG_MSG_LEN;
+    frame[idx++] = 0x00;
+
+    //payload
+    frame[idx++] = msgClass;    // msgClass
+    frame[idx++] = id;          // msgID
+    frame[idx++] = rate;        // rate on current port
+
+    idx += CK_LEN;
+    createChecksum(frame, idx);
+
+    return idx;
+}
+
+uint16_t UBX_CreateGnssConfigFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len, uint8_t enable) {
+    uint16_t payloadLen = MSG_CFG_GNSS_HEADER_LEN + GNSS_BLOCK_COUNT * MSG_CFG_GNSS_BLOCK_LEN;
+    if (frame == 0 || len < (payloadLen + HEADER_LEN + CK_LEN)) {
+        return 0;
+    }
+
+    uint16_t idx = 0;
+
+    //sync
+    frame[idx++] = SYNC_CHAR_1;
+    frame[idx++] = SYNC_CHAR_2;
+
+    //class
+    frame[idx++] = UBX_Class_CFG;
+
+    //id
+    frame[idx++] = MSG_CFG_GNSS_ID;
+
+    //length
+    frame[idx++] = payloadLen;
+    frame[idx++] = 0x00;
+
+    //payload
+    frame[idx++] = 0x00;                // msgVer       - 0
+    frame[idx++] = 0x00;                // numTrkChHw   - read only
+    frame[idx++] = 0xFF;                // numTrkChUse  - all channels
+    frame[idx++] = GNSS_BLOCK_COUNT;    // numConfigBlocks
+
+    for (uint8_t i = 0; i < GNSS_BLOCK_COUNT; i++) {
+        uint8_t on = (enable & UBX_GNSS_MASK(gnssBlocks[i].gnssId)) != 0;
+
+        frame[idx++] = gnssBlocks[i].gnssId;    // gnssId
+        frame[idx++] = gnssBlocks[i].resTrkCh;  // resTrkCh
+        frame[idx++] = gnssBlocks[i].maxTrkCh;  // maxTrkCh
+        frame[idx++] = 0x00;                    // reserved1
+        writeLE32(frame + idx, (on ? MSG_CFG_GNSS_ENABLE : 0) | MSG_CFG_GNSS_SIG_L1);  // flags
+        idx += 4;
+    }
+
+    idx += CK_LEN;
+    createChecksum(frame, idx);
+
+    return idx;
+}
+
+uint16_t UBX_CreatePowerDownFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len, uint32_t duration) {
+    if (frame == 0 || len < (MSG_PMREQ_LEN + HEADER_LEN + CK_LEN)) {
+        return 0;
+    }
+
+    uint16_t idx = 0;
+
+    //sync
+    frame[idx++] = SYNC_CHAR_1;
+    frame[idx++] = SYNC_CHAR_2;
+
+    //class
+    frame[idx++] = UBX_Class_RXM;
+
+    //id
+    frame[idx++] = UBX_Id_Rxm_Pmreq;
+
+    //length
+    frame[idx++] = MSG_PMREQ_LEN;
+    frame[idx++] = 0x00;
+
+    //payload
+    frame[idx++] = 0x00;        // version      - 0
+    frame[idx++] = 0x00;        // reserved1
+    frame[idx++] = 0x00;        // reserved1
+    frame[idx++] = 0x00;        // reserved1
+    writeLE32(frame + idx, duration);                                   // duration
+    idx += 4;
+    writeLE32(frame + idx, MSG_PMREQ_FLAG_BACKUP | MSG_PMREQ_FLAG_FORCE);  // flags        - backup, force
+    idx += 4;
+    writeLE32(frame + idx, MSG_PMREQ_WAKE_UARTRX);                      // wakeupSources - uart rx
+    idx += 4;
+
+    idx += CK_LEN;
+    createChecksum(frame, idx);
+
+    return idx;
+}
+
 static void processMsg(UBX_Instance* ubx) {
     if (ubx != 0) {
         //process message by class
@@ -258,6 +466,14 @@ static void processMsg(UBX_Instance* ubx) {
                 //process acknowledge message
                 processAck(ubx);
                 break;
+            case UBX_Class_RXM:
+                //process receiver manager message
+                processRxm(ubx);
+                break;
+            case UBX_Class_NAV:
+                //process navigation message
+                processNav(ubx);
+                break;
             default:
                 break;
         }
@@ -283,6 +499,97 @@ static void processAck(UBX_Instance* ubx) {
     }
 }
 
+static void processRxm(UBX_Instance* ubx) {
+    UBX_Callback cb = findCallback(ubx);
+    if (cb == 0) {
+        return;
+    }
+
+    switch (ubx->id)
+    {
+        case UBX_Id_Rxm_Sfrbx:
+            if (ubx->msgLength >= MSG_SFRBX_HEADER_LEN) {
+                UBX_RxmSfrbx sfrbx;
+                UBX_DataPtr data;
+
+                //parse header, data words stay in payload buffer
+                sfrbx.gnssId = ubx->msg[MSG_SFRBX_POS_GNSS];
+                sfrbx.svId = ubx->msg[MSG_SFRBX_POS_SV];
+                sfrbx.sigId = ubx->msg[MSG_SFRBX_POS_SIG];
+                sfrbx.numWords = ubx->msg[MSG_SFRBX_POS_WORDS];
+                sfrbx.words = ubx->msg + MSG_SFRBX_HEADER_LEN;
+
+                //check if all words were received
+                if (sfrbx.numWords <= UBX_SFRBX_MAX_WORDS &&
+                        ubx->msgLength >= MSG_SFRBX_HEADER_LEN + sfrbx.numWords * 4) {
+                    data.sfrbx = &sfrbx;
+                    cb(UBX_Class_RXM, ubx->id, data);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void processNav(UBX_Instance* ubx) {
+    UBX_Callback cb = findCallback(ubx);
+    if (cb == 0) {
+        return;
+    }
+
+    switch (ubx->id)
+    {
+        case UBX_Id_Nav_Pvt:
+            if (ubx->msgLength >= MSG_PVT_LEN) {
+                UBX_NavPvt pvt;
+                UBX_DataPtr data;
+
+                pvt.iTOW = readLE(ubx->msg + MSG_PVT_POS_ITOW, 4);
+                pvt.hour = ubx->msg[MSG_PVT_POS_HOUR];
+                pvt.minute = ubx->msg[MSG_PVT_POS_MIN];
+                pvt.second = ubx->msg[MSG_PVT_POS_SEC];
+                pvt.fixType = ubx->msg[MSG_PVT_POS_FIXTYPE];
+                pvt.flags = ubx->msg[MSG_PVT_POS_FLAGS];
+                pvt.numSV = ubx->msg[MSG_PVT_POS_NUMSV];
+                pvt.lon = (int32_t)readLE(ubx->msg + MSG_PVT_POS_LON, 4);
+                pvt.lat = (int32_t)readLE(ubx->msg + MSG_PVT_POS_LAT, 4);
+                pvt.hAcc = readLE(ubx->msg + MSG_PVT_POS_HACC, 4);
+                pvt.pDOP = readLE(ubx->msg + MSG_PVT_POS_PDOP, 2);
+
+                data.pvt = &pvt;
+                cb(UBX_Class_NAV, ubx->id, data);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t readLE(const uint8_t *data, uint8_t len) {
+    uint32_t value = 0;
+
+    while (len-- > 0) {
+        value = (value << 8) | data[len];
+    }
+    return value;
+}
+
+static void writeLE32(uint8_t *data, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        data[i] = value >> (8 * i);
+    }
+}
+
+static UBX_Callback findCallback(UBX_Instance* ubx) {
+    for (uint8_t i = 0; i < UBX_CB_Count; i++) {
+        if (ubx->cb[i].cb != 0 && ubx->cb[i].msgClass == ubx->msgClass && ubx->cb[i].id == ubx->id) {
+            return ubx->cb[i].cb;
+        }
+    }
+    return 0;
+}
+
 static void createChecksum(uint8_t *data, uint16_t len) {
     uint8_t ck_a = 0;
     uint8_t ck_b = 0;
@@ -15,6 +15,7 @@
 #define UBX_ACK_CB_Count 3
 #define UBX_CB_Count 5
 #define UBX_MSG_MAX_LENGTH 128
+#define UBX_SFRBX_MAX_WORDS 10
 
 /**
  * @brief UBX message state
@@ -63,13 +64,76 @@ typedef enum {
     UBX_Id_Ack_Nak = 0x00,
 } UBX_Id_Ack;
 
+/**
+ * @brief Message IDs for RXM message class
+ * 
+ */
+typedef enum {
+    UBX_Id_Rxm_Sfrbx = 0x13,
+    UBX_Id_Rxm_Pmreq = 0x41
+} UBX_Id_Rxm;
+
+/**
+ * @brief Message IDs for NAV message class
+ * 
+ */
+typedef enum {
+    UBX_Id_Nav_Pvt = 0x07
+} UBX_Id_Nav;
+
+/**
+ * @brief GNSS identifiers
+ * 
+ */
+typedef enum {
+    UBX_GnssId_GPS = 0,
+    UBX_GnssId_SBAS = 1,
+    UBX_GnssId_Galileo = 2,
+    UBX_GnssId_BeiDou = 3,
+    UBX_GnssId_QZSS = 5,
+    UBX_GnssId_GLONASS = 6
+} UBX_GnssId;
+
+#define UBX_GNSS_MASK(id) (1U << (id))   //constellation bit of a CFG-GNSS enable mask
+
+/**
+ * @brief Broadcast navigation data subframe (RXM-SFRBX)
+ * 
+ */
+typedef struct {
+    uint8_t gnssId;         //GNSS identifier
+    uint8_t svId;           //satellite identifier
+    uint8_t sigId;          //signal identifier
+    uint8_t numWords;       //number of data words
+    const uint8_t *words;   //data words (4 bytes little endian each), points into payload
+} UBX_RxmSfrbx;
+
+/**
+ * @brief Navigation position velocity time solution (NAV-PVT), fields used by the beacon
+ * 
+ */
+typedef struct {
+    uint32_t iTOW;          //GPS time of week in ms
+    uint8_t hour;           //UTC time of day
+    uint8_t minute;
+    uint8_t second;
+    uint8_t fixType;        //0: no fix, 2: 2D, 3: 3D
+    uint8_t flags;          //bit 0: gnssFixOK
+    uint8_t numSV;          //satellites used in the solution
+    int32_t lon;            //longitude in 1e-7 deg
+    int32_t lat;            //latitude in 1e-7 deg
+    uint32_t hAcc;          //horizontal accuracy estimate in mm
+    uint16_t pDOP;          //position dilution of precision * 100
+} UBX_NavPvt;
+
 /**
  * @brief Pointer to data structure 
  * to avoid void* and casting
  * 
  */
 typedef union {
-    
+    UBX_RxmSfrbx *sfrbx;
+    UBX_NavPvt *pvt;
 } UBX_DataPtr;
 
 /**
@@ -160,6 +224,52 @@ void UBX_SetCallback(UBX_Instance* ubx, UBX_Callback cb, uint8_t msgClass, uint8
  */
 void UBX_Process(UBX_Instance* ubx, uint8_t byte);
 
+/**
+ * @brief Create NMEA configuration frame (CFG-NMEA)
+ * 
+ * @param ubx ubx instance structure
+ * @param frame pointer to memory
+ * @param len length of available memory
+ * @return uint16_t length of frame, 0 on error
+ */
 uint16_t UBX_CreateNMEAConfigFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len);
 
+/**
+ * @brief Create message rate configuration frame (CFG-MSG)
+ * 
+ * @param ubx ubx instance structure
+ * @param frame pointer to memory
+ * @param len length of available memory
+ * @param msgClass class of message to configure
+ * @param id id of message to configure
+ * @param rate output rate on current port (0 disables message)
+ * @return uint16_t length of frame, 0 on error
+ */
+uint16_t UBX_CreateMsgRateFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len,
+        UBX_Class msgClass, uint8_t id, uint8_t rate);
+
+/**
+ * @brief Create GNSS system configuration frame (CFG-GNSS) for GPS, Galileo and GLONASS,
+ * the other systems keep their configuration (the receiver restarts acquisition)
+ * 
+ * @param ubx ubx instance structure
+ * @param frame pointer to memory
+ * @param len length of available memory
+ * @param enable systems to enable (UBX_GNSS_MASK of GPS, Galileo and GLONASS), the others are disabled
+ * @return uint16_t length of frame, 0 on error
+ */
+uint16_t UBX_CreateGnssConfigFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len, uint8_t enable);
+
+/**
+ * @brief Create power management request frame (RXM-PMREQ), receiver enters backup mode
+ * and wakes up after the duration or on activity on its uart rx line
+ * 
+ * @param ubx ubx instance structure
+ * @param frame pointer to memory
+ * @param len length of available memory
+ * @param duration backup duration in ms (0: until woken up)
+ * @return uint16_t length of frame, 0 on error
+ */
+uint16_t UBX_CreatePowerDownFrame(UBX_Instance* ubx, uint8_t *frame, uint16_t len, uint32_t duration);
+
 #endif //!UBX_H
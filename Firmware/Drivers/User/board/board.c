@@ -0,0 +1,178 @@
+/**
+ * @file board.c
+ * @author Paul Götzinger
+ * @brief Board description: compile time checks of the pin, alternate function and DMA
+ * assignment (STM32L073 datasheet), driver configurations in flash
+ * @version 1.0
+ * @date 2019-03-30
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "board.h"
+
+//pin identifier: port * 16 + pin
+#define BOARD_PORT_A    0
+#define BOARD_PORT_B    1
+#define BOARD_PORT_C    2
+#define BOARD_PORT_D    3
+#define BOARD_PORT_E    4
+#define BOARD_PORT_H    7
+#define BOARD_ID(...)               BOARD_ID_(__VA_ARGS__)
+#define BOARD_ID_(PORT, PIN, AF)    (BOARD_PORT_##PORT * 16 + (PIN))
+
+//pin description equals port, pin and alternate function
+#define BOARD_IS(PORT, PIN, AF, ...) \
+    (BOARD_ID(__VA_ARGS__) == BOARD_ID_(PORT, PIN, AF) && BOARD_AF(__VA_ARGS__) == (AF))
+
+//signal of a peripheral, e.g. BOARD_SIGNAL(USART, 4, TX, C, 10, 6) checks BOARD_USART4_TX
+#define BOARD_SIGNAL(PERIPH, N, SIGNAL, ...)    BOARD_SIGNAL_(PERIPH, N, SIGNAL, __VA_ARGS__)
+#define BOARD_SIGNAL_(PERIPH, N, SIGNAL, ...)   BOARD_##PERIPH##N##_##SIGNAL(__VA_ARGS__)
+
+//usart pins and alternate functions
+#define BOARD_USART1_TX(...)    (BOARD_IS(A, 9, 4, __VA_ARGS__) || BOARD_IS(B, 6, 0, __VA_ARGS__))
+#define BOARD_USART1_RX(...)    (BOARD_IS(A, 10, 4, __VA_ARGS__) || BOARD_IS(B, 7, 0, __VA_ARGS__))
+#define BOARD_USART2_TX(...)    (BOARD_IS(A, 2, 4, __VA_ARGS__) || BOARD_IS(A, 14, 4, __VA_ARGS__) || \
+                                 BOARD_IS(D, 5, 0, __VA_ARGS__))
+#define BOARD_USART2_RX(...)    (BOARD_IS(A, 3, 4, __VA_ARGS__) || BOARD_IS(A, 15, 4, __VA_ARGS__) || \
+                                 BOARD_IS(D, 6, 0, __VA_ARGS__))
+#define BOARD_USART4_TX(...)    (BOARD_IS(A, 0, 6, __VA_ARGS__) || BOARD_IS(C, 10, 6, __VA_ARGS__) || \
+                                 BOARD_IS(E, 8, 6, __VA_ARGS__))
+#define BOARD_USART4_RX(...)    (BOARD_IS(A, 1, 6, __VA_ARGS__) || BOARD_IS(C, 11, 6, __VA_ARGS__) || \
+                                 BOARD_IS(E, 9, 6, __VA_ARGS__))
+#define BOARD_USART5_TX(...)    (BOARD_IS(B, 3, 6, __VA_ARGS__) || BOARD_IS(C, 12, 2, __VA_ARGS__) || \
+                                 BOARD_IS(E, 10, 6, __VA_ARGS__))
+#define BOARD_USART5_RX(...)    (BOARD_IS(B, 4, 6, __VA_ARGS__) || BOARD_IS(D, 2, 6, __VA_ARGS__) || \
+                                 BOARD_IS(E, 11, 6, __VA_ARGS__))
+
+//usart DMA channels (requests as mapped by UART_Init)
+#define BOARD_USART1_TX_DMA(CH) ((CH) == 2 || (CH) == 4)
+#define BOARD_USART1_RX_DMA(CH) ((CH) == 3 || (CH) == 5)
+#define BOARD_USART2_TX_DMA(CH) ((CH) == 4 || (CH) == 7)
+#define BOARD_USART2_RX_DMA(CH) ((CH) == 5 || (CH) == 6)
+#define BOARD_USART4_TX_DMA(CH) ((CH) == 3 || (CH) == 7)
+#define BOARD_USART4_RX_DMA(CH) ((CH) == 2 || (CH) == 6)
+#define BOARD_USART5_TX_DMA(CH) ((CH) == 3 || (CH) == 7)
+#define BOARD_USART5_RX_DMA(CH) ((CH) == 2 || (CH) == 6)
+
+//spi2 pins and alternate functions
+#define BOARD_SPI2_SCK(...)     (BOARD_IS(B, 10, 5, __VA_ARGS__) || BOARD_IS(B, 13, 0, __VA_ARGS__) || \
+                                 BOARD_IS(D, 1, 1, __VA_ARGS__))
+#define BOARD_SPI2_MISO(...)    (BOARD_IS(B, 14, 0, __VA_ARGS__) || BOARD_IS(C, 2, 2, __VA_ARGS__) || \
+                                 BOARD_IS(D, 3, 2, __VA_ARGS__))
+#define BOARD_SPI2_MOSI(...)    (BOARD_IS(B, 15, 0, __VA_ARGS__) || BOARD_IS(C, 3, 2, __VA_ARGS__) || \
+                                 BOARD_IS(D, 4, 1, __VA_ARGS__))
+
+//tim2 channel 1 pins and alternate functions, DMA channel of the channel 3 request
+#define BOARD_TIM2_CH1(...)     (BOARD_IS(A, 0, 2, __VA_ARGS__) || BOARD_IS(A, 5, 5, __VA_ARGS__))
+#define BOARD_TIM2_CH3_DMA(CH)  ((CH) == 1)
+
+#define BOARD_CHECK_UART(NAME) \
+    _Static_assert(BOARD_SIGNAL(USART, NAME##_USART, TX, NAME##_TX), #NAME "_TX: no tx pin of the usart"); \
+    _Static_assert(BOARD_SIGNAL(USART, NAME##_USART, RX, NAME##_RX), #NAME "_RX: no rx pin of the usart"); \
+    _Static_assert(BOARD_SIGNAL(USART, NAME##_USART, TX_DMA, NAME##_TX_DMA), #NAME "_TX_DMA: no tx channel of the usart"); \
+    _Static_assert(BOARD_SIGNAL(USART, NAME##_USART, RX_DMA, NAME##_RX_DMA), #NAME "_RX_DMA: no rx channel of the usart")
+
+BOARD_CHECK_UART(BOARD_BLE);
+BOARD_CHECK_UART(BOARD_GNSS);
+BOARD_CHECK_UART(BOARD_LOG);
+
+_Static_assert(BOARD_SIGNAL(SPI, BOARD_RADIO_SPI, SCK, BOARD_RADIO_SCK), "BOARD_RADIO_SCK: no sck pin of the spi");
+_Static_assert(BOARD_SIGNAL(SPI, BOARD_RADIO_SPI, MISO, BOARD_RADIO_MISO), "BOARD_RADIO_MISO: no miso pin of the spi");
+_Static_assert(BOARD_SIGNAL(SPI, BOARD_RADIO_SPI, MOSI, BOARD_RADIO_MOSI), "BOARD_RADIO_MOSI: no mosi pin of the spi");
+
+#if BOARD_HAS_HOMER
+_Static_assert(BOARD_HOMER_TIM == 2, "BOARD_HOMER_TIM: the homer driver supports TIM2 only");
+_Static_assert(BOARD_SIGNAL(TIM, BOARD_HOMER_TIM, CH1, BOARD_HOMER_KEY), "BOARD_HOMER_KEY: no channel 1 pin of the timer");
+_Static_assert(BOARD_SIGNAL(TIM, BOARD_HOMER_TIM, CH3_DMA, BOARD_HOMER_DMA), "BOARD_HOMER_DMA: no channel 3 DMA channel of the timer");
+#endif
+
+//each pin once: the bits of all pins sum up to their union only if no pin repeats
+#define BOARD_BIT(HALF, ...)    BOARD_BIT_(HALF, BOARD_ID(__VA_ARGS__))
+#define BOARD_BIT_(HALF, ID)    ((uint64_t)((ID) / 64 == (HALF)) << ((ID) % 64))
+#define BOARD_SUM_LOW(...)      + BOARD_BIT(0, __VA_ARGS__)
+#define BOARD_OR_LOW(...)       | BOARD_BIT(0, __VA_ARGS__)
+#define BOARD_SUM_HIGH(...)     + BOARD_BIT(1, __VA_ARGS__)
+#define BOARD_OR_HIGH(...)      | BOARD_BIT(1, __VA_ARGS__)
+
+_Static_assert((0 BOARD_PINS(BOARD_SUM_LOW)) == (0 BOARD_PINS(BOARD_OR_LOW)), "pin of port A-D used twice");
+_Static_assert((0 BOARD_PINS(BOARD_SUM_HIGH)) == (0 BOARD_PINS(BOARD_OR_HIGH)), "pin of port E-H used twice");
+
+//each usart and DMA channel once (LOG_GPS shares the gnss usart on purpose, see log.c)
+_Static_assert(BOARD_BLE_USART != BOARD_GNSS_USART && BOARD_BLE_USART != BOARD_LOG_USART &&
+        BOARD_GNSS_USART != BOARD_LOG_USART, "usart used twice");
+
+#if BOARD_HAS_HOMER
+#define BOARD_HOMER_DMAS(X)     X(BOARD_HOMER_DMA)
+#else
+#define BOARD_HOMER_DMAS(X)
+#endif
+#define BOARD_DMA_CHANNELS(X) \
+    X(BOARD_BLE_TX_DMA) \
+    X(BOARD_BLE_RX_DMA) \
+    X(BOARD_GNSS_TX_DMA) \
+    X(BOARD_GNSS_RX_DMA) \
+    X(BOARD_LOG_TX_DMA) \
+    X(BOARD_LOG_RX_DMA) \
+    BOARD_HOMER_DMAS(X)
+#define BOARD_DMA_SUM(CH)       + (1 << (CH))
+#define BOARD_DMA_OR(CH)        | (1 << (CH))
+
+_Static_assert((0 BOARD_DMA_CHANNELS(BOARD_DMA_SUM)) == (0 BOARD_DMA_CHANNELS(BOARD_DMA_OR)), "DMA channel used twice");
+
+//peripheral instance by number, e.g. BOARD_INSTANCE(USART, 4) is USART4
+#define BOARD_INSTANCE(TYPE, N)     BOARD_INSTANCE_(TYPE, N)
+#define BOARD_INSTANCE_(TYPE, N)    TYPE##N
+
+#define BOARD_UART_CONFIG(NAME) { \
+    .uart = BOARD_INSTANCE(USART, NAME##_USART), \
+    .txDmaChannel = BOARD_INSTANCE(DMA1_Channel, NAME##_TX_DMA), \
+    .rxDmaChannel = BOARD_INSTANCE(DMA1_Channel, NAME##_RX_DMA), \
+    .txBoard = BOARD_GPIO(NAME##_TX), \
+    .rxBoard = BOARD_GPIO(NAME##_RX), \
+    .txPin = BOARD_PIN(NAME##_TX), \
+    .rxPin = BOARD_PIN(NAME##_RX), \
+    .txAF = BOARD_AF(NAME##_TX), \
+    .rxAF = BOARD_AF(NAME##_RX), \
+    .baud = NAME##_BAUD, \
+}
+
+#define BOARD_SPI_PIN(PIN)  { BOARD_PIN(PIN), BOARD_GPIO(PIN) }
+
+const UART_Config BOARD_BleUart = BOARD_UART_CONFIG(BOARD_BLE);
+const UART_Config BOARD_GnssUart = BOARD_UART_CONFIG(BOARD_GNSS);
+const UART_Config BOARD_LogUart = BOARD_UART_CONFIG(BOARD_LOG);
+
+const SPI_Config BOARD_RadioSpi = {
+    .MOSI = BOARD_SPI_PIN(BOARD_RADIO_MOSI),
+    .MISO = BOARD_SPI_PIN(BOARD_RADIO_MISO),
+    .CS = BOARD_SPI_PIN(BOARD_RADIO_CS),
+    .SCLK = BOARD_SPI_PIN(BOARD_RADIO_SCK),
+    .Instance = BOARD_INSTANCE(SPI, BOARD_RADIO_SPI),
+    .Init = {
+        .Mode = SPI_MODE_MASTER,
+        .Direction = SPI_DIRECTION_2LINES,
+        .DataSize = SPI_DATASIZE_8BIT,
+        .CLKPolarity = SPI_POLARITY_LOW,
+        .CLKPhase = SPI_PHASE_1EDGE,
+        .NSS = SPI_NSS_SOFT,
+        .BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64,
+        .FirstBit = SPI_FIRSTBIT_MSB,
+        .TIMode = SPI_TIMODE_DISABLE,
+        .CRCCalculation = SPI_CRCCALCULATION_DISABLE,
+        .CRCPolynomial = 7,
+    },
+};
+
+#if BOARD_HAS_HOMER
+const HOMER_Config BOARD_Homer = {
+    .tim = BOARD_INSTANCE(TIM, BOARD_HOMER_TIM),
+    .dmaChannel = BOARD_INSTANCE(DMA1_Channel, BOARD_HOMER_DMA),
+    .keyBoard = BOARD_GPIO(BOARD_HOMER_KEY),
+    .keyPin = BOARD_PIN(BOARD_HOMER_KEY),
+    .keyAF = BOARD_AF(BOARD_HOMER_KEY),
+    .enableBoard = BOARD_GPIO(BOARD_HOMER_ENABLE),
+    .enablePin = BOARD_PIN(BOARD_HOMER_ENABLE),
+};
+#endif
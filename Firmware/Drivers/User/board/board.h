@@ -0,0 +1,119 @@
+/**
+ * @file board.h
+ * @author Paul Götzinger
+ * @brief Board description: pins, alternate functions, peripherals and DMA channels of the
+ * WatchPLB board, the driver configurations built from it are kept in flash
+ * @version 1.0
+ * @date 2019-03-30
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "uart.h"
+#include "spi_driver.h"
+#include "homer.h"
+
+//a pin is described by port, pin number and alternate function (0 for plain gpio)
+
+//ble module, USART1
+#define BOARD_BLE_USART     1
+#define BOARD_BLE_BAUD      UART_BaudRate_115200
+#define BOARD_BLE_TX        A, 9, 4
+#define BOARD_BLE_RX        A, 10, 4
+#define BOARD_BLE_TX_DMA    2
+#define BOARD_BLE_RX_DMA    3
+
+//gnss receiver, USART4
+#define BOARD_GNSS_USART    4
+#define BOARD_GNSS_BAUD     UART_BaudRate_9600
+#define BOARD_GNSS_TX       C, 10, 6
+#define BOARD_GNSS_RX       C, 11, 6
+#define BOARD_GNSS_TX_DMA   7
+#define BOARD_GNSS_RX_DMA   6
+
+//log output (LOG_DEST == LOG_UART), USART2
+#define BOARD_LOG_USART     2
+#define BOARD_LOG_BAUD      UART_BaudRate_9600
+#define BOARD_LOG_TX        A, 2, 4
+#define BOARD_LOG_RX        A, 3, 4
+#define BOARD_LOG_TX_DMA    4
+#define BOARD_LOG_RX_DMA    5
+
+//radio transceiver, SPI2 (the spi driver looks the alternate functions up itself)
+#define BOARD_RADIO_SPI     2
+#define BOARD_RADIO_SCK     B, 10, 5
+#define BOARD_RADIO_MISO    C, 2, 2
+#define BOARD_RADIO_MOSI    C, 3, 2
+#define BOARD_RADIO_CS      C, 1, 0
+
+//121.5 MHz homing transmitter: power enable, carrier keyed by TIM2 channel 1, cycles loaded by
+//the DMA request of the TIM2 channel 3 compare. The layout is not verified on the board, build
+//with BOARD_HAS_HOMER=1 to use it; without it the homer driver gets no configuration and stays off
+#ifndef BOARD_HAS_HOMER
+#define BOARD_HAS_HOMER     0
+#endif
+
+#if BOARD_HAS_HOMER
+#define BOARD_HOMER_TIM     2
+#define BOARD_HOMER_KEY     A, 0, 2
+#define BOARD_HOMER_ENABLE  C, 6, 0
+#define BOARD_HOMER_DMA     1
+#define BOARD_HOMER_PINS(X) \
+    X(BOARD_HOMER_KEY) \
+    X(BOARD_HOMER_ENABLE)
+#else
+#define BOARD_HOMER_PINS(X)
+#endif
+
+//keys
+#define BOARD_KEY_1         B, 12, 0
+#define BOARD_KEY_2         C, 7, 0
+#define BOARD_KEY_3         C, 8, 0
+#define BOARD_KEY_4         C, 9, 0
+
+/**
+ * @brief All pins of the description, each pin may be used once (checked in board.c)
+ *
+ */
+#define BOARD_PINS(X) \
+    X(BOARD_BLE_TX) \
+    X(BOARD_BLE_RX) \
+    X(BOARD_GNSS_TX) \
+    X(BOARD_GNSS_RX) \
+    X(BOARD_LOG_TX) \
+    X(BOARD_LOG_RX) \
+    X(BOARD_RADIO_SCK) \
+    X(BOARD_RADIO_MISO) \
+    X(BOARD_RADIO_MOSI) \
+    X(BOARD_RADIO_CS) \
+    BOARD_HOMER_PINS(X) \
+    X(BOARD_KEY_1) \
+    X(BOARD_KEY_2) \
+    X(BOARD_KEY_3) \
+    X(BOARD_KEY_4)
+
+//accessors of a pin description, the indirection expands the description first
+#define BOARD_GPIO(...)         BOARD_GPIO_(__VA_ARGS__)
+#define BOARD_GPIO_(PORT, PIN, AF)  GPIO##PORT
+#define BOARD_PIN(...)          BOARD_PIN_(__VA_ARGS__)
+#define BOARD_PIN_(PORT, PIN, AF)   GPIO_PIN_##PIN
+#define BOARD_AF(...)           BOARD_AF_(__VA_ARGS__)
+#define BOARD_AF_(PORT, PIN, AF)    (AF)
+
+//driver configurations of the board
+extern const UART_Config BOARD_BleUart;
+extern const UART_Config BOARD_GnssUart;
+extern const UART_Config BOARD_LogUart;
+extern const SPI_Config BOARD_RadioSpi;
+#if BOARD_HAS_HOMER
+extern const HOMER_Config BOARD_Homer;
+#define BOARD_HOMER_CONFIG  (&BOARD_Homer)
+#else
+#define BOARD_HOMER_CONFIG  0
+#endif
+
+#endif //!BOARD_H
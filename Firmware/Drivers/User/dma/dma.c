@@ -10,6 +10,7 @@
  */
 
 #include "dma.h"
+#include "trace.h"
 
 #define TRUE  1
 #define FALSE 0
@@ -63,26 +64,31 @@ void DMA_RegisterInterrupt(DMA_HandleTypeDef *dma) {
 * @brief This function handles DMA1 channel 1 interrupt.
 */
 void DMA1_Channel1_IRQHandler(void) {
+	TRACE_BEGIN(TRACE_Event_Dma1_Ch1, 0);
 	//if dma handle in table, call HAL interrupt handler
 	if (dma_handles[0] != 0)
 		HAL_DMA_IRQHandler(dma_handles[0]);
+	TRACE_END(TRACE_Event_Dma1_Ch1, 0);
 }
 
 /**
 * @brief This function handles DMA1 channel 2 and channel 3 interrupts.
 */
 void DMA1_Channel2_3_IRQHandler(void) {
+	TRACE_BEGIN(TRACE_Event_Dma1_Ch2_3, 0);
 	//if dma handle in table, call HAL interrupt handler
 	if (dma_handles[1] != 0)
 		HAL_DMA_IRQHandler(dma_handles[1]);
 	if (dma_handles[2] != 0)
 		HAL_DMA_IRQHandler(dma_handles[2]);
+	TRACE_END(TRACE_Event_Dma1_Ch2_3, 0);
 }
 
 /**
 * @brief This function handles DMA1 channel 4-7 interrupts.
 */
 void DMA1_Channel4_5_6_7_IRQHandler(void) {
+	TRACE_BEGIN(TRACE_Event_Dma1_Ch4_7, 0);
 	//if dma handle in table, call HAL interrupt handler
 	if (dma_handles[3] != 0)
 		HAL_DMA_IRQHandler(dma_handles[3]);
@@ -92,4 +98,5 @@ void DMA1_Channel4_5_6_7_IRQHandler(void) {
 		HAL_DMA_IRQHandler(dma_handles[5]);
 	if (dma_handles[6] != 0)
 		HAL_DMA_IRQHandler(dma_handles[6]);
+	TRACE_END(TRACE_Event_Dma1_Ch4_7, 0);
 }
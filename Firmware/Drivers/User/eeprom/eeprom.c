@@ -0,0 +1,88 @@
+/**
+ * @file eeprom.c
+ * @author Paul Götzinger
+ * @brief Data EEPROM driver
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#include "eeprom.h"
+#include <string.h>
+
+#define WORD_SIZE 4
+
+/**
+ * @brief Program one word if it differs from the stored one
+ * 
+ * @param addr word aligned address
+ * @param word new word content
+ * @return HAL_StatusTypeDef HAL_OK on success
+ */
+static HAL_StatusTypeDef programWord(uint32_t addr, uint32_t word);
+
+HAL_StatusTypeDef EEPROM_Read(uint16_t offset, uint8_t *data, uint16_t len) {
+    if (data == 0 || (uint32_t)offset + len > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+
+    memcpy(data, (const uint8_t*)(DATA_EEPROM_BASE + offset), len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEPROM_Write(uint16_t offset, const uint8_t *data, uint16_t len) {
+    if (data == 0 || (uint32_t)offset + len > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef status = HAL_FLASHEx_DATAEEPROM_Unlock();
+
+    uint32_t addr = DATA_EEPROM_BASE + offset;
+    uint32_t end = addr + len;
+    while (status == HAL_OK && addr < end) {
+        //merge new data into aligned word
+        uint32_t base = addr & ~(WORD_SIZE - 1);
+        uint32_t word = *(volatile uint32_t*)base;
+        uint8_t *bytes = (uint8_t*)&word;
+        for (uint8_t i = addr - base; i < WORD_SIZE && addr < end; i++, addr++) {
+            bytes[i] = *data++;
+        }
+        status = programWord(base, word);
+    }
+
+    HAL_FLASHEx_DATAEEPROM_Lock();
+    return status;
+}
+
+HAL_StatusTypeDef EEPROM_ProgramWord(uint16_t offset, uint32_t word) {
+    if ((offset & (WORD_SIZE - 1)) != 0 || (uint32_t)offset + WORD_SIZE > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+    if (EEPROM_IsBusy()) {
+        return HAL_BUSY;
+    }
+
+    //the HAL only waits for the previous operation, the new one runs on after return
+    HAL_StatusTypeDef status = HAL_FLASHEx_DATAEEPROM_Unlock();
+    if (status == HAL_OK) {
+        status = HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, DATA_EEPROM_BASE + offset, word);
+    }
+    return status;
+}
+
+uint8_t EEPROM_IsBusy(void) {
+    return __HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) != 0;
+}
+
+void EEPROM_Lock(void) {
+    HAL_FLASHEx_DATAEEPROM_Lock();
+}
+
+static HAL_StatusTypeDef programWord(uint32_t addr, uint32_t word) {
+    if (*(volatile uint32_t*)addr == word) {
+        return HAL_OK;
+    }
+    return HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr, word);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file eeprom.h
+ * @author Paul Götzinger
+ * @brief Data EEPROM driver
+ * @version 1.0
+ * @date 2019-03-08
+ * 
+ * @copyright Copyright (c) 2019
+ * 
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#define EEPROM_SIZE (DATA_EEPROM_BANK2_END - DATA_EEPROM_BASE + 1)
+
+/**
+ * @brief Read data from data eeprom
+ * 
+ * @param offset offset from start of data eeprom
+ * @param data buffer to fill
+ * @param len count of bytes to read
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if out of range
+ */
+HAL_StatusTypeDef EEPROM_Read(uint16_t offset, uint8_t *data, uint16_t len);
+
+/**
+ * @brief Write data to data eeprom.
+ * Only words which differ from the stored content are programmed to reduce wear.
+ * 
+ * @param offset offset from start of data eeprom
+ * @param data data to write
+ * @param len count of bytes to write
+ * @return HAL_StatusTypeDef HAL_OK on success
+ */
+HAL_StatusTypeDef EEPROM_Write(uint16_t offset, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Start programming of one word without waiting for its end (erase and write take
+ * about 3.2 ms, reads of the data eeprom stall meanwhile). The data eeprom stays unlocked
+ * until \ref EEPROM_Lock.
+ *
+ * @param offset word aligned offset from start of data eeprom
+ * @param word new word content
+ * @return HAL_StatusTypeDef HAL_OK if started, HAL_BUSY if the previous operation is still running
+ */
+HAL_StatusTypeDef EEPROM_ProgramWord(uint16_t offset, uint32_t word);
+
+/**
+ * @brief Check if a program operation is running
+ *
+ * @return uint8_t 1 if busy
+ */
+uint8_t EEPROM_IsBusy(void);
+
+/**
+ * @brief Lock data eeprom against writes after the last \ref EEPROM_ProgramWord finished
+ *
+ */
+void EEPROM_Lock(void);
+
+#endif //!EEPROM_H
@@ -0,0 +1,130 @@
+/**
+ * @file homer.c
+ * @author Paul Götzinger
+ * @brief 121.5 MHz homing transmitter driver: the timer runs at HOM_TICK_RATE, channel 1 in pwm
+ * mode keys the carrier and the channel 3 compare at the start of each cycle requests a DMA
+ * burst loading the next cycle (ARR, gap, CCR1) into the preload registers
+ * @version 1.0
+ * @date 2019-04-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stddef.h>
+#include "homer.h"
+#include "homing.h"
+
+#define BURST_BASE      (offsetof(TIM_TypeDef, ARR) / 4)    //first register of a burst
+#define BURST_LENGTH    (sizeof(HOM_Cycle) / sizeof(uint16_t))  //registers per cycle
+
+static const HOMER_Config *config;
+static DMA_HandleTypeDef dma;
+static uint8_t on;
+
+/**
+ * @brief Enable clock of a GPIO board
+ *
+ * @param board GPIO board
+ */
+static void EnableClock(GPIO_TypeDef *board);
+
+void HOMER_Init(const HOMER_Config *conf) {
+    if (conf == 0) {
+        return;
+    }
+    config = conf;
+    on = 0;
+
+    EnableClock(conf->enableBoard);
+    EnableClock(conf->keyBoard);
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    if (conf->tim == TIM2) {
+        __HAL_RCC_TIM2_CLK_ENABLE();
+    }
+
+    //transmitter off
+    GPIO_InitTypeDef gpio;
+    HAL_GPIO_WritePin(conf->enableBoard, conf->enablePin, GPIO_PIN_RESET);
+    gpio.Pin = conf->enablePin;
+    gpio.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    gpio.Alternate = 0;
+    HAL_GPIO_Init(conf->enableBoard, &gpio);
+
+    //keying output of the timer
+    gpio.Pin = conf->keyPin;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Alternate = conf->keyAF;
+    HAL_GPIO_Init(conf->keyBoard, &gpio);
+
+    //timer clock is twice the bus clock if the bus is divided
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        clk *= 2;
+    }
+    conf->tim->PSC = clk / HOM_TICK_RATE - 1;
+    conf->tim->CR1 = TIM_CR1_ARPE;
+    conf->tim->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;   //pwm mode 1: on while CNT < CCR1
+    conf->tim->CCR3 = 0;
+    conf->tim->DCR = ((BURST_LENGTH - 1) << TIM_DCR_DBL_Pos) | (BURST_BASE << TIM_DCR_DBA_Pos);
+    conf->tim->DIER = TIM_DIER_CC3DE;
+
+    //the sweep is loaded circularly, no interrupt
+    dma.Instance = conf->dmaChannel;
+    dma.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    dma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    dma.Init.MemInc = DMA_MINC_ENABLE;
+    dma.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma.Init.Mode = DMA_CIRCULAR;
+    dma.Init.Priority = DMA_PRIORITY_LOW;
+    dma.Init.Request = DMA_REQUEST_8;
+    HAL_DMA_Init(&dma);
+}
+
+void HOMER_Start(void) {
+    if (config == 0 || on) {
+        return;
+    }
+    TIM_TypeDef *tim = config->tim;
+
+    //the first cycle is the last of the sweep, meanwhile the DMA loads the sweep from its start
+    tim->ARR = HOM_Sweep[HOM_SWEEP_CYCLES - 1].arr;
+    tim->CCR1 = HOM_Sweep[HOM_SWEEP_CYCLES - 1].on;
+    tim->EGR = TIM_EGR_UG;
+    HAL_DMA_Start(&dma, (uint32_t)HOM_Sweep, (uint32_t)&tim->DMAR, HOM_SWEEP_CYCLES * BURST_LENGTH);
+
+    HAL_GPIO_WritePin(config->enableBoard, config->enablePin, GPIO_PIN_SET);
+    tim->CCER = TIM_CCER_CC1E;
+    tim->CR1 |= TIM_CR1_CEN;
+    on = 1;
+}
+
+void HOMER_Stop(void) {
+    if (config == 0 || !on) {
+        return;
+    }
+    HAL_GPIO_WritePin(config->enableBoard, config->enablePin, GPIO_PIN_RESET);
+    config->tim->CR1 &= ~TIM_CR1_CEN;
+    config->tim->CCER = 0;
+    HAL_DMA_Abort(&dma);
+    on = 0;
+}
+
+uint8_t HOMER_IsOn(void) {
+    return on;
+}
+
+static void EnableClock(GPIO_TypeDef *board) {
+    if (board == GPIOA) {
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+    } else if (board == GPIOB) {
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+    } else if (board == GPIOC) {
+        __HAL_RCC_GPIOC_CLK_ENABLE();
+    } else if (board == GPIOH) {
+        __HAL_RCC_GPIOH_CLK_ENABLE();
+    }
+}
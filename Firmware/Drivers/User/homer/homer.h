@@ -0,0 +1,58 @@
+/**
+ * @file homer.h
+ * @author Paul Götzinger
+ * @brief 121.5 MHz homing transmitter driver: the transceiver synthesizer does not reach
+ * 121.5 MHz, a separate transmitter is powered by an enable pin and its carrier is keyed by a
+ * timer output. DMA loads the audio cycles of the homing sweep into the timer, no cpu time is
+ * spent while transmitting.
+ * @version 1.0
+ * @date 2019-04-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef HOMER_H
+#define HOMER_H
+
+/**
+ * @brief Homing transmitter configuration structure
+ *
+ */
+typedef struct {
+    TIM_TypeDef*          tim;          //keying timer, channel 1 keys the carrier
+    DMA_Channel_TypeDef*  dmaChannel;   //DMA channel of the channel 3 compare request of the timer
+    GPIO_TypeDef*         keyBoard;     //GPIO board of the keying output
+    uint16_t              keyPin;       //GPIO pin of the keying output
+    uint32_t              keyAF;        //alternate function of the keying output
+    GPIO_TypeDef*         enableBoard;  //GPIO board of the transmitter power
+    uint16_t              enablePin;    //GPIO pin of the transmitter power (high = on)
+} HOMER_Config;
+
+/**
+ * @brief Initialize timer, DMA and pins, the transmitter stays off
+ *
+ * @param conf configuration
+ */
+void HOMER_Init(const HOMER_Config *conf);
+
+/**
+ * @brief Power up the transmitter and start the homing sweep at its beginning
+ *
+ */
+void HOMER_Start(void);
+
+/**
+ * @brief Power down the transmitter at once
+ *
+ */
+void HOMER_Stop(void);
+
+/**
+ * @brief Check if the transmitter is on
+ *
+ * @return uint8_t 1 if transmitting
+ */
+uint8_t HOMER_IsOn(void);
+
+#endif //!HOMER_H
@@ -6,6 +6,8 @@
  */
 
 #include "key.h"
+#include "record.h"
+#include "board.h"
 
 
 #define KEY_COUNT 4
@@ -15,11 +17,11 @@ typedef struct {
 	uint16_t      pin;
 } pin_typedef;
 
-static pin_typedef keys[KEY_COUNT] = {
-	{GPIOB,GPIO_PIN_12},
-	{GPIOC,GPIO_PIN_7},
-	{GPIOC,GPIO_PIN_8},
-	{GPIOC,GPIO_PIN_9},
+static const pin_typedef keys[KEY_COUNT] = {
+	{BOARD_GPIO(BOARD_KEY_1),BOARD_PIN(BOARD_KEY_1)},
+	{BOARD_GPIO(BOARD_KEY_2),BOARD_PIN(BOARD_KEY_2)},
+	{BOARD_GPIO(BOARD_KEY_3),BOARD_PIN(BOARD_KEY_3)},
+	{BOARD_GPIO(BOARD_KEY_4),BOARD_PIN(BOARD_KEY_4)},
 };
 
 void KEY_Init(void){
@@ -46,7 +48,9 @@ void KEY_Init(void){
 // gives you the state of the requested button
 GPIO_PinState KEY_Get(BTN_Pins btn){
 	if (btn >= 0 && btn < KEY_COUNT) {
-		return HAL_GPIO_ReadPin(keys[btn].board, keys[btn].pin);
+		GPIO_PinState state = HAL_GPIO_ReadPin(keys[btn].board, keys[btn].pin);
+		REC_KEY(btn, state == GPIO_PIN_SET);
+		return state;
 	}
 	return 0;
 }
@@ -10,6 +10,7 @@
 
 /* Include Block*/
 #include "led_driver.h"
+#include "trace.h"
 #include <assert.h>
 #include <stdbool.h>
 
@@ -42,7 +43,7 @@ typedef struct {
 	LED_PIN pseudo_pin;
 } LUT;
 
-LUT look_up[LUT_SIZE] = { { PA4, led_pa4 },		//1
+static const LUT look_up[LUT_SIZE] = { { PA4, led_pa4 },		//1
 		{ PA5, led_pa5 },						//2
 		{ PA6, led_pa6 },						//3
 		{ PA7, led_pa7 },						//4
@@ -241,6 +242,7 @@ register_struct tim_shift_reg[REG_SIZE] = { 0 };
  * @retval none
  */
 void TIM7_IRQHandler() {
+	TRACE_BEGIN(TRACE_Event_Tim7, 0);
 	/* Shifter */
 	static const REGISTER n_bit = 1 << (sizeof(REGISTER) * 8 - 1);
 	for (int i = 0; i < REG_SIZE; i++) {
@@ -256,6 +258,7 @@ void TIM7_IRQHandler() {
 		}
 	}
 	TIM7->SR = 0;
+	TRACE_END(TRACE_Event_Tim7, 0);
 }
 
 /**
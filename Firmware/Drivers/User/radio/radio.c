@@ -8,6 +8,8 @@
 
 #include "radio.h"
 #include "string.h"
+#include "trace.h"
+#include "memory.h"
 
 #define MIN(X, Y)  ((X) < (Y) ? (X) : (Y))
 
@@ -58,6 +60,7 @@
 //Register configuration Values
 #define CONF_XTALOSC      0x18
 #define CONF_MODULATION   0x06
+#define CONF_MODULATION_OQPSK 0x04
 #define CONF_ENCODING     0x00
 #define CONF_FRAMING      0x00
 #define CONF_FREQ3        0x19
@@ -68,6 +71,9 @@
 #define CONF_TXRATEHI     0x01
 #define CONF_TXRATEMID    0x99
 #define CONF_TXRATELO     0x9a
+#define CONF_CHIPRATEHI   0x00  //38.4 kchip/s
+#define CONF_CHIPRATEMID  0x9d
+#define CONF_CHIPRATELO   0x49
 #define CONF_PLLRANGING   0x18
 #define CONF_PLLLOOP      0x29
 #define CONF_FSKDEV2      0x00  //should be 0?!
@@ -106,6 +112,21 @@
 #define PREAMBLE_DURATION 160
 #define AR_INTERVAL       (5*60*1000)
 
+/**
+ * @brief Configuration and transmitter start up sequence (states configure .. preamble)
+ * 
+ * @param inst radio instance
+ * @return THREAD_Status thread status
+ */
+static THREAD_Status WarmUp(RADIO_Instance *inst);
+
+/**
+ * @brief Write configuration registers
+ * 
+ * @param inst radio instance
+ */
+static void Configure(RADIO_Instance *inst);
+
 /**
  * @brief Transmit bit as 10Bit symbol
  * 
@@ -115,6 +136,23 @@
  */
 static uint8_t Transmit10(RADIO_Instance *inst, uint8_t data);
 
+/**
+ * @brief Transmit byte of chips
+ * 
+ * @param inst radio instance
+ * @param data chip byte to send
+ * @return uint8_t 0 on fail, else 1
+ */
+static uint8_t TransmitChips(RADIO_Instance *inst, uint8_t data);
+
+/**
+ * @brief Configure modulation and data rate for frame or chip mode
+ * 
+ * @param inst radio instance
+ * @param chips 1 for DSSS-OQPSK chip mode, 0 for frame mode
+ */
+static void SetModulation(RADIO_Instance *inst, uint8_t chips);
+
 /**
  * @brief Set a register
  * 
@@ -147,94 +185,26 @@ void RADIO_Init(RADIO_Instance *inst, SPI_Init_Struct *spi) {
         inst->spi = spi;
         inst->idx = 0;
         inst->len = 0;
+        inst->nextAR = HAL_GetTick();
+        inst->chipSource = 0;
         inst->state = RADIO_STATE_CONFIGURE;
+        THREAD_INIT(&inst->warmUp);
     }
 }
 
 void RADIO_Process(RADIO_Instance *inst) {
     if (inst != 0) {
+        TRACE_BEGIN(TRACE_Event_Radio, inst->state);
+
         switch (inst->state)
         {
             case RADIO_STATE_CONFIGURE:
-                //configure radio module
-                SetReg(inst, ADDR_PWRMODE, PWRMODE_STANDBY);
-                inst->idx = HAL_GetTick() + CONFIGURATION_DELAY;
-                SetReg(inst, ADDR_XTALOSC, CONF_XTALOSC);
-                SetReg(inst, ADDR_PLLLOOP, CONF_PLLLOOP);
-                SetReg(inst, ADDR_FREQ3, CONF_FREQ3);
-                SetReg(inst, ADDR_FREQ2, CONF_FREQ2);
-                SetReg(inst, ADDR_FREQ1, CONF_FREQ1);
-                SetReg(inst, ADDR_FREQ0, CONF_FREQ0);
-                SetReg(inst, ADDR_TXPWR, CONF_TXPWR);
-                SetReg(inst, ADDR_FSKDEV2, CONF_FSKDEV2);
-                SetReg(inst, ADDR_FSKDEV1, CONF_FSKDEV1);
-                SetReg(inst, ADDR_FSKDEV0, CONF_FSKDEV0);        
-                SetReg(inst, ADDR_TXRATEHI, CONF_TXRATEHI);
-                SetReg(inst, ADDR_TXRATEMID, CONF_TXRATEMID);
-                SetReg(inst, ADDR_TXRATELO, CONF_TXRATELO);
-                SetReg(inst, ADDR_MODULATION, CONF_MODULATION);
-                SetReg(inst, ADDR_ENCODING, CONF_ENCODING);
-                SetReg(inst, ADDR_FRAMING, CONF_FRAMING);
-                inst->nextAR = 0;
-
-                DumpRegister(inst);
-
-                LOG("[RADIO] Configuration complete\n");
-                inst->state = RADIO_STATE_WAIT_CONF;
-                break;
             case RADIO_STATE_WAIT_CONF:
-                //wait until configuration is finished
-                if (HAL_GetTick() > inst->idx) {
-                    inst->state = RADIO_STATE_IDLE;
-                }
-                break;
             case RADIO_STATE_START_TX:
-                //power up transmitter (step 1)
-                SetReg(inst, ADDR_PWRMODE, PWRMODE_SYNTHTX);
-                inst->idx = HAL_GetTick() + STARTUP_DELAY;
-                inst->state = RADIO_STATE_WAIT_TX;
-                break;
             case RADIO_STATE_WAIT_TX:
-                //wait until transmitter is ready
-                if (HAL_GetTick() > inst->idx) {
-                    if (HAL_GetTick() > inst->nextAR) {
-                        //power up transmitter (step 2)
-                        SetReg(inst, ADDR_PWRMODE, PWRMODE_FULLTX);
-                        inst->idx   = HAL_GetTick() + PREAMBLE_DURATION;
-                        inst->state = RADIO_STATE_PREAMBLE;
-                    } else {
-                        //perform autorange
-                        SetReg(inst, ADDR_PLLRANGING, CONF_PLLRANGING);
-                        inst->state = RADIO_STATE_WAIT_AR;
-                    }
-                }
-                break;
             case RADIO_STATE_WAIT_AR:
-                //wait for auto range to finish
-                {
-                    uint8_t reg;
-                    GetReg(inst, ADDR_PLLRANGING, &reg);
-                    if (reg & MASK_PLLRANGING_ERROR) {
-                        //autorange failed
-                        LOG("[RADIO] PLL Ranging failed! Restart Configuration\n");
-                        inst->state = RADIO_STATE_CONFIGURE;
-                    } else if ((reg & MASK_PLLRANGING_START) == 0) {
-                        //autorange finished; power up transmitter (step 2)
-                        SetReg(inst, ADDR_PWRMODE, PWRMODE_FULLTX);
-                        inst->state  = RADIO_STATE_PREAMBLE;
-                        inst->nextAR = HAL_GetTick() + AR_INTERVAL;
-                        inst->idx    = HAL_GetTick() + PREAMBLE_DURATION;
-                    }
-                    break;
-                }
             case RADIO_STATE_PREAMBLE:
-                //send preamble message
-                if (HAL_GetTick() < inst->idx) {
-                    SetReg(inst, ADDR_FIFODATA, PREAMBLE_MSG);
-                } else {
-                    inst->idx = 0;
-                    inst->state = RADIO_STATE_FRAME; 
-                }
+                WarmUp(inst);
                 break;
             case RADIO_STATE_FRAME:
                 //send frame
@@ -247,7 +217,37 @@ void RADIO_Process(RADIO_Instance *inst) {
                     }
                 }                
                 break;
+            case RADIO_STATE_CHIPS:
+                //refill fifo from chip source
+                while (1) {
+                    if (inst->idx >= inst->len) {
+                        inst->len = inst->chipSource(inst->frame, RADIO_FRAME_LENGTH);
+                        inst->idx = 0;
+                        if (inst->len == 0) {
+                            inst->state = RADIO_STATE_POSTAMBLE;
+                            break;
+                        }
+                    }
+                    if (!TransmitChips(inst, inst->frame[inst->idx])) {
+                        break;
+                    }
+                    inst->idx++;
+                }
+                break;
             case RADIO_STATE_POSTAMBLE:
+                if (inst->chipSource != 0) {
+                    //wait until last chips left the fifo
+                    uint8_t reg;
+                    if (GetReg(inst, ADDR_FIFOCTRL, &reg) & STATE_S2_FIFO_EMPTY) {
+                        //power down transmitter
+                        SetReg(inst, ADDR_PWRMODE, PWRMODE_STANDBY);
+                        inst->chipSource = 0;
+                        inst->state = RADIO_STATE_IDLE;
+                        inst->idx = 0;
+                    }
+                    break;
+                }
+
                 //send postamble
                 Transmit10(inst, 0);
                 if (inst->idx == 0) {
@@ -262,6 +262,8 @@ void RADIO_Process(RADIO_Instance *inst) {
             default:
                 break;
         }
+
+        TRACE_END(TRACE_Event_Radio, inst->state);
     }
 }
 
@@ -273,7 +275,21 @@ void RADIO_SetFrame(RADIO_Instance *inst, uint8_t *data, uint16_t len) {
         memcpy(inst->frame, data, len);
         inst->len = len;
         inst->idx = 0;
+        inst->chipSource = 0;
+        inst->state = RADIO_STATE_START_TX;
+        THREAD_INIT(&inst->warmUp);
+    }
+}
+
+void RADIO_SetChipStream(RADIO_Instance *inst, RADIO_ChipSource src) {
+    if (inst != 0 && inst->state == RADIO_STATE_IDLE && src != 0) {
+        //chips are requested in RADIO_STATE_CHIPS
+        LOG("[RADIO] New Chip Stream\n");
+        inst->chipSource = src;
+        inst->len = 0;
+        inst->idx = 0;
         inst->state = RADIO_STATE_START_TX;
+        THREAD_INIT(&inst->warmUp);
     }
 }
 
@@ -285,7 +301,87 @@ RADIO_State RADIO_GetState(RADIO_Instance *inst) {
     return 0;
 }
 
-static uint8_t Transmit10(RADIO_Instance *inst, uint8_t data) {
+static THREAD_Status WarmUp(RADIO_Instance *inst) {
+    THREAD_Context *t = &inst->warmUp;
+    uint8_t reg;
+
+    THREAD_BEGIN(t);
+
+    if (inst->state == RADIO_STATE_CONFIGURE) {
+        //configure radio module, it needs a while to settle
+        Configure(inst);
+        inst->state = RADIO_STATE_WAIT_CONF;
+        THREAD_DELAY(t, CONFIGURATION_DELAY);
+        inst->state = RADIO_STATE_IDLE;
+        THREAD_EXIT(t);
+    }
+
+    //select modulation and power up transmitter (step 1)
+    SetModulation(inst, inst->chipSource != 0);
+    SetReg(inst, ADDR_PWRMODE, PWRMODE_SYNTHTX);
+    inst->state = RADIO_STATE_WAIT_TX;
+    THREAD_DELAY(t, STARTUP_DELAY);
+
+    if ((int32_t)(HAL_GetTick() - inst->nextAR) >= 0) {
+        //perform autorange
+        SetReg(inst, ADDR_PLLRANGING, CONF_PLLRANGING);
+        inst->state = RADIO_STATE_WAIT_AR;
+        //read the ranging register until the start bit clears
+        THREAD_WAIT_UNTIL(t, (GetReg(inst, ADDR_PLLRANGING, &reg), (reg & MASK_PLLRANGING_START) == 0));
+
+        if (reg & MASK_PLLRANGING_ERROR) {
+            //autorange failed, the transmission is dropped
+            LOG("[RADIO] PLL Ranging failed! Restart Configuration\n");
+            inst->state = RADIO_STATE_CONFIGURE;
+            THREAD_RESTART(t);
+        }
+        inst->nextAR = HAL_GetTick() + AR_INTERVAL;
+    }
+
+    //power up transmitter (step 2)
+    SetReg(inst, ADDR_PWRMODE, PWRMODE_FULLTX);
+
+    if (inst->chipSource != 0) {
+        //chip streams contain their own preamble
+        inst->state = RADIO_STATE_CHIPS;
+        THREAD_EXIT(t);
+    }
+
+    //send preamble message
+    inst->state = RADIO_STATE_PREAMBLE;
+    THREAD_TIMER_START(t);
+    while (THREAD_ELAPSED(t) < PREAMBLE_DURATION) {
+        //raw fifo byte like a chip byte, skipped while the fifo is full
+        TransmitChips(inst, PREAMBLE_MSG);
+        THREAD_YIELD(t);
+    }
+    inst->state = RADIO_STATE_FRAME;
+
+    THREAD_END(t);
+}
+
+static void Configure(RADIO_Instance *inst) {
+    SetReg(inst, ADDR_PWRMODE, PWRMODE_STANDBY);
+    SetReg(inst, ADDR_XTALOSC, CONF_XTALOSC);
+    SetReg(inst, ADDR_PLLLOOP, CONF_PLLLOOP);
+    SetReg(inst, ADDR_FREQ3, CONF_FREQ3);
+    SetReg(inst, ADDR_FREQ2, CONF_FREQ2);
+    SetReg(inst, ADDR_FREQ1, CONF_FREQ1);
+    SetReg(inst, ADDR_FREQ0, CONF_FREQ0);
+    SetReg(inst, ADDR_TXPWR, CONF_TXPWR);
+    SetReg(inst, ADDR_FSKDEV2, CONF_FSKDEV2);
+    SetReg(inst, ADDR_FSKDEV1, CONF_FSKDEV1);
+    SetReg(inst, ADDR_FSKDEV0, CONF_FSKDEV0);        
+    SetModulation(inst, 0);
+    SetReg(inst, ADDR_ENCODING, CONF_ENCODING);
+    SetReg(inst, ADDR_FRAMING, CONF_FRAMING);
+
+    DumpRegister(inst);
+
+    LOG("[RADIO] Configuration complete\n");
+}
+
+MEM_RAMFUNC static uint8_t Transmit10(RADIO_Instance *inst, uint8_t data) {
     uint16_t tx = (data == 0) ? IQ_0 : IQ_1;    //select symbol to send
 
     uint8_t ret = SetReg(inst, ADDR_FIFOCTRL, tx >> 8); //send bit 8 and 9
@@ -298,7 +394,33 @@ static uint8_t Transmit10(RADIO_Instance *inst, uint8_t data) {
     return (ret & STATE_S3_FIFO_FULL) == 0;
 }
 
-static uint8_t SetReg(RADIO_Instance *inst, uint8_t addr, uint8_t data) {
+MEM_RAMFUNC static uint8_t TransmitChips(RADIO_Instance *inst, uint8_t data) {
+    uint8_t reg;
+    uint8_t ret = GetReg(inst, ADDR_FIFOCTRL, &reg);   //read fifo status
+
+    //check if fifo isn't full
+    if ((ret & STATE_S3_FIFO_FULL) == 0) {
+        SetReg(inst, ADDR_FIFODATA, data);
+    }
+
+    return (ret & STATE_S3_FIFO_FULL) == 0;
+}
+
+static void SetModulation(RADIO_Instance *inst, uint8_t chips) {
+    if (chips) {
+        SetReg(inst, ADDR_TXRATEHI, CONF_CHIPRATEHI);
+        SetReg(inst, ADDR_TXRATEMID, CONF_CHIPRATEMID);
+        SetReg(inst, ADDR_TXRATELO, CONF_CHIPRATELO);
+        SetReg(inst, ADDR_MODULATION, CONF_MODULATION_OQPSK);
+    } else {
+        SetReg(inst, ADDR_TXRATEHI, CONF_TXRATEHI);
+        SetReg(inst, ADDR_TXRATEMID, CONF_TXRATEMID);
+        SetReg(inst, ADDR_TXRATELO, CONF_TXRATELO);
+        SetReg(inst, ADDR_MODULATION, CONF_MODULATION);
+    }
+}
+
+MEM_RAMFUNC static uint8_t SetReg(RADIO_Instance *inst, uint8_t addr, uint8_t data) {
     uint8_t status, tmp;
 
     //chip select -> 0
@@ -317,7 +439,7 @@ static uint8_t SetReg(RADIO_Instance *inst, uint8_t addr, uint8_t data) {
     return status;
 }
 
-static uint8_t GetReg(RADIO_Instance *inst, uint8_t addr, uint8_t *data) {
+MEM_RAMFUNC static uint8_t GetReg(RADIO_Instance *inst, uint8_t addr, uint8_t *data) {
     uint8_t status;
 
     //chip select -> 0
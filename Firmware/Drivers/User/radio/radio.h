@@ -10,6 +10,7 @@
 #define RADIO_H
 
 #include "spi_driver.h"
+#include "thread.h"
 
 #define RADIO_FRAME_LENGTH 256
 
@@ -26,9 +27,19 @@ typedef enum {
     RADIO_STATE_WAIT_AR,
     RADIO_STATE_PREAMBLE,
     RADIO_STATE_FRAME,
+    RADIO_STATE_CHIPS,
     RADIO_STATE_POSTAMBLE
 } RADIO_State;
 
+/**
+ * @brief Chip source callback, fills buffer with next radio fifo bytes
+ * 
+ * @param buf buffer to fill
+ * @param len length of buffer
+ * @return uint16_t count of bytes written, 0 at end of transmission
+ */
+typedef uint16_t (*RADIO_ChipSource)(uint8_t *buf, uint16_t len);
+
 /**
  * @brief Radio instance structure
  * 
@@ -38,9 +49,10 @@ typedef struct {
     uint8_t frame[RADIO_FRAME_LENGTH];
     RADIO_State state;
     uint16_t len;
-    uint32_t idx;
-    uint32_t nextAR;
-    
+    uint16_t idx;                   //next byte of frame or chip buffer, postamble symbols sent
+    uint32_t nextAR;                //tick the next auto range is due
+    THREAD_Context warmUp;          //configuration and transmitter start up
+    RADIO_ChipSource chipSource;    //chip source in DSSS mode, 0 in frame mode
 } RADIO_Instance;
 
 /**
@@ -67,6 +79,15 @@ void        RADIO_Process(RADIO_Instance *inst);
  */
 void        RADIO_SetFrame(RADIO_Instance *inst, uint8_t *data, uint16_t len);
 
+/**
+ * @brief Starts a DSSS-OQPSK transmission streaming chips from a source.
+ * The chip source is polled whenever the fifo needs to be refilled.
+ * 
+ * @param inst radio instance
+ * @param src chip source
+ */
+void        RADIO_SetChipStream(RADIO_Instance *inst, RADIO_ChipSource src);
+
 /**
  * @brief Retrieve current state
  * 
@@ -10,6 +10,7 @@
 #define LUT_SIZE 26
 
 #include "spi_driver.h"
+#include "memory.h"
 
 /*Private Structs*/
 /**
@@ -24,7 +25,7 @@ typedef struct {
 /**
  * @brief A Look- Up- Table(LUT) to find out which PIN Corresponds to what AF.
  */
-spi_init_lut_tdef spi_init_lut[LUT_SIZE] = { { { GPIO_PIN_4, GPIOA },
+static const spi_init_lut_tdef spi_init_lut[LUT_SIZE] = { { { GPIO_PIN_4, GPIOA },
 		GPIO_AF0_SPI1 }, { { GPIO_PIN_5, GPIOA }, GPIO_AF0_SPI1 }, { {
 		GPIO_PIN_6, GPIOA }, GPIO_AF0_SPI1 }, { { GPIO_PIN_7, GPIOA },
 		GPIO_AF0_SPI1 }, { { GPIO_PIN_11, GPIOA }, GPIO_AF0_SPI1 }, { {
@@ -111,40 +112,45 @@ static void SPI_Init_CS(const SPI_GPIO_Pair gp) {
  * @param  gp: The Pin and the Location of the Pin to use
  * @retval none
  */
-void SPI_CS_Enable(SPI_Init_Struct * spi_init) {
-	HAL_GPIO_WritePin(spi_init->CS.bank, spi_init->CS.pin, GPIO_PIN_RESET);
+MEM_RAMFUNC void SPI_CS_Enable(SPI_Init_Struct * spi_init) {
+	HAL_GPIO_WritePin(spi_init->conf->CS.bank, spi_init->conf->CS.pin, GPIO_PIN_RESET);
 }
 /**
  * @brief Disable CS
  * @param  gp: The Pin and the Location of the Pin to use
  * @retval none
  */
-void SPI_CS_Disable(SPI_Init_Struct * spi_init) {
-	HAL_GPIO_WritePin(spi_init->CS.bank, spi_init->CS.pin, GPIO_PIN_SET);
+MEM_RAMFUNC void SPI_CS_Disable(SPI_Init_Struct * spi_init) {
+	HAL_GPIO_WritePin(spi_init->conf->CS.bank, spi_init->conf->CS.pin, GPIO_PIN_SET);
 }
 /**
  * @brief Initialize SPI and GPIOs; Enables CS
- * @param  spi_init: The Pins and SPI to initialize
+ * @param  spi_init: The SPI to initialize
+ * @param  conf: The Pins and SPI configuration to use
  * @retval Result of Operation
  */
-SPI_RetType SPI_Init(SPI_Init_Struct * spi_init) {
-	if (spi_init == 0) {
+SPI_RetType SPI_Init(SPI_Init_Struct * spi_init, const SPI_Config * conf) {
+	if (spi_init == 0 || conf == 0) {
 		return SPI_RET_INVALID_PARAM;
 	}
 
-	if (spi_init->SPI.Instance == SPI1) {
+	if (conf->Instance == SPI1) {
 		__HAL_RCC_SPI1_CLK_ENABLE();
-	} else if (spi_init->SPI.Instance == SPI2) {
+	} else if (conf->Instance == SPI2) {
 		__HAL_RCC_SPI2_CLK_ENABLE();
 	} else {
 		return SPI_RET_INVALID_PARAM;
 	}
 
-	//SPI_AF_INIT(spi_init->CS);
-	SPI_AF_INIT(spi_init->MOSI);
-	SPI_AF_INIT(spi_init->MISO);
-	SPI_AF_INIT(spi_init->SCLK);
-	SPI_Init_CS(spi_init->CS);
+	spi_init->conf = conf;
+	spi_init->SPI.Instance = conf->Instance;
+	spi_init->SPI.Init = conf->Init;
+
+	//SPI_AF_INIT(conf->CS);
+	SPI_AF_INIT(conf->MOSI);
+	SPI_AF_INIT(conf->MISO);
+	SPI_AF_INIT(conf->SCLK);
+	SPI_Init_CS(conf->CS);
 	SPI_CS_Disable(spi_init);
 
 	__HAL_SPI_DISABLE(&spi_init->SPI);
@@ -188,7 +194,7 @@ SPI_RetType SPI_SendData(SPI_Init_Struct * spi_init, uint8_t * tx_buffer,
  * @param timout: the timeout
  * @retval Result of Operation
  */
-SPI_RetType SPI_WriteRead(SPI_Init_Struct * spi_init, uint8_t tx_byte, 
+MEM_RAMFUNC SPI_RetType SPI_WriteRead(SPI_Init_Struct * spi_init, uint8_t tx_byte, 
 		uint8_t * rx_byte, uint8_t timeout) {
 	
 	if (spi_init == 0) {
@@ -234,10 +240,10 @@ SPI_RetType SPI_DeInit(SPI_Init_Struct * spi_init) {
 		return SPI_RET_INVALID_PARAM;
 	}
 	SPI_CS_Disable(spi_init);
-	HAL_GPIO_DeInit(spi_init->CS.bank, spi_init->CS.pin);
-	HAL_GPIO_DeInit(spi_init->SCLK.bank, spi_init->SCLK.pin);
-	HAL_GPIO_DeInit(spi_init->MOSI.bank, spi_init->MOSI.pin);
-	HAL_GPIO_DeInit(spi_init->MISO.bank, spi_init->MISO.pin);
+	HAL_GPIO_DeInit(spi_init->conf->CS.bank, spi_init->conf->CS.pin);
+	HAL_GPIO_DeInit(spi_init->conf->SCLK.bank, spi_init->conf->SCLK.pin);
+	HAL_GPIO_DeInit(spi_init->conf->MOSI.bank, spi_init->conf->MOSI.pin);
+	HAL_GPIO_DeInit(spi_init->conf->MISO.bank, spi_init->conf->MISO.pin);
 
 	if (HAL_SPI_DeInit(&spi_init->SPI) != HAL_OK) {
 		return SPI_RET_FAILED_INIT;
@@ -44,23 +44,32 @@ typedef struct {
 } SPI_GPIO_Pair;
 
 /*
- * @brief Public Struct for Pins to Use and SPI to Initialize
+ * @brief Public Struct for Pins to Use and SPI to Initialize, kept in flash
  * */
 typedef struct {
 	SPI_GPIO_Pair MOSI;
 	SPI_GPIO_Pair MISO;
 	SPI_GPIO_Pair CS;
 	SPI_GPIO_Pair SCLK;
+	SPI_TypeDef * Instance;
+	SPI_InitTypeDef Init;
+} SPI_Config;
+/*
+ * @brief Public Struct for an initialized SPI
+ * */
+typedef struct {
+	const SPI_Config * conf;
 	SPI_HandleTypeDef SPI;
 } SPI_Init_Struct;
 
 /*Basic LED- Driver Block*/
 /**
  * @brief Initialize SPI and GPIOs; Enables CS
- * @param  spi_init: The Pins and SPI to initialize
+ * @param  spi_init: The SPI to initialize
+ * @param  conf: The Pins and SPI configuration to use
  * @retval Result of Operation
  */
-SPI_RetType SPI_Init(SPI_Init_Struct * spi_init);
+SPI_RetType SPI_Init(SPI_Init_Struct * spi_init, const SPI_Config * conf);
 
 /**
  * @brief Send Data via given SPI
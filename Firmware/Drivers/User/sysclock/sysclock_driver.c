@@ -9,6 +9,7 @@
  */
 
 #include "sysclock_driver.h"
+#include "trace.h"
 
 /**
  * @brief Error Handler
@@ -73,6 +74,9 @@ void SystemClock_Config(void) {
 
 	//SysTick_IRQn interrupt configuration
 	HAL_NVIC_SetPriority(SysTick_IRQn, 0, 0);
+
+	//keep trace timestamps in us
+	TRACE_ClockChanged();
 }
 
 /**
@@ -135,6 +139,9 @@ void SystemClock_SleepMode_Config(void) {
 
 	//SysTick_IRQn interrupt configuration
 	HAL_NVIC_SetPriority(SysTick_IRQn, 0, 0);
+
+	//keep trace timestamps in us
+	TRACE_ClockChanged();
 }
 
 /**
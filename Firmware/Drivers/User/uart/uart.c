@@ -11,6 +11,7 @@
 
 #include "uart.h"
 #include "dma.h"
+#include "trace.h"
 #include <string.h>
 
 #define TRUE 1
@@ -81,7 +82,7 @@ static void startReceive(UART_Instance* inst);
 static uint8_t init = FALSE;	//module init flag
 static UART_Instance* instances[UART_MODULE_COUNT];	//uart instances table (needed for interrupts)
 
-void UART_Init(UART_Instance* inst, UART_Config* conf) {
+void UART_Init(UART_Instance* inst, const UART_Config* conf) {
 	if (!init) {
 		//if not already initialized clear instance table
 		for (uint8_t i = 0; i < UART_MODULE_COUNT; i++) {
@@ -472,6 +473,8 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *uart) {
 }
 
 void USART1_IRQHandler() {
+	TRACE_BEGIN(TRACE_Event_Usart1, 0);
+
 	//if instance for uart1 is configured
 	if (instances[UART_1] != 0) {
 		//check for IDLE interrupt
@@ -483,9 +486,13 @@ void USART1_IRQHandler() {
 		//call HAL interrupt handler
 		HAL_UART_IRQHandler(&(instances[UART_1]->uart));
 	}
+
+	TRACE_END(TRACE_Event_Usart1, 0);
 }
 
 void USART2_IRQHandler() {
+	TRACE_BEGIN(TRACE_Event_Usart2, 0);
+
 	//if instance for uart2 is configured
 	if (instances[UART_2] != 0) {
 		//check for IDLE interrupt
@@ -497,9 +504,13 @@ void USART2_IRQHandler() {
 		//call HAL interrupt handler
 		HAL_UART_IRQHandler(&(instances[UART_2]->uart));
 	}
+
+	TRACE_END(TRACE_Event_Usart2, 0);
 }
 
 void USART4_5_IRQHandler() {
+	TRACE_BEGIN(TRACE_Event_Usart4_5, 0);
+
 	//if instance for uart4 is configured
 	if (instances[UART_4] != 0) {
 		//check for IDLE interrupt
@@ -522,4 +533,6 @@ void USART4_5_IRQHandler() {
 		//call HAL interrupt handler
 		HAL_UART_IRQHandler(&(instances[UART_5]->uart));
 	}
+
+	TRACE_END(TRACE_Event_Usart4_5, 0);
 }
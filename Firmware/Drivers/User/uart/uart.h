@@ -72,7 +72,7 @@ typedef struct {
  * @param inst empty UART instance
  * @param conf Configration
  */
-void UART_Init(UART_Instance* inst, UART_Config* conf);
+void UART_Init(UART_Instance* inst, const UART_Config* conf);
 
 /**
  * @brief Send single byte
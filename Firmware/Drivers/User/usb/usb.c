@@ -11,6 +11,8 @@
 #include "usb_device.h"
 #include "usbd_cdc_if.h"
 
+static USB_ReceiveCallback receiveCallback = 0;
+
 HAL_StatusTypeDef USB_Init()
 {
 	//enable clocks
@@ -25,10 +27,28 @@ HAL_StatusTypeDef USB_Init()
 HAL_StatusTypeDef USB_SendData(uint8_t* Buf, uint16_t Len)
 {
 	//CDC_Transmit_FS: Data to send over USB IN endpoint are sent over CDC interface through this function.
-	if(CDC_Transmit_FS(Buf, Len) == USBD_FAIL)
+	uint8_t result = CDC_Transmit_FS(Buf, Len);
+	if(result == USBD_BUSY)
+	{
+		return HAL_BUSY;
+	}
+	if(result == USBD_FAIL)
 	{
 		return HAL_ERROR;
 	}
 
 	return HAL_OK;
 }
+
+void USB_SetReceiveCallback(USB_ReceiveCallback cb)
+{
+	receiveCallback = cb;
+}
+
+void USB_DataReceived(uint8_t* Buf, uint16_t Len)
+{
+	if(receiveCallback != 0)
+	{
+		receiveCallback(Buf, Len);
+	}
+}
@@ -8,8 +8,22 @@
   **************************
   */
 
+#ifndef USB_H
+#define USB_H
+
+// Callback for data received from vcom (called in interrupt context)
+typedef void (*USB_ReceiveCallback)(uint8_t* Buf, uint16_t Len);
+
 // Initializes all components needed to send data via USB to Virtual COM Port
 HAL_StatusTypeDef USB_Init();
 
-// Sends unsigned char array to vcom
+// Copies unsigned char array to the vcom transmit buffer (HAL_BUSY if it does not fit yet, HAL_ERROR if no host is attached)
 HAL_StatusTypeDef USB_SendData(uint8_t* Buf, uint16_t Len);
+
+// Sets callback for data received from vcom
+void USB_SetReceiveCallback(USB_ReceiveCallback cb);
+
+// Forwards data received over cdc interface to callback
+void USB_DataReceived(uint8_t* Buf, uint16_t Len);
+
+#endif //!USB_H
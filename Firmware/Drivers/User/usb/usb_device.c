@@ -11,8 +11,9 @@
 #include "usb_device.h"
 #include "usbd_core.h"
 #include "usbd_desc.h"
-#include "usbd_cdc.h"
+#include "usbd_composite.h"
 #include "usbd_cdc_if.h"
+#include "usbd_storage_if.h"
 
 
 /* USB Device Core handle declaration. */
@@ -27,10 +28,12 @@ void MX_USB_DEVICE_Init(void)
   /* Init Device Library, add supported class and start the library. */
   USBD_Init(&hUsbDeviceFS, &FS_Desc, DEVICE_FS);
 
-  USBD_RegisterClass(&hUsbDeviceFS, &USBD_CDC);
+  USBD_RegisterClass(&hUsbDeviceFS, &USBD_COMPOSITE);
 
   USBD_CDC_RegisterInterface(&hUsbDeviceFS, &USBD_Interface_fops_FS);
 
+  USBD_MSC_RegisterStorage(&hUsbDeviceFS, &USBD_Storage_Interface_fops_FS);
+
   USBD_Start(&hUsbDeviceFS);
 
 }
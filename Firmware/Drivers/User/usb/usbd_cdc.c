@@ -670,6 +670,12 @@ static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
     
     hcdc->TxState = 0;
 
+    /* Next transfer starts from the interrupt, the endpoint stays busy */
+    if (((USBD_CDC_ItfTypeDef *)pdev->pUserData)->TransmitCplt != NULL)
+    {
+      ((USBD_CDC_ItfTypeDef *)pdev->pUserData)->TransmitCplt();
+    }
+
     return USBD_OK;
   }
   else
@@ -50,7 +50,7 @@
   * @{
   */ 
 #define CDC_IN_EP                                   0x81  /* EP1 for data IN */
-#define CDC_OUT_EP                                  0x01  /* EP1 for data OUT */
+#define CDC_OUT_EP                                  0x03  /* EP3 for data OUT (EP1 IN is double buffered) */
 #define CDC_CMD_EP                                  0x82  /* EP2 for CDC commands */
 
 /* CDC Endpoints parameters: you can fine tune these values depending on the needed baudrates and performance. */
@@ -104,6 +104,7 @@ typedef struct _USBD_CDC_Itf
   int8_t (* DeInit)        (void);
   int8_t (* Control)       (uint8_t, uint8_t * , uint16_t);   
   int8_t (* Receive)       (uint8_t *, uint32_t *);  
+  int8_t (* TransmitCplt)  (void);                        /* IN transfer acknowledged (interrupt) */
 
 }USBD_CDC_ItfTypeDef;
 
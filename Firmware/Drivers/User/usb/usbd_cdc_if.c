@@ -8,15 +8,28 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_cdc_if.h"
+#include "usb.h"
+#include "memory.h"
 
-#define APP_RX_DATA_SIZE  1000
-#define APP_TX_DATA_SIZE  1000
+/** One packet is received at a time */
+#define APP_RX_DATA_SIZE  CDC_DATA_FS_OUT_PACKET_SIZE
 
-/** Received data over USB are stored in this buffer      */
-uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
+/** Transmit ring (power of 2, holds a log line): one packet on the wire, the next one waiting in
+    the idle packet buffer, the following ones queued */
+#define APP_TX_DATA_SIZE  (4 * CDC_DATA_FS_IN_PACKET_SIZE)
 
-/** Data to send over USB CDC are stored in this buffer   */
-uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
+/** Received data over USB are stored in this buffer */
+static uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
+
+/** Data to send over USB are copied to this ring */
+static uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
+static volatile uint8_t configured; /* set while the host has the device configured */
+static volatile uint16_t txHead;    /* written by CDC_Transmit_FS, free running */
+static volatile uint16_t txTail;    /* advanced when a transfer is acknowledged, free running */
+static uint16_t txLength;           /* length of the transfer in progress */
+
+MEM_BUFFER("usb", UserRxBufferFS);
+MEM_BUFFER("usb", UserTxBufferFS);
 
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
@@ -25,6 +38,8 @@ static int8_t CDC_Init_FS(void);
 static int8_t CDC_DeInit_FS(void);
 static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Receive_FS(uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_TransmitCplt_FS(void);
+static void CDC_StartTransmit_FS(void);
 
 
 
@@ -33,7 +48,8 @@ USBD_CDC_ItfTypeDef USBD_Interface_fops_FS =
   CDC_Init_FS,
   CDC_DeInit_FS,
   CDC_Control_FS,
-  CDC_Receive_FS
+  CDC_Receive_FS,
+  CDC_TransmitCplt_FS
 };
 
 /* Private functions ---------------------------------------------------------*/
@@ -44,8 +60,12 @@ USBD_CDC_ItfTypeDef USBD_Interface_fops_FS =
 static int8_t CDC_Init_FS(void)
 {
   /* Set Application Buffers */
-  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
+  txHead = 0;
+  txTail = 0;
+  txLength = 0;
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, 0, 0);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  configured = 1;
   return (USBD_OK);
 }
 
@@ -55,6 +75,7 @@ static int8_t CDC_Init_FS(void)
   */
 static int8_t CDC_DeInit_FS(void)
 {
+  configured = 0;
   return (USBD_OK);
 }
 
@@ -145,6 +166,7 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
   */
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
+  USB_DataReceived(Buf, *Len);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
   USBD_CDC_ReceivePacket(&hUsbDeviceFS);
   return (USBD_OK);
@@ -152,24 +174,78 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 
 /**
   * @brief  CDC_Transmit_FS
-  *         Data to send over USB IN endpoint are sent over CDC interface
-  *         through this function.
-  *         @note
-  *
+  *         Data to send over USB IN endpoint are copied to the transmit ring,
+  *         the transfers continue from the interrupt until the ring is empty.
   *
   * @param  Buf: Buffer of data to be sent
   * @param  Len: Number of data to be sent (in bytes)
-  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  * @retval USBD_OK if all operations are OK, USBD_BUSY if the data does not fit
+  *         (yet), USBD_FAIL if no host is attached
   */
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
 {
-  uint8_t result = USBD_OK;
-  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
-  if (hcdc->TxState != 0){
+  if (!configured || Len > APP_TX_DATA_SIZE) {
+    return USBD_FAIL;
+  }
+  if ((uint16_t)(APP_TX_DATA_SIZE - (uint16_t)(txHead - txTail)) < Len) {
     return USBD_BUSY;
   }
-  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, Buf, Len);
-  result = USBD_CDC_TransmitPacket(&hUsbDeviceFS);
-  return result;
+
+  /* only this function moves the head, the interrupt reads it */
+  uint16_t head = txHead;
+  for (uint16_t i = 0; i < Len; i++) {
+    UserTxBufferFS[(head + i) % APP_TX_DATA_SIZE] = Buf[i];
+  }
+  txHead = head + Len;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  CDC_StartTransmit_FS();
+  __set_PRIMASK(primask);
+  return USBD_OK;
 }
 
+/**
+  * @brief  CDC_TransmitCplt_FS
+  *         Transfer acknowledged by the host (interrupt context), start the next one.
+  *         A transfer of full packets is terminated with a zero length packet once
+  *         the ring is empty, the host passes the data on without waiting for more.
+  * @retval USBD_OK
+  */
+static int8_t CDC_TransmitCplt_FS(void)
+{
+  uint16_t sent = txLength;
+
+  txTail += sent;
+  txLength = 0;
+  if (txHead != txTail) {
+    CDC_StartTransmit_FS();
+  } else if (sent != 0 && sent % CDC_DATA_FS_IN_PACKET_SIZE == 0) {
+    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
+    USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+  }
+  return (USBD_OK);
+}
+
+/**
+  * @brief  CDC_StartTransmit_FS
+  *         Start transfer of the contiguous data at the tail of the ring if the
+  *         endpoint is idle (interrupts masked or interrupt context)
+  * @retval None
+  */
+static void CDC_StartTransmit_FS(void)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+  uint16_t tail = txTail % APP_TX_DATA_SIZE;
+  uint16_t len = txHead - txTail;
+
+  if (hcdc == 0 || hcdc->TxState != 0 || len == 0) {
+    return;
+  }
+  if (len > APP_TX_DATA_SIZE - tail) {
+    len = APP_TX_DATA_SIZE - tail;
+  }
+  txLength = len;
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, &UserTxBufferFS[tail], len);
+  USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+}
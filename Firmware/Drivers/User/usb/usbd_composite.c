@@ -0,0 +1,357 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.c
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Composite device of the CDC virtual com port (interfaces 0 and 1,
+  *          grouped by an interface association) and the mass storage logbook
+  *          disk (interface 2).
+  *
+  *  @verbatim
+  *
+  *          ===================================================================
+  *                                Composite Class Description
+  *          ===================================================================
+  *           The core knows a single class. This class owns the configuration
+  *           descriptor and forwards every request to the class of its interface
+  *           or endpoint:
+  *             - interface MSC_INTERFACE, endpoints MSC_IN_EP/MSC_OUT_EP: USBD_MSC
+  *             - everything else: USBD_CDC (which keeps pClassData/pUserData)
+  *
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_composite.h"
+#include "usbd_desc.h"
+#include "usbd_ctlreq.h"
+
+
+/** @defgroup USBD_COMPOSITE_Private_FunctionPrototypes
+  * @{
+  */
+static uint8_t  USBD_COMPOSITE_Init (USBD_HandleTypeDef *pdev,
+                                     uint8_t cfgidx);
+
+static uint8_t  USBD_COMPOSITE_DeInit (USBD_HandleTypeDef *pdev,
+                                       uint8_t cfgidx);
+
+static uint8_t  USBD_COMPOSITE_Setup (USBD_HandleTypeDef *pdev,
+                                      USBD_SetupReqTypedef *req);
+
+static uint8_t  USBD_COMPOSITE_EP0_RxReady (USBD_HandleTypeDef *pdev);
+
+static uint8_t  USBD_COMPOSITE_DataIn (USBD_HandleTypeDef *pdev,
+                                       uint8_t epnum);
+
+static uint8_t  USBD_COMPOSITE_DataOut (USBD_HandleTypeDef *pdev,
+                                        uint8_t epnum);
+
+static uint8_t  *USBD_COMPOSITE_GetCfgDesc (uint16_t *length);
+
+static uint8_t  *USBD_COMPOSITE_GetDeviceQualifierDescriptor (uint16_t *length);
+/**
+  * @}
+  */
+
+/** @defgroup USBD_COMPOSITE_Private_Variables
+  * @{
+  */
+
+/* Composite class callbacks structure */
+USBD_ClassTypeDef  USBD_COMPOSITE =
+{
+  USBD_COMPOSITE_Init,
+  USBD_COMPOSITE_DeInit,
+  USBD_COMPOSITE_Setup,
+  NULL,                 /* EP0_TxSent, */
+  USBD_COMPOSITE_EP0_RxReady,
+  USBD_COMPOSITE_DataIn,
+  USBD_COMPOSITE_DataOut,
+  NULL,
+  NULL,
+  NULL,
+  USBD_COMPOSITE_GetCfgDesc,
+  USBD_COMPOSITE_GetCfgDesc,
+  USBD_COMPOSITE_GetCfgDesc,
+  USBD_COMPOSITE_GetDeviceQualifierDescriptor,
+};
+
+/* USB composite device Configuration Descriptor (full speed only) */
+__ALIGN_BEGIN static uint8_t USBD_COMPOSITE_CfgDesc[USB_COMPOSITE_CONFIG_DESC_SIZ] __ALIGN_END =
+{
+  /*Configuration Descriptor*/
+  0x09,   /* bLength: Configuration Descriptor size */
+  USB_DESC_TYPE_CONFIGURATION,      /* bDescriptorType: Configuration */
+  LOBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),  /* wTotalLength:no of returned bytes */
+  HIBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),
+  0x03,   /* bNumInterfaces: 3 interface */
+  0x01,   /* bConfigurationValue: Configuration value */
+  0x00,   /* iConfiguration: Index of string descriptor describing the configuration */
+  0xC0,   /* bmAttributes: self powered */
+  0x32,   /* MaxPower 0 mA */
+
+  /*---------------------------------------------------------------------------*/
+
+  /*Interface Association Descriptor: CDC interfaces 0 and 1 */
+  0x08,   /* bLength: IAD size */
+  0x0B,   /* bDescriptorType: Interface Association */
+  0x00,   /* bFirstInterface */
+  0x02,   /* bInterfaceCount */
+  0x02,   /* bFunctionClass: Communication Interface Class */
+  0x02,   /* bFunctionSubClass: Abstract Control Model */
+  0x01,   /* bFunctionProtocol: Common AT commands */
+  0x00,   /* iFunction */
+
+  /*Interface Descriptor */
+  0x09,   /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,  /* bDescriptorType: Interface */
+  /* Interface descriptor type */
+  0x00,   /* bInterfaceNumber: Number of Interface */
+  0x00,   /* bAlternateSetting: Alternate setting */
+  0x01,   /* bNumEndpoints: One endpoints used */
+  0x02,   /* bInterfaceClass: Communication Interface Class */
+  0x02,   /* bInterfaceSubClass: Abstract Control Model */
+  0x01,   /* bInterfaceProtocol: Common AT commands */
+  0x00,   /* iInterface: */
+
+  /*Header Functional Descriptor*/
+  0x05,   /* bLength: Endpoint Descriptor size */
+  0x24,   /* bDescriptorType: CS_INTERFACE */
+  0x00,   /* bDescriptorSubtype: Header Func Desc */
+  0x10,   /* bcdCDC: spec release number */
+  0x01,
+
+  /*Call Management Functional Descriptor*/
+  0x05,   /* bFunctionLength */
+  0x24,   /* bDescriptorType: CS_INTERFACE */
+  0x01,   /* bDescriptorSubtype: Call Management Func Desc */
+  0x00,   /* bmCapabilities: D0+D1 */
+  0x01,   /* bDataInterface: 1 */
+
+  /*ACM Functional Descriptor*/
+  0x04,   /* bFunctionLength */
+  0x24,   /* bDescriptorType: CS_INTERFACE */
+  0x02,   /* bDescriptorSubtype: Abstract Control Management desc */
+  0x02,   /* bmCapabilities */
+
+  /*Union Functional Descriptor*/
+  0x05,   /* bFunctionLength */
+  0x24,   /* bDescriptorType: CS_INTERFACE */
+  0x06,   /* bDescriptorSubtype: Union func desc */
+  0x00,   /* bMasterInterface: Communication class interface */
+  0x01,   /* bSlaveInterface0: Data Class Interface */
+
+  /*Endpoint 2 Descriptor*/
+  0x07,                           /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,   /* bDescriptorType: Endpoint */
+  CDC_CMD_EP,                     /* bEndpointAddress */
+  0x03,                           /* bmAttributes: Interrupt */
+  LOBYTE(CDC_CMD_PACKET_SIZE),     /* wMaxPacketSize: */
+  HIBYTE(CDC_CMD_PACKET_SIZE),
+  0x10,                           /* bInterval: */
+
+  /*Data class interface descriptor*/
+  0x09,   /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_INTERFACE,  /* bDescriptorType: */
+  0x01,   /* bInterfaceNumber: Number of Interface */
+  0x00,   /* bAlternateSetting: Alternate setting */
+  0x02,   /* bNumEndpoints: Two endpoints used */
+  0x0A,   /* bInterfaceClass: CDC */
+  0x00,   /* bInterfaceSubClass: */
+  0x00,   /* bInterfaceProtocol: */
+  0x00,   /* iInterface: */
+
+  /*Endpoint OUT Descriptor*/
+  0x07,   /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
+  CDC_OUT_EP,                        /* bEndpointAddress */
+  0x02,                              /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),  /* wMaxPacketSize: */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                              /* bInterval: ignore for Bulk transfer */
+
+  /*Endpoint IN Descriptor*/
+  0x07,   /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
+  CDC_IN_EP,                         /* bEndpointAddress */
+  0x02,                              /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),  /* wMaxPacketSize: */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                              /* bInterval: ignore for Bulk transfer */
+
+  /*---------------------------------------------------------------------------*/
+
+  /*Mass Storage interface descriptor*/
+  0x09,   /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,  /* bDescriptorType: */
+  MSC_INTERFACE,  /* bInterfaceNumber: Number of Interface */
+  0x00,   /* bAlternateSetting: Alternate setting */
+  0x02,   /* bNumEndpoints: Two endpoints used */
+  0x08,   /* bInterfaceClass: MSC Class */
+  0x06,   /* bInterfaceSubClass : SCSI transparent*/
+  0x50,   /* nInterfaceProtocol: Bulk-only transport */
+  0x00,   /* iInterface: */
+
+  /*Endpoint IN Descriptor*/
+  0x07,   /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
+  MSC_IN_EP,                         /* bEndpointAddress */
+  0x02,                              /* bmAttributes: Bulk */
+  LOBYTE(MSC_MAX_FS_PACKET),         /* wMaxPacketSize: */
+  HIBYTE(MSC_MAX_FS_PACKET),
+  0x00,                              /* bInterval: ignore for Bulk transfer */
+
+  /*Endpoint OUT Descriptor*/
+  0x07,   /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
+  MSC_OUT_EP,                        /* bEndpointAddress */
+  0x02,                              /* bmAttributes: Bulk */
+  LOBYTE(MSC_MAX_FS_PACKET),         /* wMaxPacketSize: */
+  HIBYTE(MSC_MAX_FS_PACKET),
+  0x00                               /* bInterval: ignore for Bulk transfer */
+};
+/**
+  * @}
+  */
+
+/** @defgroup USBD_COMPOSITE_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_COMPOSITE_Init
+  *         Initialize both interfaces
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_Init (USBD_HandleTypeDef *pdev,
+                                     uint8_t cfgidx)
+{
+  uint8_t ret = USBD_CDC.Init(pdev, cfgidx);
+
+  if (ret == USBD_OK)
+  {
+    ret = USBD_MSC.Init(pdev, cfgidx);
+  }
+  return ret;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DeInit
+  *         DeInitialize both interfaces in reverse order
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_DeInit (USBD_HandleTypeDef *pdev,
+                                       uint8_t cfgidx)
+{
+  USBD_MSC.DeInit(pdev, cfgidx);
+  return USBD_CDC.DeInit(pdev, cfgidx);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Setup
+  *         Forward request to the class of the addressed interface or endpoint
+  * @param  pdev: instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_Setup (USBD_HandleTypeDef *pdev,
+                                      USBD_SetupReqTypedef *req)
+{
+  uint8_t index = LOBYTE(req->wIndex);
+
+  switch (req->bmRequest & USB_REQ_RECIPIENT_MASK)
+  {
+  case USB_REQ_RECIPIENT_INTERFACE:
+    if (index == MSC_INTERFACE)
+    {
+      return USBD_MSC.Setup(pdev, req);
+    }
+    break;
+
+  case USB_REQ_RECIPIENT_ENDPOINT:
+    if ((index == MSC_IN_EP) || (index == MSC_OUT_EP))
+    {
+      return USBD_MSC.Setup(pdev, req);
+    }
+    break;
+
+  default:
+    break;
+  }
+  return USBD_CDC.Setup(pdev, req);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_EP0_RxReady
+  *         Control data received, only CDC requests carry data
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_EP0_RxReady (USBD_HandleTypeDef *pdev)
+{
+  return USBD_CDC.EP0_RxReady(pdev);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataIn
+  *         Data sent on non-control IN endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (epnum == (MSC_IN_EP & 0x7F))
+  {
+    return USBD_MSC.DataIn(pdev, epnum);
+  }
+  return USBD_CDC.DataIn(pdev, epnum);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataOut
+  *         Data received on non-control Out endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_COMPOSITE_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (epnum == MSC_OUT_EP)
+  {
+    return USBD_MSC.DataOut(pdev, epnum);
+  }
+  return USBD_CDC.DataOut(pdev, epnum);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetCfgDesc
+  *         Return configuration descriptor (same for every speed)
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t  *USBD_COMPOSITE_GetCfgDesc (uint16_t *length)
+{
+  *length = sizeof (USBD_COMPOSITE_CfgDesc);
+  return USBD_COMPOSITE_CfgDesc;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetDeviceQualifierDescriptor
+  *         return Device Qualifier descriptor
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t  *USBD_COMPOSITE_GetDeviceQualifierDescriptor (uint16_t *length)
+{
+  return USBD_CDC.GetDeviceQualifierDescriptor(length);
+}
+/**
+  * @}
+  */
@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.h
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Header file for the usbd_composite.c file: virtual com port and
+  *          logbook disk on one device.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_COMPOSITE_H
+#define __USBD_COMPOSITE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_cdc.h"
+#include  "usbd_msc.h"
+
+/** @defgroup usbd_composite_Exported_Defines
+  * @{
+  */
+#define USB_IAD_DESC_SIZ                            8
+#define USB_COMPOSITE_CONFIG_DESC_SIZ               (USB_CDC_CONFIG_DESC_SIZ + USB_IAD_DESC_SIZ + USB_MSC_INTERFACE_DESC_SIZ)
+/**
+  * @}
+  */
+
+/** @defgroup usbd_composite_Exported_Variables
+  * @{
+  */
+extern USBD_ClassTypeDef  USBD_COMPOSITE;
+#define USBD_COMPOSITE_CLASS    &USBD_COMPOSITE
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_COMPOSITE_H */
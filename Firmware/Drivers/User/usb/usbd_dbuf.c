@@ -0,0 +1,280 @@
+/**
+  ******************************************************************************
+  * @file    usbd_dbuf.c
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Double buffered bulk IN endpoints on top of the PCD driver: one
+  *          packet buffer is on the wire while the next packet waits in the
+  *          other one.
+  *
+  *  @verbatim
+  *
+  *          ===================================================================
+  *                                Double Buffered IN
+  *          ===================================================================
+  *           DTOG_TX selects the buffer of the USB, SW_BUF (DTOG_RX) the buffer
+  *           of the application. They are equal while no packet is released,
+  *           the endpoint NAKs then; toggling SW_BUF releases the buffer of the
+  *           application. A transmit releases its first packet at once and
+  *           writes the next one into the other buffer. Each acknowledge
+  *           releases the waiting packet first and refills the freed buffer
+  *           while that one is on the wire.
+  *
+  *           The PCD driver sees a single buffered endpoint with buffer 0 as
+  *           its packet buffer and xfer_len 0, so each acknowledge ends up in
+  *           HAL_PCD_DataInStageCallback, which calls USBD_DBUF_DataIn. Before
+  *           that the driver writes the count of buffer 0 from xfer_buff into
+  *           buffer 0 again; xfer_buff is kept at the source of the packet in
+  *           buffer 0, so the write leaves the buffer as it is.
+  *
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_dbuf.h"
+
+/** @defgroup USBD_DBUF_Private_Defines
+  * @{
+  */
+#define DBUF_ENDPOINTS    8U
+/**
+  * @}
+  */
+
+/** @defgroup USBD_DBUF_Private_Variables
+  * @{
+  */
+static struct
+{
+  uint8_t   enabled;    /* endpoint set up by USBD_DBUF_PMAConfig */
+  uint8_t   waiting;    /* next packet waits in the buffer of the application */
+  uint8_t   *buff;      /* rest of the transfer */
+  uint32_t  len;
+  uint8_t   *buf0;      /* source of the packet in buffer 0 */
+} dbuf[DBUF_ENDPOINTS];
+/**
+  * @}
+  */
+
+/** @defgroup USBD_DBUF_Private_FunctionPrototypes
+  * @{
+  */
+/**
+  * @brief  Write the next packet of the transfer into the buffer of the
+  *         application, it waits there until released
+  * @param  hpcd: PCD handle
+  * @param  num: endpoint number
+  * @retval None
+  */
+static void USBD_DBUF_WriteNext(PCD_HandleTypeDef *hpcd, uint8_t num);
+/**
+  * @}
+  */
+
+/** @defgroup USBD_DBUF_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  Packet buffers of a double buffered IN endpoint, instead of
+  *         HAL_PCDEx_PMAConfig
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: IN endpoint address
+  * @param  pmaaddr0: packet buffer 0
+  * @param  pmaaddr1: packet buffer 1
+  * @retval None
+  */
+void USBD_DBUF_PMAConfig(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t pmaaddr0, uint16_t pmaaddr1)
+{
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[ep_addr & 0x7FU];
+
+  HAL_PCDEx_PMAConfig(hpcd, ep_addr, PCD_SNG_BUF, pmaaddr0);
+  ep->pmaaddr0 = pmaaddr0;
+  ep->pmaaddr1 = pmaaddr1;
+  dbuf[ep_addr & 0x7FU].enabled = 1U;
+}
+
+/**
+  * @brief  Open an endpoint, instead of HAL_PCD_EP_Open
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: endpoint address
+  * @param  ep_mps: max packet size
+  * @param  ep_type: endpoint type
+  * @retval HAL status
+  */
+HAL_StatusTypeDef USBD_DBUF_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type)
+{
+  uint8_t num = ep_addr & 0x7FU;
+  HAL_StatusTypeDef ret = HAL_PCD_EP_Open(hpcd, ep_addr, ep_mps, ep_type);
+
+  if ((ep_addr & 0x80U) == 0U || !dbuf[num].enabled || ret != HAL_OK)
+  {
+    return ret;
+  }
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[num];
+
+  __HAL_LOCK(hpcd);
+  PCD_SET_EP_DBUF(hpcd->Instance, num);
+  PCD_SET_EP_DBUF_ADDR(hpcd->Instance, num, ep->pmaaddr0, ep->pmaaddr1);
+  PCD_SET_EP_DBUF0_CNT(hpcd->Instance, num, PCD_EP_DBUF_IN, 0U);
+  ep->xfer_len = 0U;
+  dbuf[num].waiting = 0U;
+  dbuf[num].len = 0U;
+
+  /* no packet released, the endpoint NAKs until the first transmit. The status stays
+     VALID, the buffer flags alone control the flow of a double buffered endpoint. */
+  PCD_CLEAR_RX_DTOG(hpcd->Instance, num);
+  PCD_CLEAR_TX_DTOG(hpcd->Instance, num);
+  PCD_SET_EP_TX_STATUS(hpcd->Instance, num, USB_EP_TX_VALID);
+  __HAL_UNLOCK(hpcd);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Close an endpoint, instead of HAL_PCD_EP_Close
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: endpoint address
+  * @retval HAL status
+  */
+HAL_StatusTypeDef USBD_DBUF_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  uint8_t num = ep_addr & 0x7FU;
+  HAL_StatusTypeDef ret = HAL_PCD_EP_Close(hpcd, ep_addr);
+
+  if ((ep_addr & 0x80U) == 0U || !dbuf[num].enabled || ret != HAL_OK)
+  {
+    return ret;
+  }
+  __HAL_LOCK(hpcd);
+  PCD_CLEAR_RX_DTOG(hpcd->Instance, num);
+  PCD_CLEAR_EP_DBUF(hpcd->Instance, num);
+  dbuf[num].waiting = 0U;
+  dbuf[num].len = 0U;
+  __HAL_UNLOCK(hpcd);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Clear the stall of an endpoint, instead of HAL_PCD_EP_ClrStall. Both
+  *         buffer flags are cleared before the endpoint is valid again, so no
+  *         stale packet is released.
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: endpoint address
+  * @retval HAL status
+  */
+HAL_StatusTypeDef USBD_DBUF_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  uint8_t num = ep_addr & 0x7FU;
+
+  if ((ep_addr & 0x80U) == 0U || !dbuf[num].enabled)
+  {
+    return HAL_PCD_EP_ClrStall(hpcd, ep_addr);
+  }
+  __HAL_LOCK(hpcd);
+  hpcd->IN_ep[num].is_stall = 0U;
+  dbuf[num].waiting = 0U;
+  dbuf[num].len = 0U;
+  PCD_CLEAR_RX_DTOG(hpcd->Instance, num);
+  PCD_CLEAR_TX_DTOG(hpcd->Instance, num);
+  PCD_SET_EP_TX_STATUS(hpcd->Instance, num, USB_EP_TX_VALID);
+  __HAL_UNLOCK(hpcd);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start a transfer, instead of HAL_PCD_EP_Transmit
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: endpoint address
+  * @param  pbuf: data, kept until the transfer is complete
+  * @param  len: data length, 0 sends a zero length packet
+  * @retval HAL status
+  */
+HAL_StatusTypeDef USBD_DBUF_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pbuf, uint32_t len)
+{
+  uint8_t num = ep_addr & 0x7FU;
+
+  if (!dbuf[num].enabled)
+  {
+    return HAL_PCD_EP_Transmit(hpcd, ep_addr, pbuf, len);
+  }
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[num];
+
+  dbuf[num].buff = pbuf;
+  dbuf[num].len = len;
+  ep->xfer_count = 0U;
+
+  /* release the first packet to the USB at once, the next one waits in the other
+     buffer until the first is acknowledged */
+  USBD_DBUF_WriteNext(hpcd, num);
+  PCD_FreeUserBuffer(hpcd->Instance, num, PCD_EP_DBUF_IN);
+  dbuf[num].waiting = 0U;
+  if (dbuf[num].len != 0U)
+  {
+    USBD_DBUF_WriteNext(hpcd, num);
+  }
+  ep->xfer_buff = dbuf[num].buf0;
+  ep->xfer_len = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Packet of an endpoint acknowledged, called by HAL_PCD_DataInStageCallback
+  * @param  hpcd: PCD handle
+  * @param  epnum: endpoint number
+  * @retval 1 if the transfer is complete, 0 while it goes on
+  */
+uint8_t USBD_DBUF_DataIn(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  if (epnum >= DBUF_ENDPOINTS || !dbuf[epnum].enabled)
+  {
+    return 1U;
+  }
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[epnum];
+  uint8_t complete = 0U;
+
+  if (dbuf[epnum].waiting)
+  {
+    /* the USB toggled DTOG_TX onto the buffer of the application (NAK): release the
+       waiting packet first, then refill the freed buffer while that one is on the wire */
+    PCD_FreeUserBuffer(hpcd->Instance, epnum, PCD_EP_DBUF_IN);
+    dbuf[epnum].waiting = 0U;
+    if (dbuf[epnum].len != 0U)
+    {
+      USBD_DBUF_WriteNext(hpcd, epnum);
+    }
+  }
+  else
+  {
+    /* last released packet acknowledged */
+    complete = 1U;
+  }
+  ep->xfer_buff = dbuf[epnum].buf0;
+  ep->xfer_len = 0U;
+  return complete;
+}
+
+static void USBD_DBUF_WriteNext(PCD_HandleTypeDef *hpcd, uint8_t num)
+{
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[num];
+  uint32_t len = dbuf[num].len > ep->maxpacket ? ep->maxpacket : dbuf[num].len;
+
+  if ((PCD_GET_ENDPOINT(hpcd->Instance, num) & USB_EP_DTOG_RX) != 0U)
+  {
+    PCD_WritePMA(hpcd->Instance, dbuf[num].buff, ep->pmaaddr1, len);
+    PCD_SET_EP_DBUF1_CNT(hpcd->Instance, num, PCD_EP_DBUF_IN, len);
+  }
+  else
+  {
+    PCD_WritePMA(hpcd->Instance, dbuf[num].buff, ep->pmaaddr0, len);
+    PCD_SET_EP_DBUF0_CNT(hpcd->Instance, num, PCD_EP_DBUF_IN, len);
+    dbuf[num].buf0 = dbuf[num].buff;
+  }
+  dbuf[num].buff += len;
+  dbuf[num].len -= len;
+  ep->xfer_count += len;
+  dbuf[num].waiting = 1U;
+}
+/**
+  * @}
+  */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    usbd_dbuf.h
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Header file for the usbd_dbuf.c file: double buffered bulk IN
+  *          endpoints on top of the PCD driver.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_DBUF_H
+#define __USBD_DBUF_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l0xx_hal.h"
+
+/** @defgroup usbd_dbuf_Exported_FunctionsPrototype
+  * @{
+  */
+void USBD_DBUF_PMAConfig(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t pmaaddr0, uint16_t pmaaddr1);
+HAL_StatusTypeDef USBD_DBUF_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type);
+HAL_StatusTypeDef USBD_DBUF_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_DBUF_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_DBUF_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pbuf, uint32_t len);
+uint8_t USBD_DBUF_DataIn(PCD_HandleTypeDef *hpcd, uint8_t epnum);
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DBUF_H */
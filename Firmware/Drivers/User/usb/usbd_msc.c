@@ -0,0 +1,685 @@
+/**
+  ******************************************************************************
+  * @file    usbd_msc.c
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Mass storage class of the composite device: bulk-only transport and
+  *          the SCSI commands of a read-only disk.
+  *
+  *  @verbatim
+  *
+  *          ===================================================================
+  *                                MSC Class Driver Description
+  *          ===================================================================
+  *           This driver manages the "Universal Serial Bus Mass Storage Class
+  *           Bulk-Only Transport Revision 1.0" with the SCSI transparent command
+  *           set a host needs to mount a disk:
+  *             - TEST UNIT READY, REQUEST SENSE, INQUIRY, MODE SENSE (6/10)
+  *             - READ FORMAT CAPACITIES, READ CAPACITY (10), READ (10), VERIFY (10)
+  *             - START STOP UNIT, PREVENT ALLOW MEDIUM REMOVAL
+  *
+  *           The disk is write protected, write commands fail with DATA PROTECT.
+  *           A read is sent one block at a time: the next block is requested from
+  *           the storage in the data IN interrupt, so no more than one block
+  *           (MSC_MEDIA_PACKET) is held in RAM.
+  *
+  *           The class does not own pClassData/pUserData of the device handle,
+  *           these belong to the CDC interface of the composite device.
+  *
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_msc.h"
+#include "usbd_ctlreq.h"
+#include "memory.h"
+#include <string.h>
+
+/** @defgroup USBD_MSC_Private_Defines
+  * @{
+  */
+#define SCSI_TEST_UNIT_READY                        0x00
+#define SCSI_REQUEST_SENSE                          0x03
+#define SCSI_INQUIRY                                0x12
+#define SCSI_MODE_SENSE6                            0x1A
+#define SCSI_START_STOP_UNIT                        0x1B
+#define SCSI_ALLOW_MEDIUM_REMOVAL                   0x1E
+#define SCSI_READ_FORMAT_CAPACITIES                 0x23
+#define SCSI_READ_CAPACITY10                        0x25
+#define SCSI_READ10                                 0x28
+#define SCSI_VERIFY10                               0x2F
+#define SCSI_MODE_SENSE10                           0x5A
+#define SCSI_WRITE6                                 0x0A
+#define SCSI_WRITE10                                0x2A
+#define SCSI_WRITE12                                0xAA
+
+#define NO_SENSE                                    0x00
+#define NOT_READY                                   0x02
+#define MEDIUM_ERROR                                0x03
+#define ILLEGAL_REQUEST                             0x05
+#define DATA_PROTECT                                0x07
+
+#define ASC_NONE                                    0x00
+#define ASC_UNRECOVERED_READ_ERROR                  0x11
+#define ASC_INVALID_COMMAND                         0x20
+#define ASC_ADDRESS_OUT_OF_RANGE                    0x21
+#define ASC_INVALID_CDB                             0x24
+#define ASC_WRITE_PROTECTED                         0x27
+#define ASC_MEDIUM_NOT_PRESENT                      0x3A
+
+#define REQUEST_SENSE_DATA_LEN                      18
+#define MODE_SENSE6_DATA_LEN                        4
+#define MODE_SENSE10_DATA_LEN                       8
+#define READ_FORMAT_CAPACITY_DATA_LEN               12
+#define READ_CAPACITY10_DATA_LEN                    8
+#define MODE_SENSE_WRITE_PROTECT                    0x80
+/**
+  * @}
+  */
+
+/** @defgroup USBD_MSC_Private_FunctionPrototypes
+  * @{
+  */
+static uint8_t  USBD_MSC_Init (USBD_HandleTypeDef *pdev,
+                               uint8_t cfgidx);
+
+static uint8_t  USBD_MSC_DeInit (USBD_HandleTypeDef *pdev,
+                                 uint8_t cfgidx);
+
+static uint8_t  USBD_MSC_Setup (USBD_HandleTypeDef *pdev,
+                                USBD_SetupReqTypedef *req);
+
+static uint8_t  USBD_MSC_DataIn (USBD_HandleTypeDef *pdev,
+                                 uint8_t epnum);
+
+static uint8_t  USBD_MSC_DataOut (USBD_HandleTypeDef *pdev,
+                                  uint8_t epnum);
+
+static void     MSC_BOT_Reset (USBD_HandleTypeDef *pdev);
+
+static void     MSC_BOT_CplClrFeature (USBD_HandleTypeDef *pdev,
+                                       uint8_t epnum);
+
+static void     MSC_BOT_SendData (USBD_HandleTypeDef *pdev,
+                                  uint16_t len);
+
+static void     MSC_BOT_SendCSW (USBD_HandleTypeDef *pdev,
+                                 uint8_t status);
+
+static void     MSC_BOT_Fail (USBD_HandleTypeDef *pdev,
+                              uint8_t sKey,
+                              uint8_t ASC);
+
+static void     SCSI_ProcessCmd (USBD_HandleTypeDef *pdev);
+
+static void     SCSI_Read10 (USBD_HandleTypeDef *pdev);
+
+static void     SCSI_ReadNextBlock (USBD_HandleTypeDef *pdev);
+/**
+  * @}
+  */
+
+/** @defgroup USBD_MSC_Private_Variables
+  * @{
+  */
+
+/* MSC interface class callbacks structure, the descriptors are part of the composite */
+USBD_ClassTypeDef  USBD_MSC =
+{
+  USBD_MSC_Init,
+  USBD_MSC_DeInit,
+  USBD_MSC_Setup,
+  NULL,                 /* EP0_TxSent, */
+  NULL,                 /* EP0_RxReady, */
+  USBD_MSC_DataIn,
+  USBD_MSC_DataOut,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+};
+
+static USBD_MSC_BOT_HandleTypeDef hmsc;
+__ALIGN_BEGIN static uint8_t block[MSC_MEDIA_PACKET] __ALIGN_END;
+MEM_BUFFER("usb", block);
+static USBD_StorageTypeDef *storage = NULL;
+static uint8_t ifalt = 0;
+/**
+  * @}
+  */
+
+/** @defgroup USBD_MSC_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_MSC_Init
+  *         Initialize the mass storage interface
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_MSC_Init (USBD_HandleTypeDef *pdev,
+                               uint8_t cfgidx)
+{
+  USBD_LL_OpenEP(pdev,
+                 MSC_IN_EP,
+                 USBD_EP_TYPE_BULK,
+                 MSC_MAX_FS_PACKET);
+
+  USBD_LL_OpenEP(pdev,
+                 MSC_OUT_EP,
+                 USBD_EP_TYPE_BULK,
+                 MSC_MAX_FS_PACKET);
+
+  memset(&hmsc, 0, sizeof(hmsc));
+  hmsc.bot_data = block;
+
+  if (storage == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  hmsc.max_lun = storage->GetMaxLun();
+  storage->Init(0);
+
+  MSC_BOT_Reset(pdev);
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DeInit
+  *         DeInitialize the mass storage interface
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t  USBD_MSC_DeInit (USBD_HandleTypeDef *pdev,
+                                 uint8_t cfgidx)
+{
+  USBD_LL_CloseEP(pdev,
+                  MSC_IN_EP);
+
+  USBD_LL_CloseEP(pdev,
+                  MSC_OUT_EP);
+
+  hmsc.bot_state = USBD_BOT_IDLE;
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_Setup
+  *         Handle the bulk-only class requests and the endpoint halt of the interface
+  * @param  pdev: instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t  USBD_MSC_Setup (USBD_HandleTypeDef *pdev,
+                                USBD_SetupReqTypedef *req)
+{
+  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  {
+  case USB_REQ_TYPE_CLASS :
+    switch (req->bRequest)
+    {
+    case BOT_GET_MAX_LUN :
+      if ((req->wValue == 0) && (req->wLength == 1) && ((req->bmRequest & 0x80) == 0x80))
+      {
+        USBD_CtlSendData (pdev,
+                          &hmsc.max_lun,
+                          1);
+      }
+      else
+      {
+        USBD_CtlError(pdev , req);
+      }
+      break;
+
+    case BOT_RESET :
+      if ((req->wValue == 0) && (req->wLength == 0) && ((req->bmRequest & 0x80) != 0x80))
+      {
+        MSC_BOT_Reset(pdev);
+      }
+      else
+      {
+        USBD_CtlError(pdev , req);
+      }
+      break;
+
+    default:
+      USBD_CtlError(pdev , req);
+      break;
+    }
+    break;
+
+  case USB_REQ_TYPE_STANDARD:
+    switch (req->bRequest)
+    {
+    case USB_REQ_GET_INTERFACE :
+      USBD_CtlSendData (pdev,
+                        &ifalt,
+                        1);
+      break;
+
+    case USB_REQ_SET_INTERFACE :
+      break;
+
+    case USB_REQ_CLEAR_FEATURE:
+      /* Reopen the endpoint: resets both buffers of the double buffered IN endpoint */
+      USBD_LL_FlushEP(pdev, (uint8_t)req->wIndex);
+      USBD_LL_CloseEP(pdev, (uint8_t)req->wIndex);
+      USBD_LL_OpenEP(pdev,
+                     (uint8_t)req->wIndex,
+                     USBD_EP_TYPE_BULK,
+                     MSC_MAX_FS_PACKET);
+
+      MSC_BOT_CplClrFeature(pdev, (uint8_t)req->wIndex);
+      break;
+    }
+    break;
+
+  default:
+    break;
+  }
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DataIn
+  *         Block or response sent, continue the read or send the status
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_MSC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  switch (hmsc.bot_state)
+  {
+  case USBD_BOT_DATA_IN:
+    SCSI_ReadNextBlock(pdev);
+    break;
+
+  case USBD_BOT_LAST_DATA_IN:
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    break;
+
+  default:
+    break;
+  }
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_MSC_DataOut
+  *         Command wrapper received, decode it
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t  USBD_MSC_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (hmsc.bot_state != USBD_BOT_IDLE)
+  {
+    return USBD_OK;
+  }
+
+  hmsc.csw.dTag = hmsc.cbw.dTag;
+  hmsc.csw.dDataResidue = hmsc.cbw.dDataLength;
+
+  if ((USBD_LL_GetRxDataSize (pdev, MSC_OUT_EP) != USBD_BOT_CBW_LENGTH) ||
+      (hmsc.cbw.dSignature != USBD_BOT_CBW_SIGNATURE) ||
+      (hmsc.cbw.bLUN > hmsc.max_lun) ||
+      (hmsc.cbw.bCBLength < 1) || (hmsc.cbw.bCBLength > 16))
+  {
+    /* Invalid wrapper: both endpoints stay halted until the reset recovery of the host */
+    hmsc.sense_key = ILLEGAL_REQUEST;
+    hmsc.sense_asc = ASC_INVALID_CDB;
+    hmsc.bot_status = USBD_BOT_STATUS_RECOVERY;
+    USBD_LL_StallEP(pdev, MSC_IN_EP);
+    USBD_LL_StallEP(pdev, MSC_OUT_EP);
+    return USBD_OK;
+  }
+
+  SCSI_ProcessCmd(pdev);
+  return USBD_OK;
+}
+
+/**
+  * @brief  MSC_BOT_Reset
+  *         Leave the recovery and wait for the next command wrapper
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void  MSC_BOT_Reset (USBD_HandleTypeDef *pdev)
+{
+  hmsc.bot_state = USBD_BOT_IDLE;
+  hmsc.bot_status = USBD_BOT_STATUS_NORMAL;
+
+  USBD_LL_PrepareReceive (pdev,
+                          MSC_OUT_EP,
+                          (uint8_t *)&hmsc.cbw,
+                          USBD_BOT_CBW_LENGTH);
+}
+
+/**
+  * @brief  MSC_BOT_CplClrFeature
+  *         Endpoint halt cleared by the host
+  * @param  pdev: device instance
+  * @param  epnum: endpoint address
+  * @retval None
+  */
+static void  MSC_BOT_CplClrFeature (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (hmsc.bot_status == USBD_BOT_STATUS_RECOVERY)
+  {
+    /* Only the class reset ends the recovery */
+    USBD_LL_StallEP(pdev, epnum);
+  }
+  else if (hmsc.bot_state == USBD_BOT_NO_DATA)
+  {
+    MSC_BOT_SendCSW (pdev, hmsc.csw.bStatus);
+  }
+  else if (((epnum & 0x80) != 0x80) && (hmsc.bot_state == USBD_BOT_IDLE))
+  {
+    /* The reopened OUT endpoint lost the pending command wrapper reception */
+    MSC_BOT_Reset(pdev);
+  }
+}
+
+/**
+  * @brief  MSC_BOT_SendData
+  *         Send response of a command, limited to the length the host asked for
+  * @param  pdev: device instance
+  * @param  len: length of the response in bot_data
+  * @retval None
+  */
+static void  MSC_BOT_SendData (USBD_HandleTypeDef *pdev, uint16_t len)
+{
+  if ((hmsc.cbw.dDataLength != 0) && ((hmsc.cbw.bmFlags & 0x80) != 0x80))
+  {
+    MSC_BOT_Fail(pdev, ILLEGAL_REQUEST, ASC_INVALID_CDB);
+    return;
+  }
+
+  len = MIN(hmsc.cbw.dDataLength, len);
+  hmsc.csw.dDataResidue -= len;
+
+  if (len == 0)
+  {
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    return;
+  }
+
+  hmsc.bot_state = USBD_BOT_LAST_DATA_IN;
+  USBD_LL_Transmit (pdev, MSC_IN_EP, hmsc.bot_data, len);
+}
+
+/**
+  * @brief  MSC_BOT_SendCSW
+  *         Send command status wrapper and wait for the next command
+  * @param  pdev: device instance
+  * @param  status: CSW status
+  * @retval None
+  */
+static void  MSC_BOT_SendCSW (USBD_HandleTypeDef *pdev, uint8_t status)
+{
+  hmsc.csw.dSignature = USBD_BOT_CSW_SIGNATURE;
+  hmsc.csw.bStatus = status;
+  hmsc.bot_state = USBD_BOT_IDLE;
+
+  USBD_LL_Transmit (pdev,
+                    MSC_IN_EP,
+                    (uint8_t *)&hmsc.csw,
+                    USBD_BOT_CSW_LENGTH);
+
+  USBD_LL_PrepareReceive (pdev,
+                          MSC_OUT_EP,
+                          (uint8_t *)&hmsc.cbw,
+                          USBD_BOT_CBW_LENGTH);
+}
+
+/**
+  * @brief  MSC_BOT_Fail
+  *         Fail command: without data phase the status is sent at once, else the
+  *         endpoint of the data phase is halted and the status follows its clearing
+  * @param  pdev: device instance
+  * @param  sKey: sense key
+  * @param  ASC: additional sense code
+  * @retval None
+  */
+static void  MSC_BOT_Fail (USBD_HandleTypeDef *pdev, uint8_t sKey, uint8_t ASC)
+{
+  hmsc.sense_key = sKey;
+  hmsc.sense_asc = ASC;
+
+  if (hmsc.cbw.dDataLength == 0)
+  {
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+    return;
+  }
+
+  hmsc.csw.dSignature = USBD_BOT_CSW_SIGNATURE;
+  hmsc.csw.bStatus = USBD_CSW_CMD_FAILED;
+  hmsc.bot_state = USBD_BOT_NO_DATA;
+  USBD_LL_StallEP(pdev, (hmsc.cbw.bmFlags & 0x80) == 0x80 ? MSC_IN_EP : MSC_OUT_EP);
+}
+
+/**
+  * @brief  SCSI_ProcessCmd
+  *         Execute command of the wrapper, responses are built in bot_data
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void  SCSI_ProcessCmd (USBD_HandleTypeDef *pdev)
+{
+  uint8_t *cb = hmsc.cbw.CB;
+  uint8_t *data = hmsc.bot_data;
+  uint16_t len;
+
+  switch (cb[0])
+  {
+  case SCSI_TEST_UNIT_READY:
+    if (storage->IsReady(hmsc.cbw.bLUN) != 0)
+    {
+      MSC_BOT_Fail(pdev, NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+    }
+    else
+    {
+      MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    }
+    break;
+
+  case SCSI_REQUEST_SENSE:
+    memset(data, 0, REQUEST_SENSE_DATA_LEN);
+    data[0] = 0x70;                                 /* Current error, fixed format */
+    data[2] = hmsc.sense_key;
+    data[7] = REQUEST_SENSE_DATA_LEN - 8;
+    data[12] = hmsc.sense_asc;
+    hmsc.sense_key = NO_SENSE;
+    hmsc.sense_asc = ASC_NONE;
+    MSC_BOT_SendData(pdev, MIN(cb[4], REQUEST_SENSE_DATA_LEN));
+    break;
+
+  case SCSI_INQUIRY:
+    len = (cb[3] << 8) | cb[4];
+    if ((cb[1] & 0x01) != 0)
+    {
+      /* Vital product data: only the list of supported pages */
+      memset(data, 0, 5);
+      data[3] = 1;
+      MSC_BOT_SendData(pdev, MIN(len, 5));
+    }
+    else
+    {
+      memcpy(data, storage->pInquiry, STANDARD_INQUIRY_DATA_LEN);
+      MSC_BOT_SendData(pdev, MIN(len, MIN(storage->pInquiry[4] + 5, STANDARD_INQUIRY_DATA_LEN)));
+    }
+    break;
+
+  case SCSI_MODE_SENSE6:
+    memset(data, 0, MODE_SENSE6_DATA_LEN);
+    data[0] = MODE_SENSE6_DATA_LEN - 1;
+    data[2] = MODE_SENSE_WRITE_PROTECT;
+    MSC_BOT_SendData(pdev, MIN(cb[4], MODE_SENSE6_DATA_LEN));
+    break;
+
+  case SCSI_MODE_SENSE10:
+    memset(data, 0, MODE_SENSE10_DATA_LEN);
+    data[1] = MODE_SENSE10_DATA_LEN - 2;
+    data[3] = MODE_SENSE_WRITE_PROTECT;
+    MSC_BOT_SendData(pdev, MIN((cb[7] << 8) | cb[8], MODE_SENSE10_DATA_LEN));
+    break;
+
+  case SCSI_START_STOP_UNIT:
+  case SCSI_ALLOW_MEDIUM_REMOVAL:
+  case SCSI_VERIFY10:
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    break;
+
+  case SCSI_READ_FORMAT_CAPACITIES:
+  case SCSI_READ_CAPACITY10:
+    if (storage->GetCapacity(hmsc.cbw.bLUN, &hmsc.scsi_blk_nbr, &hmsc.scsi_blk_size) != 0)
+    {
+      MSC_BOT_Fail(pdev, NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+      break;
+    }
+    if (cb[0] == SCSI_READ_CAPACITY10)
+    {
+      uint32_t last = hmsc.scsi_blk_nbr - 1;
+      data[0] = last >> 24;
+      data[1] = last >> 16;
+      data[2] = last >> 8;
+      data[3] = last;
+      data[4] = 0;
+      data[5] = 0;
+      data[6] = hmsc.scsi_blk_size >> 8;
+      data[7] = hmsc.scsi_blk_size;
+      MSC_BOT_SendData(pdev, READ_CAPACITY10_DATA_LEN);
+    }
+    else
+    {
+      memset(data, 0, 4);
+      data[3] = 8;                                  /* Capacity list length */
+      data[4] = hmsc.scsi_blk_nbr >> 24;
+      data[5] = hmsc.scsi_blk_nbr >> 16;
+      data[6] = hmsc.scsi_blk_nbr >> 8;
+      data[7] = hmsc.scsi_blk_nbr;
+      data[8] = 0x02;                               /* Formatted media */
+      data[9] = 0;
+      data[10] = hmsc.scsi_blk_size >> 8;
+      data[11] = hmsc.scsi_blk_size;
+      MSC_BOT_SendData(pdev, MIN((cb[7] << 8) | cb[8], READ_FORMAT_CAPACITY_DATA_LEN));
+    }
+    break;
+
+  case SCSI_READ10:
+    SCSI_Read10(pdev);
+    break;
+
+  case SCSI_WRITE6:
+  case SCSI_WRITE10:
+  case SCSI_WRITE12:
+    MSC_BOT_Fail(pdev, DATA_PROTECT, ASC_WRITE_PROTECTED);
+    break;
+
+  default:
+    MSC_BOT_Fail(pdev, ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+    break;
+  }
+}
+
+/**
+  * @brief  SCSI_Read10
+  *         Check range of the read and send its first block
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void  SCSI_Read10 (USBD_HandleTypeDef *pdev)
+{
+  uint8_t *cb = hmsc.cbw.CB;
+
+  if ((hmsc.cbw.bmFlags & 0x80) != 0x80)
+  {
+    MSC_BOT_Fail(pdev, ILLEGAL_REQUEST, ASC_INVALID_CDB);
+    return;
+  }
+
+  if (storage->GetCapacity(hmsc.cbw.bLUN, &hmsc.scsi_blk_nbr, &hmsc.scsi_blk_size) != 0)
+  {
+    MSC_BOT_Fail(pdev, NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+    return;
+  }
+
+  hmsc.scsi_blk_addr = ((uint32_t)cb[2] << 24) | ((uint32_t)cb[3] << 16) | ((uint32_t)cb[4] << 8) | cb[5];
+  hmsc.scsi_blk_len = (cb[7] << 8) | cb[8];
+
+  if ((hmsc.scsi_blk_addr >= hmsc.scsi_blk_nbr) ||
+      (hmsc.scsi_blk_len > hmsc.scsi_blk_nbr - hmsc.scsi_blk_addr))
+  {
+    MSC_BOT_Fail(pdev, ILLEGAL_REQUEST, ASC_ADDRESS_OUT_OF_RANGE);
+    return;
+  }
+
+  if (hmsc.cbw.dDataLength < hmsc.scsi_blk_len * hmsc.scsi_blk_size)
+  {
+    MSC_BOT_Fail(pdev, ILLEGAL_REQUEST, ASC_INVALID_CDB);
+    return;
+  }
+
+  if (hmsc.scsi_blk_len == 0)
+  {
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    return;
+  }
+
+  SCSI_ReadNextBlock(pdev);
+}
+
+/**
+  * @brief  SCSI_ReadNextBlock
+  *         Request the next block of the read from the storage and send it
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void  SCSI_ReadNextBlock (USBD_HandleTypeDef *pdev)
+{
+  if (storage->Read(hmsc.cbw.bLUN, hmsc.bot_data, hmsc.scsi_blk_addr, 1) != 0)
+  {
+    MSC_BOT_Fail(pdev, MEDIUM_ERROR, ASC_UNRECOVERED_READ_ERROR);
+    return;
+  }
+
+  hmsc.scsi_blk_addr++;
+  hmsc.scsi_blk_len--;
+  hmsc.csw.dDataResidue -= hmsc.scsi_blk_size;
+  hmsc.bot_state = (hmsc.scsi_blk_len == 0) ? USBD_BOT_LAST_DATA_IN : USBD_BOT_DATA_IN;
+
+  USBD_LL_Transmit (pdev, MSC_IN_EP, hmsc.bot_data, hmsc.scsi_blk_size);
+}
+
+/**
+  * @brief  USBD_MSC_RegisterStorage
+  * @param  pdev: device instance
+  * @param  fops: storage callback
+  * @retval status
+  */
+uint8_t  USBD_MSC_RegisterStorage  (USBD_HandleTypeDef   *pdev,
+                                    USBD_StorageTypeDef *fops)
+{
+  uint8_t  ret = USBD_FAIL;
+
+  if(fops != NULL)
+  {
+    storage = fops;
+    ret = USBD_OK;
+  }
+
+  return ret;
+}
+/**
+  * @}
+  */
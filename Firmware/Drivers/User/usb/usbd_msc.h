@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    usbd_msc.h
+  * @version V1.0
+  * @date    01-April-2019
+  * @brief   Header file for the usbd_msc.c file: mass storage class, bulk-only
+  *          transport with the SCSI commands of a read-only disk.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_MSC_H
+#define __USBD_MSC_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_ioreq.h"
+
+/** @defgroup usbd_msc_Exported_Defines
+  * @{
+  */
+#define MSC_INTERFACE                 0x02  /* Interface after the two CDC interfaces */
+#define MSC_IN_EP                     0x84  /* EP4 for data IN (double buffered) */
+#define MSC_OUT_EP                    0x05  /* EP5 for data OUT (commands) */
+#define MSC_MAX_FS_PACKET             64
+#define MSC_MEDIA_PACKET              512   /* One block is generated at a time */
+
+#define USB_MSC_INTERFACE_DESC_SIZ    23    /* Interface and both endpoint descriptors */
+
+#define BOT_GET_MAX_LUN               0xFE
+#define BOT_RESET                     0xFF
+
+#define USBD_BOT_CBW_SIGNATURE        0x43425355
+#define USBD_BOT_CSW_SIGNATURE        0x53425355
+#define USBD_BOT_CBW_LENGTH           31
+#define USBD_BOT_CSW_LENGTH           13
+
+#define USBD_BOT_STATUS_NORMAL        0
+#define USBD_BOT_STATUS_RECOVERY      1     /* Invalid command wrapper, stalled until reset */
+
+#define USBD_CSW_CMD_PASSED           0x00
+#define USBD_CSW_CMD_FAILED           0x01
+#define USBD_CSW_PHASE_ERROR          0x02
+
+#define STANDARD_INQUIRY_DATA_LEN     36
+/**
+  * @}
+  */
+
+/** @defgroup usbd_msc_Exported_TypesDefinitions
+  * @{
+  */
+
+/* Storage of the mass storage interface, called in interrupt context. Only reading is
+   supported, write commands are answered as write protected. */
+typedef struct _USBD_STORAGE
+{
+  int8_t (* Init)             (uint8_t lun);
+  int8_t (* GetCapacity)      (uint8_t lun, uint32_t *block_num, uint16_t *block_size);
+  int8_t (* IsReady)          (uint8_t lun);
+  int8_t (* Read)             (uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+  int8_t (* GetMaxLun)        (void);
+  int8_t *pInquiry;
+}USBD_StorageTypeDef;
+
+typedef struct
+{
+  uint32_t dSignature;
+  uint32_t dTag;
+  uint32_t dDataLength;
+  uint8_t  bmFlags;
+  uint8_t  bLUN;
+  uint8_t  bCBLength;
+  uint8_t  CB[16];
+  uint8_t  ReservedForAlign;
+}USBD_MSC_BOT_CBWTypeDef;
+
+typedef struct
+{
+  uint32_t dSignature;
+  uint32_t dTag;
+  uint32_t dDataResidue;
+  uint8_t  bStatus;
+  uint8_t  ReservedForAlign[3];
+}USBD_MSC_BOT_CSWTypeDef;
+
+typedef enum
+{
+  USBD_BOT_IDLE = 0,          /* Waiting for a command */
+  USBD_BOT_DATA_IN,           /* Sending blocks of a read */
+  USBD_BOT_LAST_DATA_IN,      /* Sending the response of a command */
+  USBD_BOT_NO_DATA            /* Status after an error, sent once the host cleared the stall */
+}USBD_MSC_BOT_StateTypeDef;
+
+typedef struct
+{
+  USBD_MSC_BOT_StateTypeDef bot_state;
+  uint8_t                   bot_status;
+  uint8_t                   max_lun;
+  uint16_t                  bot_data_length;
+  uint8_t                   *bot_data;          /* MSC_MEDIA_PACKET bytes */
+  USBD_MSC_BOT_CBWTypeDef   cbw;
+  USBD_MSC_BOT_CSWTypeDef   csw;
+
+  uint8_t                   sense_key;
+  uint8_t                   sense_asc;
+  uint32_t                  scsi_blk_addr;
+  uint32_t                  scsi_blk_nbr;
+  uint32_t                  scsi_blk_len;       /* Blocks of the read still to be sent */
+  uint16_t                  scsi_blk_size;
+}USBD_MSC_BOT_HandleTypeDef;
+/**
+  * @}
+  */
+
+/** @defgroup usbd_msc_Exported_Variables
+  * @{
+  */
+extern USBD_ClassTypeDef  USBD_MSC;
+#define USBD_MSC_CLASS    &USBD_MSC
+/**
+  * @}
+  */
+
+/** @defgroup usbd_msc_Exported_Functions
+  * @{
+  */
+uint8_t  USBD_MSC_RegisterStorage  (USBD_HandleTypeDef   *pdev,
+                                    USBD_StorageTypeDef *fops);
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_MSC_H */
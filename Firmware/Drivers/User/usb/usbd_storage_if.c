@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_storage_if.c
+  * @version        :
+  * @brief          : Usb device for the logbook disk, a single read-only unit
+  *                   backed by the generated volume.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_storage_if.h"
+#include "volume.h"
+
+#define STORAGE_LUN_NBR   1
+
+
+static int8_t STORAGE_Init_FS(uint8_t lun);
+static int8_t STORAGE_GetCapacity_FS(uint8_t lun, uint32_t *block_num, uint16_t *block_size);
+static int8_t STORAGE_IsReady_FS(uint8_t lun);
+static int8_t STORAGE_Read_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t STORAGE_GetMaxLun_FS(void);
+
+/** Standard inquiry data: removable direct access device, vendor and product of the disk */
+static int8_t STORAGE_Inquirydata_FS[STANDARD_INQUIRY_DATA_LEN] =
+{
+  0x00,
+  0x80,
+  0x02,
+  0x02,
+  (STANDARD_INQUIRY_DATA_LEN - 5),
+  0x00,
+  0x00,
+  0x00,
+  'W', 'a', 't', 'c', 'h', 'P', 'L', 'B', /* Manufacturer : 8 bytes */
+  'L', 'o', 'g', 'b', 'o', 'o', 'k', ' ', /* Product      : 16 Bytes */
+  ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+  '1', '.', '0' ,'0'                      /* Version      : 4 Bytes */
+};
+
+USBD_StorageTypeDef USBD_Storage_Interface_fops_FS =
+{
+  STORAGE_Init_FS,
+  STORAGE_GetCapacity_FS,
+  STORAGE_IsReady_FS,
+  STORAGE_Read_FS,
+  STORAGE_GetMaxLun_FS,
+  STORAGE_Inquirydata_FS
+};
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Initializes the storage unit (the volume needs no setup)
+  * @param  lun: logical unit number
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t STORAGE_Init_FS(uint8_t lun)
+{
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Returns the medium capacity
+  * @param  lun: logical unit number
+  * @param  block_num: number of blocks
+  * @param  block_size: size of a block
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t STORAGE_GetCapacity_FS(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+  *block_num  = VOL_SECTORS;
+  *block_size = VOL_SECTOR_SIZE;
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Checks whether the medium is ready (always, the volume is generated)
+  * @param  lun: logical unit number
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t STORAGE_IsReady_FS(uint8_t lun)
+{
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Reads blocks of the volume, called from the usb interrupt
+  * @param  lun: logical unit number
+  * @param  buf: buffer of blk_len blocks
+  * @param  blk_addr: first block
+  * @param  blk_len: number of blocks
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t STORAGE_Read_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  while (blk_len-- > 0)
+  {
+    if (VOL_Read(blk_addr++, buf) == 0)
+    {
+      return (USBD_FAIL);
+    }
+    buf += VOL_SECTOR_SIZE;
+  }
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Returns the highest logical unit number
+  * @retval lun
+  */
+static int8_t STORAGE_GetMaxLun_FS(void)
+{
+  return (STORAGE_LUN_NBR - 1);
+}
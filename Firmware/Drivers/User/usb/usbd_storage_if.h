@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_storage_if.h
+  * @version        :
+  * @brief          : Header for usbd_storage_if.c file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_STORAGE_IF_H__
+#define __USBD_STORAGE_IF_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_msc.h"
+
+/** MSC Interface callback. */
+extern USBD_StorageTypeDef USBD_Storage_Interface_fops_FS;
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_STORAGE_IF_H__ */
@@ -0,0 +1,255 @@
+/**
+ * @file bench.c
+ * @author Paul Götzinger
+ * @brief Host tool: microbenchmarks of the parser, encoder and buffer hot paths with stored baselines
+ * @version 1.0
+ * @date 2019-03-28
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench_kernels.h"
+
+#define LINE_LEN      256
+#define SAMPLES       7           //samples per benchmark, the fastest one counts
+#define SAMPLE_NS     20000000    //minimal duration of a sample
+#define BENCH_MAX     16
+#define CALIB_NAME    "calibration"
+#define CALIB_LEN     4096        //bytes hashed per pass of the calibration kernel
+
+/**
+ * @brief Benchmark
+ *
+ */
+typedef struct {
+    const BENCH_Kernel *kernel;
+    double nsPerOp;         //fastest sample
+    double bytesPerS;
+    double ratio;           //ns/op over the ns/op of the calibration measured with it
+    double baseline;        //ratio, 0 if none
+} Bench;
+
+static volatile uint32_t calibSink;     //result of the calibration is kept alive here
+
+/**
+ * @brief Calibration kernel: FNV-1a hash with a branch per byte, scalar integer work like the
+ * parsers; the results are stored and compared as ratios to it, so they do not depend on the
+ * speed of the host
+ *
+ * @return BENCH_Work bytes hashed
+ */
+static BENCH_Work calibrate(void);
+
+/**
+ * @brief Read baseline file
+ *
+ * @param file baseline file
+ * @param bench benchmarks
+ * @param count number of benchmarks
+ */
+static void readBaseline(const char *file, Bench *bench, int count);
+
+/**
+ * @brief Write baseline file
+ *
+ * @param file baseline file
+ * @param bench benchmarks
+ * @param count number of benchmarks
+ * @return int 0 on success
+ */
+static int writeBaseline(const char *file, Bench *bench, int count);
+
+/**
+ * @brief Run benchmark, the fastest of several samples is kept
+ *
+ * @param b benchmark
+ */
+static void measure(Bench *b);
+
+/**
+ * @brief Monotonic time
+ *
+ * @return uint64_t ns
+ */
+static uint64_t nowNs(void);
+
+int main(int argc, char **argv) {
+    const char *gnssFile = "Simulator/Scenarios/vienna_urban.gnss";
+    const char *baselineFile = "Host/Bench/baseline.txt";
+    const char *filter = 0;
+    int write = 0;
+    double tolerance = 25;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:b:t:f:w")) != -1) {
+        switch (opt) {
+            case 'g':
+                gnssFile = optarg;
+                break;
+            case 'b':
+                baselineFile = optarg;
+                break;
+            case 't':
+                tolerance = atof(optarg);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'w':
+                write = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-g gnss script] [-b baseline] [-t tolerance %%] [-f name] [-w]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (BENCH_LoadCorpus(gnssFile) != 0) {
+        fprintf(stderr, "cannot load gnss script %s\n", gnssFile);
+        return 1;
+    }
+    BENCH_Init();
+
+    Bench bench[BENCH_MAX];
+    int count = 0;
+    while (count < BENCH_MAX && count < BENCH_KernelCount) {
+        bench[count] = (Bench) { &BENCH_Kernels[count] };
+        count++;
+    }
+    readBaseline(baselineFile, bench, count);
+
+    static const BENCH_Kernel calibKernel = {CALIB_NAME, "byte", calibrate};
+    Bench calib = {&calibKernel};
+
+    printf("corpus       %u bytes, %u epochs from %s\n", BENCH_GetCorpusLength(), BENCH_GetCorpusEpochs(), gnssFile);
+    printf("%-12s %10s %12s %8s %9s %8s\n", "benchmark", "ns/op", "MB/s", "ratio", "baseline", "change");
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        Bench *b = &bench[i];
+        if (filter != 0 && strcmp(filter, b->kernel->name) != 0) {
+            continue;
+        }
+        //the calibration right before the kernel, at the same clock of the host
+        measure(&calib);
+        measure(b);
+        b->ratio = b->nsPerOp / calib.nsPerOp;
+
+        printf("%-12s %10.2f %12.2f %8.2f", b->kernel->name, b->nsPerOp, b->bytesPerS / 1e6, b->ratio);
+        if (b->baseline > 0 && !write) {
+            double change = (b->ratio / b->baseline - 1) * 100;
+            int slower = change > tolerance;
+            printf(" %9.2f %+7.1f%%%s", b->baseline, change, slower ? " REGRESSION" : "");
+            failed |= slower;
+        }
+        printf("  (ns/%s)\n", b->kernel->op);
+    }
+
+    //the benchmarks measure real work only if the inputs are processed correctly
+    uint32_t nmeaErrors, ringErrors;
+    BENCH_GetInputErrors(&nmeaErrors, &ringErrors);
+    if (nmeaErrors != 0 || ringErrors != 0) {
+        printf("input errors %u nmea checksum/overlength, %u uart ring\n", nmeaErrors, ringErrors);
+        failed = 1;
+    }
+
+    if (write) {
+        if (writeBaseline(baselineFile, bench, count) != 0) {
+            fprintf(stderr, "cannot write %s\n", baselineFile);
+            return 1;
+        }
+        printf("baseline written to %s\n", baselineFile);
+        return failed;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed;
+}
+
+static void measure(Bench *b) {
+    BENCH_Work w = b->kernel->run();    //warm up caches and parser state
+
+    for (int s = 0; s < SAMPLES; s++) {
+        uint64_t ops = 0, bytes = 0, dt;
+        uint64_t start = nowNs();
+        do {
+            w = b->kernel->run();
+            ops += w.ops;
+            bytes += w.bytes;
+            dt = nowNs() - start;
+        } while (dt < SAMPLE_NS);
+
+        double ns = (double)dt / ops;
+        if (s == 0 || ns < b->nsPerOp) {
+            b->nsPerOp = ns;
+            b->bytesPerS = bytes * 1e9 / dt;
+        }
+    }
+}
+
+static BENCH_Work calibrate(void) {
+    static uint8_t data[CALIB_LEN];
+
+    if (data[0] == 0) {
+        uint32_t x = 1;
+        for (uint16_t i = 0; i < CALIB_LEN; i++) {
+            x = x * 1103515245 + 12345;
+            data[i] = (x >> 16) | 1;
+        }
+    }
+    uint32_t h = 2166136261u;
+    for (uint16_t i = 0; i < CALIB_LEN; i++) {
+        h = (h ^ data[i]) * 16777619u;
+        if (data[i] < 0x20) {
+            h += i;
+        }
+    }
+    calibSink = h;
+    return (BENCH_Work) { CALIB_LEN, CALIB_LEN };
+}
+
+static void readBaseline(const char *file, Bench *bench, int count) {
+    FILE *in = fopen(file, "r");
+    if (in == 0) {
+        return;
+    }
+
+    char line[LINE_LEN], name[LINE_LEN];
+    double ratio;
+    while (fgets(line, sizeof(line), in) != 0) {
+        if (line[0] == '#' || sscanf(line, "%255s %lf", name, &ratio) != 2) {
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            if (strcmp(name, bench[i].kernel->name) == 0) {
+                bench[i].baseline = ratio;
+            }
+        }
+    }
+    fclose(in);
+}
+
+static int writeBaseline(const char *file, Bench *bench, int count) {
+    FILE *out = fopen(file, "w");
+    if (out == 0) {
+        return -1;
+    }
+
+    fprintf(out, "# benchmark ns/op over calibration ns/op, written by bench -w (make bench-baseline)\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%-12s %.2f\n", bench[i].kernel->name, bench[i].ratio > 0 ? bench[i].ratio : bench[i].baseline);
+    }
+    fclose(out);
+    return 0;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
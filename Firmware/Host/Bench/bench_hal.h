@@ -0,0 +1,30 @@
+/**
+ * @file bench_hal.h
+ * @author Paul Götzinger
+ * @brief Host tool: redirects the peripherals used by uart.c to host memory.
+ * Force included after the HAL headers when building the benchmarks.
+ * @version 1.0
+ * @date 2019-03-28
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BENCH_HAL_H
+#define BENCH_HAL_H
+
+//uart, dma channel and clock registers of the ring buffer benchmark
+extern USART_TypeDef BENCH_USART4;
+extern DMA_Channel_TypeDef BENCH_DMA1_Channel2;
+extern DMA_Channel_TypeDef BENCH_DMA1_Channel3;
+extern RCC_TypeDef BENCH_RCC;
+#undef  USART4
+#define USART4 (&BENCH_USART4)
+#undef  DMA1_Channel2
+#define DMA1_Channel2 (&BENCH_DMA1_Channel2)
+#undef  DMA1_Channel3
+#define DMA1_Channel3 (&BENCH_DMA1_Channel3)
+#undef  RCC
+#define RCC (&BENCH_RCC)
+
+#endif //!BENCH_HAL_H
@@ -0,0 +1,100 @@
+/**
+ * @file bench_kernels.h
+ * @author Paul Götzinger
+ * @brief Host tool: benchmark kernels of the parser, encoder and buffer hot paths and their inputs,
+ * shared by the host benchmarks and the Cortex-M0+ benchmark image
+ * @version 1.0
+ * @date 2019-03-29
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BENCH_KERNELS_H
+#define BENCH_KERNELS_H
+
+#include <stdint.h>
+
+//input sizes, the Cortex-M0+ image overrides them to fit into its RAM
+#ifndef BENCH_CORPUS_MAX
+#define BENCH_CORPUS_MAX  (256 * 1024)  //bytes of gnss corpus
+#endif
+#ifndef BENCH_POSITIONS
+#define BENCH_POSITIONS   256           //random positions for frame encoding
+#endif
+#ifndef BENCH_FIELDS
+#define BENCH_FIELDS      1024          //random bit fields
+#endif
+#ifndef BENCH_RING_PASS
+#define BENCH_RING_PASS   65536         //bytes through the uart ring per pass
+#endif
+#ifndef BENCH_CRC_DATA
+#define BENCH_CRC_DATA    4096          //bytes the crc frames are taken from
+#endif
+#ifndef BENCH_CRC_FRAMES
+#define BENCH_CRC_FRAMES  256
+#endif
+
+/**
+ * @brief Work of one pass
+ *
+ */
+typedef struct {
+    uint64_t ops;       //operations
+    uint64_t bytes;     //bytes processed
+} BENCH_Work;
+
+/**
+ * @brief Benchmark kernel
+ *
+ */
+typedef struct {
+    const char *name;
+    const char *op;             //unit of one operation
+    BENCH_Work (*run)(void);    //one pass
+} BENCH_Kernel;
+
+//all kernels in the order they are reported
+extern const BENCH_Kernel BENCH_Kernels[];
+extern const uint8_t BENCH_KernelCount;
+
+/**
+ * @brief Build the gnss corpus from a simulator script: the NMEA sentences with checksum
+ * and line end, a UBX-NAV-PVT after each epoch, UBX lines as they are
+ *
+ * @param file gnss script
+ * @return int 0 on success
+ */
+int BENCH_LoadCorpus(const char *file);
+
+/**
+ * @brief Initialize parsers, encoders and the uart ring, fill inputs of the encoder, ring
+ * and crc benchmarks from a fixed seed
+ *
+ */
+void BENCH_Init(void);
+
+/**
+ * @brief Retrieve length of the corpus
+ *
+ * @return uint32_t bytes
+ */
+uint32_t BENCH_GetCorpusLength(void);
+
+/**
+ * @brief Retrieve epochs of the corpus
+ *
+ * @return uint32_t epochs
+ */
+uint32_t BENCH_GetCorpusEpochs(void);
+
+/**
+ * @brief Retrieve input errors, the kernels measure real work only if their inputs are
+ * processed correctly
+ *
+ * @param nmeaErrors NMEA checksum and overlength errors
+ * @param ring wrong bytes out of the uart ring and rejected transmissions
+ */
+void BENCH_GetInputErrors(uint32_t *nmeaErrors, uint32_t *ring);
+
+#endif //!BENCH_KERNELS_H
@@ -0,0 +1,141 @@
+/**
+ * @file bench_m0.c
+ * @author Paul Götzinger
+ * @brief Benchmark image: runs the benchmark kernels on an emulated Cortex-M0+, counts the
+ * SysTick cycles of each kernel and prints the results over semihosting
+ * @version 1.0
+ * @date 2019-03-29
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench_kernels.h"
+
+#define GNSS_FILE   "Simulator/Scenarios/vienna_urban.gnss"   //read over semihosting, relative to the emulator
+#define PASSES      5       //measured passes per kernel, the fastest one counts
+
+//symbols of the linker script
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+
+//semihosting file handles of newlib (librdimon)
+extern void initialise_monitor_handles(void);
+
+static volatile uint32_t periods;   //systick periods elapsed
+
+void Reset_Handler(void);
+void SysTick_Handler(void);
+
+/**
+ * @brief Handler of unexpected exceptions, ends the emulation
+ *
+ */
+static void Default_Handler(void);
+
+/**
+ * @brief Retrieve cpu cycles since start (SysTick based)
+ *
+ * @return uint32_t cycles
+ */
+static uint32_t getCycles(void);
+
+//stack and exceptions of the core, no peripheral interrupts are used
+__attribute__((section(".isr_vector"), used))
+static void (* const vectors[16])(void) = {
+    (void (*)(void))&_estack,
+    Reset_Handler,
+    Default_Handler,        //nmi
+    Default_Handler,        //hard fault
+    [11] = Default_Handler, //svc
+    [14] = Default_Handler, //pendsv
+    [15] = SysTick_Handler,
+};
+
+int main(void) {
+    //full 24 bit period, cycles are counted across the period interrupts
+    SysTick_Config(SysTick_LOAD_RELOAD_Msk + 1);
+
+    if (BENCH_LoadCorpus(GNSS_FILE) != 0) {
+        printf("cannot load gnss script %s\n", GNSS_FILE);
+        return 1;
+    }
+    BENCH_Init();
+
+    //cycles of the measurement itself
+    uint32_t start = getCycles();
+    uint32_t overhead = getCycles() - start;
+
+    printf("corpus       %u bytes, %u epochs from %s\n", (unsigned)BENCH_GetCorpusLength(),
+            (unsigned)BENCH_GetCorpusEpochs(), GNSS_FILE);
+    printf("%-12s %12s %10s %12s\n", "benchmark", "cycles/op", "ops", "cycles");
+
+    for (uint8_t i = 0; i < BENCH_KernelCount; i++) {
+        const BENCH_Kernel *k = &BENCH_Kernels[i];
+        BENCH_Work w = k->run();    //warm up parser state
+        uint32_t best = 0xFFFFFFFF;
+
+        for (uint8_t p = 0; p < PASSES; p++) {
+            start = getCycles();
+            w = k->run();
+            uint32_t cycles = getCycles() - start - overhead;
+            if (cycles < best) {
+                best = cycles;
+            }
+        }
+
+        //no printf of floats in newlib nano, one decimal in fixed point
+        uint32_t ops = w.ops;
+        uint32_t perOp = ((uint64_t)best * 10 + ops / 2) / ops;
+        printf("%-12s %10u.%u %10u %12u  (cycles/%s)\n", k->name, (unsigned)(perOp / 10), (unsigned)(perOp % 10),
+                (unsigned)ops, (unsigned)best, k->op);
+    }
+
+    uint32_t nmeaErrors, ringErrors;
+    BENCH_GetInputErrors(&nmeaErrors, &ringErrors);
+    if (nmeaErrors != 0 || ringErrors != 0) {
+        printf("input errors %u nmea checksum/overlength, %u uart ring\n", (unsigned)nmeaErrors, (unsigned)ringErrors);
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
+
+void Reset_Handler(void) {
+    //initialized data from flash, zeroed bss
+    uint32_t *src = &_sidata;
+    for (uint32_t *dst = &_sdata; dst < &_edata;) {
+        *dst++ = *src++;
+    }
+    for (uint32_t *dst = &_sbss; dst < &_ebss;) {
+        *dst++ = 0;
+    }
+
+    initialise_monitor_handles();
+    //reports the exit code to the emulator
+    exit(main());
+}
+
+void SysTick_Handler(void) {
+    periods++;
+}
+
+static void Default_Handler(void) {
+    printf("unexpected exception %u\n", (unsigned)(SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk));
+    exit(2);
+}
+
+static uint32_t getCycles(void) {
+    uint32_t period;
+    uint32_t val;
+
+    //read again if systick wrapped in between
+    do {
+        period = periods;
+        val = SysTick->VAL;
+    } while (period != periods);
+
+    return period * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+}
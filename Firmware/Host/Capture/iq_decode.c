@@ -0,0 +1,817 @@
+/**
+ * @file iq_decode.c
+ * @author Paul Götzinger
+ * @brief Host tool: detects 406 MHz beacon bursts in IQ captures, demodulates the biphase-L phase
+ * modulation and decodes the frames with plb.c. Files are processed in parallel, one per thread.
+ * @version 1.0
+ * @date 2019-04-04
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "plb.h"
+
+#define BIT_RATE        400     //C/S T.001 data rate, biphase-L
+#define PHASE           1.1     //rad, phase deviation of the halves of a bit
+#define PREAMBLE        0.160   //s of unmodulated carrier before the frame
+#define FRAME_BITS      144     //long message
+#define SYNC_BITS       24      //bit sync (15 ones) and frame sync
+#define FORMAT_BIT      24      //format flag, 1 for the long message
+
+#define WORK_RATE       12800   //samples per second after mixing and decimation (at least)
+#define LANES           8       //floats per vector
+#define ENV_TIME        0.005   //s, block of the power envelope
+#define NOISE_QUANTILE  0.2     //blocks below are noise
+#define THRESHOLD_DB    5       //burst detection above noise
+#define BURST_MIN       0.250   //s, burst duration accepted
+#define BURST_MAX       0.700
+#define SEARCH_START    0.100   //s after burst start, window of the frame sync correlation
+#define SEARCH_END      0.240
+
+#define GEN_INTERVAL    2.0     //s between generated bursts
+#define GEN_DRIFT       300     //Hz, carrier error of generated bursts (+-)
+
+#define MAX_FILES       256
+
+typedef float vf __attribute__((vector_size(LANES * sizeof(float))));
+
+/**
+ * @brief Sample format of a capture, selected by the file extension
+ *
+ */
+typedef enum {
+    Format_CU8 = 0,     //rtl-sdr: unsigned 8 bit, offset 127.5
+    Format_CS8,         //hackrf: signed 8 bit
+    Format_CS16,        //signed 16 bit
+    Format_CF32,        //float
+    Format_Count
+} Format;
+
+/**
+ * @brief Result of a file
+ *
+ */
+typedef struct {
+    const char *name;
+    char *report;       //one line per burst
+    size_t reportLen;
+    uint64_t samples;
+    uint32_t bursts;    //detected
+    uint32_t frames;    //decoded and verified
+} Result;
+
+/**
+ * @brief Field of pdf1 or pdf2, the layout of plb.c
+ *
+ */
+typedef struct {
+    uint8_t bits;
+    uint32_t *value;
+} Field;
+
+static const char *const extensions[Format_Count] = {".cu8", ".cs8", ".cs16", ".cf32"};
+static const uint8_t sampleSize[Format_Count] = {2, 2, 4, 8};
+
+static double sampleRate = 250000;
+static double offset;           //Hz, beacon carrier above the capture center
+static int forcedFormat = -1;
+static int verbose;
+
+static Result results[MAX_FILES];
+static int fileCount;
+static int nextFile;
+static pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t plbLock = PTHREAD_MUTEX_INITIALIZER;    //plb.c keeps pdf1 in a static buffer
+static pthread_mutex_t outLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Retrieve format of a file from its extension
+ *
+ * @param name file name
+ * @return int Format, -1 if unknown
+ */
+static int formatOf(const char *name);
+
+/**
+ * @brief Convert raw samples to floats
+ *
+ * @param fmt sample format
+ * @param raw first sample
+ * @param n samples
+ * @param i in-phase, filled
+ * @param q quadrature, filled
+ */
+static void convert(Format fmt, const uint8_t *raw, uint32_t n, float *i, float *q);
+
+/**
+ * @brief Mix the beacon carrier down to 0 Hz and decimate by summing blocks (SIMD)
+ *
+ * @param fmt sample format
+ * @param raw capture
+ * @param outLen decimated samples
+ * @param decim input samples per output sample, multiple of LANES
+ * @param re real part, filled
+ * @param im imaginary part, filled
+ */
+static void mixDown(Format fmt, const uint8_t *raw, size_t outLen, uint32_t decim, float *re, float *im);
+
+/**
+ * @brief Dot product (SIMD)
+ *
+ * @param a first vector
+ * @param b second vector
+ * @param n length
+ * @return float sum of products
+ */
+static float dot(const float *a, const float *b, uint32_t n);
+
+/**
+ * @brief Demodulate and decode a burst
+ *
+ * @param re real part of decimated capture
+ * @param im imaginary part of decimated capture
+ * @param len length of capture
+ * @param rate decimated sample rate
+ * @param start first sample of burst
+ * @param end end of burst
+ * @param line report line, filled
+ * @param size size of line
+ * @return int 1 if the frame was decoded and verified
+ */
+static int decodeBurst(const float *re, const float *im, size_t len, double rate, size_t start, size_t end,
+        char *line, size_t size);
+
+/**
+ * @brief Decode bits of a long message, verify it by encoding the decoded fields with plb.c
+ *
+ * @param bits frame, one bit per byte
+ * @param line report, filled
+ * @param size size of line
+ * @return int 1 if the encoded frame equals the received one
+ */
+static int decodeFrame(const uint8_t *bits, char *line, size_t size);
+
+/**
+ * @brief Order of floats for qsort
+ *
+ * @param a first float
+ * @param b second float
+ * @return int -1, 0 or 1
+ */
+static int compare(const void *a, const void *b);
+
+/**
+ * @brief Process one capture: mix, detect bursts, decode
+ *
+ * @param res result, name set
+ */
+static void processFile(Result *res);
+
+/**
+ * @brief Worker thread, takes files until all are done
+ *
+ * @param arg unused
+ * @return void* 0
+ */
+static void* worker(void *arg);
+
+/**
+ * @brief Write a capture with bursts of random positions (self test)
+ *
+ * @param name file name, extension selects the format
+ * @param bursts count of bursts
+ * @param snr carrier to noise ratio in the capture bandwidth in dB
+ * @return int 0 on success
+ */
+static int generate(const char *name, int bursts, double snr);
+
+/**
+ * @brief Append to report of a file
+ *
+ * @param res result
+ * @param line text
+ */
+static void appendReport(Result *res, const char *line);
+
+static int formatOf(const char *name) {
+    if (forcedFormat >= 0) {
+        return forcedFormat;
+    }
+    const char *ext = strrchr(name, '.');
+    for (int f = 0; ext != 0 && f < Format_Count; f++) {
+        if (strcmp(ext, extensions[f]) == 0) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+static void convert(Format fmt, const uint8_t *raw, uint32_t n, float *i, float *q) {
+    switch (fmt) {
+        case Format_CU8:
+            for (uint32_t k = 0; k < n; k++) {
+                i[k] = raw[2 * k] - 127.5f;
+                q[k] = raw[2 * k + 1] - 127.5f;
+            }
+            break;
+        case Format_CS8:
+            for (uint32_t k = 0; k < n; k++) {
+                i[k] = (int8_t)raw[2 * k];
+                q[k] = (int8_t)raw[2 * k + 1];
+            }
+            break;
+        case Format_CS16: {
+            const int16_t *s = (const int16_t*)raw;
+            for (uint32_t k = 0; k < n; k++) {
+                i[k] = s[2 * k];
+                q[k] = s[2 * k + 1];
+            }
+            break;
+        }
+        default: {
+            const float *s = (const float*)raw;
+            for (uint32_t k = 0; k < n; k++) {
+                i[k] = s[2 * k];
+                q[k] = s[2 * k + 1];
+            }
+            break;
+        }
+    }
+}
+
+static void mixDown(Format fmt, const uint8_t *raw, size_t outLen, uint32_t decim, float *re, float *im) {
+    float bi[decim] __attribute__((aligned(32)));
+    float bq[decim] __attribute__((aligned(32)));
+    double w = -2 * M_PI * offset / sampleRate;
+    vf cr = {0}, ci = {0};
+    vf sr, si;
+
+    //the phasors of the lanes advance by LANES samples per step
+    for (int l = 0; l < LANES; l++) {
+        sr[l] = cos(w * LANES);
+        si[l] = sin(w * LANES);
+    }
+
+    for (size_t m = 0; m < outLen; m++) {
+        uint64_t n = (uint64_t)m * decim;
+        if (m % 64 == 0) {
+            //exact phase from time to time, the rotation accumulates rounding errors
+            for (int l = 0; l < LANES; l++) {
+                double p = fmod(w * (double)(n + l), 2 * M_PI);
+                cr[l] = cos(p);
+                ci[l] = sin(p);
+            }
+        }
+
+        convert(fmt, raw + n * sampleSize[fmt], decim, bi, bq);
+
+        vf ar = {0}, ai = {0};
+        for (uint32_t k = 0; k < decim; k += LANES) {
+            vf xi, xq;
+            memcpy(&xi, bi + k, sizeof(vf));
+            memcpy(&xq, bq + k, sizeof(vf));
+            ar += xi * cr - xq * ci;
+            ai += xi * ci + xq * cr;
+            vf t = cr * sr - ci * si;
+            ci = cr * si + ci * sr;
+            cr = t;
+        }
+
+        float sumR = 0, sumI = 0;
+        for (int l = 0; l < LANES; l++) {
+            sumR += ar[l];
+            sumI += ai[l];
+        }
+        re[m] = sumR / decim;
+        im[m] = sumI / decim;
+    }
+}
+
+static float dot(const float *a, const float *b, uint32_t n) {
+    vf acc = {0};
+    uint32_t k = 0;
+
+    for (; k + LANES <= n; k += LANES) {
+        vf x, y;
+        memcpy(&x, a + k, sizeof(vf));
+        memcpy(&y, b + k, sizeof(vf));
+        acc += x * y;
+    }
+    float sum = 0;
+    for (int l = 0; l < LANES; l++) {
+        sum += acc[l];
+    }
+    for (; k < n; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static int decodeBurst(const float *re, const float *im, size_t len, double rate, size_t start, size_t end,
+        char *line, size_t size) {
+    double spb = rate / BIT_RATE;
+    size_t pre0 = start + (size_t)(0.02 * rate);
+    size_t pre1 = start + (size_t)(0.12 * rate);
+    size_t frameLen = (size_t)(FRAME_BITS * spb) + 1;
+    size_t last = start + (size_t)(SEARCH_END * rate) + frameLen;
+
+    if (last >= len || end <= pre1) {
+        snprintf(line, size, "truncated");
+        return 0;
+    }
+
+    //residual carrier frequency from the unmodulated preamble, refined with growing lags: each
+    //stage leaves an error well within the unambiguous range of the next one
+    const double lags[] = {1, 0.010 * rate, 0.050 * rate};
+    double dw = 0;
+    for (uint8_t l = 0; l < sizeof(lags) / sizeof(lags[0]); l++) {
+        size_t lag = (size_t)lags[l];
+        double dr = 0, di = 0;
+        for (size_t m = pre0 + lag; m < pre1; m++) {
+            double p = dw * (double)lag;
+            double xr = re[m - lag] * cos(p) - im[m - lag] * sin(p);
+            double xi = re[m - lag] * sin(p) + im[m - lag] * cos(p);
+            dr += re[m] * xr + im[m] * xi;
+            di += im[m] * xr - re[m] * xi;
+        }
+        dw += atan2(di, dr) / lag;
+    }
+
+    //carrier phase and amplitude after removing the residual frequency
+    double pr = 0, pi = 0;
+    for (size_t m = pre0; m < pre1; m++) {
+        double p = -dw * (double)(m - pre0);
+        pr += re[m] * cos(p) - im[m] * sin(p);
+        pi += re[m] * sin(p) + im[m] * cos(p);
+    }
+    double phase0 = atan2(pi, pr);
+    double amp = sqrt(pr * pr + pi * pi) / (pre1 - pre0);
+
+    //phase modulation appears in the quadrature component: +-sin(PHASE)
+    size_t s0 = start + (size_t)(SEARCH_START * rate);
+    size_t n = last - s0;
+    float *s = malloc(n * sizeof(float));
+    for (size_t k = 0; k < n; k++) {
+        size_t m = s0 + k;
+        double p = -dw * (double)(m - pre0) - phase0;
+        s[k] = (re[m] * sin(p) + im[m] * cos(p)) / (amp * sin(PHASE));
+    }
+
+    //timing from the correlation with bit and frame sync (biphase-L: 1 is +phase, then -phase)
+    static const uint8_t sync[SYNC_BITS] = {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 0,0,0,1,0,1,1,1,1};
+    uint32_t tlen = (uint32_t)(SYNC_BITS * spb);
+    float *tmpl = malloc(tlen * sizeof(float));
+    for (uint32_t k = 0; k < tlen; k++) {
+        uint32_t half = (uint32_t)(k * 2 / spb);
+        float v = sync[half / 2] ? 1 : -1;
+        tmpl[k] = half % 2 ? -v : v;
+    }
+    size_t searchLen = (size_t)((SEARCH_END - SEARCH_START) * rate);
+    float best = 0;
+    size_t bestOfs = 0;
+    for (size_t o = 0; o < searchLen; o++) {
+        float c = dot(tmpl, s + o, tlen);
+        if (fabsf(c) > fabsf(best)) {
+            best = c;
+            bestOfs = o;
+        }
+    }
+    free(tmpl);
+    float polarity = best < 0 ? -1 : 1;
+
+    //integrate the halves of each bit, without the edges
+    uint8_t bits[FRAME_BITS];
+    double margin = 1e9;
+    double guard = spb / 16;
+    for (int b = 0; b < FRAME_BITS; b++) {
+        double h[2] = {0, 0};
+        for (int half = 0; half < 2; half++) {
+            double from = bestOfs + (2 * b + half) * spb / 2;
+            size_t k0 = (size_t)(from + guard);
+            size_t k1 = (size_t)(from + spb / 2 - guard);
+            for (size_t k = k0; k < k1; k++) {
+                h[half] += s[k];
+            }
+            h[half] /= k1 - k0;
+        }
+        double soft = polarity * (h[0] - h[1]) / 2;
+        bits[b] = soft > 0;
+        margin = fabs(soft) < margin ? fabs(soft) : margin;
+    }
+    free(s);
+
+    char frame[160];
+    int ok;
+    if (bits[FORMAT_BIT] == 0) {
+        snprintf(frame, sizeof(frame), "short message not supported");
+        ok = 0;
+    } else {
+        ok = decodeFrame(bits, frame, sizeof(frame));
+    }
+    snprintf(line, size, "%+7.1f Hz  margin %.2f  %s", dw * rate / (2 * M_PI), margin, frame);
+    return ok;
+}
+
+static int decodeFrame(const uint8_t *bits, char *line, size_t size) {
+    PLB_Identity id;
+    uint32_t v[16];
+    //pdf1 bits 26-85 and pdf2 bits 107-132 in the order and widths of plb.c
+    const Field pdf1[] = {
+        {1, &v[0]}, {10, &v[1]}, {3, &v[2]}, {3, &v[3]}, {1, &v[4]}, {20, &v[5]}, {10, &v[6]}, {10, &v[7]}, {2, &v[8]}
+    };
+    const Field pdf2[] = {
+        {1, &v[9]}, {1, &v[10]}, {7, &v[11]}, {4, &v[12]}, {1, &v[13]}, {8, &v[14]}, {4, &v[15]}
+    };
+    uint16_t idx = SYNC_BITS + 1;
+
+    for (uint8_t f = 0; f < sizeof(pdf1) / sizeof(pdf1[0]); f++) {
+        *pdf1[f].value = 0;
+        for (uint8_t b = 0; b < pdf1[f].bits; b++) {
+            *pdf1[f].value = (*pdf1[f].value << 1) | bits[idx++];
+        }
+    }
+    idx = SYNC_BITS + 82;
+    for (uint8_t f = 0; f < sizeof(pdf2) / sizeof(pdf2[0]); f++) {
+        *pdf2[f].value = 0;
+        for (uint8_t b = 0; b < pdf2[f].bits; b++) {
+            *pdf2[f].value = (*pdf2[f].value << 1) | bits[idx++];
+        }
+    }
+
+    id.protocolFlag = v[0];
+    id.countryCode = v[1];
+    id.testProtocol = v[2];
+    id.beaconType = v[3];
+    id.certif = v[4];
+    id.serialNumber = v[5];
+    id.nationalUse = v[6];
+    id.certifNumber = v[7];
+    id.radiolocating = v[8];
+
+    POS_Position pos;
+    memset(&pos, 0, sizeof(pos));
+    pos.valid = POS_Valid_Flag_Valid;
+    pos.source = v[9] ? POS_Source_Flag_Internal : POS_Source_Flag_External;
+    pos.latitude.direction = v[10];
+    pos.latitude.degree = v[11];
+    pos.latitude.minute = v[12] * 4;
+    pos.longitude.direction = v[13];
+    pos.longitude.degree = v[14];
+    pos.longitude.minute = v[15] * 4;
+
+    //the frame of the decoded fields has to match bit by bit, this checks sync, bch1 and bch2
+    uint8_t encoded[FRAME_BITS];
+    pthread_mutex_lock(&plbLock);
+    PLB_Init(&id);
+    uint16_t len = PLB_CreateFrame(encoded, FRAME_BITS, &pos);
+    uint64_t hexId = PLB_GetBeaconId(&id);
+    pthread_mutex_unlock(&plbLock);
+
+    int errors = 0;
+    for (uint16_t b = 0; b < FRAME_BITS; b++) {
+        errors += len != FRAME_BITS || encoded[b] != bits[b];
+    }
+
+    snprintf(line, size, "id %015llX  %c %2u° %2u' %c %3u° %2u'  %s", (unsigned long long)hexId,
+            pos.latitude.direction == POS_Latitude_Flag_N ? 'N' : 'S', pos.latitude.degree, (unsigned)pos.latitude.minute,
+            pos.longitude.direction == POS_Longitude_Flag_E ? 'E' : 'W', pos.longitude.degree, (unsigned)pos.longitude.minute,
+            errors == 0 ? "ok" : "sync or bch error");
+    return errors == 0;
+}
+
+static void appendReport(Result *res, const char *line) {
+    size_t n = strlen(line);
+    res->report = realloc(res->report, res->reportLen + n + 2);
+    memcpy(res->report + res->reportLen, line, n);
+    res->reportLen += n;
+    res->report[res->reportLen++] = '\n';
+    res->report[res->reportLen] = 0;
+}
+
+static int compare(const void *a, const void *b) {
+    return *(const float*)a < *(const float*)b ? -1 : *(const float*)a > *(const float*)b;
+}
+
+static void processFile(Result *res) {
+    char line[256];
+    int fmt = formatOf(res->name);
+    if (fmt < 0) {
+        snprintf(line, sizeof(line), "%s: unknown format, use -f or one of .cu8 .cs8 .cs16 .cf32", res->name);
+        appendReport(res, line);
+        return;
+    }
+
+    int fd = open(res->name, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        snprintf(line, sizeof(line), "%s: cannot open", res->name);
+        appendReport(res, line);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    const uint8_t *raw = st.st_size > 0 ? mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (raw == MAP_FAILED) {
+        snprintf(line, sizeof(line), "%s: cannot map", res->name);
+        appendReport(res, line);
+        return;
+    }
+    madvise((void*)raw, st.st_size, MADV_SEQUENTIAL);
+
+    //decimation in whole vectors, at least WORK_RATE remains
+    uint32_t decim = (uint32_t)(sampleRate / WORK_RATE) / LANES * LANES;
+    decim = decim < LANES ? LANES : decim;
+    double rate = sampleRate / decim;
+    res->samples = st.st_size / sampleSize[fmt];
+    size_t len = res->samples / decim;
+
+    float *re = malloc(len * sizeof(float) + 1);
+    float *im = malloc(len * sizeof(float) + 1);
+    mixDown(fmt, raw, len, decim, re, im);
+    munmap((void*)raw, st.st_size);
+
+    //power envelope in blocks, noise floor from the quiet blocks
+    uint32_t block = (uint32_t)(ENV_TIME * rate);
+    size_t blocks = len / block;
+    float *power = malloc(blocks * sizeof(float) + 1);
+    float *sorted = malloc(blocks * sizeof(float) + 1);
+    for (size_t b = 0; b < blocks; b++) {
+        float p = dot(re + b * block, re + b * block, block) + dot(im + b * block, im + b * block, block);
+        power[b] = sorted[b] = p / block;
+    }
+    qsort(sorted, blocks, sizeof(float), compare);
+    float noise = blocks > 0 ? sorted[(size_t)(blocks * NOISE_QUANTILE)] : 0;
+    float threshold = noise * powf(10, THRESHOLD_DB / 10.0f);
+    free(sorted);
+
+    for (size_t b = 0; b < blocks; b++) {
+        if (power[b] <= threshold) {
+            continue;
+        }
+        size_t e = b;
+        double sum = 0;
+        while (e < blocks && power[e] > threshold) {
+            sum += power[e++];
+        }
+        double duration = (e - b) * ENV_TIME;
+        if (duration >= BURST_MIN && duration <= BURST_MAX) {
+            char frame[200];
+            double snr = 10 * log10(fmax(sum / (e - b) / noise - 1, 1e-3));
+            res->bursts++;
+            res->frames += decodeBurst(re, im, len, rate, b * block, e * block, frame, sizeof(frame));
+            snprintf(line, sizeof(line), "%s  %9.3f s  %3.0f ms  %5.1f dB  %s", res->name, b * ENV_TIME,
+                    duration * 1e3, snr, frame);
+            appendReport(res, line);
+        } else if (verbose) {
+            snprintf(line, sizeof(line), "%s  %9.3f s  %3.0f ms  skipped (no beacon burst)", res->name,
+                    b * ENV_TIME, duration * 1e3);
+            appendReport(res, line);
+        }
+        b = e;
+    }
+
+    free(power);
+    free(re);
+    free(im);
+}
+
+static void* worker(void *arg) {
+    while (1) {
+        pthread_mutex_lock(&fileLock);
+        int f = nextFile++;
+        pthread_mutex_unlock(&fileLock);
+        if (f >= fileCount) {
+            break;
+        }
+        processFile(&results[f]);
+
+        pthread_mutex_lock(&outLock);
+        if (results[f].report != 0) {
+            fputs(results[f].report, stdout);
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&outLock);
+    }
+    return 0;
+}
+
+static int generate(const char *name, int bursts, double snr) {
+    int fmt = formatOf(name);
+    if (fmt < 0) {
+        fprintf(stderr, "%s: unknown format\n", name);
+        return 1;
+    }
+    FILE *out = fopen(name, "wb");
+    if (out == 0) {
+        fprintf(stderr, "%s: cannot create\n", name);
+        return 1;
+    }
+
+    //identification of the configuration defaults, random positions
+    PLB_Identity id = {.protocolFlag = 1, .countryCode = 203, .testProtocol = 0b110, .beaconType = 0b011,
+            .certif = 0, .serialNumber = 0x1A2B3, .nationalUse = 0, .certifNumber = 0x155, .radiolocating = 0b01};
+    PLB_Init(&id);
+
+    static const double scale[Format_Count] = {40, 40, 4000, 1};
+    double noiseRms = scale[fmt] / sqrt(1 + pow(10, snr / 10));
+    double amp = noiseRms * pow(10, snr / 20);
+    uint64_t total = (uint64_t)(bursts * GEN_INTERVAL * sampleRate);
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    uint8_t frame[FRAME_BITS];
+    double freq = 0, phase = 0;
+    uint64_t burstStart = 0, burstEnd = 0;
+    int burst = -1;
+
+    for (uint64_t n = 0; n < total; n++) {
+        double t = n / sampleRate;
+        int k = (int)(t / GEN_INTERVAL);
+        if (k != burst) {
+            burst = k;
+            POS_Position pos;
+            memset(&pos, 0, sizeof(pos));
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            pos.valid = POS_Valid_Flag_Valid;
+            pos.latitude.direction = rng & 1;
+            pos.latitude.degree = (rng >> 1) % 90;
+            pos.latitude.minute = ((rng >> 8) % 15) * 4;
+            pos.longitude.direction = (rng >> 16) & 1;
+            pos.longitude.degree = (rng >> 17) % 180;
+            pos.longitude.minute = ((rng >> 25) % 15) * 4;
+            PLB_CreateFrame(frame, FRAME_BITS, &pos);
+            freq = offset + (double)((int)((rng >> 32) % (2 * GEN_DRIFT + 1)) - GEN_DRIFT);
+            burstStart = (uint64_t)((k * GEN_INTERVAL + 0.5) * sampleRate);
+            burstEnd = burstStart + (uint64_t)((PREAMBLE + (double)FRAME_BITS / BIT_RATE) * sampleRate);
+        }
+
+        double si = 0, sq = 0;
+        if (n >= burstStart && n < burstEnd) {
+            double tb = (n - burstStart) / sampleRate - PREAMBLE;
+            double mod = 0;
+            if (tb >= 0) {
+                int half = (int)(tb * 2 * BIT_RATE);
+                double v = frame[half / 2] ? PHASE : -PHASE;
+                mod = half % 2 ? -v : v;
+            }
+            si = amp * cos(phase + mod);
+            sq = amp * sin(phase + mod);
+        }
+        phase = fmod(phase + 2 * M_PI * freq / sampleRate, 2 * M_PI);
+
+        //gaussian noise (Box-Muller)
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        double u1 = ((rng >> 11) + 1.0) / 9007199254740993.0;
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        double u2 = (rng >> 11) / 9007199254740992.0;
+        double r = noiseRms * sqrt(-log(u1));
+        si += r * cos(2 * M_PI * u2);
+        sq += r * sin(2 * M_PI * u2);
+
+        switch (fmt) {
+            case Format_CU8: {
+                uint8_t b[2] = {(uint8_t)fmin(fmax(lrint(si + 127.5), 0), 255), (uint8_t)fmin(fmax(lrint(sq + 127.5), 0), 255)};
+                fwrite(b, 1, 2, out);
+                break;
+            }
+            case Format_CS8: {
+                int8_t b[2] = {(int8_t)fmin(fmax(lrint(si), -128), 127), (int8_t)fmin(fmax(lrint(sq), -128), 127)};
+                fwrite(b, 1, 2, out);
+                break;
+            }
+            case Format_CS16: {
+                int16_t b[2] = {(int16_t)fmin(fmax(lrint(si), -32768), 32767), (int16_t)fmin(fmax(lrint(sq), -32768), 32767)};
+                fwrite(b, 2, 2, out);
+                break;
+            }
+            default: {
+                float b[2] = {si, sq};
+                fwrite(b, 4, 2, out);
+                break;
+            }
+        }
+    }
+    fclose(out);
+    printf("%s  %d bursts, %.1f s at %.0f samples/s, %.1f dB\n", name, bursts, total / sampleRate, sampleRate, snr);
+    return 0;
+}
+
+void LOG_Log(const char *format, ...) {
+}
+
+void LOG_BitArray(uint8_t *array, uint16_t len) {
+}
+
+int main(int argc, char **argv) {
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *genName = 0;
+    int genBursts = 10;
+    double genSnr = 0;
+    int expected = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:o:f:j:g:n:r:e:v")) != -1) {
+        switch (opt) {
+            case 's':
+                sampleRate = atof(optarg);
+                break;
+            case 'o':
+                offset = atof(optarg);
+                break;
+            case 'f':
+                for (int f = 0; f < Format_Count; f++) {
+                    forcedFormat = strcmp(optarg, extensions[f] + 1) == 0 ? f : forcedFormat;
+                }
+                if (forcedFormat < 0) {
+                    fprintf(stderr, "unknown format %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'g':
+                genName = optarg;
+                break;
+            case 'n':
+                genBursts = atoi(optarg);
+                break;
+            case 'r':
+                genSnr = atof(optarg);
+                break;
+            case 'e':
+                expected = atoi(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s sample rate] [-o carrier offset Hz] [-f cu8|cs8|cs16|cf32] [-j threads] "
+                        "[-e expected frames] [-v] capture...\n"
+                        "       %s -g capture [-s sample rate] [-o carrier offset Hz] [-n bursts] [-r snr dB]\n",
+                        argv[0], argv[0]);
+                return 1;
+        }
+    }
+    if (sampleRate < WORK_RATE) {
+        fprintf(stderr, "sample rate must be at least %d\n", WORK_RATE);
+        return 1;
+    }
+    if (genName != 0) {
+        return generate(genName, genBursts, genSnr);
+    }
+
+    fileCount = argc - optind;
+    if (fileCount < 1 || fileCount > MAX_FILES) {
+        fprintf(stderr, "1..%d captures\n", MAX_FILES);
+        return 1;
+    }
+    for (int f = 0; f < fileCount; f++) {
+        results[f].name = argv[optind + f];
+    }
+    threads = threads < 1 ? 1 : threads > fileCount ? fileCount : threads;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_t pool[threads];
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&pool[t], 0, worker, 0);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(pool[t], 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    uint64_t samples = 0;
+    uint32_t bursts = 0, frames = 0;
+    for (int f = 0; f < fileCount; f++) {
+        samples += results[f].samples;
+        bursts += results[f].bursts;
+        frames += results[f].frames;
+        free(results[f].report);
+    }
+
+    printf("captures     %d in %.3f s, %d threads, %.1f Msamples/s (%.1f s of signal)\n", fileCount, wall, threads,
+            samples / 1e6 / wall, samples / sampleRate);
+    printf("bursts       %u detected, %u frames decoded (%.1f %%)\n", bursts, frames, bursts > 0 ? 100.0 * frames / bursts : 0);
+    printf("frames/s     %.1f\n", frames / wall);
+    if (expected >= 0) {
+        int failed = frames != (uint32_t)expected || bursts != (uint32_t)expected;
+        printf("%s\n", failed ? "FAILED" : "PASSED");
+        return failed;
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file posbus_stress.c
+ * @author Paul Götzinger
+ * @brief Host tool: stress test of the position bus with a concurrent producer and readers
+ * @version 1.0
+ * @date 2019-03-23
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "posbus.h"
+
+#define MAX_READERS POS_BUS_SUBSCRIBERS
+
+/**
+ * @brief Reader statistics
+ *
+ */
+typedef struct {
+    POS_Subscriber sub;
+    uint64_t reads;     //snapshots fetched
+    uint64_t busy;      //fetch gave up while the producer wrote
+    uint64_t torn;      //inconsistent snapshots
+    uint64_t order;     //version went backwards or did not match content
+    uint64_t missed;    //versions skipped (slower than producer)
+} Reader;
+
+static POS_Bus bus;
+static volatile int running = 1;
+static volatile uint64_t notifications;
+static Reader readers[MAX_READERS];
+static uint64_t published;
+static uint64_t maxPublish;     //longest publish (ns), readers must not stall the producer
+static uint32_t interval;       //us between publishes, 0: as fast as possible
+
+/**
+ * @brief Fill position, every field derives from the publish counter
+ *
+ * @param n publish counter
+ * @param pos position
+ */
+static void makePosition(uint32_t n, POS_Position *pos);
+
+/**
+ * @brief Check that all fields of a snapshot belong to the same publish
+ *
+ * @param pos snapshot
+ * @param n publish counter encoded in the snapshot
+ * @return int 1 if consistent
+ */
+static int checkPosition(POS_Position *pos, uint32_t *n);
+
+/**
+ * @brief Wake-up function of the subscribers
+ *
+ */
+static void notify(void);
+
+/**
+ * @brief Producer thread, publishes as fast as possible
+ *
+ * @param arg unused
+ * @return void* 0
+ */
+static void* producer(void *arg);
+
+/**
+ * @brief Reader thread, fetches every change of its subscription and checks it
+ *
+ * @param arg reader statistics
+ * @return void* 0
+ */
+static void* reader(void *arg);
+
+/**
+ * @brief Monotonic time
+ *
+ * @return uint64_t ns
+ */
+static uint64_t nowNs(void);
+
+int main(int argc, char **argv) {
+    int readerCount = 3;
+    double duration = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:d:i:")) != -1) {
+        switch (opt) {
+            case 'r':
+                readerCount = atoi(optarg);
+                break;
+            case 'd':
+                duration = atof(optarg);
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r readers (1..%d)] [-d seconds] [-i publish interval us]\n", argv[0], MAX_READERS);
+                return 1;
+        }
+    }
+    if (readerCount < 1 || readerCount > MAX_READERS) {
+        fprintf(stderr, "readers must be 1..%d\n", MAX_READERS);
+        return 1;
+    }
+
+    POS_BusInit(&bus);
+    for (int i = 0; i < readerCount; i++) {
+        POS_BusSubscribe(&bus, &readers[i].sub, notify);
+    }
+
+    pthread_t prod, threads[MAX_READERS];
+
+    for (int i = 0; i < readerCount; i++) {
+        pthread_create(&threads[i], 0, reader, &readers[i]);
+    }
+    pthread_create(&prod, 0, producer, 0);
+
+    usleep(duration * 1e6);
+    running = 0;
+    pthread_join(prod, 0);
+    for (int i = 0; i < readerCount; i++) {
+        pthread_join(threads[i], 0);
+    }
+
+    int failed = 0;
+    printf("published    %llu positions, version %u, publish max %llu ns\n",
+            (unsigned long long)published, POS_BusGetVersion(&bus), (unsigned long long)maxPublish);
+    printf("notified     %llu, read retries %u\n", (unsigned long long)notifications, bus.retries);
+    for (int i = 0; i < readerCount; i++) {
+        Reader *r = &readers[i];
+        printf("reader %d     %llu reads, %llu busy, %llu missed, %llu torn, %llu out of order\n", i,
+                (unsigned long long)r->reads, (unsigned long long)r->busy, (unsigned long long)r->missed,
+                (unsigned long long)r->torn, (unsigned long long)r->order);
+        failed |= r->torn != 0 || r->order != 0 || r->reads == 0;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed;
+}
+
+static void* producer(void *arg) {
+    POS_Position pos;
+    uint32_t n = 0;
+
+    while (running) {
+        makePosition(n++, &pos);
+        uint64_t start = nowNs();
+        POS_BusPublish(&bus, &pos);
+        uint64_t dt = nowNs() - start;
+        maxPublish = dt > maxPublish ? dt : maxPublish;
+        if (interval != 0) {
+            usleep(interval);
+        }
+    }
+    published = n;
+    return 0;
+}
+
+static void* reader(void *arg) {
+    Reader *r = arg;
+    POS_Position pos;
+    uint32_t last = 0;
+
+    while (running) {
+        if (!POS_BusChanged(&bus, &r->sub)) {
+            continue;
+        }
+        uint32_t version = POS_BusFetch(&bus, &r->sub, &pos);
+        if (version == 0) {
+            r->busy++;
+            continue;
+        }
+
+        uint32_t n;
+        r->reads++;
+        if (!checkPosition(&pos, &n)) {
+            r->torn++;
+        } else if (version != n + 1 || version <= last) {
+            //version n + 1 carries publish n
+            r->order++;
+        } else {
+            r->missed += version - last - 1;
+        }
+        last = version;
+    }
+    return 0;
+}
+
+static void notify(void) {
+    __sync_fetch_and_add(&notifications, 1);
+}
+
+static void makePosition(uint32_t n, POS_Position *pos) {
+    pos->time.hour = n % 24;
+    pos->time.minute = n % 60;
+    pos->time.second = (n / 60) % 60;
+    pos->time.split = n % 100;
+    pos->latitude.direction = n & 1 ? POS_Latitude_Flag_S : POS_Latitude_Flag_N;
+    pos->latitude.degree = n & 0xFFFF;
+    pos->latitude.minute = (n % 6000) / 100.0f;
+    pos->longitude.direction = n & 2 ? POS_Longitude_Flag_W : POS_Longitude_Flag_E;
+    pos->longitude.degree = n >> 16;
+    pos->longitude.minute = (n % 3000) / 50.0f;
+    pos->valid = POS_Valid_Flag_Valid;
+    pos->source = n & 4 ? POS_Source_Flag_External : POS_Source_Flag_Internal;
+}
+
+static int checkPosition(POS_Position *pos, uint32_t *n) {
+    POS_Position expected;
+
+    *n = pos->latitude.degree | ((uint32_t)pos->longitude.degree << 16);
+    makePosition(*n, &expected);
+    return pos->time.hour == expected.time.hour && pos->time.minute == expected.time.minute
+            && pos->time.second == expected.time.second && pos->time.split == expected.time.split
+            && pos->latitude.direction == expected.latitude.direction
+            && pos->latitude.minute == expected.latitude.minute
+            && pos->longitude.direction == expected.longitude.direction
+            && pos->longitude.minute == expected.longitude.minute
+            && pos->valid == expected.valid && pos->source == expected.source;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
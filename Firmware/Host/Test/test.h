@@ -0,0 +1,58 @@
+/**
+ * @file test.h
+ * @author Paul Götzinger
+ * @brief Host tool: checks, random numbers, time and the HAL tick stand-in shared by the host tests
+ * @version 1.0
+ * @date 2019-04-05
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Check condition, print location and message if it fails
+ *
+ */
+#define CHECK(COND, ...) do { \
+        TEST_Checks++; \
+        if (!(COND)) { \
+            TEST_Failed++; \
+            printf("%s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+extern uint32_t TEST_Checks;
+extern uint32_t TEST_Failed;
+extern uint32_t TEST_Tick;      //returned by HAL_GetTick
+extern int TEST_Verbose;        //LOG output to stdout
+
+/**
+ * @brief Print count of checks and PASSED or FAILED
+ *
+ * @return int 0 if all checks passed, 1 otherwise (exit code)
+ */
+int TEST_Result(void);
+
+/**
+ * @brief Retrieve pseudo random number (xorshift, fixed seed so runs repeat)
+ *
+ * @return uint64_t random number
+ */
+uint64_t TEST_Random(void);
+
+/**
+ * @brief Retrieve monotonic time for throughput figures
+ *
+ * @return double seconds
+ */
+double TEST_Seconds(void);
+
+#endif //!TEST_H
@@ -0,0 +1,40 @@
+/**
+ * @file test_hal.h
+ * @author Paul Götzinger
+ * @brief Host tool: redirects the peripherals used by the modules under test to host memory.
+ * Force included after the HAL headers by the tests that need it.
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef TEST_HAL_H
+#define TEST_HAL_H
+
+//trace timer, SysTick and clock control registers, set by the test
+extern TIM_TypeDef TEST_TIM6;
+extern SysTick_Type TEST_SysTick;
+extern RCC_TypeDef TEST_RCC;
+#undef  TIM6
+#define TIM6 (&TEST_TIM6)
+#undef  SysTick
+#define SysTick (&TEST_SysTick)
+#undef  RCC
+#define RCC (&TEST_RCC)
+
+//main stack pointer, set by the test
+extern uint32_t *TEST_Msp;
+#define __get_MSP()         ((uintptr_t)TEST_Msp)
+
+//the host linker defines _edata itself
+#define _edata TEST_edata
+
+//no interrupts on the host
+#define __disable_irq()     ((void)0)
+#define __enable_irq()      ((void)0)
+#define __get_PRIMASK()     0U
+#define __set_PRIMASK(X)    ((void)(X))
+
+#endif //!TEST_HAL_H
@@ -0,0 +1,196 @@
+/**
+ * @file test_memory.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the stack high-water mark, the stack guard and the RAM report.
+ * The symbols of the linker script are placed in a RAM image of the test
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "test.h"
+#include "memory.h"
+#include "trace.h"
+
+#define STACK_WORDS     512     //2 KB, stm32_flash.ld
+#define GUARD_WORDS     (MEM_GUARD_SIZE / 4)
+#define SP_MARGIN       16      //words left unpainted below the stack pointer, memory.c
+#define GARBAGE         0xA5A5A5A5UL
+#define DEPTHS          1000    //random call depths
+
+TIM_TypeDef TEST_TIM6;
+SysTick_Type TEST_SysTick;
+RCC_TypeDef TEST_RCC;
+uint32_t *TEST_Msp;
+
+/**
+ * @brief RAM image: data, bss with the module groups, noinit, ram functions and stack
+ *
+ */
+uint8_t ramImage[1024] __attribute__((aligned(4)));
+uint32_t stackImage[STACK_WORDS];
+
+//linker script symbols (stm32_flash.ld), addresses in the images, budgets are absolute
+__asm__(
+    ".globl _sdata, TEST_edata, _sbss, _ebss, __noinit_start, __noinit_end, _sramfunc, _eramfunc\n"
+    ".set _sdata, ramImage\n"
+    ".set TEST_edata, ramImage + 100\n"
+    ".set _sbss, ramImage + 100\n"
+    ".set _ebss, ramImage + 700\n"
+    ".set __noinit_start, ramImage + 700\n"
+    ".set __noinit_end, ramImage + 1000\n"
+    ".set _sramfunc, ramImage + 1000\n"
+    ".set _eramfunc, ramImage + 1024\n"
+    ".globl __stack_limit, _estack\n"
+    ".set __stack_limit, stackImage\n"
+    ".set _estack, stackImage + 2048\n"
+    ".globl __mem_usb_start, __mem_usb_end, __mem_usb_budget\n"
+    ".set __mem_usb_start, ramImage + 100\n"
+    ".set __mem_usb_end, ramImage + 300\n"
+    ".set __mem_usb_budget, 2560\n"
+    ".globl __mem_ble_start, __mem_ble_end, __mem_ble_budget\n"
+    ".set __mem_ble_start, ramImage + 300\n"
+    ".set __mem_ble_end, ramImage + 400\n"
+    ".set __mem_ble_budget, 1536\n"
+    ".globl __mem_gnss_start, __mem_gnss_end, __mem_gnss_budget\n"
+    ".set __mem_gnss_start, ramImage + 400\n"
+    ".set __mem_gnss_end, ramImage + 450\n"
+    ".set __mem_gnss_budget, 1792\n"
+    ".globl __mem_emc_start, __mem_emc_end, __mem_emc_budget\n"
+    ".set __mem_emc_start, ramImage + 450\n"
+    ".set __mem_emc_end, ramImage + 460\n"
+    ".set __mem_emc_budget, 1024\n"
+    ".globl __mem_com_start, __mem_com_end, __mem_com_budget\n"
+    ".set __mem_com_start, ramImage + 460\n"
+    ".set __mem_com_end, ramImage + 461\n"
+    ".set __mem_com_budget, 256\n"
+    ".globl __mem_log_start, __mem_log_end, __mem_log_budget\n"
+    ".set __mem_log_start, ramImage + 461\n"
+    ".set __mem_log_end, ramImage + 461\n"
+    ".set __mem_log_budget, 320\n"
+);
+
+//registered buffers: the table MEM_BUFFER builds in .membuf, 2 entries of 32 bytes on the host
+static uint8_t rxBuffer[64];
+static uint16_t txBuffer[10];
+const MEM_Buffer membuf[] = {
+    {"usb", "rxBuffer", rxBuffer, sizeof(rxBuffer)},
+    {"ble", "txBuffer", txBuffer, sizeof(txBuffer)},
+};
+_Static_assert(sizeof(membuf) == 64, "end of buffer table");
+extern const MEM_Buffer __membuf_start[], __membuf_end[];
+__asm__(
+    ".globl __membuf_start, __membuf_end\n"
+    ".set __membuf_start, membuf\n"
+    ".set __membuf_end, membuf + 64\n"
+);
+
+/**
+ * @brief Count trace entries of the stack event
+ *
+ * @param arg argument of the last one
+ * @return int count
+ */
+static int stackEvents(uint16_t *arg);
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return 32000000;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+    CHECK(__membuf_end == &__membuf_start[2], "buffer table end");
+    TRACE_Init();
+
+    //boot: 40 words in use above the stack pointer, the rest holds values of before the reset
+    for (uint16_t i = 0; i < STACK_WORDS; i++) {
+        stackImage[i] = GARBAGE;
+    }
+    TEST_Msp = &stackImage[STACK_WORDS - 40];
+    MEM_PaintStack();
+    CHECK(MEM_GetStackSize() == STACK_WORDS * 4, "stack size %u", MEM_GetStackSize());
+    CHECK(MEM_GetStackUsage() == (40 + SP_MARGIN) * 4, "usage after paint %u", MEM_GetStackUsage());
+    CHECK(MEM_GuardIntact(), "guard after paint");
+    CHECK(stackImage[0] == MEM_STACK_PATTERN && stackImage[STACK_WORDS - 40 - SP_MARGIN - 1] == MEM_STACK_PATTERN
+            && stackImage[STACK_WORDS - 40 - SP_MARGIN] == GARBAGE, "painted range");
+
+    //calls of random depth: the deepest one is the high-water mark, the guard stays intact
+    uint16_t deepest = 40 + SP_MARGIN;
+    for (int i = 0; i < DEPTHS; i++) {
+        uint16_t depth = 1 + TEST_Random() % (STACK_WORDS - GUARD_WORDS);
+        stackImage[STACK_WORDS - depth] = (uint32_t)TEST_Random() | 1;  //the pattern itself is not counted
+        deepest = depth > deepest ? depth : deepest;
+        CHECK(MEM_GetStackUsage() == deepest * 4, "depth %u: usage %u", depth * 4, MEM_GetStackUsage());
+        MEM_Check();
+    }
+    CHECK(MEM_GuardIntact() && stackEvents(0) == 0, "guard intact above the guard");
+
+    //into the guard: reported once with the usage
+    stackImage[GUARD_WORDS - 1] = 0;
+    CHECK(!MEM_GuardIntact(), "guard violation");
+    MEM_Check();
+    MEM_Check();
+    uint16_t arg;
+    CHECK(stackEvents(&arg) == 1 && arg == (STACK_WORDS - GUARD_WORDS + 1) * 4, "stack events %d, arg %u",
+            stackEvents(0), arg);
+
+    //a new paint rearms the check
+    TEST_Msp = &stackImage[STACK_WORDS - 8];
+    MEM_PaintStack();
+    CHECK(MEM_GuardIntact() && MEM_GetStackUsage() == (8 + SP_MARGIN) * 4, "usage after repaint %u",
+            MEM_GetStackUsage());
+    stackImage[0] = 0;
+    MEM_Check();
+    CHECK(stackEvents(0) == 2, "second violation after repaint");
+
+    //static data, modules and buffers of the report
+    uint16_t data, bss, noinit;
+    MEM_GetStatic(&data, &bss, &noinit);
+    CHECK(data == 100 && bss == 600 && noinit == 300 && MEM_GetRamCode() == 24, "static %u %u %u, ramfunc %u",
+            data, bss, noinit, MEM_GetRamCode());
+    static const char *const names[] = {"usb", "ble", "gnss", "emc", "com", "log"};
+    static const uint16_t used[] = {200, 100, 50, 10, 1, 0};
+    static const uint16_t budget[] = {2560, 1536, 1792, 1024, 256, 320};
+    MEM_Module module;
+    uint8_t count = 0;
+    for (; MEM_GetModule(count, &module); count++) {
+        CHECK(count < 6 && strcmp(module.name, names[count]) == 0 && module.used == used[count]
+                && module.budget == budget[count], "module %u: %s %u of %u", count, module.name, module.used,
+                module.budget);
+    }
+    CHECK(count == 6 && !MEM_GetModule(0, 0), "%u modules", count);
+    CHECK(MEM_GetBuffer(0) == &__membuf_start[0] && MEM_GetBuffer(1)->size == 20 && MEM_GetBuffer(2) == 0,
+            "buffers");
+    MEM_LogReport();
+
+    return TEST_Result();
+}
+
+static int stackEvents(uint16_t *arg) {
+    TRACE_Entry e;
+    int count = 0;
+    for (uint16_t i = 0; TRACE_GetEntry(i, &e); i++) {
+        if (e.event == TRACE_Event_Stack) {
+            count++;
+            if (arg != 0) {
+                *arg = e.arg;
+            }
+        }
+    }
+    return count;
+}
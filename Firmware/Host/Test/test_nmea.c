@@ -0,0 +1,336 @@
+/**
+ * @file test_nmea.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the nmea parser with generated sentences of all types, corrupted
+ * checksums, payloads and frames; the counters per type and the parsed fields are compared
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "test.h"
+#include "nmea.h"
+
+#define SENTENCES       200000
+#define LINE_LEN        128
+
+/**
+ * @brief Ways a sentence is sent
+ *
+ */
+typedef enum {
+    Send_Intact = 0,
+    Send_Payload,       //one payload character replaced
+    Send_ChecksumHigh,  //wrong first checksum digit
+    Send_ChecksumLow,   //wrong second checksum digit
+    Send_NotHex,        //checksum digit is no hex digit
+    Send_Truncated,     //cut off by the next '$'
+    Send_NoCr,          //line end is LF only
+    Send_Overlength,    //payload longer than NMEA_DATA_LENGTH
+    Send_BadType,       //type field not 5 characters
+    Send_Count
+} Send;
+
+static const char *const sendNames[Send_Count] = {
+    "intact", "payload", "checksum high", "checksum low", "not hex", "truncated", "no cr", "overlength", "bad type"
+};
+
+static NMEA_Instance nmea;
+static NMEA_Counter expected[NMEA_Type_Count];
+static uint32_t expectedFraming;
+
+//last callbacks
+static POS_Position lastPos;
+static POS_Quality lastQuality;
+static NMEA_Satellite lastSv[NMEA_SV_PER_SENTENCE];
+static uint8_t lastSvCount;
+static int positions, qualities, satellites, unknowns;
+
+/**
+ * @brief Build a sentence with random content
+ *
+ * @param type sentence type, NMEA_Type_NONE for an unknown one
+ * @param line sentence without '$', checksum and line end
+ * @return int 1 if the fields have to be checked after parsing
+ */
+static int build(NMEA_Type type, char *line);
+
+/**
+ * @brief Send sentence to the parser byte by byte
+ *
+ * @param text bytes
+ * @param len count of bytes
+ */
+static void feed(const char *text, size_t len);
+
+static void positionCallback(POS_Position *pos) {
+    lastPos = *pos;
+    positions++;
+}
+
+static void qualityCallback(POS_Quality *quality) {
+    lastQuality = *quality;
+    qualities++;
+}
+
+static void satellitesCallback(NMEA_Satellite *sv, uint8_t count) {
+    memcpy(lastSv, sv, count * sizeof(NMEA_Satellite));
+    lastSvCount = count;
+    satellites++;
+}
+
+static void unknownCallback(NMEA_Type type, uint8_t *data, uint16_t len) {
+    unknowns++;
+}
+
+//expected fields of the last built sentence
+static POS_Position wantPos;
+static POS_Quality wantQuality;
+static NMEA_Satellite wantSv[NMEA_SV_PER_SENTENCE];
+static uint8_t wantSvCount;
+
+int main(int argc, char **argv) {
+    int count = SENTENCES;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n sentences] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    NMEA_Init(&nmea);
+    NMEA_SetPositionCallback(&nmea, positionCallback);
+    NMEA_SetQualityCallback(&nmea, qualityCallback);
+    NMEA_SetSatellitesCallback(&nmea, satellitesCallback);
+    NMEA_SetUnknownCallback(&nmea, unknownCallback);
+
+    uint32_t sent[Send_Count] = {0};
+    uint64_t bytes = 0;
+    double t = 0;
+    for (int n = 0; n < count; n++) {
+        char payload[LINE_LEN], text[2 * LINE_LEN];
+        NMEA_Type type = TEST_Random() % NMEA_Type_Count;
+        int check = build(type, payload);
+        Send how = TEST_Random() % 4 != 0 ? Send_Intact : 1 + TEST_Random() % (Send_Count - 1);
+
+        if (how == Send_Overlength) {
+            //pad the last field
+            while (strlen(payload) <= 6 + NMEA_DATA_LENGTH) {
+                strcat(payload, "0");
+            }
+        }
+        uint8_t cs = 0;
+        for (const char *p = payload; *p != 0; p++) {
+            cs ^= *p;
+        }
+        const char *hex = TEST_Random() & 1 ? "0123456789ABCDEF" : "0123456789abcdef";
+        int len = sprintf(text, "$%s*%c%c\r\n", payload, hex[cs >> 4], hex[cs & 0x0F]);
+        int star = len - 5;
+
+        switch (how) {
+            case Send_Payload: {
+                //a character after the type field, replaced by another one of the same kind
+                int pos = 7 + TEST_Random() % (star - 7);
+                char c = text[pos];
+                do {
+                    c = "0123456789,.NSEWAV"[TEST_Random() % 18];
+                } while (c == text[pos]);
+                text[pos] = c;
+                break;
+            }
+            case Send_ChecksumHigh:
+                text[star + 1] = hex[((cs >> 4) + 1 + TEST_Random() % 15) & 0x0F];
+                break;
+            case Send_ChecksumLow:
+                text[star + 2] = hex[((cs & 0x0F) + 1 + TEST_Random() % 15) & 0x0F];
+                break;
+            case Send_NotHex:
+                text[star + 1 + (TEST_Random() & 1)] = "GZ*,-"[TEST_Random() % 5];
+                break;
+            case Send_Truncated:
+                len = 1 + TEST_Random() % (len - 1);
+                break;
+            case Send_NoCr:
+                text[len - 2] = '\n';
+                len--;
+                break;
+            case Send_BadType:
+                //drop or repeat a type character
+                if (TEST_Random() & 1) {
+                    memmove(&text[3], &text[4], len - 3);
+                    len--;
+                } else {
+                    memmove(&text[4], &text[3], len - 3);
+                    len++;
+                }
+                break;
+            default:
+                break;
+        }
+
+        switch (how) {
+            case Send_Intact:
+                expected[type].accepted++;
+                break;
+            case Send_Payload:
+            case Send_ChecksumHigh:
+            case Send_ChecksumLow:
+            case Send_NotHex:
+                expected[type].checksum++;
+                break;
+            case Send_Overlength:
+                expected[type].overlength++;
+                break;
+            default:
+                expectedFraming++;
+                break;
+        }
+        sent[how]++;
+
+        int before = positions + qualities + satellites;
+        double t0 = TEST_Seconds();
+        feed(text, len);
+        t += TEST_Seconds() - t0;
+        bytes += len;
+
+        if (how == Send_Intact && check) {
+            if (type == NMEA_Type_GPGLL) {
+                CHECK(positions + qualities + satellites == before + 1 && lastPos.valid == wantPos.valid
+                        && lastPos.latitude.degree == wantPos.latitude.degree
+                        && fabsf(lastPos.latitude.minute - wantPos.latitude.minute) < 1e-3f
+                        && lastPos.latitude.direction == wantPos.latitude.direction
+                        && lastPos.longitude.degree == wantPos.longitude.degree
+                        && fabsf(lastPos.longitude.minute - wantPos.longitude.minute) < 1e-3f
+                        && lastPos.longitude.direction == wantPos.longitude.direction
+                        && memcmp(&lastPos.time, &wantPos.time, sizeof(POS_Time)) == 0, "GLL %s", payload);
+            } else if (type == NMEA_Type_GNGSA) {
+                CHECK(lastQuality.satellites == wantQuality.satellites && lastQuality.hdop == wantQuality.hdop
+                        && (wantSvCount == 0 || (lastSvCount == wantSvCount
+                        && memcmp(lastSv, wantSv, wantSvCount * sizeof(NMEA_Satellite)) == 0)), "GSA %s", payload);
+            } else if (type == NMEA_Type_GPGSV) {
+                CHECK(lastSvCount == wantSvCount && memcmp(lastSv, wantSv, wantSvCount * sizeof(NMEA_Satellite)) == 0,
+                        "GSV %s", payload);
+            }
+        }
+        if (how != Send_Intact) {
+            CHECK(positions + qualities + satellites == before, "%s sentence parsed: %.*s", sendNames[how], len, text);
+        }
+    }
+    //a truncated last sentence is counted by the next start
+    feed("$", 1);
+    nmea.state = NMEA_State_IDLE;
+
+    for (uint8_t i = 0; i < NMEA_Type_Count; i++) {
+        NMEA_Counter *c = &nmea.counter[i];
+        CHECK(c->accepted == expected[i].accepted && c->checksum == expected[i].checksum
+                && c->overlength == expected[i].overlength, "%s: accepted %u/%u, checksum %u/%u, overlength %u/%u",
+                NMEA_GetTypeName(i), c->accepted, expected[i].accepted, c->checksum, expected[i].checksum,
+                c->overlength, expected[i].overlength);
+    }
+    CHECK(nmea.framing == expectedFraming, "framing %u, expected %u", nmea.framing, expectedFraming);
+    NMEA_ResetCounters(&nmea);
+    CHECK(nmea.counter[NMEA_Type_GPGLL].accepted == 0 && nmea.framing == 0, "reset");
+
+    printf("sentences");
+    for (uint8_t i = 0; i < Send_Count; i++) {
+        printf(" %u %s%s", sent[i], sendNames[i], i + 1 < Send_Count ? "," : "\n");
+    }
+    printf("callbacks %d positions, %d quality, %d satellites, %d unknown\n", positions, qualities, satellites,
+            unknowns);
+    printf("speed     %.1f Mbyte/s on the host, the receiver sends 9600 baud\n", bytes / t / 1e6);
+
+    return TEST_Result();
+}
+
+static int build(NMEA_Type type, char *line) {
+    static const char *const names[NMEA_Type_Count] = {
+        "GPXYZ", "GPGLL", "GNGLL", "GLGSB", "GPGSV", "GNGSA", "GNGGA", "GNVTG", "GNRMC"
+    };
+    int len = sprintf(line, "%s,", names[type]);
+
+    if (type == NMEA_Type_GPGLL) {
+        //ddmm.mmmmm,N,dddmm.mmmmm,E,hhmmss.ss,A,A
+        memset(&wantPos, 0, sizeof(wantPos));
+        wantPos.latitude.degree = TEST_Random() % 90;
+        wantPos.latitude.minute = (TEST_Random() % 6000000) / 100000.0f;
+        wantPos.latitude.direction = TEST_Random() & 1 ? POS_Latitude_Flag_N : POS_Latitude_Flag_S;
+        wantPos.longitude.degree = TEST_Random() % 180;
+        wantPos.longitude.minute = (TEST_Random() % 6000000) / 100000.0f;
+        wantPos.longitude.direction = TEST_Random() & 1 ? POS_Longitude_Flag_E : POS_Longitude_Flag_W;
+        wantPos.time.hour = TEST_Random() % 24;
+        wantPos.time.minute = TEST_Random() % 60;
+        wantPos.time.second = TEST_Random() % 60;
+        wantPos.time.split = TEST_Random() % 100;
+        wantPos.valid = TEST_Random() % 4 ? POS_Valid_Flag_Valid : POS_Valid_Flag_Invalid;
+        sprintf(line + len, "%02u%08.5f,%c,%03u%08.5f,%c,%02u%02u%02u.%02u,%c,A", wantPos.latitude.degree,
+                wantPos.latitude.minute, wantPos.latitude.direction == POS_Latitude_Flag_N ? 'N' : 'S',
+                wantPos.longitude.degree, wantPos.longitude.minute,
+                wantPos.longitude.direction == POS_Longitude_Flag_E ? 'E' : 'W', wantPos.time.hour,
+                wantPos.time.minute, wantPos.time.second, wantPos.time.split,
+                wantPos.valid == POS_Valid_Flag_Valid ? 'A' : 'V');
+        return 1;
+    } else if (type == NMEA_Type_GNGSA) {
+        //A,fix,12 prn fields,pdop,hdop,vdop,system
+        uint8_t fix = 1 + TEST_Random() % 3;
+        len += sprintf(line + len, "A,%u", fix);
+        memset(&wantQuality, 0, sizeof(wantQuality));
+        wantSvCount = 0;
+        for (uint8_t i = 0; i < 12; i++) {
+            if (TEST_Random() % 3 != 0) {
+                uint8_t prn = 1 + TEST_Random() % 96;
+                len += sprintf(line + len, ",%02u", prn);
+                wantSv[wantSvCount++] = (NMEA_Satellite){prn, -128, 0, 1};
+            } else {
+                len += sprintf(line + len, ",");
+            }
+        }
+        uint16_t hdop = TEST_Random() % 2000;
+        sprintf(line + len, ",%.2f,%u.%02u,1.50,1", hdop / 50.0, hdop / 100, hdop % 100);
+        wantQuality.satellites = fix < 2 ? 0 : wantSvCount;
+        wantQuality.hdop = fix < 2 ? 0 : hdop;
+        wantSvCount = fix < 2 ? 0 : wantSvCount;
+        return 1;
+    } else if (type == NMEA_Type_GPGSV) {
+        //sentences,number,in view,{prn,elevation,azimuth,cn0} x 1..4,signal
+        wantSvCount = 1 + TEST_Random() % 4;
+        len += sprintf(line + len, "3,1,%02u", (unsigned)(8 + TEST_Random() % 4));
+        for (uint8_t i = 0; i < wantSvCount; i++) {
+            uint8_t prn = 1 + TEST_Random() % 32;
+            int8_t elevation = TEST_Random() % 91;
+            uint8_t cn0 = TEST_Random() % 3 == 0 ? 0 : 10 + TEST_Random() % 40;
+            len += sprintf(line + len, ",%02u,%02d,%03u,", prn, elevation, (unsigned)(TEST_Random() % 360));
+            if (cn0 != 0) {
+                len += sprintf(line + len, "%02u", cn0);
+            }
+            wantSv[i] = (NMEA_Satellite){prn, elevation, cn0, 0};
+        }
+        sprintf(line + len, ",1");
+        return 1;
+    }
+
+    //other types are counted only
+    sprintf(line + len, "%06u.00,%u,%u.%u,M,,", (unsigned)(TEST_Random() % 240000), (unsigned)(TEST_Random() % 9),
+            (unsigned)(TEST_Random() % 99), (unsigned)(TEST_Random() % 10));
+    return 0;
+}
+
+static void feed(const char *text, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        NMEA_Process(&nmea, text[i]);
+    }
+}
@@ -0,0 +1,252 @@
+/**
+ * @file test_record.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the input recorder with random inputs of all sources; the decoded
+ * recording has to give back every recorded input with its tick, the inputs after the buffer is
+ * full have to be dropped and counted
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "record.h"
+#include "eeprom.h"
+
+#define RUNS            2000
+#define INPUTS_MAX      (4 * REC_SIZE)  //inputs offered per run, the buffer is full long before
+#define FAKE_EEPROM     (REC_EEPROM_OFFSET + 16 + REC_SIZE)
+
+/**
+ * @brief Input the recorder has to keep
+ *
+ */
+typedef struct {
+    REC_Source source;
+    uint32_t tick;
+    int32_t value;      //stream byte, key mask or conversion
+    uint16_t repeats;   //adc: repeats of the previous conversion before
+} Expected;
+
+//HAL tick read by the recorder
+volatile uint32_t uwTick;
+
+static Expected expected[INPUTS_MAX];
+static uint32_t expectedCount;
+static uint8_t eeprom[FAKE_EEPROM];
+
+/**
+ * @brief Offer random inputs until the buffer is full and some more; an input offered while or
+ * when the buffer becomes full is dropped
+ *
+ * @param mask recorded sources
+ * @return uint32_t expected count of dropped inputs
+ */
+static uint32_t offer(uint32_t mask);
+
+/**
+ * @brief Decode recording and compare it with the expected inputs
+ *
+ * @param run run for messages
+ * @return uint32_t bytes of stream records
+ */
+static uint32_t decode(int run);
+
+HAL_StatusTypeDef EEPROM_Read(uint16_t offset, uint8_t *data, uint16_t len) {
+    if (offset + len > FAKE_EEPROM) {
+        return HAL_ERROR;
+    }
+    memcpy(data, eeprom + offset, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEPROM_Write(uint16_t offset, const uint8_t *data, uint16_t len) {
+    if (offset + len > FAKE_EEPROM) {
+        return HAL_ERROR;
+    }
+    memcpy(eeprom + offset, data, len);
+    return HAL_OK;
+}
+
+int main(int argc, char **argv) {
+    int runs = RUNS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n runs] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    REC_Init();
+    CHECK(REC_GetMask() == REC_MASK_DEFAULT && REC_IsRunning() && !REC_IsFull(), "init");
+    for (REC_Source src = 0; src < REC_Source_Count; src++) {
+        CHECK(REC_GetName(src) != 0, "source %u without name", src);
+    }
+    CHECK(REC_GetName(REC_Source_Count) == 0, "name of invalid source");
+
+    uint64_t bytes = 0, inputs = 0, streamBytes = 0;
+    double t = 0;
+    for (int run = 0; run < runs && TEST_Failed < 20; run++) {
+        //every fourth run leaves a source out
+        uint32_t mask = run % 4 == 3 ? REC_MASK_DEFAULT & ~(1UL << (TEST_Random() % REC_Source_Count)) : REC_MASK_DEFAULT;
+        uwTick = TEST_Random();
+        REC_SetMask(mask);
+        REC_Restart();
+
+        double start = TEST_Seconds();
+        uint32_t dropped = offer(mask);
+        t += TEST_Seconds() - start;
+
+        uint16_t len;
+        REC_GetData(&len);
+        CHECK(REC_IsFull() && !REC_IsRunning() && len <= REC_SIZE, "run %d: full %u, running %u, %u bytes",
+              run, REC_IsFull(), REC_IsRunning(), len);
+        CHECK(REC_GetDropped() == dropped, "run %d: %u dropped, expected %u", run, REC_GetDropped(), dropped);
+        streamBytes += decode(run);
+        bytes += len;
+        inputs += expectedCount;
+    }
+
+    //save and load keep the recording, a restart clears it
+    uint16_t len;
+    const uint8_t *data = REC_GetData(&len);
+    uint8_t copy[REC_SIZE];
+    memcpy(copy, data, len);
+    uint32_t start = REC_GetStartTick();
+    CHECK(REC_Save(), "save");
+    REC_Restart();
+    uint16_t restarted;
+    REC_GetData(&restarted);
+    CHECK(restarted == 0 && REC_GetDropped() == 0 && !REC_IsFull(), "restart: %u bytes", restarted);
+    CHECK(REC_Load(), "load");
+    data = REC_GetData(&restarted);
+    CHECK(restarted == len && memcmp(data, copy, len) == 0 && REC_GetStartTick() == start && REC_IsFull(), "loaded recording");
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    CHECK(!REC_Load(), "load of erased eeprom");
+
+    printf("recorded  %llu inputs (%llu stream bytes) in %llu bytes, %.2f bytes per input\n", (unsigned long long)inputs,
+           (unsigned long long)streamBytes, (unsigned long long)bytes, inputs > 0 ? (double)bytes / inputs : 0);
+    printf("speed     %.1f Minputs/s on the host\n", t > 0 ? inputs / t / 1e6 : 0);
+    return TEST_Result();
+}
+
+static uint32_t offer(uint32_t mask) {
+    static const char *const sentences[] = {
+        "$GNGLL,4812.34567,N,01622.12345,E,100000.00,A,A*7C\r\n",
+        "$GNGSA,A,3,05,13,15,18,20,,,,,,,,1.94,1.18,1.54,1*04\r\n",
+        "$GPGSV,3,1,10,05,45,210,38,13,60,080,42,15,30,300,35,18,12,120,28,1*6A\r\n",
+    };
+    uint8_t keys = 0;
+    int32_t adc = 0;
+    uint16_t repeats = 0;
+    uint32_t dropped = 0;
+
+    expectedCount = 0;
+    //some more inputs after the buffer is full
+    for (uint32_t extra = 0; extra < 200 && expectedCount < INPUTS_MAX; extra += REC_IsFull()) {
+        //long pauses now and then (varint tick deltas)
+        uint32_t r = TEST_Random() % 100;
+        uwTick += r < 90 ? TEST_Random() % 40 : TEST_Random() % 200000;
+
+        REC_Source src = TEST_Random() % REC_Source_Count;
+        uint8_t selected = (mask & (1UL << src)) != 0;
+        Expected in = {src, uwTick, 0, 0};
+
+        if (src < REC_STREAMS) {
+            //nmea sentences (predicted after the first epoch) or random bytes, in the same or the next ms
+            const char *s = sentences[TEST_Random() % 3];
+            uint8_t random = TEST_Random() % 4 == 0;
+            uint16_t n = random ? 1 + TEST_Random() % 40 : strlen(s);
+            for (uint16_t i = 0; i < n; i++) {
+                in.value = random ? (uint8_t)TEST_Random() : (uint8_t)s[i];
+                in.tick = uwTick;
+                REC_Byte(src, in.value);
+                if (selected && REC_IsFull()) {
+                    dropped++;
+                } else if (selected && expectedCount < INPUTS_MAX) {
+                    expected[expectedCount++] = in;
+                }
+                uwTick += TEST_Random() % 4 == 0;
+            }
+        } else if (src == REC_Source_Keys) {
+            uint8_t key = TEST_Random() % 8;
+            uint8_t state = TEST_Random() % 2;
+            uint8_t next = state ? keys | (1 << key) : keys & ~(1 << key);
+            REC_Key(key, state);
+            if (selected && next != keys) {
+                if (REC_IsFull()) {
+                    dropped++;
+                } else {
+                    in.value = keys = next;
+                    expected[expectedCount++] = in;
+                }
+            }
+        } else {
+            //battery conversions mostly repeat, only a change is a record
+            int32_t value = TEST_Random() % 4 == 0 ? (int32_t)(TEST_Random() % 4096) - 100 : adc;
+            REC_Adc(value);
+            if (selected && value == adc) {
+                repeats++;
+            } else if (selected && REC_IsFull()) {
+                dropped++;
+            } else if (selected) {
+                in.value = adc = value;
+                in.repeats = repeats;
+                repeats = 0;
+                expected[expectedCount++] = in;
+            }
+        }
+    }
+    return dropped;
+}
+
+static uint32_t decode(int run) {
+    uint16_t len;
+    const uint8_t *data = REC_GetData(&len);
+    REC_Reader reader;
+    REC_Input input;
+    uint32_t idx = 0;
+    uint32_t streamBytes = 0;
+
+    REC_ReaderInit(&reader, data, len, REC_GetStartTick());
+    while (REC_Next(&reader, &input) && idx < expectedCount) {
+        Expected *e = &expected[idx];
+        if (input.source < REC_STREAMS) {
+            //bytes of one source in order, the record has the tick of its last byte and the span from the first
+            uint32_t first = e->tick;
+            for (uint16_t i = 0; i < input.count && idx < expectedCount; i++) {
+                e = &expected[idx++];
+                CHECK(e->source == input.source && e->value == input.data[i], "run %d: %s byte %u of %u is %s 0x%02X",
+                      run, REC_GetName(input.source), i, input.count, REC_GetName(e->source), e->value);
+            }
+            CHECK(input.tick == e->tick && input.tick - input.span == first, "run %d: %s record at %u, span %u, bytes %u .. %u",
+                  run, REC_GetName(input.source), input.tick, input.span, first, e->tick);
+            streamBytes += input.count;
+        } else {
+            idx++;
+            CHECK(e->source == input.source && e->value == input.value && e->tick == input.tick && e->repeats == input.count,
+                  "run %d: %s %d at %u after %u repeats, expected %s %d at %u after %u", run, REC_GetName(input.source),
+                  input.value, input.tick, input.count, REC_GetName(e->source), e->value, e->tick, e->repeats);
+        }
+        if (TEST_Failed > 20) {
+            return streamBytes;
+        }
+    }
+    CHECK(reader.pos == len && idx == expectedCount, "run %d: decoded %u of %u bytes, %u of %u inputs",
+          run, reader.pos, len, idx, expectedCount);
+    return streamBytes;
+}
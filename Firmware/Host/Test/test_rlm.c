@@ -0,0 +1,321 @@
+/**
+ * @file test_rlm.c
+ * @author Paul Götzinger
+ * @brief Host tool: return link test. Synthesized Galileo I/NAV page pairs of several satellites are
+ * sent as UBX-RXM-SFRBX frames through ubx.c into the rlm decoder, with messages for this and other
+ * beacons, alert pages, CRC and UBX checksum errors
+ * @version 1.0
+ * @date 2019-04-05
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "ubx.h"
+#include "rlm.h"
+#include "plb.h"
+
+#define PAGE_BITS       256     //even and odd page part in 8 words
+#define ODD             128
+#define SFRBX_LEN       (8 + 8 * 4)
+#define FRAME_LEN       (SFRBX_LEN + 8)
+#define SATELLITES      3       //in view and sending at the same time
+#define MAX_MESSAGES    16384
+#define CRC24Q_CHECK    0xCDE703UL  //CRC-24Q of "123456789"
+
+/**
+ * @brief Message sent by the simulated ground segment
+ *
+ */
+typedef struct {
+    uint64_t id;        //addressed beacon
+    uint8_t code;
+    uint16_t param;
+    uint8_t longMsg;
+    uint8_t broken;     //a page was lost or corrupted
+} Message;
+
+/**
+ * @brief Pages in flight of one satellite
+ *
+ */
+typedef struct {
+    uint8_t svId;
+    int msg;            //message index, -1 between messages
+    uint8_t page;       //next page of message
+    uint8_t bits[160];  //message bits
+} Satellite;
+
+static Message messages[MAX_MESSAGES];
+static int messageCount;
+static int received[MAX_MESSAGES];  //callbacks per message
+static uint16_t lastParam;
+static uint8_t lastCode;
+static int callbacks;
+
+static UBX_Instance ubx;
+static RLM_Instance rlm;
+static uint64_t beaconId;
+static uint32_t framesSent, pagesCorrupted, framesCorrupted, alertPages;
+
+/**
+ * @brief CRC-24Q over bits (bit serial, independent of rlm.c)
+ *
+ * @param bits bits, one per byte
+ * @param len count of bits
+ * @return uint32_t crc
+ */
+static uint32_t crc24q(const uint8_t *bits, uint16_t len);
+
+/**
+ * @brief Build page pair and send it as UBX-RXM-SFRBX frame byte by byte
+ *
+ * @param svId satellite
+ * @param sar 22 bit SAR field (start, long, 20 data bits)
+ * @param alert alert page instead of nominal
+ * @param corruptPage flip a bit after the crc was calculated
+ * @param corruptFrame wrong UBX checksum
+ */
+static void sendPage(uint8_t svId, uint32_t sar, uint8_t alert, uint8_t corruptPage, uint8_t corruptFrame);
+
+/**
+ * @brief SFRBX callback of ubx.c, as in the location module
+ *
+ */
+static void sfrbxCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data);
+
+/**
+ * @brief RLM callback
+ *
+ */
+static void rlmCallback(RLM_Code code, uint16_t param);
+
+/**
+ * @brief Run satellites sending messages, some to this beacon
+ *
+ * @param pages page pairs per satellite
+ * @param satellites satellites sending in turn
+ * @param errors probability of a page error in 1/1000
+ */
+static void run(int pages, int satellites, int errors);
+
+static uint32_t crc24q(const uint8_t *bits, uint16_t len) {
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        uint32_t feedback = ((crc >> 23) ^ bits[i]) & 1;
+        crc = (crc << 1) & 0xFFFFFF;
+        if (feedback) {
+            crc ^= 0x864CFB;
+        }
+    }
+    return crc;
+}
+
+static void sendPage(uint8_t svId, uint32_t sar, uint8_t alert, uint8_t corruptPage, uint8_t corruptFrame) {
+    uint8_t bits[PAGE_BITS];
+
+    //even part: even/odd 0, page type, data; odd part: even/odd 1, page type, data, reserved, SAR, spare
+    for (uint16_t i = 0; i < PAGE_BITS; i++) {
+        bits[i] = TEST_Random() & 1;
+    }
+    bits[0] = 0;
+    bits[1] = alert;
+    bits[ODD] = 1;
+    bits[ODD + 1] = alert;
+    for (uint8_t i = 0; i < 22; i++) {
+        bits[ODD + 58 + i] = (sar >> (21 - i)) & 1;
+    }
+
+    //crc over the 114 bits of the even part and the first 82 bits of the odd part
+    uint8_t crcBits[114 + 82];
+    memcpy(crcBits, bits, 114);
+    memcpy(crcBits + 114, bits + ODD, 82);
+    uint32_t crc = crc24q(crcBits, sizeof(crcBits));
+    for (uint8_t i = 0; i < 24; i++) {
+        bits[ODD + 82 + i] = (crc >> (23 - i)) & 1;
+    }
+    if (corruptPage) {
+        bits[2 + TEST_Random() % 110] ^= 1;
+    }
+
+    uint8_t frame[FRAME_LEN] = {0xB5, 0x62, 0x02, 0x13, SFRBX_LEN, 0,
+            UBX_GnssId_Galileo, svId, 1, 0, 8, 0, 2, 0};
+    for (uint16_t i = 0; i < PAGE_BITS; i++) {
+        //words little endian, bit 0 is the MSB of word 0
+        uint8_t bit = 31 - (i & 31);
+        frame[6 + 8 + (i >> 5) * 4 + (bit >> 3)] |= bits[i] << (bit & 7);
+    }
+    uint8_t a = 0, b = 0;
+    for (uint16_t i = 2; i < FRAME_LEN - 2; i++) {
+        a += frame[i];
+        b += a;
+    }
+    frame[FRAME_LEN - 2] = a ^ corruptFrame;
+    frame[FRAME_LEN - 1] = b;
+
+    for (uint16_t i = 0; i < FRAME_LEN; i++) {
+        UBX_Process(&ubx, frame[i]);
+    }
+    framesSent++;
+}
+
+static void sfrbxCallback(UBX_Class msgClass, uint8_t id, UBX_DataPtr data) {
+    if (data.sfrbx != 0 && data.sfrbx->gnssId == UBX_GnssId_Galileo) {
+        RLM_ProcessPage(&rlm, data.sfrbx->svId, data.sfrbx->words, data.sfrbx->numWords, HAL_GetTick());
+    }
+}
+
+static void rlmCallback(RLM_Code code, uint16_t param) {
+    lastCode = code;
+    lastParam = param;
+    callbacks++;
+}
+
+static void run(int pages, int satellites, int errors) {
+    Satellite sat[8];
+
+    for (int s = 0; s < satellites; s++) {
+        sat[s].svId = 1 + s * 3;
+        sat[s].msg = -1;
+    }
+
+    for (int p = 0; p < pages * satellites; p++) {
+        Satellite *sv = &sat[p % satellites];
+        TEST_Tick += 2000 / satellites;
+
+        //between messages: alert pages or a dummy start (id 0)
+        if (sv->msg < 0) {
+            if (TEST_Random() % 10 == 0) {
+                alertPages++;
+                sendPage(sv->svId, TEST_Random(), 1, 0, 0);
+                continue;
+            }
+            if (messageCount < MAX_MESSAGES && TEST_Random() % 2 == 0) {
+                Message *m = &messages[messageCount];
+                sv->msg = messageCount++;
+                sv->page = 0;
+                m->id = TEST_Random() % 3 == 0 ? (TEST_Random() & 0x0FFFFFFFFFFFFFFFULL) : beaconId;
+                m->code = TEST_Random() % 4 == 0 ? RLM_Code_Test : RLM_Code_Ack;
+                m->param = TEST_Random();
+                m->longMsg = TEST_Random() % 4 == 0;
+                memset(sv->bits, 0, sizeof(sv->bits));
+                for (uint8_t i = 0; i < 160; i++) {
+                    if (i < 60) {
+                        sv->bits[i] = (m->id >> (59 - i)) & 1;
+                    } else if (i < 64) {
+                        sv->bits[i] = (m->code >> (63 - i)) & 1;
+                    } else if (i < 80) {
+                        sv->bits[i] = (m->param >> (79 - i)) & 1;
+                    } else {
+                        sv->bits[i] = TEST_Random() & 1;
+                    }
+                }
+            } else {
+                sendPage(sv->svId, 1UL << 21, 0, 0, 0);
+                continue;
+            }
+        }
+
+        Message *m = &messages[sv->msg];
+        uint32_t sar = (sv->page == 0) << 21 | m->longMsg << 20;
+        for (uint8_t i = 0; i < 20; i++) {
+            sar |= (uint32_t)sv->bits[sv->page * 20 + i] << (19 - i);
+        }
+        uint8_t error = (int)(TEST_Random() % 1000) < errors;
+        uint8_t corruptPage = error && (TEST_Random() & 1);
+        uint8_t corruptFrame = error && !corruptPage;
+        pagesCorrupted += corruptPage;
+        framesCorrupted += corruptFrame;
+        m->broken |= error;
+
+        int before = callbacks;
+        sendPage(sv->svId, sar, 0, corruptPage, corruptFrame);
+        if (callbacks != before) {
+            received[sv->msg]++;
+            CHECK(lastCode == m->code && lastParam == m->param, "message %d: code %u param 0x%04X", sv->msg,
+                    lastCode, lastParam);
+        }
+        if (++sv->page == (m->longMsg ? 8 : 4)) {
+            sv->msg = -1;
+        }
+    }
+
+    //messages cut off at the end of the run are incomplete
+    for (int s = 0; s < satellites; s++) {
+        if (sat[s].msg >= 0) {
+            messages[sat[s].msg].broken = 1;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int pages = 20000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                pages = atoi(optarg);
+                break;
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n page pairs per satellite] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    CHECK(crc24q((const uint8_t[72]){
+        0,0,1,1,0,0,0,1, 0,0,1,1,0,0,1,0, 0,0,1,1,0,0,1,1, 0,0,1,1,0,1,0,0, 0,0,1,1,0,1,0,1,
+        0,0,1,1,0,1,1,0, 0,0,1,1,0,1,1,1, 0,0,1,1,1,0,0,0, 0,0,1,1,1,0,0,1}, 72) == CRC24Q_CHECK,
+        "crc24q check value");
+
+    //beacon id as the firmware derives it
+    PLB_Identity id = {.protocolFlag = 1, .countryCode = 203, .testProtocol = 0b110, .beaconType = 0b011,
+            .serialNumber = 0x1A2B3, .certifNumber = 0x155, .radiolocating = 0b01};
+    PLB_Init(&id);
+    beaconId = PLB_GetBeaconId(&id);
+
+    UBX_Init(&ubx);
+    UBX_SetCallback(&ubx, sfrbxCallback, UBX_Class_RXM, UBX_Id_Rxm_Sfrbx);
+    RLM_Init(&rlm, beaconId, rlmCallback);
+
+    //error free, then 2 % of the pages with crc or ubx checksum errors
+    double t0 = TEST_Seconds();
+    run(pages / 2, SATELLITES, 0);
+    run(pages / 2, SATELLITES, 20);
+    double t = TEST_Seconds() - t0;
+
+    int own = 0, intact = 0, delivered = 0, wrong = 0;
+    for (int m = 0; m < messageCount; m++) {
+        uint8_t mine = messages[m].id == beaconId;
+        own += mine;
+        intact += mine && !messages[m].broken;
+        delivered += received[m];
+        if (mine && !messages[m].broken) {
+            CHECK(received[m] == 1, "message %d for this beacon received %d times", m, received[m]);
+        } else if (!mine) {
+            wrong += received[m];
+        }
+    }
+    CHECK(wrong == 0, "%d messages for other beacons delivered", wrong);
+    CHECK(rlm.crcErrors == pagesCorrupted, "crc errors %u, corrupted pages %u", rlm.crcErrors, pagesCorrupted);
+    CHECK(rlm.pages == framesSent - pagesCorrupted - framesCorrupted - alertPages, "valid pages %u of %u frames",
+            rlm.pages, framesSent);
+
+    printf("pages     %u sent, %u valid, %u alert, %u crc errors, %u ubx checksum errors\n", framesSent, rlm.pages,
+            alertPages, rlm.crcErrors, framesCorrupted);
+    printf("messages  %d sent, %d for this beacon (%d intact), %d delivered, 0x%015llX\n", messageCount, own, intact,
+            delivered, (unsigned long long)beaconId);
+    printf("memory    %u bytes decoder state (%u slots), %u bytes ubx instance\n", (unsigned)sizeof(rlm),
+            RLM_SLOT_COUNT, (unsigned)sizeof(ubx));
+    printf("speed     %.0f pages/s on the host (ubx parsing, crc and assembly), a satellite sends a page pair every 2 s\n",
+            framesSent / t);
+
+    return TEST_Result();
+}
@@ -0,0 +1,288 @@
+/**
+ * @file test_satellite.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the satellite table and the time to fix prediction with scripted
+ * sky views and random epochs compared to a reference model
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "satellite.h"
+
+#define EPOCHS          100000
+#define POOL            SAT_TABLE_SIZE  //prns of the random epochs, the table never overflows
+#define FIRST_PRN       65              //random epochs use GLONASS numbering
+
+/**
+ * @brief Reference entry of the random epochs
+ *
+ */
+typedef struct {
+    uint8_t alive;
+    uint8_t age;
+    uint8_t cn0;
+    uint8_t used;
+} RefEntry;
+
+static SAT_Table table;
+static RefEntry ref[POOL];
+static uint16_t refDecodeEpochs;
+
+/**
+ * @brief Report satellites with the same C/N0 and end the epoch
+ *
+ * @param first first prn
+ * @param count count of satellites
+ * @param cn0 C/N0 in dBHz
+ * @param used count of them used in the fix
+ * @return SAT_Prediction* prediction
+ */
+static SAT_Prediction* epoch(uint8_t first, uint8_t count, uint8_t cn0, uint8_t used);
+
+/**
+ * @brief Search entry of satellite in the table
+ *
+ * @param prn satellite number
+ * @return SAT_Entry* entry, 0 if not in the table
+ */
+static SAT_Entry* lookup(uint8_t prn);
+
+/**
+ * @brief Scripted sky views: classification, time to fix count down, aging and used flags
+ *
+ */
+static void testSky(void);
+
+/**
+ * @brief More satellites than entries: the oldest and then the weakest entry is replaced
+ *
+ */
+static void testOverflow(void);
+
+/**
+ * @brief Random epochs compared to the reference model
+ *
+ * @param count count of epochs
+ */
+static void testRandom(int count);
+
+int main(int argc, char **argv) {
+    int count = EPOCHS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n epochs] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    testSky();
+    testOverflow();
+    testRandom(count);
+
+    return TEST_Result();
+}
+
+static SAT_Prediction* epoch(uint8_t first, uint8_t count, uint8_t cn0, uint8_t used) {
+    for (uint8_t i = 0; i < count; i++) {
+        SAT_Report(&table, first + i, 45, cn0);
+    }
+    for (uint8_t i = 0; i < used; i++) {
+        SAT_MarkUsed(&table, first + i);
+    }
+    SAT_EndEpoch(&table);
+    return SAT_GetPrediction(&table);
+}
+
+static SAT_Entry* lookup(uint8_t prn) {
+    for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+        if (table.sv[i].prn == prn) {
+            return &table.sv[i];
+        }
+    }
+    return 0;
+}
+
+static void testSky(void) {
+    SAT_Init(&table);
+    SAT_Prediction *p = SAT_GetPrediction(&table);
+    CHECK(p->sky == SAT_Sky_Unknown && p->ttff == SAT_TTFF_NEVER, "init: sky %s, ttff %u", SAT_GetSkyName(p->sky), p->ttff);
+
+    //three strong satellites are not enough
+    p = epoch(1, 3, 45, 0);
+    CHECK(p->sky == SAT_Sky_Blocked && p->ttff == SAT_TTFF_NEVER && p->visible == 3,
+          "3 strong: sky %s, ttff %u, visible %u", SAT_GetSkyName(p->sky), p->ttff, p->visible);
+
+    //trackable, but the data bits get lost: several ephemeris broadcasts
+    SAT_Init(&table);
+    p = epoch(1, 6, SAT_CN0_TRACK, 0);
+    CHECK(p->sky == SAT_Sky_Weak && p->ttff > SAT_EPHEMERIS_TIME && p->ttff != SAT_TTFF_NEVER && p->decodable == 0,
+          "6 weak: sky %s, ttff %u, decodable %u", SAT_GetSkyName(p->sky), p->ttff, p->decodable);
+    p = epoch(1, 6, SAT_CN0_TRACK - 1, 0);
+    CHECK(p->sky == SAT_Sky_Blocked, "6 below tracking: sky %s", SAT_GetSkyName(p->sky));
+
+    //decodable: the estimate counts down to the end of the ephemeris broadcast
+    SAT_Init(&table);
+    uint16_t last = SAT_TTFF_NEVER;
+    for (uint16_t n = 1; n <= SAT_EPHEMERIS_TIME + 5; n++) {
+        p = epoch(1, SAT_FIX_MIN, SAT_CN0_DECODE, 0);
+        uint16_t want = n < SAT_EPHEMERIS_TIME ? SAT_EPHEMERIS_TIME - n : 1;
+        CHECK(p->sky == SAT_Sky_Good && p->ttff == want && p->ttff <= last,
+              "decodable epoch %u: sky %s, ttff %u, expected %u", n, SAT_GetSkyName(p->sky), p->ttff, want);
+        last = p->ttff;
+    }
+
+    //a weak epoch restarts the count down
+    p = epoch(1, SAT_FIX_MIN, SAT_CN0_DECODE - 1, 0);
+    CHECK(p->sky == SAT_Sky_Weak, "drop to weak: sky %s", SAT_GetSkyName(p->sky));
+    p = epoch(1, SAT_FIX_MIN, SAT_CN0_DECODE, 0);
+    CHECK(p->ttff == SAT_EPHEMERIS_TIME - 1, "restarted count down: ttff %u", p->ttff);
+
+    //fix; the used flags only hold for the epoch they were reported in
+    p = epoch(1, 8, 40, SAT_FIX_MIN);
+    CHECK(p->sky == SAT_Sky_Fix && p->ttff == 0 && p->used == SAT_FIX_MIN && p->visible == 8,
+          "fix: sky %s, ttff %u, used %u, visible %u", SAT_GetSkyName(p->sky), p->ttff, p->used, p->visible);
+    p = epoch(1, 8, 40, SAT_FIX_MIN - 1);
+    CHECK(p->sky == SAT_Sky_Good && p->used == SAT_FIX_MIN - 1, "fix lost: sky %s, used %u", SAT_GetSkyName(p->sky), p->used);
+
+    //a satellite reported by GSV and GSA is counted once
+    SAT_Init(&table);
+    for (uint8_t i = 0; i < SAT_FIX_MIN; i++) {
+        SAT_MarkUsed(&table, 10 + i);
+        SAT_Report(&table, 10 + i, 30, 38);
+        SAT_Report(&table, 10 + i, 30, 38);
+    }
+    SAT_EndEpoch(&table);
+    p = SAT_GetPrediction(&table);
+    CHECK(p->visible == SAT_FIX_MIN && p->used == SAT_FIX_MIN && p->sky == SAT_Sky_Fix,
+          "duplicate reports: visible %u, used %u, sky %s", p->visible, p->used, SAT_GetSkyName(p->sky));
+    SAT_Entry *sv = lookup(10);
+    CHECK(sv != 0 && sv->elevation == 30 && sv->cn0 == 38, "entry fields");
+    SAT_MarkUsed(&table, 20);
+    SAT_EndEpoch(&table);
+    sv = lookup(20);
+    CHECK(sv != 0 && sv->elevation == SAT_ELEVATION_UNKNOWN, "gsa only: elevation %d", sv != 0 ? sv->elevation : 0);
+
+    //satellites no longer reported are kept SAT_MAX_AGE epochs
+    SAT_Init(&table);
+    epoch(1, 6, 40, 0);
+    for (uint8_t n = 1; n <= SAT_MAX_AGE + 1; n++) {
+        p = epoch(1, 2, 40, 0);
+        uint8_t want = n <= SAT_MAX_AGE ? 6 : 2;
+        CHECK(p->visible == want && (lookup(5) != 0) == (want == 6), "aging epoch %u: visible %u, expected %u", n, p->visible, want);
+    }
+
+    //invalid arguments
+    SAT_Report(0, 1, 0, 0);
+    SAT_MarkUsed(0, 1);
+    SAT_EndEpoch(0);
+    SAT_Report(&table, 0, 10, 40);
+    CHECK(lookup(0) == 0 || lookup(0)->prn == 0, "prn 0 accepted");
+    CHECK(SAT_GetPrediction(0) == 0 && SAT_GetSkyName((SAT_Sky)(SAT_Sky_Fix + 1)) == 0, "invalid arguments");
+}
+
+static void testOverflow(void) {
+    SAT_Init(&table);
+
+    //a full table of satellites of 20 .. 43 dBHz, then 4 of them are no longer reported
+    for (uint8_t i = 0; i < SAT_TABLE_SIZE; i++) {
+        SAT_Report(&table, 1 + i, 20, 20 + i);
+    }
+    SAT_EndEpoch(&table);
+    for (uint8_t i = 4; i < SAT_TABLE_SIZE; i++) {
+        SAT_Report(&table, 1 + i, 20, 20 + i);
+    }
+    SAT_EndEpoch(&table);
+
+    //new satellites replace the unreported ones first, weakest first, then the weakest reported ones
+    for (uint8_t i = 0; i < 6; i++) {
+        SAT_Report(&table, 100 + i, 20, 45);
+    }
+    for (uint8_t prn = 1; prn <= 6; prn++) {
+        CHECK(lookup(prn) == 0, "overflow: prn %u should be replaced", prn);
+    }
+    for (uint8_t prn = 7; prn <= SAT_TABLE_SIZE; prn++) {
+        CHECK(lookup(prn) != 0, "overflow: prn %u should be kept", prn);
+    }
+    for (uint8_t i = 0; i < 6; i++) {
+        CHECK(lookup(100 + i) != 0, "overflow: prn %u missing", 100 + i);
+    }
+    SAT_EndEpoch(&table);
+    CHECK(table.prediction.visible == SAT_TABLE_SIZE, "overflow: visible %u", table.prediction.visible);
+}
+
+static void testRandom(int count) {
+    SAT_Init(&table);
+    memset(ref, 0, sizeof(ref));
+    refDecodeEpochs = 0;
+    uint32_t skies[SAT_Sky_Fix + 1] = {0};
+
+    double t = TEST_Seconds();
+    for (int n = 0; n < count; n++) {
+        //random count of reported satellites, some of them missing, C/N0 around a random sky strength
+        uint8_t reported = TEST_Random() % (POOL + 1);
+        uint8_t strength = TEST_Random() % 4;
+        uint8_t used = 0;
+        for (uint8_t i = 0; i < POOL; i++) {
+            ref[i].used = 0;
+            if (i < reported && TEST_Random() % 8 != 0) {
+                uint8_t cn0 = strength * 10 + TEST_Random() % 20;
+                uint8_t mark = cn0 >= SAT_CN0_DECODE && strength == 3 && TEST_Random() % 2;
+                if (mark) {
+                    SAT_MarkUsed(&table, FIRST_PRN + i);
+                }
+                SAT_Report(&table, FIRST_PRN + i, TEST_Random() % 91, cn0);
+                ref[i] = (RefEntry){1, 0, cn0, mark};
+                used += mark;
+            } else if (ref[i].alive && ++ref[i].age > SAT_MAX_AGE) {
+                ref[i].alive = 0;
+            }
+        }
+        SAT_EndEpoch(&table);
+
+        uint8_t visible = 0, decodable = 0, trackable = 0;
+        for (uint8_t i = 0; i < POOL; i++) {
+            visible += ref[i].alive;
+            decodable += ref[i].alive && ref[i].cn0 >= SAT_CN0_DECODE;
+            trackable += ref[i].alive && ref[i].cn0 >= SAT_CN0_TRACK;
+        }
+        SAT_Sky sky = used >= SAT_FIX_MIN ? SAT_Sky_Fix : decodable >= SAT_FIX_MIN ? SAT_Sky_Good
+                : trackable >= SAT_FIX_MIN ? SAT_Sky_Weak : SAT_Sky_Blocked;
+        if (sky == SAT_Sky_Good) {
+            refDecodeEpochs++;
+        } else if (sky != SAT_Sky_Fix) {
+            refDecodeEpochs = 0;
+        }
+
+        SAT_Prediction *p = SAT_GetPrediction(&table);
+        CHECK(p->sky == sky && p->visible == visible && p->decodable == decodable && p->used == used,
+              "epoch %d: sky %s/%s, visible %u/%u, decodable %u/%u, used %u/%u", n, SAT_GetSkyName(p->sky),
+              SAT_GetSkyName(sky), p->visible, visible, p->decodable, decodable, p->used, used);
+        CHECK(sky != SAT_Sky_Good || p->ttff == (refDecodeEpochs < SAT_EPHEMERIS_TIME ? SAT_EPHEMERIS_TIME - refDecodeEpochs : 1),
+              "epoch %d: ttff %u after %u decodable epochs", n, p->ttff, refDecodeEpochs);
+        skies[p->sky]++;
+        if (TEST_Failed > 20) {
+            break;
+        }
+    }
+    t = TEST_Seconds() - t;
+
+    printf("epochs    %d: %u blocked, %u weak, %u good, %u fix\n", count, skies[SAT_Sky_Blocked], skies[SAT_Sky_Weak],
+           skies[SAT_Sky_Good], skies[SAT_Sky_Fix]);
+    printf("speed     %.0f epochs/s on the host, the receiver reports 1 epoch/s\n", count / t);
+}
@@ -0,0 +1,426 @@
+/**
+ * @file test_sgb.c
+ * @author Paul Götzinger
+ * @brief Host tool: reference decoder of the second generation beacon chip stream. Despreads the
+ * radio fifo bytes of sgb.c with a bit serial PRN generator, corrects errors with a BCH(250,202)
+ * decoder (Berlekamp-Massey, Chien search) and compares the decoded fields with the input
+ * @version 1.0
+ * @date 2019-04-05
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "sgb.h"
+
+#define BURST_PAIRS     (SGB_BURST_BITS / 2)
+#define CHANNEL_CHIPS   (BURST_PAIRS * SGB_CHIPS_PER_BIT)
+#define BCH_T           6       //errors corrected by BCH(250,202)
+#define BCH_N           255     //length of the unshortened code
+#define GF_SIZE         256
+
+//generator polynomial of C/S T.018 (degree 48, highest power first)
+static const char *const generator = "1110001111110101110000101110111110011110010010111";
+
+/**
+ * @brief Message at 48 deg 47.589' N, 69 deg 0.5256' E, laid out by hand after the field table of
+ * C/S T.018: TAC 65535 (1-16), serial 13371 (17-30), country 203 (31-40), homing, no rls, normal
+ * operation (41-43), location 0 0110000 110010110000110 0 01000101 000000100011111 (44-90), no
+ * vessel id (91-137), PLB (138-140), spare all 1 (141-154), rotating field #0 (155-202) with
+ * altitude, DOP and battery not available and a gnss fix, BCH parity (203-250)
+ */
+static const uint8_t vector[SGB_MSG_LENGTH] = {
+    0xFF, 0xFF, 0xD0, 0xEC, 0xCB, 0x86, 0x19, 0x61, 0x88, 0xA0, 0x47, 0xC0, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x2F, 0xFF, 0xC0, 0x00, 0x01, 0xFF, 0xFF, 0x9D, 0x0D, 0xA9, 0xCC, 0xBB, 0x7B, 0x96, 0x80
+};
+
+//identification of the vector, the defaults of the configuration
+static const SGB_Identity identity = {.tacNumber = 0xFFFF, .serialNumber = 13371, .countryCode = 203, .homing = 1,
+        .rls = 0};
+
+static uint8_t gfExp[2 * GF_SIZE];
+static uint8_t gfLog[GF_SIZE];
+
+/**
+ * @brief Build tables of the GF(2^8) in which the generator has the roots a^1 .. a^12
+ *
+ * @return int field polynomial, 0 if the generator is no 6 error correcting BCH code
+ */
+static int setupField(void);
+
+/**
+ * @brief Evaluate a binary polynomial (highest power first) at a^power
+ *
+ * @param bits coefficients, one per byte
+ * @param len count of coefficients
+ * @param power exponent of a
+ * @return uint8_t value
+ */
+static uint8_t evaluate(const uint8_t *bits, uint16_t len, uint16_t power);
+
+/**
+ * @brief Multiply in GF(2^8)
+ *
+ * @param a factor
+ * @param b factor
+ * @return uint8_t product
+ */
+static uint8_t gfMul(uint8_t a, uint8_t b);
+
+/**
+ * @brief Correct a received codeword
+ *
+ * @param code 250 bits, one per byte, corrected in place
+ * @return int corrected errors, -1 if not correctable
+ */
+static int bchDecode(uint8_t *code);
+
+/**
+ * @brief Despread the fifo bytes of a burst
+ *
+ * @param stream fifo bytes (SGB_STREAM_LENGTH)
+ * @param chipErrors probability of a flipped chip, in 1/65536
+ * @param bits burst bits, filled (SGB_BURST_BITS)
+ * @return uint32_t chips that disagreed with the decided bit
+ */
+static uint32_t despread(const uint8_t *stream, uint32_t chipErrors, uint8_t *bits);
+
+/**
+ * @brief Read field of the information bits (numbering of C/S T.018, first bit is 1)
+ *
+ * @param info information bits, one per byte
+ * @param first first bit
+ * @param last last bit
+ * @return uint32_t value
+ */
+static uint32_t field(const uint8_t *info, uint8_t first, uint8_t last);
+
+/**
+ * @brief Create message and chip stream, fetched in random block sizes
+ *
+ * @param pos position
+ * @param msg packed message, filled
+ * @param stream fifo bytes, filled
+ */
+static void createBurst(POS_Position *pos, uint8_t *msg, uint8_t *stream);
+
+/**
+ * @brief Check the decoded fields against the position of the burst
+ *
+ * @param info information bits
+ * @param pos position
+ */
+static void checkFields(const uint8_t *info, const POS_Position *pos);
+
+/**
+ * @brief Compare the message of the vector position with the vector
+ *
+ */
+static void checkVector(void);
+
+static int setupField(void) {
+    uint8_t g[SGB_BCH_BITS + 1];
+    for (uint8_t i = 0; i <= SGB_BCH_BITS; i++) {
+        g[i] = generator[i] - '0';
+    }
+
+    for (int poly = 0x101; poly < 0x200; poly += 2) {
+        //a has to be primitive: order 255
+        int x = 1;
+        for (int i = 0; i < BCH_N; i++) {
+            gfExp[i] = gfExp[i + BCH_N] = x;
+            gfLog[x] = i;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= poly;
+            }
+            if (x == 1 && i < BCH_N - 1) {
+                break;
+            }
+        }
+        if (x != 1) {
+            continue;
+        }
+        uint8_t roots = 0;
+        for (uint8_t i = 1; i <= 2 * BCH_T; i++) {
+            roots += evaluate(g, SGB_BCH_BITS + 1, i) == 0;
+        }
+        if (roots == 2 * BCH_T) {
+            return poly;
+        }
+    }
+    return 0;
+}
+
+static uint8_t evaluate(const uint8_t *bits, uint16_t len, uint16_t power) {
+    uint8_t value = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        if (bits[i]) {
+            value ^= gfExp[(power * (len - 1 - i)) % BCH_N];
+        }
+    }
+    return value;
+}
+
+static uint8_t gfMul(uint8_t a, uint8_t b) {
+    return a == 0 || b == 0 ? 0 : gfExp[gfLog[a] + gfLog[b]];
+}
+
+static int bchDecode(uint8_t *code) {
+    uint8_t s[2 * BCH_T];
+    uint8_t any = 0;
+    for (uint8_t i = 0; i < 2 * BCH_T; i++) {
+        s[i] = evaluate(code, SGB_MSG_BITS, i + 1);
+        any |= s[i];
+    }
+    if (!any) {
+        return 0;
+    }
+
+    //Berlekamp-Massey: error locator lambda
+    uint8_t lambda[2 * BCH_T + 1] = {1}, prev[2 * BCH_T + 1] = {1}, tmp[2 * BCH_T + 1];
+    uint8_t order = 0, shift = 1, b = 1;
+    for (uint8_t n = 0; n < 2 * BCH_T; n++) {
+        uint8_t d = s[n];
+        for (uint8_t i = 1; i <= order; i++) {
+            d ^= gfMul(lambda[i], s[n - i]);
+        }
+        if (d == 0) {
+            shift++;
+            continue;
+        }
+        uint8_t coef = gfExp[(gfLog[d] + BCH_N - gfLog[b]) % BCH_N];
+        memcpy(tmp, lambda, sizeof(tmp));
+        for (uint8_t i = 0; i + shift <= 2 * BCH_T; i++) {
+            lambda[i + shift] ^= gfMul(coef, prev[i]);
+        }
+        if (2 * order <= n) {
+            order = n + 1 - order;
+            memcpy(prev, tmp, sizeof(prev));
+            b = d;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    if (order > BCH_T) {
+        return -1;
+    }
+
+    //Chien search over the positions of the shortened code, bit i has power 249 - i
+    uint8_t found = 0;
+    for (uint16_t i = 0; i < SGB_MSG_BITS; i++) {
+        uint16_t inverse = (BCH_N - (SGB_MSG_BITS - 1 - i)) % BCH_N;
+        uint8_t value = 0;
+        for (uint8_t k = 0; k <= order; k++) {
+            value ^= gfMul(lambda[k], gfExp[(inverse * k) % BCH_N]);
+        }
+        if (value == 0) {
+            code[i] ^= 1;
+            found++;
+        }
+    }
+    return found == order ? found : -1;
+}
+
+static uint32_t despread(const uint8_t *stream, uint32_t chipErrors, uint8_t *bits) {
+    //chip pairs are sent MSB first, I before Q; a(n+23) = a(n+18) ^ a(n)
+    uint32_t prn[2] = {SGB_PRN_SEED_I, SGB_PRN_SEED_Q};
+    uint32_t disagree = 0;
+
+    for (uint16_t pair = 0; pair < BURST_PAIRS; pair++) {
+        uint16_t ones[2] = {0, 0};
+        for (uint16_t c = 0; c < SGB_CHIPS_PER_BIT; c++) {
+            uint32_t n = (uint32_t)pair * SGB_CHIPS_PER_BIT + c;
+            uint16_t word = stream[n / 8 * 2] << 8 | stream[n / 8 * 2 + 1];
+            for (uint8_t ch = 0; ch < 2; ch++) {
+                uint8_t chip = (word >> (15 - 2 * (n % 8) - ch)) & 1;
+                if ((TEST_Random() & 0xFFFF) < chipErrors) {
+                    chip ^= 1;
+                }
+                uint8_t ref = prn[ch] & 1;
+                prn[ch] = (prn[ch] >> 1) | (((prn[ch] ^ (prn[ch] >> 18)) & 1) << 22);
+                ones[ch] += chip ^ ref;
+            }
+        }
+        for (uint8_t ch = 0; ch < 2; ch++) {
+            bits[2 * pair + ch] = ones[ch] > SGB_CHIPS_PER_BIT / 2;
+            disagree += bits[2 * pair + ch] ? SGB_CHIPS_PER_BIT - ones[ch] : ones[ch];
+        }
+    }
+    return disagree;
+}
+
+static uint32_t field(const uint8_t *info, uint8_t first, uint8_t last) {
+    uint32_t value = 0;
+    for (uint8_t i = first; i <= last; i++) {
+        value = value << 1 | info[i - 1];
+    }
+    return value;
+}
+
+static void createBurst(POS_Position *pos, uint8_t *msg, uint8_t *stream) {
+    SGB_ChipStream s;
+    uint32_t len = 0;
+
+    CHECK(SGB_CreateMessage(msg, SGB_MSG_LENGTH, &identity, pos) == SGB_MSG_BITS, "message length");
+    SGB_StartStream(&s, msg);
+    while (len < SGB_STREAM_LENGTH) {
+        uint16_t block = 2 + 2 * (TEST_Random() % 32);
+        block = block > SGB_STREAM_LENGTH - len ? SGB_STREAM_LENGTH - len : block;
+        uint16_t got = SGB_GetChips(&s, stream + len, block);
+        CHECK(got == block, "chips %u of %u at %u", got, block, len);
+        if (got == 0) {
+            break;
+        }
+        len += got;
+    }
+    uint8_t extra[2];
+    CHECK(SGB_GetChips(&s, extra, sizeof(extra)) == 0, "stream longer than %u bytes", SGB_STREAM_LENGTH);
+}
+
+static void checkFields(const uint8_t *info, const POS_Position *pos) {
+    CHECK(field(info, 31, 40) == 203, "country code %u", field(info, 31, 40));
+    CHECK(field(info, 41, 41) == 1, "homing");
+    CHECK(field(info, 138, 140) == 0b010, "beacon type");
+    CHECK(field(info, 155, 158) == 0, "rotating field id");
+
+    if (pos->valid != POS_Valid_Flag_Valid) {
+        CHECK(field(info, 45, 51) == 127 && field(info, 68, 75) == 255, "default location");
+        CHECK(field(info, 199, 200) == 0, "gnss status without fix");
+        return;
+    }
+    CHECK(field(info, 44, 44) == pos->latitude.direction, "latitude direction");
+    CHECK(field(info, 45, 51) == pos->latitude.degree, "latitude %u", field(info, 45, 51));
+    double minute = field(info, 52, 66) * 60.0 / 32768;
+    CHECK(minute - pos->latitude.minute < 0.001 && pos->latitude.minute - minute < 0.001, "latitude minute %f", minute);
+    CHECK(field(info, 67, 67) == pos->longitude.direction, "longitude direction");
+    CHECK(field(info, 68, 75) == pos->longitude.degree, "longitude %u", field(info, 68, 75));
+    minute = field(info, 76, 90) * 60.0 / 32768;
+    CHECK(minute - pos->longitude.minute < 0.001 && pos->longitude.minute - minute < 0.001, "longitude minute %f", minute);
+    CHECK(field(info, 199, 200) == 0b01, "gnss status with fix");
+}
+
+static void checkVector(void) {
+    POS_Position pos;
+    uint8_t msg[SGB_MSG_LENGTH];
+
+    memset(&pos, 0, sizeof(pos));
+    pos.valid = POS_Valid_Flag_Valid;
+    pos.latitude.direction = POS_Latitude_Flag_N;
+    pos.latitude.degree = 48;
+    pos.latitude.minute = 47.589f;
+    pos.longitude.direction = POS_Longitude_Flag_E;
+    pos.longitude.degree = 69;
+    pos.longitude.minute = 0.5256f;
+    CHECK(SGB_CreateMessage(msg, sizeof(msg), 0, &pos) == 0, "message without identification");
+    CHECK(SGB_CreateMessage(msg, sizeof(msg), &identity, &pos) == SGB_MSG_BITS, "vector message length");
+    for (uint8_t i = 0; i < SGB_MSG_LENGTH; i++) {
+        CHECK(msg[i] == vector[i], "vector byte %u: 0x%02X instead of 0x%02X", i, msg[i], vector[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    int bursts = 200;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                bursts = atoi(optarg);
+                break;
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n bursts] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int poly = setupField();
+    CHECK(poly != 0, "generator has no 12 consecutive roots in any GF(2^8)");
+    printf("bch       roots a^1..a^12 in GF(2^8) of 0x%03X\n", poly);
+    checkVector();
+
+    static uint8_t stream[SGB_STREAM_LENGTH];
+    uint8_t msg[SGB_MSG_LENGTH];
+    uint8_t bits[SGB_BURST_BITS];
+    uint32_t corrected = 0, disagree = 0, uncorrectable = 0;
+
+    for (int n = 0; n < bursts; n++) {
+        POS_Position pos;
+        uint64_t r = TEST_Random();
+        memset(&pos, 0, sizeof(pos));
+        pos.valid = n % 10 == 0 ? POS_Valid_Flag_Invalid : POS_Valid_Flag_Valid;
+        pos.latitude.direction = r & 1;
+        pos.latitude.degree = (r >> 1) % 90;
+        pos.latitude.minute = ((r >> 8) % 60000) / 1000.0f;
+        pos.longitude.direction = (r >> 24) & 1;
+        pos.longitude.degree = (r >> 25) % 180;
+        pos.longitude.minute = ((r >> 33) % 60000) / 1000.0f;
+        createBurst(&pos, msg, stream);
+
+        //every second burst with 30 % chip errors, the spreading gain has to remove them
+        disagree += despread(stream, n % 2 ? 19661 : 0, bits);
+        uint8_t preamble = 0;
+        for (uint8_t i = 0; i < SGB_PREAMBLE_BITS; i++) {
+            preamble |= bits[i];
+        }
+        CHECK(preamble == 0, "preamble not zero");
+
+        //the despread message equals the packed message of sgb.c
+        uint8_t *code = bits + SGB_PREAMBLE_BITS;
+        uint16_t wrong = 0;
+        for (uint16_t i = 0; i < SGB_MSG_BITS; i++) {
+            wrong += code[i] != ((msg[i / 8] >> (7 - i % 8)) & 1);
+        }
+        CHECK(wrong == 0, "burst %d: %u bits differ after despreading", n, wrong);
+        CHECK(bchDecode(code) == 0, "burst %d: syndrome of the sent codeword not zero", n);
+
+        //up to 6 bit errors are corrected, 7 are not (or to another codeword)
+        uint8_t errors = n % (BCH_T + 2);
+        uint8_t sent[SGB_MSG_BITS];
+        memcpy(sent, code, sizeof(sent));
+        for (uint8_t e = 0; e < errors; e++) {
+            uint16_t i;
+            do {
+                i = TEST_Random() % SGB_MSG_BITS;
+            } while (code[i] != sent[i]);
+            code[i] ^= 1;
+        }
+        int fixed = bchDecode(code);
+        if (errors <= BCH_T) {
+            CHECK(fixed == errors && memcmp(code, sent, sizeof(sent)) == 0, "burst %d: %u errors, decoder %d", n, errors, fixed);
+            corrected += errors;
+        } else {
+            uncorrectable += fixed < 0;
+            CHECK(fixed < 0 || memcmp(code, sent, sizeof(sent)) != 0, "burst %d: 7 errors corrected", n);
+        }
+        checkFields(sent, &pos);
+    }
+    printf("decoded   %d bursts, %u chips against the bit (30 %% chip errors on every second burst)\n", bursts, disagree);
+    printf("bch       %u bit errors corrected, %u of %u bursts with 7 errors detected as uncorrectable\n",
+            corrected, uncorrectable, bursts / (BCH_T + 2));
+
+    //throughput of the chip stream, the radio needs 2 x 38400 chips/s
+    SGB_ChipStream s;
+    uint64_t chips = 0;
+    double t0 = TEST_Seconds(), t;
+    do {
+        SGB_StartStream(&s, msg);
+        while (SGB_GetChips(&s, stream, 64) > 0) {
+        }
+        chips += 2 * CHANNEL_CHIPS;
+        t = TEST_Seconds();
+    } while (t - t0 < 0.5);
+    double rate = chips / (t - t0);
+    printf("chips     %.1f Mchips/s on the host, %.0f x the chip rate of the burst\n", rate / 1e6,
+            rate / (2.0 * SGB_CHIP_RATE));
+
+    return TEST_Result();
+}
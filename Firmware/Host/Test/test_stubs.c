@@ -0,0 +1,60 @@
+/**
+ * @file test_stubs.c
+ * @author Paul Götzinger
+ * @brief Host tool: stand-ins of the firmware services the modules under test use (log, tick)
+ * @version 1.0
+ * @date 2019-04-05
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include "test.h"
+
+uint32_t TEST_Checks;
+uint32_t TEST_Failed;
+uint32_t TEST_Tick;
+int TEST_Verbose;
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+int TEST_Result(void) {
+    printf("%u checks, %u failed\n", TEST_Checks, TEST_Failed);
+    printf("%s\n", TEST_Failed == 0 ? "PASSED" : "FAILED");
+    return TEST_Failed != 0;
+}
+
+uint64_t TEST_Random(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+double TEST_Seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+uint32_t HAL_GetTick(void) {
+    return TEST_Tick;
+}
+
+void LOG_Log(const char *format, ...) {
+    if (TEST_Verbose) {
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+}
+
+void LOG_BitArray(uint8_t *array, uint16_t len) {
+    for (uint16_t i = 0; TEST_Verbose && i < len; i++) {
+        putchar(array[i] ? '1' : '0');
+    }
+}
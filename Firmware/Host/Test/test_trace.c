@@ -0,0 +1,286 @@
+/**
+ * @file test_trace.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the event trace ring (mask, wrap, freeze, crash trace over a reset,
+ * timer prescaler, interrupt latency) and of the time reconstruction of traceview from the 16 bit
+ * timer and tick
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "trace.h"
+
+#define ROUNDS          50      //dumps given to traceview
+#define TIMER_OFFSET    12345   //us, the timer is not in phase with the tick
+#define MAX_GAP         60000000ULL //us, the 16 bit tick wraps after 65.5 s
+#define LATENCY_TICKS   100000
+
+TIM_TypeDef TEST_TIM6;
+SysTick_Type TEST_SysTick;
+RCC_TypeDef TEST_RCC;
+
+static uint32_t pclk1 = 32000000;
+static uint64_t now;    //true time in us
+
+/**
+ * @brief Set true time, timer and tick follow
+ *
+ * @param us time
+ */
+static void setTime(uint64_t us);
+
+/**
+ * @brief Write the ring in the format of the usb command "trace", run traceview on it
+ * and compare its timeline with the true times
+ *
+ * @param times true time of each entry, oldest first
+ * @return int count of entries with a wrong time
+ */
+static int checkTimeline(const uint64_t *times);
+
+/**
+ * @brief Measure random latencies and compare the statistics with a reference, then check the
+ * figures traceview prints from the dump
+ *
+ */
+static void checkLatency(void);
+
+/**
+ * @brief Write the ring and the latency in the format of the usb command "trace"
+ *
+ * @param path temporary file, the name is filled in
+ * @return int 0 on success
+ */
+static int writeDump(char *path);
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return pclk1;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    //cold start: ring cleared, boot marker recorded
+    TRACE_Init();
+    TRACE_Entry e;
+    CHECK(TRACE_GetCount() == 1 && TRACE_GetEntry(0, &e) && e.event == TRACE_Event_Boot, "boot marker");
+    CHECK(TRACE_GetMask() == TRACE_MASK_DEFAULT, "default mask 0x%08X", TRACE_GetMask());
+    CHECK(TEST_TIM6.PSC == 31 && (TEST_TIM6.CR1 & TIM_CR1_CEN), "timer at 32 MHz: prescaler %u", TEST_TIM6.PSC);
+    CHECK(strcmp(TRACE_GetName(TRACE_Event_Radio), "radio") == 0 && TRACE_GetName(TRACE_Event_Count) == 0, "names");
+
+    //1 MHz at other bus clocks, timers run at twice a divided APB1 clock
+    pclk1 = 2097152;
+    TRACE_ClockChanged();
+    CHECK(TEST_TIM6.PSC == 1, "timer at 2.1 MHz: prescaler %u", TEST_TIM6.PSC);
+    pclk1 = 8000000;
+    TEST_RCC.CFGR = RCC_CFGR_PPRE1_DIV2;
+    TRACE_ClockChanged();
+    CHECK(TEST_TIM6.PSC == 15, "timer at 8 MHz APB1 / 2: prescaler %u", TEST_TIM6.PSC);
+    TEST_RCC.CFGR = 0;
+
+    //tasks are off by default
+    TRACE_Record(TRACE_Event_Radio | TRACE_FLAG_BEGIN, 0);
+    TRACE_Record(40, 0);
+    CHECK(TRACE_GetCount() == 1, "masked events recorded: %u", TRACE_GetCount());
+    TRACE_SetMask(1UL << TRACE_Event_Radio);
+    TRACE_Record(TRACE_Event_Radio | TRACE_FLAG_BEGIN, 7);
+    CHECK(TRACE_GetCount() == 2 && TRACE_GetEntry(1, &e) && e.arg == 7
+            && e.event == (TRACE_Event_Radio | TRACE_FLAG_BEGIN), "enabled event");
+
+    //wrap: the newest TRACE_SIZE entries remain, oldest first
+    TRACE_Restart();
+    for (uint16_t i = 0; i < 3 * TRACE_SIZE + 5; i++) {
+        TRACE_Record(TRACE_Event_Radio, i);
+    }
+    CHECK(TRACE_GetCount() == TRACE_SIZE, "count %u", TRACE_GetCount());
+    for (uint16_t i = 0; i < TRACE_SIZE; i++) {
+        CHECK(TRACE_GetEntry(i, &e) && e.arg == 2 * TRACE_SIZE + 5 + i, "entry %u: arg %u", i, e.arg);
+    }
+    CHECK(!TRACE_GetEntry(TRACE_SIZE, &e) && !TRACE_GetEntry(0, 0), "entry out of range");
+
+    //frozen while dumping
+    TRACE_Freeze(1);
+    TRACE_Record(TRACE_Event_Radio, 0xFFFF);
+    TRACE_Freeze(0);
+    CHECK(TRACE_GetEntry(TRACE_SIZE - 1, &e) && e.arg == 3 * TRACE_SIZE + 4, "recorded while frozen");
+
+    //crash trace survives the reset until restarted
+    TRACE_SetMask(TRACE_MASK_DEFAULT);
+    TRACE_Crash();
+    TRACE_Init();
+    CHECK(TRACE_IsCrashDump() && TRACE_GetCount() == TRACE_SIZE, "crash trace preserved");
+    CHECK(TRACE_GetEntry(TRACE_SIZE - 1, &e) && e.event == TRACE_Event_Fault, "fault marker last");
+    TRACE_Record(TRACE_Event_Usart2 | TRACE_FLAG_BEGIN, 0);
+    CHECK(TRACE_GetEntry(TRACE_SIZE - 1, &e) && e.event == TRACE_Event_Fault, "recorded into crash trace");
+    TRACE_Restart();
+    CHECK(!TRACE_IsCrashDump() && TRACE_GetCount() == 0, "restart");
+
+    //a normal reset starts a new trace
+    TRACE_Record(TRACE_Event_Usart2, 0);
+    TRACE_Init();
+    CHECK(!TRACE_IsCrashDump() && TRACE_GetCount() == 1, "trace after reset: %u entries", TRACE_GetCount());
+
+    //time reconstruction of traceview: gaps from 1 us up to a minute, nested begin and end
+    TRACE_SetMask(0xFFFFFFFF);
+    checkLatency();
+    int wrong = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t times[TRACE_SIZE];
+        TRACE_Restart();
+        for (uint16_t i = 0; i < TRACE_SIZE; i++) {
+            uint64_t r = TEST_Random();
+            uint64_t gap = (r & 3) == 0 ? 1 + (r >> 8) % MAX_GAP
+                    : (r & 3) == 1 ? 1 + (r >> 8) % 200000 : 1 + (r >> 8) % 100;
+            setTime(now + gap);
+            times[i] = now;
+            TRACE_Record(TRACE_Event_Usart2 | (i & 1 ? TRACE_FLAG_END : TRACE_FLAG_BEGIN), i);
+        }
+        wrong += checkTimeline(times);
+    }
+    CHECK(wrong == 0, "%d of %d entries at a wrong time", wrong, ROUNDS * TRACE_SIZE);
+    printf("timeline  %d entries over %.1f h, gaps of 1 us .. %.0f s, %d at a wrong time\n", ROUNDS * TRACE_SIZE,
+            now / 3.6e9, MAX_GAP / 1e6, wrong);
+
+    return TEST_Result();
+}
+
+static void setTime(uint64_t us) {
+    now = us;
+    TEST_TIM6.CNT = (now + TIMER_OFFSET) & 0xFFFF;
+    TEST_Tick = now / 1000;
+}
+
+static int checkTimeline(const uint64_t *times) {
+    char path[] = "/tmp/test-trace-XXXXXX";
+    if (writeDump(path) != 0) {
+        CHECK(0, "cannot create %s", path);
+        return TRACE_SIZE;
+    }
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "%s -t %s", TRACEVIEW, path);
+    FILE *in = popen(cmd, "r");
+    int wrong = 0, lines = 0;
+    char line[256];
+    while (in != 0 && fgets(line, sizeof(line), in) != 0) {
+        double ms;
+        char sign;
+        if (sscanf(line, "%lf %c", &ms, &sign) == 2 && (sign == '+' || sign == '-')) {
+            int64_t us = (int64_t)(ms * 1000 + (ms >= 0 ? 0.5 : -0.5));
+            if (lines < TRACE_SIZE && us != (int64_t)(times[lines] - times[0])) {
+                wrong++;
+                if (TEST_Verbose) {
+                    printf("entry %d: %lld us, expected %llu us\n", lines, (long long)us,
+                            (unsigned long long)(times[lines] - times[0]));
+                }
+            }
+            lines++;
+        }
+    }
+    CHECK(in != 0 && pclose(in) == 0 && lines == TRACE_SIZE, "traceview: %d timeline entries", lines);
+    unlink(path);
+    return wrong;
+}
+
+static void checkLatency(void) {
+    uint32_t min = UINT32_MAX, max = 0, hist[TRACE_LATENCY_BINS] = {0};
+    uint64_t sum = 0;
+    TRACE_Latency lat;
+
+    TRACE_Restart();
+    TRACE_GetLatency(&lat);
+    CHECK(lat.count == 0 && lat.max == 0, "latency after restart: %u interrupts", lat.count);
+
+    //mostly the exception entry, now and then delayed by other handlers up to the whole period
+    TEST_SysTick.LOAD = 32000 - 1;
+    for (int i = 0; i < LATENCY_TICKS; i++) {
+        uint32_t r = TEST_Random();
+        uint32_t cycles = (r & 7) == 0 ? (r >> 3) % 32000 : 20 + (r >> 3) % 40;
+        TEST_SysTick.VAL = TEST_SysTick.LOAD - cycles;
+        TRACE_Tick();
+
+        uint8_t bin = cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+        hist[bin < TRACE_LATENCY_BINS ? bin : TRACE_LATENCY_BINS - 1]++;
+        min = cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        sum += cycles;
+    }
+    //beyond the last bin
+    TEST_SysTick.LOAD = 0xFFFFFF;
+    TEST_SysTick.VAL = 0;
+    TRACE_Tick();
+    hist[TRACE_LATENCY_BINS - 1]++;
+    max = 0xFFFFFF;
+    sum += 0xFFFFFF;
+
+    TRACE_GetLatency(&lat);
+    CHECK(lat.count == LATENCY_TICKS + 1 && lat.min == min && lat.max == max && lat.sum == sum,
+          "latency %u interrupts, min %u, max %u, expected %u, %u", lat.count, lat.min, lat.max, min, max);
+    CHECK(memcmp(lat.hist, hist, sizeof(hist)) == 0, "latency histogram");
+
+    //traceview prints min, avg and max of the dump
+    char path[] = "/tmp/test-trace-XXXXXX";
+    TRACE_Record(TRACE_Event_Usart2, 0);
+    if (writeDump(path) != 0) {
+        CHECK(0, "cannot create %s", path);
+        return;
+    }
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "%s -h %s", TRACEVIEW, path);
+    FILE *in = popen(cmd, "r");
+    char line[256];
+    unsigned long vmin = 0, vavg = 0, vmax = 0;
+    int found = 0;
+    while (in != 0 && fgets(line, sizeof(line), in) != 0) {
+        found |= sscanf(line, " min %lu, avg %lu, max %lu cycles", &vmin, &vavg, &vmax) == 3;
+    }
+    CHECK(in != 0 && pclose(in) == 0 && found && vmin == min && vavg == sum / (LATENCY_TICKS + 1) && vmax == max,
+          "traceview latency min %lu, avg %lu, max %lu", vmin, vavg, vmax);
+    unlink(path);
+    printf("latency   %d interrupts of 0 .. 32000 cycles, avg %lu cycles\n", LATENCY_TICKS + 1, vavg);
+}
+
+static int writeDump(char *path) {
+    int fd = mkstemp(path);
+    FILE *out = fd >= 0 ? fdopen(fd, "w") : 0;
+    if (out == 0) {
+        return -1;
+    }
+
+    fprintf(out, "trace %u entries, mask 0x%08x\n", TRACE_GetCount(), TRACE_GetMask());
+    for (uint16_t i = 0; i < TRACE_Event_Count; i++) {
+        fprintf(out, "event %u %s\n", i, TRACE_GetName(i));
+    }
+    TRACE_Entry e;
+    for (uint16_t i = 0; TRACE_GetEntry(i, &e); i++) {
+        fprintf(out, "%04x %04x %04x %04x\n", e.time, e.tick, e.event, e.arg);
+    }
+    TRACE_Latency lat;
+    TRACE_GetLatency(&lat);
+    fprintf(out, "latency %u %u %u %u %u", lat.count, 32000000, lat.min, lat.count > 0 ? (uint32_t)(lat.sum / lat.count) : 0,
+            lat.max);
+    for (uint8_t i = 0; i < TRACE_LATENCY_BINS; i++) {
+        fprintf(out, " %u", lat.hist[i]);
+    }
+    fprintf(out, "\nend\n");
+    fclose(out);
+    return 0;
+}
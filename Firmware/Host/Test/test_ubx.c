@@ -0,0 +1,179 @@
+/**
+ * @file test_ubx.c
+ * @author Paul Götzinger
+ * @brief Host tool: test of the constellation profile frame (UBX-CFG-GNSS) against the u-blox
+ * M8 protocol description and of its acknowledgement
+ * @version 1.0
+ * @date 2019-04-06
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test.h"
+#include "ubx.h"
+
+#define FRAME_LEN       64
+#define CFG_GNSS_ID     0x3E
+#define M8_CHANNELS     32      //tracking channels of the M8 receivers
+#define BLOCKS          3       //GPS, Galileo, GLONASS
+#define GNSS_LEN        (4 + 8 * BLOCKS)
+
+static const uint8_t systems[BLOCKS] = {UBX_GnssId_GPS, UBX_GnssId_Galileo, UBX_GnssId_GLONASS};
+
+static UBX_Instance ubx;
+static UBX_Class ackClass;
+static uint8_t ackId;
+static int acks, naks;
+
+/**
+ * @brief Check frame of one enable mask field by field
+ *
+ * @param enable systems to enable
+ */
+static void checkFrame(uint8_t enable);
+
+/**
+ * @brief Send an acknowledgement to the parser
+ *
+ * @param ack ACK-ACK or ACK-NAK
+ * @param msgClass class of the acknowledged message
+ * @param id id of the acknowledged message
+ */
+static void sendAck(UBX_Id_Ack ack, uint8_t msgClass, uint8_t id);
+
+static void ackCallback(UBX_Class msgClass, uint8_t id, UBX_Id_Ack ack) {
+    ackClass = msgClass;
+    ackId = id;
+    acks += ack == UBX_Id_Ack_Ack;
+    naks += ack == UBX_Id_Ack_Nak;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v':
+                TEST_Verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    UBX_Init(&ubx);
+
+    //every combination of the three systems, the firmware uses three of them
+    for (uint8_t combo = 0; combo < (1 << BLOCKS); combo++) {
+        uint8_t enable = 0;
+        for (uint8_t i = 0; i < BLOCKS; i++) {
+            enable |= (combo >> i) & 1 ? UBX_GNSS_MASK(systems[i]) : 0;
+        }
+        checkFrame(enable);
+    }
+
+    //other systems in the mask are not configured
+    uint8_t frame[FRAME_LEN];
+    uint8_t other[FRAME_LEN];
+    uint16_t len = UBX_CreateGnssConfigFrame(&ubx, frame, sizeof(frame), UBX_GNSS_MASK(UBX_GnssId_GPS));
+    uint16_t otherLen = UBX_CreateGnssConfigFrame(&ubx, other, sizeof(other), UBX_GNSS_MASK(UBX_GnssId_GPS)
+            | UBX_GNSS_MASK(UBX_GnssId_SBAS) | UBX_GNSS_MASK(UBX_GnssId_BeiDou) | UBX_GNSS_MASK(UBX_GnssId_QZSS));
+    CHECK(len == otherLen && memcmp(frame, other, len) == 0, "sbas, beidou or qzss changed the frame");
+
+    //buffer too small
+    CHECK(UBX_CreateGnssConfigFrame(&ubx, frame, 8 + GNSS_LEN - 1, 0) == 0, "short buffer accepted");
+    CHECK(UBX_CreateGnssConfigFrame(&ubx, 0, sizeof(frame), 0) == 0, "null buffer accepted");
+    CHECK(UBX_CreateGnssConfigFrame(&ubx, frame, 8 + GNSS_LEN, 0) == 8 + GNSS_LEN, "exact buffer rejected");
+
+    //acknowledgement of the profile, the callback is configured per command and called once;
+    //acknowledgements of other messages do not reach it
+    acks = 0;
+    UBX_SetAckCallback(&ubx, ackCallback, UBX_Class_CFG, CFG_GNSS_ID);
+    sendAck(UBX_Id_Ack_Ack, UBX_Class_CFG, 0x01);
+    CHECK(acks == 0 && naks == 0, "ACK-ACK of CFG-MSG: %d acks, %d naks", acks, naks);
+    sendAck(UBX_Id_Ack_Ack, UBX_Class_CFG, CFG_GNSS_ID);
+    CHECK(acks == 1 && naks == 0 && ackClass == UBX_Class_CFG && ackId == CFG_GNSS_ID, "ACK-ACK: %d acks, %d naks", acks, naks);
+    sendAck(UBX_Id_Ack_Ack, UBX_Class_CFG, CFG_GNSS_ID);
+    CHECK(acks == 1, "second ACK-ACK without command: %d acks", acks);
+    UBX_SetAckCallback(&ubx, ackCallback, UBX_Class_CFG, CFG_GNSS_ID);
+    sendAck(UBX_Id_Ack_Nak, UBX_Class_CFG, CFG_GNSS_ID);
+    CHECK(acks == 1 && naks == 1, "ACK-NAK: %d acks, %d naks", acks, naks);
+
+    printf("frames    %u combinations of GPS, Galileo and GLONASS, %u bytes each\n", 1 << BLOCKS, 8 + GNSS_LEN);
+    return TEST_Result();
+}
+
+static void checkFrame(uint8_t enable) {
+    uint8_t frame[FRAME_LEN];
+    memset(frame, 0xAA, sizeof(frame));
+    uint16_t len = UBX_CreateGnssConfigFrame(&ubx, frame, sizeof(frame), enable);
+
+    //header: sync, class, id, little endian length
+    CHECK(len == 8 + GNSS_LEN, "mask 0x%02X: length %u", enable, len);
+    CHECK(frame[0] == 0xB5 && frame[1] == 0x62 && frame[2] == UBX_Class_CFG && frame[3] == CFG_GNSS_ID,
+          "mask 0x%02X: header %02X %02X %02X %02X", enable, frame[0], frame[1], frame[2], frame[3]);
+    CHECK(frame[4] == GNSS_LEN && frame[5] == 0, "mask 0x%02X: payload length %u", enable, frame[4] | frame[5] << 8);
+    CHECK(frame[len] == 0xAA, "mask 0x%02X: written beyond the frame", enable);
+
+    //8 bit Fletcher over class, id, length and payload
+    uint8_t a = 0, b = 0;
+    for (uint16_t i = 2; i < len - 2; i++) {
+        a += frame[i];
+        b += a;
+    }
+    CHECK(frame[len - 2] == a && frame[len - 1] == b, "mask 0x%02X: checksum", enable);
+
+    //payload: msgVer 0, all channels, one block per system
+    const uint8_t *p = frame + 6;
+    CHECK(p[0] == 0 && p[2] == 0xFF && p[3] == BLOCKS, "mask 0x%02X: msgVer %u, numTrkChUse %u, numConfigBlocks %u",
+          enable, p[0], p[2], p[3]);
+
+    uint8_t seen = 0, reserved = 0;
+    for (uint8_t i = 0; i < BLOCKS; i++) {
+        const uint8_t *block = p + 4 + 8 * i;
+        uint32_t flags = block[4] | block[5] << 8 | (uint32_t)block[6] << 16 | (uint32_t)block[7] << 24;
+        uint8_t id = block[0];
+
+        CHECK(id == UBX_GnssId_GPS || id == UBX_GnssId_Galileo || id == UBX_GnssId_GLONASS,
+              "mask 0x%02X: block %u gnssId %u", enable, i, id);
+        CHECK((seen & UBX_GNSS_MASK(id)) == 0, "mask 0x%02X: gnssId %u twice", enable, id);
+        seen |= UBX_GNSS_MASK(id);
+
+        CHECK(block[1] <= block[2] && block[2] <= M8_CHANNELS && block[3] == 0,
+              "mask 0x%02X: gnssId %u resTrkCh %u, maxTrkCh %u", enable, id, block[1], block[2]);
+        reserved += block[1];
+
+        //enable bit 0, sigCfgMask bits 16 .. 23: L1C/A, E1 and L1OF are signal 0x01 of their system
+        CHECK((flags & 1) == ((enable & UBX_GNSS_MASK(id)) != 0), "mask 0x%02X: gnssId %u enable flag", enable, id);
+        CHECK((flags & 0xFFFFFFFE) == 0x00010000, "mask 0x%02X: gnssId %u flags 0x%08X", enable, id, (unsigned)flags);
+    }
+    CHECK(reserved <= M8_CHANNELS, "mask 0x%02X: %u reserved channels", enable, reserved);
+
+    //the length field matches the frame: the parser is back at idle for the acknowledgement following it
+    int before = acks;
+    for (uint16_t i = 0; i < len; i++) {
+        UBX_Process(&ubx, frame[i]);
+    }
+    UBX_SetAckCallback(&ubx, ackCallback, UBX_Class_CFG, CFG_GNSS_ID);
+    sendAck(UBX_Id_Ack_Ack, UBX_Class_CFG, CFG_GNSS_ID);
+    CHECK(acks == before + 1, "mask 0x%02X: parser lost the acknowledgement after the frame", enable);
+}
+
+static void sendAck(UBX_Id_Ack ack, uint8_t msgClass, uint8_t id) {
+    uint8_t frame[10] = {0xB5, 0x62, UBX_Class_ACK, ack, 2, 0, msgClass, id};
+    uint8_t a = 0, b = 0;
+    for (uint8_t i = 2; i < 8; i++) {
+        a += frame[i];
+        b += a;
+    }
+    frame[8] = a;
+    frame[9] = b;
+    for (uint8_t i = 0; i < sizeof(frame); i++) {
+        UBX_Process(&ubx, frame[i]);
+    }
+}
@@ -0,0 +1,395 @@
+/**
+ * @file traceview.c
+ * @author Paul Götzinger
+ * @brief Host tool: timeline and duration histograms of a trace dump (usb command "trace")
+ * @version 1.0
+ * @date 2019-03-20
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_EVENTS      256
+#define MAX_ENTRIES     65536
+#define MAX_DEPTH       16
+#define NAME_LEN        32
+#define LINE_LEN        256
+#define BUCKETS         20      //log2 duration buckets, 1 us .. 0.5 s
+#define LATENCY_BINS    16      //log2 latency bins, trace.h
+#define BAR_LEN         40
+
+#define FLAG_BEGIN      0x8000  //trace.h
+#define FLAG_END        0x4000
+#define ID_MASK         0x00FF
+
+#define WRAP            65536LL //16 bit timer (us) and tick (ms)
+
+/**
+ * @brief Entry with unwrapped time
+ *
+ */
+typedef struct {
+    int64_t  time;      //us since first entry
+    uint16_t event;
+    uint16_t arg;
+} Entry;
+
+/**
+ * @brief Duration statistics of one event
+ *
+ */
+typedef struct {
+    uint32_t count;
+    int64_t  min;
+    int64_t  max;
+    int64_t  sum;
+    int64_t  self;      //without nested events
+    uint32_t hist[BUCKETS];
+} Stats;
+
+/**
+ * @brief Open event (begin seen, end pending)
+ *
+ */
+typedef struct {
+    uint16_t id;
+    int64_t  start;
+    int64_t  child;     //time spent in nested events
+} Frame;
+
+/**
+ * @brief Interrupt latency in SysTick cycles
+ *
+ */
+typedef struct {
+    uint8_t  valid;
+    unsigned long count;
+    unsigned long clock;    //Hz
+    unsigned long min;
+    unsigned long avg;
+    unsigned long max;
+    unsigned long hist[LATENCY_BINS];
+} Latency;
+
+static char names[MAX_EVENTS][NAME_LEN];
+static Entry entries[MAX_ENTRIES];
+static uint32_t entryCount;
+static Stats stats[MAX_EVENTS];
+static Latency latency;
+
+/**
+ * @brief Read dump, names and entries; lines may carry a prefix (e.g. timestamps of a terminal)
+ *
+ * @param in input
+ */
+static void readDump(FILE *in);
+
+/**
+ * @brief Name of event id
+ *
+ * @param id event id
+ * @return const char* name
+ */
+static const char* name(uint16_t id);
+
+/**
+ * @brief Print timeline with nesting and collect duration statistics
+ *
+ * @param print 1 to print timeline
+ */
+static void timeline(uint8_t print);
+
+/**
+ * @brief Print duration statistics and histograms
+ *
+ */
+static void histograms(void);
+
+/**
+ * @brief Parse latency line: count, clock, min, avg, max and bins
+ *
+ * @param p line after "latency"
+ * @return uint8_t 1 if complete
+ */
+static uint8_t readLatency(const char *p);
+
+/**
+ * @brief Print interrupt latency and its histogram
+ *
+ */
+static void printLatency(void);
+
+/**
+ * @brief Print log2 histogram bar
+ *
+ * @param from lower bound
+ * @param to upper bound
+ * @param unit unit of bounds
+ * @param n count in bin
+ * @param peak largest count
+ */
+static void bar(long long from, long long to, const char *unit, unsigned long n, unsigned long peak);
+
+int main(int argc, char **argv) {
+    uint8_t showTimeline = 1, showStats = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "th")) != -1) {
+        switch (opt) {
+            case 't':
+                showStats = 0;
+                break;
+            case 'h':
+                showTimeline = 0;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t timeline only] [-h histograms only] [dump]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    FILE *in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "r");
+        if (in == 0) {
+            fprintf(stderr, "cannot open %s\n", argv[optind]);
+            return 1;
+        }
+    }
+    readDump(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    if (entryCount == 0) {
+        fprintf(stderr, "no trace entries found\n");
+        return 1;
+    }
+
+    timeline(showTimeline);
+    if (showStats) {
+        histograms();
+        printLatency();
+    }
+    return 0;
+}
+
+static void readDump(FILE *in) {
+    char line[LINE_LEN];
+    int64_t time = 0;
+    unsigned prevTime = 0, prevTick = 0;
+
+    while (fgets(line, sizeof(line), in) != 0) {
+        char *p = line;
+        unsigned t, tick, event, arg, id;
+        char n[NAME_LEN];
+
+        //skip prefix up to the payload
+        for (uint8_t tries = 0; tries < 4 && p != 0; tries++) {
+            if (sscanf(p, "event %u %31s", &id, n) == 2) {
+                if (id < MAX_EVENTS) {
+                    strcpy(names[id], n);
+                }
+                break;
+            }
+            if (strncmp(p, "latency ", 8) == 0) {
+                latency.valid = readLatency(p + 8);
+                break;
+            }
+            if (strlen(p) >= 19 && sscanf(p, "%4x %4x %4x %4x", &t, &tick, &event, &arg) == 4 && p[4] == ' ') {
+                if (entryCount == MAX_ENTRIES) {
+                    break;
+                }
+                if (entryCount > 0) {
+                    //the tick (1 ms) tells how often the 16 bit microsecond timer wrapped
+                    int64_t dt = (t - prevTime + WRAP) % WRAP;
+                    int64_t dtick = (tick - prevTick + WRAP) % WRAP;
+                    while (dt + WRAP / 2 < dtick * 1000) {
+                        dt += WRAP;
+                    }
+                    time += dt;
+                }
+                prevTime = t;
+                prevTick = tick;
+
+                entries[entryCount].time = time;
+                entries[entryCount].event = event;
+                entries[entryCount].arg = arg;
+                entryCount++;
+                break;
+            }
+            p = strchr(p, ' ');
+            p = p != 0 ? p + 1 : 0;
+        }
+    }
+}
+
+static const char* name(uint16_t id) {
+    static char buf[16];
+
+    if (id < MAX_EVENTS && names[id][0] != 0) {
+        return names[id];
+    }
+    snprintf(buf, sizeof(buf), "event%u", id);
+    return buf;
+}
+
+static void timeline(uint8_t print) {
+    Frame stack[MAX_DEPTH];
+    uint8_t depth = 0;
+
+    for (uint16_t i = 0; i < MAX_EVENTS; i++) {
+        stats[i].min = INT64_MAX;
+    }
+    if (print) {
+        printf("%12s  %s\n", "time [ms]", "event");
+    }
+
+    for (uint32_t i = 0; i < entryCount; i++) {
+        Entry *e = &entries[i];
+        uint16_t id = e->event & ID_MASK;
+
+        if (e->event & FLAG_BEGIN) {
+            if (print) {
+                printf("%12.3f  %*s+%s (%u)\n", e->time / 1e3, depth * 2, "", name(id), e->arg);
+            }
+            if (depth < MAX_DEPTH) {
+                stack[depth].id = id;
+                stack[depth].start = e->time;
+                stack[depth].child = 0;
+                depth++;
+            }
+        } else if (e->event & FLAG_END) {
+            //find begin, entries of events in between were lost (ring overwritten)
+            int8_t d = depth - 1;
+            while (d >= 0 && stack[d].id != id) {
+                d--;
+            }
+            if (d < 0) {
+                if (print) {
+                    printf("%12.3f  %*s-%s (begin not in trace)\n", e->time / 1e3, depth * 2, "", name(id));
+                }
+                continue;
+            }
+
+            depth = d;
+            int64_t dur = e->time - stack[d].start;
+            if (print) {
+                printf("%12.3f  %*s-%s %lld us (%u)\n", e->time / 1e3, depth * 2, "", name(id), (long long)dur, e->arg);
+            }
+            if (d > 0) {
+                stack[d - 1].child += dur;
+            }
+
+            Stats *s = &stats[id];
+            uint8_t bucket = 0;
+            while (bucket < BUCKETS - 1 && (1LL << (bucket + 1)) <= dur) {
+                bucket++;
+            }
+            s->count++;
+            s->sum += dur;
+            s->self += dur - stack[d].child;
+            s->min = dur < s->min ? dur : s->min;
+            s->max = dur > s->max ? dur : s->max;
+            s->hist[bucket]++;
+        } else if (print) {
+            printf("%12.3f  %*s*%s (0x%04x)\n", e->time / 1e3, depth * 2, "", name(id), e->arg);
+        }
+    }
+    if (print) {
+        printf("\n");
+    }
+}
+
+static void histograms(void) {
+    printf("%-12s %7s %9s %9s %9s %9s %6s\n", "event", "count", "min [us]", "avg [us]", "max [us]", "self", "load");
+    int64_t span = entries[entryCount - 1].time - entries[0].time;
+
+    for (uint16_t id = 0; id < MAX_EVENTS; id++) {
+        Stats *s = &stats[id];
+        if (s->count == 0) {
+            continue;
+        }
+        printf("%-12s %7u %9lld %9.1f %9lld %9.1f %5.1f%%\n", name(id), s->count, (long long)s->min,
+                (double)s->sum / s->count, (long long)s->max, (double)s->self / s->count,
+                span > 0 ? 100.0 * s->self / span : 0);
+    }
+
+    for (uint16_t id = 0; id < MAX_EVENTS; id++) {
+        Stats *s = &stats[id];
+        if (s->count == 0) {
+            continue;
+        }
+
+        uint32_t peak = 0;
+        uint8_t first = BUCKETS, last = 0;
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            if (s->hist[b] != 0) {
+                peak = s->hist[b] > peak ? s->hist[b] : peak;
+                first = b < first ? b : first;
+                last = b;
+            }
+        }
+
+        printf("\n%s duration\n", name(id));
+        for (uint8_t b = first; b <= last; b++) {
+            bar(b == 0 ? 0LL : 1LL << b, (1LL << (b + 1)) - 1, "us", s->hist[b], peak);
+        }
+    }
+}
+
+static uint8_t readLatency(const char *p) {
+    char *end;
+    unsigned long v[5 + LATENCY_BINS];
+    for (uint8_t i = 0; i < 5 + LATENCY_BINS; i++) {
+        v[i] = strtoul(p, &end, 10);
+        if (end == p) {
+            return 0;
+        }
+        p = end;
+    }
+    latency.count = v[0];
+    latency.clock = v[1];
+    latency.min = v[2];
+    latency.avg = v[3];
+    latency.max = v[4];
+    memcpy(latency.hist, v + 5, sizeof(latency.hist));
+    return 1;
+}
+
+static void printLatency(void) {
+    if (!latency.valid || latency.count == 0) {
+        return;
+    }
+    double us = latency.clock > 0 ? 1e6 / latency.clock : 0;
+    printf("\ninterrupt latency (SysTick, %lu interrupts at %.1f MHz)\n", latency.count, latency.clock / 1e6);
+    printf("  min %lu, avg %lu, max %lu cycles (%.2f, %.2f, %.2f us), jitter %lu cycles\n", latency.min, latency.avg,
+            latency.max, latency.min * us, latency.avg * us, latency.max * us, latency.max - latency.min);
+
+    unsigned long peak = 0;
+    uint8_t first = LATENCY_BINS, last = 0;
+    for (uint8_t b = 0; b < LATENCY_BINS; b++) {
+        if (latency.hist[b] != 0) {
+            peak = latency.hist[b] > peak ? latency.hist[b] : peak;
+            first = b < first ? b : first;
+            last = b;
+        }
+    }
+    for (uint8_t b = first; b <= last; b++) {
+        bar(b == 0 ? 0LL : 1LL << b, (1LL << (b + 1)) - 1, "cycles", latency.hist[b], peak);
+    }
+}
+
+static void bar(long long from, long long to, const char *unit, unsigned long n, unsigned long peak) {
+    char line[BAR_LEN + 1];
+    uint32_t len = (uint64_t)n * BAR_LEN / peak;
+    memset(line, '#', len);
+    line[len] = 0;
+    printf("  %7lld .. %7lld %s %7lu %s\n", from, to, unit, n, line);
+}
@@ -0,0 +1,211 @@
+/**
+ * @file usb_throughput.c
+ * @author Paul Götzinger
+ * @brief Host tool: usb CDC throughput, requests a test pattern dump (usb command "dump") and
+ * measures the rate it arrives with, the pattern is checked line by line
+ * @version 1.0
+ * @date 2019-03-31
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_DEVICE  "/dev/ttyACM0"
+#define DEFAULT_SIZE    16384   //bytes
+#define LINE_LEN        48      //lines of the pattern incl. newline (DUMP_LINE, communication.c)
+#define TIMEOUT         5000    //ms without data
+#define RUNS_MAX        100
+
+/**
+ * @brief Open serial device in raw mode
+ *
+ * @param path device
+ * @return int file descriptor, -1 on failure
+ */
+static int openDevice(const char *path);
+
+/**
+ * @brief Request one dump and receive it
+ *
+ * @param fd device
+ * @param size bytes of pattern
+ * @param ms duration from request to end of pattern
+ * @return int 0 on success, -1 on timeout, -2 on pattern mismatch
+ */
+static int dump(int fd, unsigned long size, double *ms);
+
+/**
+ * @brief Check one line of the pattern (without newline)
+ *
+ * @param line received line
+ * @param len length of line
+ * @param offset offset of line in pattern
+ * @param size bytes of pattern
+ * @return int 1 if it matches
+ */
+static int checkLine(const char *line, size_t len, unsigned long offset, unsigned long size);
+
+/**
+ * @brief Retrieve monotonic time
+ *
+ * @return double ms
+ */
+static double now(void);
+
+int main(int argc, char **argv) {
+    const char *path = DEFAULT_DEVICE;
+    unsigned long size = DEFAULT_SIZE;
+    int runs = 3;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:s:n:")) != -1) {
+        switch (opt) {
+            case 'd':
+                path = optarg;
+                break;
+            case 's':
+                size = strtoul(optarg, 0, 10);
+                break;
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d device] [-s bytes] [-n runs]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (size == 0 || runs < 1 || runs > RUNS_MAX) {
+        fprintf(stderr, "invalid size or runs\n");
+        return 2;
+    }
+
+    int fd = openDevice(path);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+
+    //first run warms up the host driver, all runs are reported
+    double best = 0;
+    double sum = 0;
+    for (int i = 0; i < runs; i++) {
+        double ms;
+        int result = dump(fd, size, &ms);
+        if (result != 0) {
+            printf("run %d: %s\n", i + 1, result == -1 ? "timeout" : "pattern mismatch");
+            printf("FAILED\n");
+            close(fd);
+            return 1;
+        }
+        double rate = size / 1024.0 / (ms / 1000.0);
+        printf("run %d: %lu bytes in %.1f ms, %.1f KB/s\n", i + 1, size, ms, rate);
+        sum += rate;
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    printf("dump %lu bytes, %d runs: avg %.1f KB/s, best %.1f KB/s\n", size, runs, sum / runs, best);
+    printf("PASSED\n");
+
+    close(fd);
+    return 0;
+}
+
+static int openDevice(const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 1;    //0.1 s read timeout
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int dump(int fd, unsigned long size, double *ms) {
+    char cmd[32];
+    char buf[4096];
+    char line[LINE_LEN + 1];
+    size_t lineLen = 0;
+    unsigned long offset = 0;
+
+    int len = snprintf(cmd, sizeof(cmd), "dump %lu\n", size);
+    double start = now();
+    double last = start;
+    if (write(fd, cmd, len) != len) {
+        return -1;
+    }
+
+    while (1) {
+        ssize_t cnt = read(fd, buf, sizeof(buf));
+        if (cnt <= 0) {
+            if (now() - last > TIMEOUT) {
+                return -1;
+            }
+            continue;
+        }
+        last = now();
+
+        for (ssize_t i = 0; i < cnt; i++) {
+            if (buf[i] != '\n') {
+                if (lineLen >= LINE_LEN) {
+                    return -2;
+                }
+                line[lineLen++] = buf[i];
+                continue;
+            }
+
+            if (offset >= size) {
+                //end of pattern, echo of other output is not expected
+                if (lineLen != 3 || memcmp(line, "end", 3) != 0) {
+                    return -2;
+                }
+                *ms = last - start;
+                return 0;
+            }
+            if (!checkLine(line, lineLen, offset, size)) {
+                return -2;
+            }
+            offset += lineLen + 1;
+            lineLen = 0;
+        }
+    }
+}
+
+static int checkLine(const char *line, size_t len, unsigned long offset, unsigned long size) {
+    //same construction as the firmware, the last line is cut
+    char expected[LINE_LEN];
+    int n = snprintf(expected, LINE_LEN, "%08lx ", offset);
+    for (int i = n; i < LINE_LEN - 1; i++) {
+        expected[i] = 'a' + (offset / LINE_LEN + i) % 26;
+    }
+    size_t want = LINE_LEN - 1;
+    if (size - offset < LINE_LEN) {
+        want = size - offset - 1;
+    }
+    return len == want && memcmp(line, expected, len) == 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
@@ -0,0 +1,622 @@
+/**
+ * @file fleet.c
+ * @author Paul Götzinger
+ * @brief Fleet simulator: burst collisions of many beacons in the same satellite footprint
+ * @version 1.0
+ * @date 2019-03-18
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define US_PER_MS       1000LL
+#define US_PER_S        1000000LL
+
+#define MAX_THREADS     256
+#define MAX_PATTERN     4096    //bursts read from watchplb-sim csv
+#define LINE_LEN        256
+
+//defaults
+#define DEF_BEACONS     1000
+#define DEF_PERIOD      50.0    //s, C/S T.001 repetition period
+#define DEF_BURST       174.5   //ms, radio.c frame: 160 ms preamble + 144 bit frame
+#define DEF_DURATION    3600.0  //s
+#define DEF_ACTIVATION  60.0    //s, window in which beacons are activated
+#define DEF_FIRST       35.0    //s, first burst after activation (gnss fix)
+#define DEF_CLOCK       1.0     //%, HSI16 factory trim
+#define DEF_TRIALS      16
+#define DEF_CHANNELS    1
+
+#define T001_JITTER     0.05    //period randomized by +-5%
+#define SLOT_GUARD      10.0    //ms, guard time between gnss slots
+#define SLOT_SYNC_ERR   1.0     //ms, error of gnss time at beacon
+
+#define TEST_BEACONS    100     //self test: load 0.35 per channel, half of the bursts collide
+#define TEST_ALOHA_TOL  0.02    //self test: allowed deviation from aloha
+#define TEST_THREADS    4       //self test: threads compared with one on a single core host
+
+/**
+ * @brief Scheduling policies
+ *
+ */
+typedef enum {
+    Policy_Fixed = 0,   //constant interval after start of last burst (reference)
+    Policy_T001,        //interval randomized by +-5% (C/S T.001, emergencyCall.c)
+    Policy_Slotted,     //bursts start at gnss time slots, random slot count per interval
+    Policy_Firmware,    //burst pattern recorded by watchplb-sim
+    Policy_Count
+} Policy;
+
+static const char *policyNames[Policy_Count] = {"fixed", "t001", "slotted", "firmware"};
+
+/**
+ * @brief Simulation settings
+ *
+ */
+typedef struct {
+    uint32_t beacons;
+    uint32_t channels;
+    uint32_t trials;
+    uint32_t threads;
+    int64_t  period;        //us
+    int64_t  burst;         //us
+    int64_t  duration;      //us
+    int64_t  activation;    //us
+    int64_t  first;         //us
+    double   clock;         //relative clock tolerance
+} Settings;
+
+/**
+ * @brief Burst as seen by the satellite
+ *
+ */
+typedef struct {
+    int64_t  start;
+    int64_t  end;
+    uint32_t beacon;
+    uint16_t channel;
+    uint8_t  collided;
+} Burst;
+
+/**
+ * @brief Result of one trial
+ *
+ */
+typedef struct {
+    uint64_t bursts;
+    uint64_t collided;
+    uint32_t never;         //beacons without clean burst
+    int64_t  *firstClean;   //time to first clean burst per beacon, -1 if none
+} Result;
+
+/**
+ * @brief Work shared between threads
+ *
+ */
+typedef struct {
+    Policy policy;
+    uint32_t nextTrial;
+    pthread_mutex_t lock;
+    Result *results;
+} Work;
+
+static Settings settings = {
+    .beacons = DEF_BEACONS,
+    .channels = DEF_CHANNELS,
+    .trials = DEF_TRIALS,
+    .threads = 0,
+    .period = DEF_PERIOD * US_PER_S,
+    .burst = DEF_BURST * US_PER_MS,
+    .duration = DEF_DURATION * US_PER_S,
+    .activation = DEF_ACTIVATION * US_PER_S,
+    .first = DEF_FIRST * US_PER_S,
+    .clock = DEF_CLOCK / 100
+};
+
+static int64_t patternStart[MAX_PATTERN];  //burst start relative to first burst
+static int64_t patternLen[MAX_PATTERN];
+static uint32_t patternCount;
+static int64_t patternCycle;               //pattern repeats after this time
+
+/**
+ * @brief Random number generator state (xorshift64*)
+ *
+ */
+typedef struct {
+    uint64_t s;
+} Random;
+
+/**
+ * @brief Seed generator, every trial has its own sequence
+ *
+ * @param r generator
+ * @param seed seed
+ */
+static void seed(Random *r, uint64_t seed);
+
+/**
+ * @brief Uniform random number in [0, 1)
+ *
+ * @param r generator
+ * @return double random number
+ */
+static double uniform(Random *r);
+
+/**
+ * @brief Load burst pattern recorded by watchplb-sim (-b)
+ *
+ * @param file csv file
+ * @return int 0 on success
+ */
+static int loadPattern(const char *file);
+
+/**
+ * @brief Generate bursts of all beacons for one trial
+ *
+ * @param policy scheduling policy
+ * @param r generator
+ * @param bursts burst buffer (grown if necessary)
+ * @param cap capacity of burst buffer
+ * @param activation activation time per beacon
+ * @return uint64_t number of bursts
+ */
+static uint64_t generate(Policy policy, Random *r, Burst **bursts, uint64_t *cap, int64_t *activation);
+
+/**
+ * @brief Mark overlapping bursts on the same channel
+ *
+ * @param bursts bursts
+ * @param cnt number of bursts
+ */
+static void collide(Burst *bursts, uint64_t cnt);
+
+/**
+ * @brief Worker thread: runs trials until all are done
+ *
+ * @param arg work
+ * @return void* unused
+ */
+static void* worker(void *arg);
+
+/**
+ * @brief Run all trials of a policy on worker threads
+ *
+ * @param policy policy
+ * @param threads number of threads
+ * @return Result* results of all trials, release with freeResults
+ */
+static Result* run(Policy policy, uint32_t threads);
+
+/**
+ * @brief Release results of all trials
+ *
+ * @param results results
+ */
+static void freeResults(Result *results);
+
+/**
+ * @brief Offered load per channel (burst time per period)
+ *
+ * @param policy policy
+ * @return double load
+ */
+static double offeredLoad(Policy policy);
+
+/**
+ * @brief Print results of policy
+ *
+ * @param policy policy
+ * @param results results of all trials
+ */
+static void report(Policy policy, Result *results);
+
+/**
+ * @brief Self test: collision marking against a pairwise check, results with 1 and
+ * all threads, collision rates against pure and slotted aloha
+ *
+ * @return int 0 if all checks passed
+ */
+static int selfTest(void);
+
+static int cmpBurst(const void *a, const void *b) {
+    const Burst *x = a, *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int cmpTime(const void *a, const void *b) {
+    const int64_t *x = a, *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    const char *pattern = 0;
+    uint8_t policies[Policy_Count] = {1, 1, 1, 0};
+    uint8_t test = 0;
+
+    while ((opt = getopt(argc, argv, "n:c:t:j:p:d:T:a:f:k:b:P:sh")) != -1) {
+        switch (opt) {
+            case 'n': settings.beacons = atoi(optarg); break;
+            case 'c': settings.channels = atoi(optarg); break;
+            case 't': settings.trials = atoi(optarg); break;
+            case 'j': settings.threads = atoi(optarg); break;
+            case 'p': settings.period = atof(optarg) * US_PER_S; break;
+            case 'd': settings.burst = atof(optarg) * US_PER_MS; break;
+            case 'T': settings.duration = atof(optarg) * US_PER_S; break;
+            case 'a': settings.activation = atof(optarg) * US_PER_S; break;
+            case 'f': settings.first = atof(optarg) * US_PER_S; break;
+            case 'k': settings.clock = atof(optarg) / 100; break;
+            case 'b': pattern = optarg; break;
+            case 'P':
+                memset(policies, 0, sizeof(policies));
+                for (char *tok = strtok(optarg, ","); tok != 0; tok = strtok(0, ",")) {
+                    for (uint8_t i = 0; i < Policy_Count; i++) {
+                        if (strcmp(tok, policyNames[i]) == 0) {
+                            policies[i] = 1;
+                        }
+                    }
+                }
+                break;
+            case 's': test = 1; break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [options]\n"
+                        "  -n beacons      number of beacons (%u)\n"
+                        "  -c channels     frequency channels, chosen at random per beacon (%u)\n"
+                        "  -p seconds      repetition period (%.1f)\n"
+                        "  -d ms           burst duration (%.1f)\n"
+                        "  -b bursts.csv   burst pattern and duration recorded by watchplb-sim -b\n"
+                        "  -T seconds      simulated time (%.0f)\n"
+                        "  -a seconds      activation window (%.0f)\n"
+                        "  -f seconds      first burst after activation (%.0f)\n"
+                        "  -k percent      clock tolerance (%.1f)\n"
+                        "  -t trials       independent trials (%u)\n"
+                        "  -j threads      worker threads (cores)\n"
+                        "  -P policies     fixed,t001,slotted,firmware (fixed,t001,slotted)\n"
+                        "  -s              self test, PASSED or FAILED\n",
+                        argv[0], DEF_BEACONS, DEF_CHANNELS, DEF_PERIOD, DEF_BURST, DEF_DURATION,
+                        DEF_ACTIVATION, DEF_FIRST, DEF_CLOCK, DEF_TRIALS);
+                return 1;
+        }
+    }
+
+    if (pattern != 0) {
+        if (loadPattern(pattern) != 0) {
+            fprintf(stderr, "cannot load burst pattern %s\n", pattern);
+            return 1;
+        }
+        policies[Policy_Firmware] = 1;
+    } else if (policies[Policy_Firmware]) {
+        fprintf(stderr, "policy firmware needs a burst pattern (-b)\n");
+        return 1;
+    }
+    if (settings.beacons == 0 || settings.channels == 0 || settings.trials == 0 || settings.period <= settings.burst) {
+        fprintf(stderr, "invalid settings\n");
+        return 1;
+    }
+    if (settings.threads == 0) {
+        settings.threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    settings.threads = settings.threads > MAX_THREADS ? MAX_THREADS : settings.threads;
+    if (test) {
+        return selfTest();
+    }
+
+    printf("beacons %u, channels %u, period %.1f s, burst %.1f ms, clock +-%.2f %%\n",
+            settings.beacons, settings.channels, settings.period / 1e6, settings.burst / 1e3, settings.clock * 100);
+    printf("%u trials of %.0f s on %u threads\n\n", settings.trials, settings.duration / 1e6, settings.threads);
+    printf("%-9s %10s %8s %8s %8s | first clean burst after activation\n", "policy", "bursts", "collided", "aloha", "");
+    printf("%-9s %10s %8s %8s %8s | %8s %8s %8s %8s %7s\n", "", "", "", "pure", "slotted", "p50", "p90", "p99", "max", "never");
+
+    for (uint8_t p = 0; p < Policy_Count; p++) {
+        if (!policies[p]) {
+            continue;
+        }
+
+        Result *results = run(p, settings.threads);
+        report(p, results);
+        freeResults(results);
+    }
+    return 0;
+}
+
+static void seed(Random *r, uint64_t seed) {
+    //splitmix64 to spread consecutive seeds
+    seed += 0x9E3779B97F4A7C15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    r->s = (seed ^ (seed >> 31)) | 1;
+}
+
+static double uniform(Random *r) {
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return ((r->s * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int loadPattern(const char *file) {
+    FILE *in = fopen(file, "r");
+    if (in == 0) {
+        return -1;
+    }
+
+    char line[LINE_LEN];
+    int64_t first = -1, sum = 0;
+    while (fgets(line, sizeof(line), in) != 0 && patternCount < MAX_PATTERN) {
+        long long start, end;
+        if (sscanf(line, "%lld,%lld", &start, &end) != 2 || end <= start) {
+            continue;   //header
+        }
+        first = first < 0 ? start : first;
+        patternStart[patternCount] = start - first;
+        patternLen[patternCount] = end - start;
+        sum += end - start;
+        patternCount++;
+    }
+    fclose(in);
+
+    if (patternCount < 2) {
+        return -1;
+    }
+    //repeat with the mean interval of the recording
+    int64_t last = patternStart[patternCount - 1];
+    patternCycle = last + last / (patternCount - 1);
+    settings.burst = sum / patternCount;
+    return 0;
+}
+
+static uint64_t generate(Policy policy, Random *r, Burst **bursts, uint64_t *cap, int64_t *activation) {
+    uint64_t cnt = 0;
+    int64_t slot = settings.burst + SLOT_GUARD * US_PER_MS;
+
+    for (uint32_t b = 0; b < settings.beacons; b++) {
+        //independent clock: all beacon internal times are scaled
+        double scale = 1 + settings.clock * (2 * uniform(r) - 1);
+        uint16_t channel = uniform(r) * settings.channels;
+        int64_t t = activation[b] = uniform(r) * settings.activation;
+        uint32_t idx = 0;
+
+        t += settings.first * scale;
+        while (t < settings.duration) {
+            int64_t len = settings.burst;
+            int64_t interval;
+
+            switch (policy) {
+                case Policy_Fixed:
+                    //EMC_Process: next burst once tick > start + interval, 1 ms tick
+                    interval = (settings.period / US_PER_MS + 1) * US_PER_MS * scale;
+                    break;
+                case Policy_T001:
+                    interval = settings.period * (1 + T001_JITTER * (2 * uniform(r) - 1)) * scale;
+                    break;
+                case Policy_Slotted:
+                    //gnss time is common to all beacons, start at the next slot
+                    t = (t + slot - 1) / slot * slot + (int64_t)(SLOT_SYNC_ERR * US_PER_MS * (2 * uniform(r) - 1));
+                    interval = settings.period * (1 + T001_JITTER * (2 * uniform(r) - 1));
+                    break;
+                case Policy_Firmware:
+                default:
+                    len = patternLen[idx % patternCount];
+                    interval = ((idx + 1) % patternCount == 0 ? patternCycle - patternStart[idx % patternCount]
+                            : patternStart[(idx + 1) % patternCount] - patternStart[idx % patternCount]) * scale;
+                    len *= scale;
+                    idx++;
+                    break;
+            }
+
+            if (cnt == *cap) {
+                *cap = *cap * 2 + 1024;
+                *bursts = realloc(*bursts, *cap * sizeof(Burst));
+            }
+            Burst *burst = &(*bursts)[cnt++];
+            burst->start = t;
+            burst->end = t + len;
+            burst->beacon = b;
+            burst->channel = channel;
+            burst->collided = 0;
+
+            t += interval > len ? interval : len;
+        }
+    }
+    return cnt;
+}
+
+static void collide(Burst *bursts, uint64_t cnt) {
+    //latest ending burst per channel
+    int64_t *maxEnd = malloc(settings.channels * sizeof(int64_t));
+    uint64_t *owner = malloc(settings.channels * sizeof(uint64_t));
+    for (uint32_t c = 0; c < settings.channels; c++) {
+        maxEnd[c] = INT64_MIN;
+    }
+
+    qsort(bursts, cnt, sizeof(Burst), cmpBurst);
+    for (uint64_t i = 0; i < cnt; i++) {
+        uint16_t c = bursts[i].channel;
+        if (bursts[i].start < maxEnd[c]) {
+            //every earlier burst overlapping this one also overlaps the owner, so it is marked already
+            bursts[i].collided = 1;
+            bursts[owner[c]].collided = 1;
+        }
+        if (bursts[i].end > maxEnd[c]) {
+            maxEnd[c] = bursts[i].end;
+            owner[c] = i;
+        }
+    }
+    free(maxEnd);
+    free(owner);
+}
+
+static void* worker(void *arg) {
+    Work *work = arg;
+    Burst *bursts = 0;
+    uint64_t cap = 0;
+    int64_t *activation = malloc(settings.beacons * sizeof(int64_t));
+
+    while (1) {
+        pthread_mutex_lock(&work->lock);
+        uint32_t trial = work->nextTrial++;
+        pthread_mutex_unlock(&work->lock);
+        if (trial >= settings.trials) {
+            break;
+        }
+
+        //same seed for all policies, trials are independent of the thread count
+        Random r;
+        seed(&r, trial);
+        uint64_t cnt = generate(work->policy, &r, &bursts, &cap, activation);
+        collide(bursts, cnt);
+
+        Result *res = &work->results[trial];
+        res->bursts = cnt;
+        res->firstClean = malloc(settings.beacons * sizeof(int64_t));
+        for (uint32_t b = 0; b < settings.beacons; b++) {
+            res->firstClean[b] = -1;
+        }
+        for (uint64_t i = 0; i < cnt; i++) {
+            Burst *burst = &bursts[i];
+            if (burst->collided) {
+                res->collided++;
+            } else if (res->firstClean[burst->beacon] < 0) {
+                res->firstClean[burst->beacon] = burst->start - activation[burst->beacon];
+            }
+        }
+        for (uint32_t b = 0; b < settings.beacons; b++) {
+            res->never += res->firstClean[b] < 0;
+        }
+    }
+
+    free(activation);
+    free(bursts);
+    return 0;
+}
+
+static Result* run(Policy policy, uint32_t threads) {
+    Work work;
+    work.policy = policy;
+    work.nextTrial = 0;
+    work.results = calloc(settings.trials, sizeof(Result));
+    pthread_mutex_init(&work.lock, 0);
+
+    pthread_t thread[MAX_THREADS];
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_create(&thread[i], 0, worker, &work);
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(thread[i], 0);
+    }
+    pthread_mutex_destroy(&work.lock);
+    return work.results;
+}
+
+static void freeResults(Result *results) {
+    for (uint32_t i = 0; i < settings.trials; i++) {
+        free(results[i].firstClean);
+    }
+    free(results);
+}
+
+static double offeredLoad(Policy policy) {
+    int64_t len = policy == Policy_Slotted ? settings.burst + SLOT_GUARD * US_PER_MS : settings.burst;
+    if (policy == Policy_Firmware) {
+        return (double)settings.beacons / settings.channels * len * patternCount / patternCycle;
+    }
+    return (double)settings.beacons / settings.channels * len / settings.period;
+}
+
+static void report(Policy policy, Result *results) {
+    uint64_t bursts = 0, collided = 0, never = 0, cnt = 0;
+    int64_t *times = malloc((uint64_t)settings.trials * settings.beacons * sizeof(int64_t));
+
+    for (uint32_t i = 0; i < settings.trials; i++) {
+        bursts += results[i].bursts;
+        collided += results[i].collided;
+        never += results[i].never;
+        for (uint32_t b = 0; b < settings.beacons; b++) {
+            if (results[i].firstClean[b] >= 0) {
+                times[cnt++] = results[i].firstClean[b];
+            }
+        }
+    }
+    qsort(times, cnt, sizeof(int64_t), cmpTime);
+
+    //reference: offered load per channel and success probability of (slotted) aloha
+    double load = offeredLoad(policy);
+
+    printf("%-9s %10llu %7.2f%% %7.2f%% %7.2f%% |", policyNames[policy], (unsigned long long)bursts,
+            bursts ? 100.0 * collided / bursts : 0, 100 * (1 - exp(-2 * load)), 100 * (1 - exp(-load)));
+    if (cnt > 0) {
+        printf(" %7.1fs %7.1fs %7.1fs %7.1fs", times[cnt / 2] / 1e6, times[cnt * 9 / 10] / 1e6,
+                times[cnt * 99 / 100] / 1e6, times[cnt - 1] / 1e6);
+    } else {
+        printf(" %8s %8s %8s %8s", "-", "-", "-", "-");
+    }
+    printf(" %6.2f%%\n", 100.0 * never / ((uint64_t)settings.trials * settings.beacons));
+    free(times);
+}
+
+static int selfTest(void) {
+    int failed = 0;
+    settings.beacons = TEST_BEACONS;
+    uint32_t threads = settings.threads > 1 ? settings.threads : TEST_THREADS;
+
+    //collision marking against the pairwise overlap check
+    Random r;
+    Burst *bursts = 0;
+    uint64_t cap = 0;
+    int64_t *activation = malloc(settings.beacons * sizeof(int64_t));
+    seed(&r, 1);
+    uint64_t cnt = generate(Policy_T001, &r, &bursts, &cap, activation);
+    collide(bursts, cnt);
+    uint64_t wrong = 0;
+    for (uint64_t i = 0; i < cnt; i++) {
+        uint8_t overlap = 0;
+        for (uint64_t j = 0; j < cnt && !overlap; j++) {
+            overlap = j != i && bursts[j].channel == bursts[i].channel && bursts[j].start < bursts[i].end
+                    && bursts[i].start < bursts[j].end;
+        }
+        wrong += overlap != bursts[i].collided;
+    }
+    printf("collisions   %llu bursts, %llu marked differently than pairwise\n", (unsigned long long)cnt,
+            (unsigned long long)wrong);
+    failed += wrong != 0;
+    free(activation);
+    free(bursts);
+
+    for (uint8_t p = 0; p < Policy_Firmware; p++) {
+        //trials do not depend on the thread count
+        Result *one = run(p, 1);
+        Result *all = run(p, threads);
+        uint32_t differ = 0;
+        uint64_t total = 0, collided = 0;
+        for (uint32_t i = 0; i < settings.trials; i++) {
+            differ += one[i].bursts != all[i].bursts || one[i].collided != all[i].collided
+                    || memcmp(one[i].firstClean, all[i].firstClean, settings.beacons * sizeof(int64_t)) != 0;
+            total += one[i].bursts;
+            collided += one[i].collided;
+        }
+
+        //randomized intervals: every other burst is at a random phase, pure aloha
+        //slotted: a burst collides only with bursts of the same slot, slotted aloha
+        double load = offeredLoad(p);
+        double rate = total ? (double)collided / total : 0;
+        double aloha = p == Policy_Slotted ? 1 - exp(-load) : 1 - exp(-2 * load);
+        uint8_t ok = differ == 0 && (p == Policy_Fixed || fabs(rate - aloha) < TEST_ALOHA_TOL);
+        printf("%-9s    %u of %u trials differ on %u threads, collided %.2f%%, aloha %.2f%%%s\n", policyNames[p],
+                differ, settings.trials, threads, 100 * rate, 100 * aloha, ok ? "" : " FAILED");
+        failed += !ok;
+        freeResults(one);
+        freeResults(all);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,434 @@
+/**
+ * @file sim.h
+ * @author Paul Götzinger
+ * @brief Host simulator: virtual clock, models and reports
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "record.h"
+
+#define SIM_US_PER_MS     1000ULL
+#define SIM_US_PER_S      1000000ULL
+#define SIM_NEVER         UINT64_MAX
+
+#define SIM_CORE_CLOCK    32000000  //HSI16 * 12 / 6
+
+#define SIM_KEY_COUNT     4
+
+//model currents in mA
+#define SIM_I_MCU_MSI       0.4f    //after reset (MSI 2.1 MHz)
+#define SIM_I_MCU_RUN       4.8f    //32 MHz run mode
+#define SIM_I_MCU_LOW       0.9f    //clock reduced by SystemClock_SleepMode_Config
+#define SIM_I_GNSS_ACQ      25.0f   //acquisition
+#define SIM_I_GNSS_TRACK    18.0f   //tracking
+#define SIM_I_GNSS_SYSTEM   3.0f    //per constellation more or less than the default GPS and GLONASS
+#define SIM_I_GNSS_BACKUP   0.015f  //backup mode (RXM-PMREQ)
+#define SIM_I_RADIO_OFF     0.0f
+#define SIM_I_RADIO_STANDBY 0.6f
+#define SIM_I_RADIO_SYNTH   9.0f
+#define SIM_I_RADIO_TX      45.0f   //transceiver only, no external power amplifier
+#define SIM_I_HOMER_ENABLED 1.0f    //121.5 MHz homing transmitter powered, carrier off
+#define SIM_I_HOMER_KEYED   35.0f   //more while the carrier is on (50 mW)
+#define SIM_I_LED           2.0f    //per led
+#define SIM_I_VIBRATOR      60.0f
+
+/**
+ * @brief Energy consumers
+ *
+ */
+typedef enum {
+    SIM_Load_MCU = 0,
+    SIM_Load_GNSS,
+    SIM_Load_Radio,
+    SIM_Load_LED,
+    SIM_Load_Vibrator,
+    SIM_Load_Homer,
+    SIM_Load_Count
+} SIM_Load;
+
+/**
+ * @brief Simulation settings (from scenario file)
+ *
+ */
+typedef struct {
+    uint64_t duration;      //simulated time in us
+    uint64_t ttff;          //gnss time to first fix in us
+    uint64_t hotStart;      //gnss time to fix after backup mode in us
+    uint32_t utcStart;      //utc time of day at start in seconds
+    uint8_t  battery;       //battery state in percent
+    double   capacity;      //battery capacity in mAh for the operating time
+    uint8_t  verbose;       //print firmware log
+    const char *gnssFile;   //gnss script
+    const char *burstFile;  //burst csv output, 0 if unused
+    const char *replayFile; //recorded inputs to replay, 0 if unused
+    const char *recordFile; //recorded inputs written at the end, 0 if unused
+    uint8_t  truthValid;    //true position known
+    double   truthLat;      //true position in deg, north and east positive
+    double   truthLon;
+} SIM_Settings;
+
+extern SIM_Settings SIM_Config;
+
+//clock
+
+/**
+ * @brief Retrieve virtual time
+ *
+ * @return uint64_t time since start in us
+ */
+uint64_t SIM_Now(void);
+
+/**
+ * @brief Advance virtual time and update all models
+ *
+ * @param us time to advance in us
+ */
+void SIM_Advance(uint64_t us);
+
+/**
+ * @brief Firmware waits for input; skips time to next model event or next tick
+ *
+ */
+void SIM_Idle(void);
+
+/**
+ * @brief Set current of energy consumer
+ *
+ * @param load consumer
+ * @param mA current in mA
+ */
+void SIM_SetCurrent(SIM_Load load, float mA);
+
+/**
+ * @brief Retrieve consumed charge
+ *
+ * @param load consumer
+ * @return double charge in mAh
+ */
+double SIM_GetCharge(SIM_Load load);
+
+/**
+ * @brief Format time for reports (hh:mm:ss.mmm)
+ *
+ * @param us time in us
+ * @param buf buffer (at least 16 bytes)
+ * @return const char* buf
+ */
+const char* SIM_FormatTime(uint64_t us, char *buf);
+
+//scenario
+
+/**
+ * @brief Load scenario file
+ *
+ * @param file scenario file
+ * @return int 0 on success
+ */
+int SIM_LoadScenario(const char *file);
+
+/**
+ * @brief Execute due scenario actions
+ *
+ * @param now virtual time
+ */
+void SIM_ScenarioUpdate(uint64_t now);
+
+/**
+ * @brief Time of next scenario action
+ *
+ * @return uint64_t time in us, SIM_NEVER if none
+ */
+uint64_t SIM_ScenarioNextEvent(void);
+
+/**
+ * @brief Distance of the position published by the firmware to the true position
+ *
+ * @return double error in m, negative if unknown
+ */
+double SIM_PositionError(void);
+
+/**
+ * @brief Distance of a position to the true position
+ *
+ * @param lat latitude in deg, north positive
+ * @param lon longitude in deg, east positive
+ * @return double error in m, negative if no true position is known
+ */
+double SIM_TruthDistance(double lat, double lon);
+
+/**
+ * @brief Retrieve state of virtual key
+ *
+ * @param key key index (0 .. SIM_KEY_COUNT-1)
+ * @return uint8_t 1 if pressed
+ */
+uint8_t SIM_KeyPressed(uint8_t key);
+
+/**
+ * @brief Set state of all virtual keys (replay)
+ *
+ * @param mask key mask
+ */
+void SIM_SetKeys(uint8_t mask);
+
+//gnss model
+
+/**
+ * @brief Load gnss script
+ *
+ * @param file script file
+ * @return int 0 on success
+ */
+int SIM_GNSS_Init(const char *file);
+
+/**
+ * @brief Firmware opened gnss uart
+ *
+ * @param rx receive function of uart stand-in
+ */
+void SIM_GNSS_Attach(void (*rx)(uint8_t byte));
+
+/**
+ * @brief Data sent by firmware to gnss receiver
+ *
+ * @param data data
+ * @param len length of data
+ */
+void SIM_GNSS_Receive(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Update gnss model
+ *
+ * @param now virtual time
+ */
+void SIM_GNSS_Update(uint64_t now);
+
+/**
+ * @brief Time of next gnss output byte
+ *
+ * @return uint64_t time in us, SIM_NEVER if none
+ */
+uint64_t SIM_GNSS_NextEvent(void);
+
+/**
+ * @brief Retrieve time the receiver was not in backup mode
+ *
+ * @return uint64_t time in us
+ */
+uint64_t SIM_GNSS_OnTime(void);
+
+/**
+ * @brief Print gnss report
+ *
+ * @param out output stream
+ */
+void SIM_GNSS_Report(FILE *out);
+
+//radio model
+
+/**
+ * @brief Initialize transceiver model
+ *
+ */
+void SIM_RADIO_Init(void);
+
+/**
+ * @brief Chip select of transceiver
+ *
+ * @param active 1 if selected
+ */
+void SIM_RADIO_Select(uint8_t active);
+
+/**
+ * @brief Transfer byte over spi
+ *
+ * @param tx byte sent by firmware
+ * @return uint8_t byte returned by transceiver
+ */
+uint8_t SIM_RADIO_Transfer(uint8_t tx);
+
+/**
+ * @brief Update transceiver model
+ *
+ * @param now virtual time
+ */
+void SIM_RADIO_Update(uint64_t now);
+
+/**
+ * @brief Time of next fifo event
+ *
+ * @return uint64_t time in us, SIM_NEVER if none
+ */
+uint64_t SIM_RADIO_NextEvent(void);
+
+/**
+ * @brief Check if the fifo accepts data while transmitting
+ *
+ * @return uint8_t 1 if firmware has to refill the fifo
+ */
+uint8_t SIM_RADIO_FifoFree(void);
+
+/**
+ * @brief Print radio report
+ *
+ * @param out output stream
+ */
+void SIM_RADIO_Report(FILE *out);
+
+/**
+ * @brief Retrieve number of bursts
+ *
+ * @return uint32_t bursts
+ */
+uint32_t SIM_RADIO_BurstCount(void);
+
+/**
+ * @brief Retrieve start of first burst
+ *
+ * @return uint64_t time in us, SIM_NEVER if none
+ */
+uint64_t SIM_RADIO_FirstBurst(void);
+
+/**
+ * @brief Bus stalled by an eeprom operation, a refill during a burst is delayed
+ *
+ * @param start start of stall in us
+ * @param end end of stall in us
+ */
+void SIM_RADIO_BusStall(uint64_t start, uint64_t end);
+
+//homing transmitter
+
+/**
+ * @brief Check the homing signal: sweep rate, audio range and modulation duty cycle
+ *
+ * @return uint8_t 1 if within the limits or no homing signal was sent
+ */
+uint8_t SIM_HOMER_Valid(void);
+
+/**
+ * @brief Print homing report, ends a running transmission
+ *
+ * @param out output stream
+ */
+void SIM_HOMER_Report(FILE *out);
+
+//peripherals
+
+/**
+ * @brief Deliver data to firmware usb receive callback
+ *
+ * @param data data
+ * @param len length of data
+ */
+void SIM_USB_Inject(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Retrieve number of programmed data eeprom words
+ *
+ * @return uint32_t words
+ */
+uint32_t SIM_EEPROM_Words(void);
+
+/**
+ * @brief Deliver data from the phone app, received by the ble module in transparent mode
+ *
+ * @param data data
+ * @param len length of data
+ */
+void SIM_BLE_Inject(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Print the count of replies to the phone app (ok, ignored, error) if there were any
+ *
+ * @param out report
+ */
+void SIM_BLE_Report(FILE *out);
+
+/**
+ * @brief Retrieve number of bytes lost because the gnss uart buffer was full
+ *
+ * @return uint32_t lost bytes
+ */
+uint32_t SIM_UART_Overflows(void);
+
+/**
+ * @brief Deliver recorded bytes to the gnss or ble uart, the gnss model output is dropped while replaying
+ *
+ * @param src REC_Source_Gnss or REC_Source_Ble
+ * @param data data
+ * @param len length of data
+ */
+void SIM_UART_Replay(REC_Source src, const uint8_t *data, uint16_t len);
+
+//replay of recorded inputs
+
+/**
+ * @brief Load recording (dump of the usb command "record")
+ *
+ * @param file recording
+ * @return int 0 on success
+ */
+int SIM_REPLAY_Init(const char *file);
+
+/**
+ * @brief Check if a recording is replayed
+ *
+ * @return uint8_t 1 if replaying
+ */
+uint8_t SIM_REPLAY_Active(void);
+
+/**
+ * @brief Deliver recorded stream bytes and key changes up to now
+ *
+ * @param now virtual time
+ */
+void SIM_REPLAY_Update(uint64_t now);
+
+/**
+ * @brief Time of next recorded input
+ *
+ * @return uint64_t time in us, SIM_NEVER if none
+ */
+uint64_t SIM_REPLAY_NextEvent(void);
+
+/**
+ * @brief Retrieve next recorded adc conversion
+ *
+ * @param value conversion
+ * @return uint8_t 1 if replayed, 0 if the model has to answer
+ */
+uint8_t SIM_REPLAY_Adc(int32_t *value);
+
+/**
+ * @brief Print replay report
+ *
+ * @param out output stream
+ */
+void SIM_REPLAY_Report(FILE *out);
+
+/**
+ * @brief Write recording of the firmware (same format as the usb command "record")
+ *
+ * @param file output file
+ * @return int 0 on success
+ */
+int SIM_REPLAY_Write(const char *file);
+
+/**
+ * @brief Finish simulation: print report and exit
+ *
+ * @param reason reason for end of simulation
+ */
+void SIM_Finish(const char *reason);
+
+#endif //!SIM_H
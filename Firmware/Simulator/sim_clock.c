@@ -0,0 +1,140 @@
+/**
+ * @file sim_clock.c
+ * @author Paul Götzinger
+ * @brief Host simulator: virtual clock, HAL tick and energy accounting
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+
+#define MIN(X, Y)  ((X) < (Y) ? (X) : (Y))
+
+#define US_PER_H   3600e6
+
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+SysTick_Type SIM_SysTick;
+TIM_TypeDef SIM_TIM6;
+RCC_TypeDef SIM_RCC;
+__IO uint32_t uwTick;
+
+static uint64_t now;
+static float current[SIM_Load_Count];
+static double charge[SIM_Load_Count];   //mA * us
+
+/**
+ * @brief Move virtual time forward, integrate energy and update models
+ *
+ * @param to new time
+ */
+static void step(uint64_t to);
+
+/**
+ * @brief Time of next model event
+ *
+ * @return uint64_t time in us
+ */
+static uint64_t nextEvent(void);
+
+uint64_t SIM_Now(void) {
+    return now;
+}
+
+void SIM_Advance(uint64_t us) {
+    uint64_t target = now + us;
+
+    //models have to see every event in between (e.g. gnss bytes during HAL_Delay)
+    for (uint64_t next = nextEvent(); next <= target; next = nextEvent()) {
+        step(next > now ? next : now + 1);
+    }
+    step(target);
+}
+
+void SIM_Idle(void) {
+    uint64_t tick = (now / SIM_US_PER_MS + 1) * SIM_US_PER_MS;
+    uint64_t next = MIN(nextEvent(), tick);
+
+    //the firmware polls the transceiver fifo while transmitting, no time is skipped
+    if (SIM_RADIO_FifoFree()) {
+        next = now + 1;
+    }
+
+    SIM_Advance(next > now ? next - now : 1);
+}
+
+void SIM_SetCurrent(SIM_Load load, float mA) {
+    if (load < SIM_Load_Count) {
+        current[load] = mA;
+    }
+}
+
+double SIM_GetCharge(SIM_Load load) {
+    return load < SIM_Load_Count ? charge[load] / US_PER_H : 0;
+}
+
+const char* SIM_FormatTime(uint64_t us, char *buf) {
+    uint64_t ms = us / SIM_US_PER_MS;
+    sprintf(buf, "%02u:%02u:%02u.%03u", (unsigned)(ms / 3600000), (unsigned)(ms / 60000 % 60),
+            (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+    return buf;
+}
+
+static void step(uint64_t to) {
+    if (to <= now) {
+        return;
+    }
+    if (to > SIM_Config.duration) {
+        to = SIM_Config.duration;
+    }
+
+    for (uint8_t i = 0; i < SIM_Load_Count; i++) {
+        charge[i] += current[i] * (double)(to - now);
+    }
+    now = to;
+    uwTick = now / SIM_US_PER_MS;
+
+    //systick counts down once per millisecond
+    SIM_SysTick.LOAD = SystemCoreClock / 1000 - 1;
+    SIM_SysTick.VAL = SIM_SysTick.LOAD - (uint32_t)((now % SIM_US_PER_MS) * (SIM_SysTick.LOAD + 1) / SIM_US_PER_MS);
+
+    SIM_TIM6.CNT = now & 0xFFFF;
+
+    SIM_ScenarioUpdate(now);
+    SIM_REPLAY_Update(now);
+    SIM_GNSS_Update(now);
+    SIM_RADIO_Update(now);
+
+    if (now >= SIM_Config.duration) {
+        SIM_Finish("end of scenario");
+    }
+}
+
+static uint64_t nextEvent(void) {
+    uint64_t next = SIM_ScenarioNextEvent();
+    next = MIN(next, SIM_REPLAY_NextEvent());
+    next = MIN(next, SIM_GNSS_NextEvent());
+    next = MIN(next, SIM_RADIO_NextEvent());
+    return MIN(next, SIM_Config.duration);
+}
+
+HAL_StatusTypeDef HAL_Init(void) {
+    SIM_SetCurrent(SIM_Load_MCU, SIM_I_MCU_MSI);
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void) {
+    //every poll of the tick costs a little time, busy loops make progress
+    SIM_Advance(1);
+    return now / SIM_US_PER_MS;
+}
+
+void HAL_Delay(uint32_t Delay) {
+    SIM_Advance(Delay * SIM_US_PER_MS);
+}
+
+void SIM_SystemReset(void) {
+    SIM_Finish("reset requested by firmware");
+}
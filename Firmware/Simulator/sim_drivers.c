@@ -0,0 +1,374 @@
+/**
+ * @file sim_drivers.c
+ * @author Paul Götzinger
+ * @brief Host simulator: stand-ins for uart, spi, usb and eeprom drivers
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include "uart.h"
+#include "spi_driver.h"
+#include "usb.h"
+#include "eeprom.h"
+#include <string.h>
+
+#define SPI_CLOCK         (SIM_CORE_CLOCK / 64)   //SPI_BAUDRATEPRESCALER_64
+#define SPI_BYTE_TIME     (8 * SIM_US_PER_S / SPI_CLOCK)
+#define CALL_TIME         1     //cost of a driver call in us
+#define EEPROM_WORD_TIME  3200  //erase and program of a data eeprom word in us, the bus is stalled
+
+#define BLE_START         0xAA  //BM70 frame: start, length (2), opcode, parameters, checksum
+#define BLE_RESET         0x02  //command: reset
+#define BLE_SEND_DATA     0x3F  //command: send transparent data
+#define BLE_COMPLETE      0x80  //event: command complete
+#define BLE_STATUS        0x81  //event: status report
+#define BLE_RECEIVED_DATA 0x9A  //event: received transparent data
+#define BLE_IDLE          0x09  //status: idle mode
+
+static UART_Instance *gnssUart;
+static UART_Instance *bleUart;
+static uint32_t uartOverflows;
+static USB_ReceiveCallback usbCallback;
+static uint8_t eeprom[EEPROM_SIZE];
+static uint64_t eepromBusyUntil;
+static uint32_t eepromWords;
+static uint32_t bleOk, bleIgnored, bleErrors;   //replies to the phone app
+
+/**
+ * @brief Byte from gnss model, stored in uart receive buffer
+ *
+ * @param byte received byte
+ */
+static void gnssRx(uint8_t byte);
+
+/**
+ * @brief Store byte in uart receive buffer
+ *
+ * @param inst uart instance
+ * @param byte received byte
+ * @return int 0 on success, -1 if the buffer is full
+ */
+static int uartRx(UART_Instance *inst, uint8_t byte);
+
+/**
+ * @brief Frame sent to the ble module, transparent data goes to the log, other commands are
+ * answered with command complete (a reset with a status report)
+ *
+ * @param data frame
+ * @param len length of frame
+ */
+static void bleTx(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Event of the ble module, stored in uart receive buffer
+ *
+ * @param opcode event opcode
+ * @param head parameters before data
+ * @param headLen length of head
+ * @param data data
+ * @param len length of data
+ */
+static void bleEvent(uint8_t opcode, const uint8_t *head, uint8_t headLen, const uint8_t *data, uint16_t len);
+
+//uart
+
+void UART_Init(UART_Instance* inst, const UART_Config* conf) {
+    if (inst == 0 || conf == 0) {
+        return;
+    }
+    memset(inst, 0, sizeof(UART_Instance));
+    inst->uart.Instance = conf->uart;
+
+    //the gnss receiver is connected to USART4
+    if (conf->uart == USART4) {
+        gnssUart = inst;
+        SIM_GNSS_Attach(gnssRx);
+    }
+    //the ble module is connected to USART1
+    if (conf->uart == USART1) {
+        bleUart = inst;
+    }
+}
+
+uint8_t UART_SendByte(UART_Instance* inst, uint8_t byte) {
+    return UART_SendData(inst, 1, &byte);
+}
+
+uint8_t UART_SendData(UART_Instance* inst, uint16_t len, uint8_t *data) {
+    SIM_Advance(CALL_TIME);
+    if (inst == gnssUart && inst != 0) {
+        SIM_GNSS_Receive(data, len);
+    } else if (inst == bleUart && inst != 0) {
+        bleTx(data, len);
+    }
+    return 1;
+}
+
+uint8_t UART_SendString(UART_Instance* inst, uint8_t *byte) {
+    return UART_SendData(inst, strlen((char*)byte), byte);
+}
+
+uint16_t UART_GetAvailableBytes(UART_Instance* inst) {
+    if (inst == 0) {
+        return 0;
+    }
+
+    uint16_t cnt = (inst->rxCircHead + UART_RXBUFFER_SIZE - inst->rxCircTail) % UART_RXBUFFER_SIZE;
+    if (cnt == 0 && inst == gnssUart) {
+        //firmware polls for input, nothing to do until the next event which may bring input; once per main
+        //loop pass (gnss first), the loop runs in every tick and the inputs are read in the tick they arrive
+        SIM_Idle();
+        cnt = (inst->rxCircHead + UART_RXBUFFER_SIZE - inst->rxCircTail) % UART_RXBUFFER_SIZE;
+    }
+    return cnt;
+}
+
+uint8_t UART_GetByte(UART_Instance* inst) {
+    uint8_t byte = 0;
+    UART_GetData(inst, 1, &byte);
+    return byte;
+}
+
+uint16_t UART_GetData(UART_Instance* inst, uint16_t len, uint8_t *data) {
+    uint16_t cnt = 0;
+
+    SIM_Advance(CALL_TIME);
+    while (inst != 0 && cnt < len && inst->rxCircTail != inst->rxCircHead) {
+        data[cnt++] = inst->rxCircBuf[inst->rxCircTail];
+        inst->rxCircTail = (inst->rxCircTail + 1) % UART_RXBUFFER_SIZE;
+    }
+    return cnt;
+}
+
+static void gnssRx(uint8_t byte) {
+    if (SIM_REPLAY_Active()) {
+        //recorded bytes replace the output of the gnss model
+        return;
+    }
+    if (uartRx(gnssUart, byte) != 0) {
+        uartOverflows++;
+    }
+}
+
+static int uartRx(UART_Instance *inst, uint8_t byte) {
+    uint16_t next = (inst->rxCircHead + 1) % UART_RXBUFFER_SIZE;
+    if (next == inst->rxCircTail) {
+        return -1;
+    }
+    inst->rxCircBuf[inst->rxCircHead] = byte;
+    inst->rxCircHead = next;
+    return 0;
+}
+
+void SIM_BLE_Inject(const uint8_t *data, uint16_t len) {
+    //event with connection handle and data
+    uint8_t handle = 0x01;
+    bleEvent(BLE_RECEIVED_DATA, &handle, 1, data, len);
+}
+
+static void bleEvent(uint8_t opcode, const uint8_t *head, uint8_t headLen, const uint8_t *data, uint16_t len) {
+    if (bleUart == 0) {
+        return;
+    }
+
+    //checksum makes the sum of length to checksum 0
+    uint16_t evtLen = 1 + headLen + len;
+    uint8_t start[] = { BLE_START, evtLen >> 8, evtLen & 0xFF, opcode };
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < sizeof(start); i++) {
+        uartRx(bleUart, start[i]);
+        sum += i > 0 ? start[i] : 0;
+    }
+    for (uint8_t i = 0; i < headLen; i++) {
+        uartRx(bleUart, head[i]);
+        sum += head[i];
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        uartRx(bleUart, data[i]);
+        sum += data[i];
+    }
+    uartRx(bleUart, -sum);
+}
+
+static void bleTx(const uint8_t *data, uint16_t len) {
+    if (len < 5 || data[0] != BLE_START) {
+        return;
+    }
+
+    //the recorded answers are replayed instead
+    if (data[3] != BLE_SEND_DATA && !SIM_REPLAY_Active()) {
+        uint8_t answer[] = { data[3], 0x00 };
+        if (data[3] == BLE_RESET) {
+            answer[0] = BLE_IDLE;
+            bleEvent(BLE_STATUS, answer, 1, 0, 0);
+        } else {
+            bleEvent(BLE_COMPLETE, answer, 2, 0, 0);
+        }
+    }
+
+    if (len < 6 || data[3] != BLE_SEND_DATA) {
+        return;
+    }
+    const char *text = (const char*)data + 5;
+    if (len - 6 >= 2 && strncmp(text, "ok", 2) == 0) {
+        bleOk++;
+    } else if (len - 6 >= 7 && strncmp(text, "ignored", 7) == 0) {
+        bleIgnored++;
+    } else if (len - 6 >= 5 && strncmp(text, "error", 5) == 0) {
+        bleErrors++;
+    }
+    if (!SIM_Config.verbose) {
+        return;
+    }
+
+    //skip header and connection handle, drop checksum
+    char buf[16];
+    printf("%s [BLE] ", SIM_FormatTime(SIM_Now(), buf));
+    fwrite(data + 5, 1, len - 6, stdout);
+}
+
+void SIM_BLE_Report(FILE *out) {
+    if (bleOk + bleIgnored + bleErrors > 0) {
+        fprintf(out, "ble replies         ok %u, ignored %u, errors %u\n", bleOk, bleIgnored, bleErrors);
+    }
+}
+
+uint32_t SIM_UART_Overflows(void) {
+    return uartOverflows;
+}
+
+void SIM_UART_Replay(REC_Source src, const uint8_t *data, uint16_t len) {
+    UART_Instance *inst = src == REC_Source_Gnss ? gnssUart : src == REC_Source_Ble ? bleUart : 0;
+    for (uint16_t i = 0; inst != 0 && i < len; i++) {
+        if (uartRx(inst, data[i]) != 0) {
+            uartOverflows++;
+        }
+    }
+}
+
+//spi (transceiver)
+
+SPI_RetType SPI_Init(SPI_Init_Struct * spi_init, const SPI_Config * conf) {
+    spi_init->conf = conf;
+    SIM_RADIO_Init();
+    return SPI_RET_OK;
+}
+
+SPI_RetType SPI_DeInit(SPI_Init_Struct * spi_init) {
+    return SPI_RET_OK;
+}
+
+SPI_RetType SPI_SendData(SPI_Init_Struct * spi_init, uint8_t * tx_buffer,
+        uint8_t tx_buffer_size, uint8_t timeout) {
+    for (uint8_t i = 0; i < tx_buffer_size; i++) {
+        uint8_t rx;
+        SPI_WriteRead(spi_init, tx_buffer[i], &rx, timeout);
+    }
+    return SPI_RET_OK;
+}
+
+SPI_RetType SPI_ReadData(SPI_Init_Struct * spi_init, uint8_t * rx_buffer,
+        uint8_t rx_buffer_size, uint8_t timeout) {
+    for (uint8_t i = 0; i < rx_buffer_size; i++) {
+        SPI_WriteRead(spi_init, 0xFF, &rx_buffer[i], timeout);
+    }
+    return SPI_RET_OK;
+}
+
+SPI_RetType SPI_WriteRead(SPI_Init_Struct * spi_init, uint8_t tx_byte,
+        uint8_t * rx_byte, uint8_t timeout) {
+    SIM_Advance(SPI_BYTE_TIME);
+    *rx_byte = SIM_RADIO_Transfer(tx_byte);
+    return SPI_RET_OK;
+}
+
+void SPI_CS_Enable(SPI_Init_Struct * spi_init) {
+    SIM_RADIO_Select(1);
+}
+
+void SPI_CS_Disable(SPI_Init_Struct * spi_init) {
+    SIM_RADIO_Select(0);
+}
+
+//usb
+
+HAL_StatusTypeDef USB_Init() {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef USB_SendData(uint8_t* Buf, uint16_t Len) {
+    if (SIM_Config.verbose) {
+        char buf[16];
+        static uint8_t lineStart = 1;
+        for (uint16_t i = 0; i < Len; i++) {
+            if (lineStart) {
+                printf("%s ", SIM_FormatTime(SIM_Now(), buf));
+            }
+            putchar(Buf[i]);
+            lineStart = Buf[i] == '\n';
+        }
+    }
+    return HAL_OK;
+}
+
+void USB_SetReceiveCallback(USB_ReceiveCallback cb) {
+    usbCallback = cb;
+}
+
+void USB_DataReceived(uint8_t* Buf, uint16_t Len) {
+    if (usbCallback != 0) {
+        usbCallback(Buf, Len);
+    }
+}
+
+void SIM_USB_Inject(const uint8_t *data, uint16_t len) {
+    USB_DataReceived((uint8_t*)data, len);
+}
+
+//eeprom
+
+HAL_StatusTypeDef EEPROM_Read(uint16_t offset, uint8_t *data, uint16_t len) {
+    if (data == 0 || (uint32_t)offset + len > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+    memcpy(data, eeprom + offset, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEPROM_Write(uint16_t offset, const uint8_t *data, uint16_t len) {
+    if (data == 0 || (uint32_t)offset + len > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+    memcpy(eeprom + offset, data, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEPROM_ProgramWord(uint16_t offset, uint32_t word) {
+    if ((offset & 3) != 0 || (uint32_t)offset + 4 > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+    if (EEPROM_IsBusy()) {
+        return HAL_BUSY;
+    }
+    memcpy(eeprom + offset, &word, 4);
+    eepromBusyUntil = SIM_Now() + EEPROM_WORD_TIME;
+    eepromWords++;
+    SIM_RADIO_BusStall(SIM_Now(), eepromBusyUntil);
+    return HAL_OK;
+}
+
+uint8_t EEPROM_IsBusy(void) {
+    SIM_Advance(CALL_TIME);
+    return SIM_Now() < eepromBusyUntil;
+}
+
+void EEPROM_Lock(void) {
+}
+
+uint32_t SIM_EEPROM_Words(void) {
+    return eepromWords;
+}
@@ -0,0 +1,694 @@
+/**
+ * @file sim_gnss.c
+ * @author Paul Götzinger
+ * @brief Host simulator: scripted gnss receiver (NMEA/UBX output, UBX-CFG acknowledge, backup mode)
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#define BAUD          9600
+#define BYTE_TIME     (10 * SIM_US_PER_S / BAUD)
+#define QUEUE_LEN     8192
+#define LINE_LEN      256
+#define SEC_PER_DAY   86400
+
+#define UBX_SYNC_1    0xB5
+#define UBX_SYNC_2    0x62
+#define UBX_CLASS_ACK 0x05
+#define UBX_ID_ACK    0x01
+#define UBX_CLASS_CFG 0x06
+#define UBX_ID_CFG_MSG 0x01
+#define UBX_ID_CFG_GNSS 0x3E
+#define UBX_CLASS_NAV 0x01
+#define UBX_ID_PVT    0x07
+#define UBX_CLASS_RXM 0x02
+#define UBX_ID_PMREQ  0x41
+#define UBX_MAX_LEN   512
+
+#define PMREQ_BACKUP  0x02    //flags: enter backup mode
+#define PMREQ_UARTRX  0x08    //wakeupSources: uart rx
+#define PVT_LEN       92
+#define PVT_UERE      4.0     //m, accuracy estimate of the receiver: hdop * uere
+#define FIELD_COUNT   24
+
+#define GNSS_GPS      0x01    //enabled systems, bit = CFG-GNSS gnssId
+#define GNSS_GALILEO  0x04
+#define GNSS_GLONASS  0x40
+#define GNSS_DEFAULT  (GNSS_GPS | GNSS_GLONASS)
+#define PROFILE_COUNT 8       //combinations of GPS, Galileo and GLONASS
+
+/**
+ * @brief Script line (NMEA sentence or UBX frame); empty line separates epochs
+ *
+ */
+typedef struct {
+    uint8_t *data;
+    uint16_t len;
+    uint8_t  ubx;
+} Line;
+
+/**
+ * @brief Statistics of a constellation profile
+ *
+ */
+typedef struct {
+    uint64_t on;        //us receiver on
+    double charge;      //mAs
+    uint32_t fixes;     //acquisitions ending with a fix
+    uint64_t acqTime;   //us, sum of acquisition times
+} Profile;
+
+/**
+ * @brief Fix of a script epoch
+ *
+ */
+typedef struct {
+    uint8_t valid;
+    double lat;         //deg, north positive
+    double lon;         //deg, east positive
+    uint8_t satellites;
+    double hdop;
+} Fix;
+
+static Line *lines;
+static uint32_t lineCount;
+static uint32_t *epochStart;    //first line of each epoch, the script is replayed by time of day
+static uint32_t epochCount;
+
+static uint8_t queue[QUEUE_LEN];
+static uint32_t qHead;
+static uint32_t qTail;
+
+static void (*uartRx)(uint8_t byte);
+static uint64_t nextByte = SIM_NEVER;
+static uint64_t nextEpoch;
+
+static uint64_t firstFix = SIM_NEVER;
+static uint32_t epochs;
+static uint32_t bytesSent;
+static uint32_t bytesLost;
+static uint32_t cfgCount;
+static uint8_t pvtRate;
+
+static uint8_t backup;                  //receiver in backup mode
+static uint8_t wakeOnRx;
+static uint64_t wakeAt = SIM_NEVER;
+static uint64_t reacquired;             //no fix before (hot start after backup)
+static uint64_t coldLeft;               //acquisition time left when backup interrupted the first fix
+static uint8_t tracking;
+static uint64_t onSince;
+static uint64_t onTime;
+static uint32_t backups;
+
+static uint8_t systems = GNSS_DEFAULT;
+static Profile profiles[PROFILE_COUNT];
+static float current;                   //mA while on
+static uint64_t segStart;               //start of the current accounting segment
+static uint8_t acquiring;
+static uint64_t acqSince;
+
+static double errSum;                   //error of script fixes against the true position
+static double errMax;
+static uint32_t errCount;
+
+static uint8_t ubxBuf[UBX_MAX_LEN];
+static uint16_t ubxIdx;
+
+/**
+ * @brief Output one epoch
+ *
+ * @param now virtual time
+ */
+static void emitEpoch(uint64_t now);
+
+/**
+ * @brief Queue NMEA sentence; time field is replaced and checksum recalculated
+ *
+ * @param sentence sentence starting with '$'
+ * @param len length of sentence
+ * @param utc utc time of day in seconds
+ */
+static void queueNmea(const uint8_t *sentence, uint16_t len, uint32_t utc);
+
+/**
+ * @brief Queue raw bytes
+ *
+ * @param data data
+ * @param len length of data
+ */
+static void queueBytes(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Queue UBX frame
+ *
+ * @param cls message class
+ * @param id message id
+ * @param payload payload
+ * @param len payload length
+ */
+static void queueUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief Queue UBX-NAV-PVT derived from the epoch
+ *
+ * @param utc utc time of day in seconds
+ * @param fix fix of the epoch
+ */
+static void queuePvt(uint32_t utc, const Fix *fix);
+
+/**
+ * @brief Read position (GLL) or satellites and hdop (GSA) of a script line
+ *
+ * @param line script line
+ * @param fix fix of the epoch
+ */
+static void parseFix(const Line *line, Fix *fix);
+
+/**
+ * @brief Handle UBX frame sent by firmware
+ *
+ * @param frame complete frame
+ * @param len length of frame
+ */
+static void receiveUbx(const uint8_t *frame, uint16_t len);
+
+/**
+ * @brief Enter backup mode (RXM-PMREQ)
+ *
+ * @param now virtual time
+ * @param duration backup duration in ms, 0 until woken up
+ * @param rx 1 if activity on uart rx wakes up the receiver
+ */
+static void enterBackup(uint64_t now, uint32_t duration, uint8_t rx);
+
+/**
+ * @brief Leave backup mode, hot start
+ *
+ * @param now virtual time
+ */
+static void wakeUp(uint64_t now);
+
+/**
+ * @brief Apply CFG-GNSS, acquisition continues with the new speed or restarts while tracking
+ *
+ * @param now virtual time
+ * @param payload CFG-GNSS payload
+ * @param len payload length
+ */
+static void configureSystems(uint64_t now, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief Set receiver current, the elapsed on-time is accounted to the active profile
+ *
+ * @param now virtual time
+ * @param track 1: tracking current, 0: acquisition current
+ */
+static void setCurrent(uint64_t now, uint8_t track);
+
+/**
+ * @brief Account on-time and charge since the last call to the active profile
+ *
+ * @param now virtual time
+ */
+static void account(uint64_t now);
+
+/**
+ * @brief Acquisition time relative to the default systems
+ *
+ * @param mask enabled systems
+ * @return double factor
+ */
+static double acqFactor(uint8_t mask);
+
+/**
+ * @brief Profile statistics index of enabled systems
+ *
+ * @param mask enabled systems
+ * @return uint8_t index
+ */
+static uint8_t profileIndex(uint8_t mask);
+
+int SIM_GNSS_Init(const char *file) {
+    setCurrent(0, 0);
+    reacquired = SIM_Config.ttff;
+    acquiring = 1;
+    nextEpoch = SIM_US_PER_S;
+    onSince = 0;
+
+    if (file == 0) {
+        return 0;
+    }
+    FILE *in = fopen(file, "r");
+    if (in == 0) {
+        return -1;
+    }
+
+    char text[LINE_LEN];
+    while (fgets(text, sizeof(text), in) != 0) {
+        text[strcspn(text, "\r\n")] = 0;
+        if (text[0] == '#') {
+            continue;
+        }
+
+        lines = realloc(lines, (lineCount + 1) * sizeof(Line));
+        Line *line = &lines[lineCount++];
+        line->ubx = strncmp(text, "UBX", 3) == 0;
+        line->data = malloc(LINE_LEN);
+        line->len = 0;
+
+        if (line->ubx) {
+            //hex bytes of complete frame
+            char *p = text + 3;
+            char *end;
+            for (long v = strtol(p, &end, 16); end != p && line->len < LINE_LEN; v = strtol(p, &end, 16)) {
+                line->data[line->len++] = v;
+                p = end;
+            }
+        } else {
+            line->len = strlen(text);
+            memcpy(line->data, text, line->len);
+        }
+
+        //first line after a separator starts an epoch
+        if (line->len != 0 && (lineCount == 1 || lines[lineCount - 2].len == 0)) {
+            epochStart = realloc(epochStart, (epochCount + 1) * sizeof(uint32_t));
+            epochStart[epochCount++] = lineCount - 1;
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+void SIM_GNSS_Attach(void (*rx)(uint8_t byte)) {
+    uartRx = rx;
+}
+
+void SIM_GNSS_Receive(const uint8_t *data, uint16_t len) {
+    if (backup) {
+        //bytes waking the receiver are lost
+        if (wakeOnRx) {
+            wakeUp(SIM_Now());
+        }
+        return;
+    }
+
+    for (uint16_t i = 0; i < len && !backup; i++) {
+        uint8_t b = data[i];
+
+        //collect UBX frames
+        if ((ubxIdx == 0 && b != UBX_SYNC_1) || (ubxIdx == 1 && b != UBX_SYNC_2)) {
+            ubxIdx = 0;
+            continue;
+        }
+        ubxBuf[ubxIdx++] = b;
+        if (ubxIdx >= 6) {
+            uint16_t plen = ubxBuf[4] | (ubxBuf[5] << 8);
+            if (plen + 8 > UBX_MAX_LEN) {
+                ubxIdx = 0;
+            } else if (ubxIdx == plen + 8) {
+                receiveUbx(ubxBuf, ubxIdx);
+                ubxIdx = 0;
+            }
+        }
+    }
+}
+
+void SIM_GNSS_Update(uint64_t now) {
+    if (now >= wakeAt) {
+        wakeUp(now);
+    }
+    if (now >= nextEpoch) {
+        emitEpoch(now);
+        nextEpoch += SIM_US_PER_S;
+    }
+
+    while (nextByte <= now && qTail != qHead) {
+        if (uartRx != 0) {
+            uartRx(queue[qTail]);
+            bytesSent++;
+        } else {
+            bytesLost++;
+        }
+        qTail = (qTail + 1) % QUEUE_LEN;
+        nextByte += BYTE_TIME;
+    }
+    if (qTail == qHead) {
+        nextByte = SIM_NEVER;
+    }
+}
+
+uint64_t SIM_GNSS_NextEvent(void) {
+    uint64_t next = nextByte < nextEpoch ? nextByte : nextEpoch;
+    return wakeAt < next ? wakeAt : next;
+}
+
+uint64_t SIM_GNSS_OnTime(void) {
+    return onTime + (backup ? 0 : SIM_Now() - onSince);
+}
+
+void SIM_GNSS_Report(FILE *out) {
+    char buf[16];
+
+    if (firstFix != SIM_NEVER) {
+        fprintf(out, "first fix           %s\n", SIM_FormatTime(firstFix, buf));
+    } else {
+        fprintf(out, "first fix           none\n");
+    }
+    fprintf(out, "gnss epochs         %u\n", epochs);
+    fprintf(out, "gnss bytes          %u sent, %u lost (uart closed)\n", bytesSent, bytesLost);
+    fprintf(out, "gnss configuration  %u UBX-CFG messages acknowledged\n", cfgCount);
+    fprintf(out, "gnss on-time        %.3f s (%.1f %%), %u times in backup mode\n", SIM_GNSS_OnTime() / 1e6,
+            SIM_Now() > 0 ? 100.0 * SIM_GNSS_OnTime() / SIM_Now() : 0, backups);
+    account(SIM_Now());
+    for (uint8_t i = 0; i < PROFILE_COUNT; i++) {
+        Profile *p = &profiles[i];
+        if (p->on == 0) {
+            continue;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "%s%s%s", i & 1 ? "GPS+" : "", i & 2 ? "GAL+" : "", i & 4 ? "GLO+" : "");
+        name[strlen(name) > 0 ? strlen(name) - 1 : 0] = 0;
+        fprintf(out, "gnss %-14s on %.1f s, avg %.1f mA, %u fixes acquired in avg %.1f s\n", name, p->on / 1e6,
+                p->charge * 1e6 / p->on, p->fixes, p->fixes > 0 ? p->acqTime / 1e6 / p->fixes : 0);
+    }
+    if (errCount > 0) {
+        fprintf(out, "gnss fix error      avg %.1f m, max %.1f m (%u fixes output)\n",
+                errSum / errCount, errMax, errCount);
+    }
+}
+
+static void emitEpoch(uint64_t now) {
+    uint32_t utc = (SIM_Config.utcStart + now / SIM_US_PER_S) % SEC_PER_DAY;
+    Fix fix;
+    epochs++;
+
+    memset(&fix, 0, sizeof(Fix));
+    if (now < reacquired || epochCount == 0) {
+        //no fix yet, the satellites in view of the script epoch are already tracked
+        static const char noFix[] = "$GPGLL,,,,,000000.00,V,N";
+        for (uint32_t idx = epochCount != 0 ? epochStart[now / SIM_US_PER_S % epochCount] : lineCount;
+                idx < lineCount && lines[idx].len != 0; idx++) {
+            if (!lines[idx].ubx && lines[idx].len > 6 && memcmp(lines[idx].data + 3, "GSV", 3) == 0) {
+                queueNmea(lines[idx].data, lines[idx].len, utc);
+            }
+        }
+        queueNmea((const uint8_t*)noFix, sizeof(noFix) - 1, utc);
+        if (pvtRate != 0) {
+            queuePvt(utc, &fix);
+        }
+        return;
+    }
+    if (!tracking) {
+        tracking = 1;
+        setCurrent(now, 1);
+    }
+
+    //epoch recorded at this time of the script, epochs missed in backup mode are skipped
+    for (uint32_t idx = epochStart[now / SIM_US_PER_S % epochCount]; idx < lineCount && lines[idx].len != 0; idx++) {
+        Line *line = &lines[idx];
+        if (line->ubx) {
+            queueBytes(line->data, line->len);
+        } else if (line->data[0] == '$') {
+            queueNmea(line->data, line->len, utc);
+            parseFix(line, &fix);
+        }
+    }
+    if (pvtRate != 0) {
+        queuePvt(utc, &fix);
+    }
+
+    if (fix.valid && firstFix == SIM_NEVER) {
+        firstFix = now;
+    }
+    if (fix.valid && acquiring) {
+        Profile *p = &profiles[profileIndex(systems)];
+        p->fixes++;
+        p->acqTime += now - acqSince;
+        acquiring = 0;
+    }
+
+    double err = fix.valid ? SIM_TruthDistance(fix.lat, fix.lon) : -1;
+    if (err >= 0) {
+        errSum += err;
+        errMax = err > errMax ? err : errMax;
+        errCount++;
+    }
+}
+
+static void parseFix(const Line *line, Fix *fix) {
+    char text[LINE_LEN];
+    char *field[FIELD_COUNT];
+    uint8_t count = 0;
+
+    //split fields, empty fields are kept
+    memcpy(text, line->data, line->len);
+    text[line->len] = 0;
+    text[strcspn(text, "*")] = 0;
+    for (char *p = text; p != 0 && count < FIELD_COUNT; ) {
+        field[count++] = strsep(&p, ",");
+    }
+    if (count < 1 || strlen(field[0]) != 6) {
+        return;
+    }
+
+    if (strcmp(field[0] + 3, "GLL") == 0 && count >= 7 && strlen(field[1]) > 4 && strlen(field[3]) > 5) {
+        //ddmm.mmmm and dddmm.mmmm
+        double lat = atof(field[1]);
+        double lon = atof(field[3]);
+        fix->lat = ((int)(lat / 100) + fmod(lat, 100) / 60) * (field[2][0] == 'S' ? -1 : 1);
+        fix->lon = ((int)(lon / 100) + fmod(lon, 100) / 60) * (field[4][0] == 'W' ? -1 : 1);
+        fix->valid = field[6][0] == 'A';
+    } else if (strcmp(field[0] + 3, "GSA") == 0 && count >= 17) {
+        for (uint8_t i = 3; i < 15; i++) {
+            fix->satellites += field[i][0] != 0;
+        }
+        fix->hdop = atof(field[16]);
+    }
+}
+
+static void receiveUbx(const uint8_t *frame, uint16_t len) {
+    const uint8_t *payload = frame + 6;
+    uint16_t plen = len - 8;
+
+    if (frame[2] == UBX_CLASS_CFG) {
+        //acknowledge all configuration messages
+        cfgCount++;
+        queueUbx(UBX_CLASS_ACK, UBX_ID_ACK, frame + 2, 2);
+
+        if (frame[3] == UBX_ID_CFG_GNSS) {
+            configureSystems(SIM_Now(), payload, plen);
+        } else if (frame[3] == UBX_ID_CFG_MSG && plen >= 3 && payload[0] == UBX_CLASS_NAV && payload[1] == UBX_ID_PVT) {
+            pvtRate = payload[2];
+        }
+    } else if (frame[2] == UBX_CLASS_RXM && frame[3] == UBX_ID_PMREQ && (plen == 8 || plen == 16)) {
+        //version 1 has a header and wake-up sources
+        const uint8_t *p = plen == 16 ? payload + 4 : payload;
+        uint32_t duration = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+        uint32_t flags = p[4] | p[5] << 8 | p[6] << 16 | (uint32_t)p[7] << 24;
+        uint8_t rx = plen == 16 && (p[8] & PMREQ_UARTRX) != 0;
+
+        if ((flags & PMREQ_BACKUP) != 0) {
+            enterBackup(SIM_Now(), duration, rx);
+        }
+    }
+}
+
+static void enterBackup(uint64_t now, uint32_t duration, uint8_t rx) {
+    //pending output is lost
+    qTail = qHead;
+    nextByte = SIM_NEVER;
+    nextEpoch = SIM_NEVER;
+
+    account(now);
+    coldLeft = firstFix == SIM_NEVER && reacquired > now ? reacquired - now : 0;
+    backup = 1;
+    backups++;
+    wakeOnRx = rx;
+    wakeAt = duration != 0 ? now + duration * SIM_US_PER_MS : SIM_NEVER;
+    tracking = 0;
+    acquiring = 0;
+    onTime += now - onSince;
+    SIM_SetCurrent(SIM_Load_GNSS, SIM_I_GNSS_BACKUP);
+}
+
+static void wakeUp(uint64_t now) {
+    backup = 0;
+    wakeAt = SIM_NEVER;
+    onSince = now;
+    //without ephemeris from a first fix the search continues
+    uint64_t hot = SIM_Config.hotStart * acqFactor(systems);
+    reacquired = now + (coldLeft > hot ? coldLeft : hot);
+    nextEpoch = now + SIM_US_PER_S;
+    acquiring = 1;
+    acqSince = now;
+    segStart = now;
+    setCurrent(now, 0);
+}
+
+static void configureSystems(uint64_t now, const uint8_t *payload, uint16_t len) {
+    uint8_t mask = systems;
+
+    //header: version, channels, channels used, block count; 8 bytes per block
+    for (uint16_t i = 4; i + 8 <= len && (i - 4) / 8 < payload[3]; i += 8) {
+        uint8_t bit = payload[i] < 8 ? 1 << payload[i] : 0;
+        mask = (payload[i + 4] & 0x01) != 0 ? mask | bit : mask & ~bit;
+    }
+    if (mask == systems || (mask & (GNSS_GPS | GNSS_GALILEO | GNSS_GLONASS)) == 0) {
+        return;
+    }
+
+    double scale = acqFactor(mask) / acqFactor(systems);
+    account(now);
+    systems = mask;
+    if (now < reacquired) {
+        reacquired = now + (reacquired - now) * scale;
+    } else {
+        //reconfiguration restarts the signal search, ephemeris is kept
+        reacquired = now + SIM_Config.hotStart * acqFactor(systems);
+        tracking = 0;
+        acquiring = 1;
+        acqSince = now;
+    }
+    setCurrent(now, tracking);
+}
+
+static void setCurrent(uint64_t now, uint8_t track) {
+    int8_t extra = (systems & GNSS_GPS ? 1 : 0) + (systems & GNSS_GALILEO ? 1 : 0) + (systems & GNSS_GLONASS ? 1 : 0) - 2;
+
+    account(now);
+    current = (track ? SIM_I_GNSS_TRACK : SIM_I_GNSS_ACQ) + extra * SIM_I_GNSS_SYSTEM;
+    SIM_SetCurrent(SIM_Load_GNSS, current);
+}
+
+static void account(uint64_t now) {
+    if (!backup && now > segStart) {
+        Profile *p = &profiles[profileIndex(systems)];
+        p->on += now - segStart;
+        p->charge += (now - segStart) / 1e6 * current;
+    }
+    segStart = now;
+}
+
+static double acqFactor(uint8_t mask) {
+    //more satellites in view shorten the search, scenario times are for the default systems
+    static const double factor[] = { 1.25, 1.25, 1.0, 0.8 };
+    uint8_t count = (mask & GNSS_GPS ? 1 : 0) + (mask & GNSS_GALILEO ? 1 : 0) + (mask & GNSS_GLONASS ? 1 : 0);
+    return factor[count];
+}
+
+static uint8_t profileIndex(uint8_t mask) {
+    return (mask & GNSS_GPS ? 1 : 0) | (mask & GNSS_GALILEO ? 2 : 0) | (mask & GNSS_GLONASS ? 4 : 0);
+}
+
+static void queueNmea(const uint8_t *sentence, uint16_t len, uint32_t utc) {
+    char out[LINE_LEN];
+    char field[16];
+    uint16_t o = 0;
+
+    //field containing the time of day
+    uint8_t timeField = 1;
+    if (len > 6 && memcmp(sentence + 3, "GLL", 3) == 0) {
+        timeField = 5;
+    }
+    sprintf(field, "%02u%02u%02u.00", utc / 3600, utc / 60 % 60, utc % 60);
+
+    uint8_t f = 0;
+    for (uint16_t i = 0; i < len && sentence[i] != '*' && o < LINE_LEN - 8; i++) {
+        if (sentence[i] == ',') {
+            f++;
+            out[o++] = ',';
+            if (f == timeField) {
+                o += sprintf(out + o, "%s", field);
+                while (i + 1 < len && sentence[i + 1] != ',' && sentence[i + 1] != '*') {
+                    i++;
+                }
+            }
+        } else {
+            out[o++] = sentence[i];
+        }
+    }
+
+    uint8_t cs = 0;
+    for (uint16_t i = 1; i < o; i++) {
+        cs ^= out[i];
+    }
+    o += sprintf(out + o, "*%02X\r\n", cs);
+    queueBytes((uint8_t*)out, o);
+}
+
+static void queueBytes(const uint8_t *data, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint32_t next = (qHead + 1) % QUEUE_LEN;
+        if (next == qTail) {
+            bytesLost++;
+            continue;
+        }
+        queue[qHead] = data[i];
+        qHead = next;
+    }
+    if (nextByte == SIM_NEVER && qTail != qHead) {
+        nextByte = SIM_Now() + BYTE_TIME;
+    }
+}
+
+static void queueUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len) {
+    uint8_t frame[UBX_MAX_LEN];
+    uint16_t idx = 0;
+
+    frame[idx++] = UBX_SYNC_1;
+    frame[idx++] = UBX_SYNC_2;
+    frame[idx++] = cls;
+    frame[idx++] = id;
+    frame[idx++] = len & 0xFF;
+    frame[idx++] = len >> 8;
+    memcpy(frame + idx, payload, len);
+    idx += len;
+
+    uint8_t ckA = 0, ckB = 0;
+    for (uint16_t i = 2; i < idx; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[idx++] = ckA;
+    frame[idx++] = ckB;
+    queueBytes(frame, idx);
+}
+
+static void queuePvt(uint32_t utc, const Fix *fix) {
+    uint8_t p[PVT_LEN];
+    uint32_t v;
+
+    memset(p, 0, sizeof(p));
+
+    //iTOW, time of day stands in for the time of week
+    v = utc * 1000;
+    memcpy(p, &v, 4);
+    p[8] = utc / 3600;
+    p[9] = utc / 60 % 60;
+    p[10] = utc % 60;
+    p[11] = 0x07;                   //valid date, time, fully resolved
+    p[20] = fix->valid ? 3 : 0;     //fixType
+    p[21] = fix->valid ? 0x01 : 0;  //gnssFixOK
+    p[23] = fix->valid ? fix->satellites : 0;
+
+    int32_t lon = lround(fix->lon * 1e7);
+    int32_t lat = lround(fix->lat * 1e7);
+    memcpy(p + 24, &lon, 4);
+    memcpy(p + 28, &lat, 4);
+
+    v = fix->valid ? fix->hdop * PVT_UERE * 1000 : UINT32_MAX;  //hAcc in mm
+    memcpy(p + 40, &v, 4);
+    uint16_t pdop = fix->hdop * 150;
+    memcpy(p + 76, &pdop, 2);
+
+    queueUbx(UBX_CLASS_NAV, UBX_ID_PVT, p, PVT_LEN);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/**
+ * @file sim_hal.h
+ * @author Paul Götzinger
+ * @brief Host simulator: redirects core peripherals used by the firmware.
+ * Force included after the HAL headers when building the simulator.
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+//SysTick registers are kept in host memory and updated by the virtual clock
+extern SysTick_Type SIM_SysTick;
+#undef  SysTick
+#define SysTick (&SIM_SysTick)
+
+//trace timer (1 us) and reset and clock control registers
+extern TIM_TypeDef SIM_TIM6;
+extern RCC_TypeDef SIM_RCC;
+#undef  TIM6
+#define TIM6 (&SIM_TIM6)
+#undef  RCC
+#define RCC (&SIM_RCC)
+
+//no interrupts on the host
+#define __disable_irq()     ((void)0)
+#define __enable_irq()      ((void)0)
+#define __get_PRIMASK()     0U
+#define __set_PRIMASK(X)    ((void)(X))
+
+//a reset ends the simulation
+void SIM_SystemReset(void);
+#define NVIC_SystemReset SIM_SystemReset
+
+#endif //!SIM_HAL_H
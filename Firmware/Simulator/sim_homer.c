@@ -0,0 +1,173 @@
+/**
+ * @file sim_homer.c
+ * @author Paul Götzinger
+ * @brief Host simulator: stand-in for the 121.5 MHz homing transmitter driver, the keyed cycles
+ * of each transmission are split into sweeps and checked against ICAO Annex 10
+ * @version 1.0
+ * @date 2019-04-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include "homer.h"
+#include "homing.h"
+
+#define HOMING_SWEEP_MIN  2.0     //sweeps per second (ICAO Annex 10)
+#define HOMING_SWEEP_MAX  4.0
+#define HOMING_AUDIO_MIN  300.0   //Hz, modulation frequency
+#define HOMING_AUDIO_MAX  1600.0
+#define HOMING_RANGE_MIN  700.0   //Hz, sweep range
+#define HOMING_DUTY_MIN   0.33    //modulation duty cycle
+#define HOMING_DUTY_MAX   0.55
+#define HOMING_JUMP       70      //% of the previous period, a shorter cycle starts a downward sweep
+
+/**
+ * @brief Homing transmitter and signal analysis, the keyed carrier is split into audio cycles
+ * and sweeps (a cycle much shorter than the one before starts the next sweep)
+ *
+ */
+static struct {
+    uint8_t  init;          //HOMER_Init called
+    uint8_t  on;            //transmitting
+    float    current;       //mA while on, keyed carrier and enabled transmitter
+    uint64_t start;         //start of current transmission
+    uint64_t first;         //start of first transmission
+    uint64_t lastEnd;       //end of last transmission
+    uint64_t onAir;         //time of ended transmissions
+    uint64_t maxGap;        //longest interruption between transmissions
+    uint32_t starts;
+    uint32_t lastPeriod;    //us of last cycle, 0 at the start of a transmission
+    uint64_t sweepStart;    //start of last sweep, valid if sweepValid
+    uint8_t  sweepValid;
+    uint32_t cycles, sweeps;
+    double minDuty, maxDuty, minAudio, maxAudio, minSweep, maxSweep, maxStep;
+} homer = {.minDuty = 1, .minAudio = 1e9, .minSweep = 1e9};
+
+/**
+ * @brief Analyze the cycles sent from the start of the transmission until now, a cycle cut by
+ * the end is not counted
+ *
+ */
+static void analyze(void);
+
+/**
+ * @brief Add an audio cycle to the analysis
+ *
+ * @param start start of cycle in us
+ * @param period period in us
+ * @param on carrier on in us
+ */
+static void addCycle(uint64_t start, uint32_t period, uint32_t on);
+
+void HOMER_Init(const HOMER_Config *conf) {
+    uint64_t on = 0;
+    for (uint16_t i = 0; i < HOM_SWEEP_CYCLES; i++) {
+        on += HOM_Sweep[i].on;
+    }
+    //enabled transmitter plus the keyed carrier averaged over the sweep
+    homer.current = SIM_I_HOMER_ENABLED + SIM_I_HOMER_KEYED * on / HOM_SWEEP_TICKS;
+    homer.init = conf != 0;
+}
+
+void HOMER_Start(void) {
+    if (!homer.init || homer.on) {
+        return;
+    }
+    homer.on = 1;
+    homer.start = SIM_Now();
+    homer.starts++;
+    if (homer.starts == 1) {
+        homer.first = SIM_Now();
+    } else if (SIM_Now() - homer.lastEnd > homer.maxGap) {
+        homer.maxGap = SIM_Now() - homer.lastEnd;
+    }
+    SIM_SetCurrent(SIM_Load_Homer, homer.current);
+}
+
+void HOMER_Stop(void) {
+    if (!homer.on) {
+        return;
+    }
+    analyze();
+    homer.on = 0;
+    homer.onAir += SIM_Now() - homer.start;
+    homer.lastEnd = SIM_Now();
+    SIM_SetCurrent(SIM_Load_Homer, 0);
+}
+
+uint8_t HOMER_IsOn(void) {
+    return homer.on;
+}
+
+uint8_t SIM_HOMER_Valid(void) {
+    if (homer.cycles == 0) {
+        return 1;
+    }
+    return homer.sweeps > 0
+            && homer.minSweep >= HOMING_SWEEP_MIN && homer.maxSweep <= HOMING_SWEEP_MAX
+            && homer.minAudio >= HOMING_AUDIO_MIN && homer.maxAudio <= HOMING_AUDIO_MAX
+            && homer.maxAudio - homer.minAudio >= HOMING_RANGE_MIN
+            && homer.minDuty >= HOMING_DUTY_MIN && homer.maxDuty <= HOMING_DUTY_MAX;
+}
+
+void SIM_HOMER_Report(FILE *out) {
+    if (homer.on) {
+        //transmission still running: count it up to now
+        HOMER_Stop();
+    }
+    if (homer.starts == 0) {
+        return;
+    }
+    uint64_t since = SIM_Now() - homer.first;
+    fprintf(out, "homing              %.1f s on air, duty %.1f %% since first start, longest gap %.3f s, %u starts\n",
+            homer.onAir / 1e6, since > 0 ? 100.0 * homer.onAir / since : 0, homer.maxGap / 1e6, homer.starts);
+    fprintf(out, "homing sweep        %.2f .. %.2f Hz (%u sweeps), audio %.0f .. %.0f Hz, step max %.2f %%, duty cycle %.1f .. %.1f %%\n",
+            homer.sweeps > 0 ? homer.minSweep : 0, homer.maxSweep, homer.sweeps, homer.minAudio, homer.maxAudio,
+            100 * homer.maxStep, 100 * homer.minDuty, 100 * homer.maxDuty);
+    fprintf(out, "homing check        %s\n", SIM_HOMER_Valid() ? "ok" : "FAILED");
+}
+
+static void analyze(void) {
+    uint64_t t = homer.start;
+    uint64_t now = SIM_Now();
+
+    //the timer starts with the last cycle of the sweep, the DMA continues at the beginning
+    const HOM_Cycle *c = &HOM_Sweep[HOM_SWEEP_CYCLES - 1];
+    homer.lastPeriod = 0;
+    homer.sweepValid = 0;
+    while (t + c->arr + 1 <= now) {
+        addCycle(t, c->arr + 1, c->on);
+        t += c->arr + 1;
+        c = c == &HOM_Sweep[HOM_SWEEP_CYCLES - 1] ? HOM_Sweep : c + 1;
+    }
+}
+
+static void addCycle(uint64_t start, uint32_t period, uint32_t on) {
+    double duty = (double)on / period;
+    double audio = (double)SIM_US_PER_S / period;
+    homer.minDuty = duty < homer.minDuty ? duty : homer.minDuty;
+    homer.maxDuty = duty > homer.maxDuty ? duty : homer.maxDuty;
+    homer.minAudio = audio < homer.minAudio ? audio : homer.minAudio;
+    homer.maxAudio = audio > homer.maxAudio ? audio : homer.maxAudio;
+    homer.cycles++;
+
+    if (homer.lastPeriod > 0 && period * 100 < homer.lastPeriod * HOMING_JUMP) {
+        //back at the top frequency: the cycle starts a sweep
+        if (homer.sweepValid) {
+            double sweep = (double)SIM_US_PER_S / (start - homer.sweepStart);
+            homer.minSweep = sweep < homer.minSweep ? sweep : homer.minSweep;
+            homer.maxSweep = sweep > homer.maxSweep ? sweep : homer.maxSweep;
+            homer.sweeps++;
+        }
+        homer.sweepStart = start;
+        homer.sweepValid = 1;
+    } else if (homer.lastPeriod > 0) {
+        //tone step within the sweep
+        double step = (double)(period > homer.lastPeriod ? period - homer.lastPeriod : homer.lastPeriod - period)
+                / homer.lastPeriod;
+        homer.maxStep = step > homer.maxStep ? step : homer.maxStep;
+    }
+    homer.lastPeriod = period;
+}
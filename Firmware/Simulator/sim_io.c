@@ -0,0 +1,224 @@
+/**
+ * @file sim_io.c
+ * @author Paul Götzinger
+ * @brief Host simulator: stand-ins for keys, leds, vibrator, adc, system clock and memory monitor
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include "key.h"
+#include "led_driver.h"
+#include "adc.h"
+#include "sysclock_driver.h"
+#include "memory.h"
+#include <string.h>
+
+#define LED_COUNT         (led_pb11 + 1)
+#define PATTERN_BITS      16
+#define ADC_V0            1656    //battery.c: raw value at 0 percent
+#define ADC_PER_PERCENT   4.82f
+#define CALL_TIME         1       //cost of a driver call in us
+
+static uint8_t ledState[LED_COUNT];
+static REGISTER ledPattern[LED_COUNT];
+static uint8_t ledTimer;
+
+/**
+ * @brief Update led current
+ *
+ */
+static void updateLeds(void);
+
+//keys
+
+void KEY_Init(void) {
+}
+
+GPIO_PinState KEY_Get(BTN_Pins btn) {
+    SIM_Advance(CALL_TIME);
+    GPIO_PinState state = SIM_KeyPressed(btn) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    REC_KEY(btn, state == GPIO_PIN_SET);
+    return state;
+}
+
+//leds
+
+void led_init(void) {
+    memset(ledState, 0, sizeof(ledState));
+    memset(ledPattern, 0, sizeof(ledPattern));
+    updateLeds();
+}
+
+bool led_on(LED_PIN led) {
+    if (led >= LED_COUNT) {
+        return false;
+    }
+    ledState[led] = 1;
+    ledPattern[led] = 0;
+    updateLeds();
+    return true;
+}
+
+bool led_off(LED_PIN led) {
+    if (led >= LED_COUNT) {
+        return false;
+    }
+    ledState[led] = 0;
+    ledPattern[led] = 0;
+    updateLeds();
+    return true;
+}
+
+bool led_toggle(LED_PIN led) {
+    if (led >= LED_COUNT) {
+        return false;
+    }
+    return ledState[led] ? led_off(led) : led_on(led);
+}
+
+void led_deinit(void) {
+    led_init();
+}
+
+void led_timer_init(TIME time_intervall) {
+}
+
+bool led_timer_start(void) {
+    ledTimer = 1;
+    updateLeds();
+    return true;
+}
+
+bool led_timer_stop(void) {
+    ledTimer = 0;
+    updateLeds();
+    return true;
+}
+
+void led_action_time(LED_PIN led, REGISTER value) {
+    if (led < LED_COUNT) {
+        ledPattern[led] = value;
+        updateLeds();
+    }
+}
+
+static void updateLeds(void) {
+    float on = 0;
+
+    for (uint8_t i = 0; i < LED_COUNT; i++) {
+        if (ledTimer && ledPattern[i] != 0) {
+            //blinking pattern, average duty cycle
+            on += (float)__builtin_popcount(ledPattern[i]) / PATTERN_BITS;
+        } else {
+            on += ledState[i];
+        }
+    }
+    SIM_SetCurrent(SIM_Load_LED, on * SIM_I_LED);
+}
+
+//vibrator (header not included, its GPIO_PinType differs from spi_driver.h)
+
+bool vibrator_init(GPIO_TypeDef *BANK, uint32_t PIN) {
+    return true;
+}
+
+void vibrator_on(void) {
+    SIM_SetCurrent(SIM_Load_Vibrator, SIM_I_VIBRATOR);
+}
+
+void vibrator_off(void) {
+    SIM_SetCurrent(SIM_Load_Vibrator, 0);
+}
+
+void vibrator_deinit(void) {
+    vibrator_off();
+}
+
+//adc (battery voltage)
+
+HAL_StatusTypeDef Adc_Init() {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Adc_SetChannel(uint8_t const channel) {
+    return HAL_OK;
+}
+
+int32_t Adc_GetValue(uint32_t const timeout) {
+    int32_t value;
+
+    SIM_Advance(CALL_TIME);
+    if (SIM_REPLAY_Adc(&value)) {
+        return value;
+    }
+    return ADC_V0 + (int32_t)(SIM_Config.battery * ADC_PER_PERCENT + 0.5f);
+}
+
+//system clock
+
+void SystemClock_Config(void) {
+    SIM_SetCurrent(SIM_Load_MCU, SIM_I_MCU_RUN);
+}
+
+void SystemClock_SleepMode_Config(void) {
+    SIM_SetCurrent(SIM_Load_MCU, SIM_I_MCU_LOW);
+}
+
+void SystemClock_UnSleepMode_Config(void) {
+    SIM_SetCurrent(SIM_Load_MCU, SIM_I_MCU_RUN);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return SystemCoreClock;
+}
+
+void _Error_Handler(char *file, int line) {
+    char reason[128];
+    snprintf(reason, sizeof(reason), "error handler called (%s, %d)", file, line);
+    SIM_Finish(reason);
+}
+
+//memory monitor, the host has neither the linker script symbols nor a painted stack
+
+void MEM_PaintStack(void) {
+}
+
+void MEM_Check(void) {
+}
+
+uint8_t MEM_GuardIntact(void) {
+    return 1;
+}
+
+uint16_t MEM_GetStackUsage(void) {
+    return 0;
+}
+
+uint16_t MEM_GetStackSize(void) {
+    return 0;
+}
+
+void MEM_GetStatic(uint16_t *data, uint16_t *bss, uint16_t *noinit) {
+    *data = 0;
+    *bss = 0;
+    *noinit = 0;
+}
+
+uint16_t MEM_GetRamCode(void) {
+    return 0;
+}
+
+uint8_t MEM_GetModule(uint8_t idx, MEM_Module *module) {
+    return 0;
+}
+
+const MEM_Buffer* MEM_GetBuffer(uint8_t idx) {
+    return 0;
+}
+
+void MEM_LogReport(void) {
+}
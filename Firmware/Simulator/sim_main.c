@@ -0,0 +1,515 @@
+/**
+ * @file sim_main.c
+ * @author Paul Götzinger
+ * @brief Host simulator: scenario handling, firmware start and report
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "location.h"
+
+#undef main     //firmware main is renamed to FW_Main
+
+#define LINE_LEN      256
+#define PATH_LEN      512
+#define WORD_COUNT    16  //words of a report line
+#define BTN_SOS_1     2   //BTN_3
+#define BTN_SOS_2     3   //BTN_4
+#define EARTH_RADIUS  6371000.0 //m
+#define DEG_TO_RAD    (M_PI / 180)
+
+/**
+ * @brief Scenario action types
+ *
+ */
+typedef enum {
+    Action_Press,
+    Action_Release,
+    Action_Usb,
+    Action_Ble
+} ActionType;
+
+/**
+ * @brief Timed scenario action
+ *
+ */
+typedef struct {
+    uint64_t time;
+    ActionType type;
+    uint8_t keys;           //key mask
+    char text[LINE_LEN];    //usb or ble text
+} Action;
+
+/**
+ * @brief Expected value of a report line
+ *
+ */
+typedef struct {
+    char label[LINE_LEN];   //words in the order of the report line, the first one starts it
+    char op[4];             //<, <=, >, >=, = or !=
+    char value[32];         //number or word
+    int lineNr;
+} Expect;
+
+SIM_Settings SIM_Config = {
+    .duration = 60 * SIM_US_PER_S,
+    .ttff = 30 * SIM_US_PER_S,
+    .hotStart = 2 * SIM_US_PER_S,
+    .utcStart = 12 * 3600,
+    .battery = 100,
+    .capacity = 1000,
+    .verbose = 0,
+    .gnssFile = 0,
+    .burstFile = 0,
+    .replayFile = 0,
+    .recordFile = 0
+};
+
+static const char *scenarioFile;
+static char gnssPath[PATH_LEN];
+static char replayPath[PATH_LEN];
+static Action *actions;
+static uint32_t actionCount;
+static uint32_t actionIdx;
+static Expect *expects;
+static uint32_t expectCount;
+static uint8_t keys;
+static uint64_t sosPressed = SIM_NEVER;
+static clock_t hostStart;
+
+int FW_Main(void);
+
+/**
+ * @brief Parse duration with unit (us, ms, s, min, h)
+ *
+ * @param text text
+ * @param us parsed duration
+ * @return int 0 on success
+ */
+static int parseTime(const char *text, uint64_t *us);
+
+/**
+ * @brief Parse key list ("3 4") to key mask
+ *
+ * @param text text
+ * @return uint8_t key mask
+ */
+static uint8_t parseKeys(char *text);
+
+/**
+ * @brief Check expectations of the scenario against the report
+ *
+ * @param report report text
+ * @return int count of failed expectations
+ */
+static int checkExpects(const char *report);
+
+/**
+ * @brief Retrieve value of a report line after the label words
+ *
+ * @param line report line
+ * @param label label words
+ * @param number 1: next number after the label, 0: next word
+ * @param value found value, not changed if the label does not match
+ * @return int 1 if the line matches the label
+ */
+static int reportValue(const char *line, const char *label, uint8_t number, char *value);
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            SIM_Config.verbose = 1;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            SIM_Config.burstFile = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            SIM_Config.recordFile = argv[++i];
+        } else {
+            scenarioFile = argv[i];
+        }
+    }
+    if (scenarioFile == 0) {
+        fprintf(stderr, "usage: %s [-v] [-b bursts.csv] [-r record.txt] scenario\n", argv[0]);
+        return 1;
+    }
+    if (SIM_LoadScenario(scenarioFile) != 0) {
+        fprintf(stderr, "cannot load scenario %s\n", scenarioFile);
+        return 1;
+    }
+    if (SIM_GNSS_Init(SIM_Config.gnssFile) != 0) {
+        fprintf(stderr, "cannot load gnss script %s\n", SIM_Config.gnssFile);
+        return 1;
+    }
+    if (SIM_Config.replayFile != 0 && SIM_REPLAY_Init(SIM_Config.replayFile) != 0) {
+        fprintf(stderr, "cannot load recording %s\n", SIM_Config.replayFile);
+        return 1;
+    }
+
+    hostStart = clock();
+    FW_Main();
+    SIM_Finish("firmware returned");
+    return 0;
+}
+
+int SIM_LoadScenario(const char *file) {
+    FILE *in = fopen(file, "r");
+    if (in == 0) {
+        return -1;
+    }
+
+    //paths in the scenario are relative to the scenario file
+    const char *slash = strrchr(file, '/');
+    int dirLen = slash != 0 ? slash - file + 1 : 0;
+
+    char line[LINE_LEN];
+    int lineNr = 0;
+    while (fgets(line, sizeof(line), in) != 0) {
+        lineNr++;
+        line[strcspn(line, "\r\n#")] = 0;
+
+        char cmd[32], arg[LINE_LEN];
+        int n = sscanf(line, "%31s %255[^\n]", cmd, arg);
+        if (n <= 0) {
+            continue;
+        }
+
+        int ok = n == 2;
+        if (strcmp(cmd, "gnss") == 0 && ok) {
+            snprintf(gnssPath, sizeof(gnssPath), "%.*s%s", dirLen, file, arg);
+            SIM_Config.gnssFile = gnssPath;
+        } else if (strcmp(cmd, "replay") == 0 && ok) {
+            snprintf(replayPath, sizeof(replayPath), "%.*s%s", dirLen, file, arg);
+            SIM_Config.replayFile = replayPath;
+        } else if (strcmp(cmd, "ttff") == 0 && ok) {
+            ok = parseTime(arg, &SIM_Config.ttff) == 0;
+        } else if (strcmp(cmd, "hotstart") == 0 && ok) {
+            ok = parseTime(arg, &SIM_Config.hotStart) == 0;
+        } else if (strcmp(cmd, "truth") == 0 && ok) {
+            ok = sscanf(arg, "%lf %lf", &SIM_Config.truthLat, &SIM_Config.truthLon) == 2;
+            SIM_Config.truthValid = ok;
+        } else if (strcmp(cmd, "run") == 0 && ok) {
+            ok = parseTime(arg, &SIM_Config.duration) == 0;
+        } else if (strcmp(cmd, "battery") == 0 && ok) {
+            SIM_Config.battery = atoi(arg);
+        } else if (strcmp(cmd, "capacity") == 0 && ok) {
+            SIM_Config.capacity = atof(arg);
+            ok = SIM_Config.capacity > 0;
+        } else if (strcmp(cmd, "utc") == 0 && ok) {
+            unsigned h, m, s;
+            ok = sscanf(arg, "%u:%u:%u", &h, &m, &s) == 3;
+            SIM_Config.utcStart = h * 3600 + m * 60 + s;
+        } else if (strcmp(cmd, "at") == 0 && ok) {
+            char when[32], type[32], rest[LINE_LEN] = "";
+            ok = sscanf(arg, "%31s %31s %255[^\n]", when, type, rest) >= 2;
+
+            actions = realloc(actions, (actionCount + 1) * sizeof(Action));
+            Action *a = &actions[actionCount];
+            memset(a, 0, sizeof(Action));
+            ok = ok && parseTime(when, &a->time) == 0;
+            if (ok && strcmp(type, "press") == 0) {
+                a->type = Action_Press;
+                a->keys = parseKeys(rest);
+            } else if (ok && strcmp(type, "release") == 0) {
+                a->type = Action_Release;
+                a->keys = parseKeys(rest);
+            } else if (ok && strcmp(type, "usb") == 0) {
+                a->type = Action_Usb;
+                snprintf(a->text, sizeof(a->text), "%s\n", rest);
+            } else if (ok && strcmp(type, "ble") == 0) {
+                a->type = Action_Ble;
+                snprintf(a->text, sizeof(a->text), "%s\n", rest);
+            } else {
+                ok = 0;
+            }
+            if (ok) {
+                //actions are kept sorted by time
+                uint32_t i = actionCount++;
+                Action tmp = *a;
+                while (i > 0 && actions[i - 1].time > tmp.time) {
+                    actions[i] = actions[i - 1];
+                    i--;
+                }
+                actions[i] = tmp;
+            }
+        } else if (strcmp(cmd, "expect") == 0 && ok) {
+            //expect <label words> <op> <value>
+            expects = realloc(expects, (expectCount + 1) * sizeof(Expect));
+            Expect *e = &expects[expectCount];
+            char *words[WORD_COUNT];
+            int count = 0;
+            for (char *w = strtok(arg, " \t"); w != 0 && count < WORD_COUNT; w = strtok(0, " \t")) {
+                words[count++] = w;
+            }
+            ok = count >= 3 && strlen(words[count - 2]) < sizeof(e->op) && strlen(words[count - 1]) < sizeof(e->value)
+                    && strspn(words[count - 2], "<>=!") == strlen(words[count - 2]);
+            if (ok) {
+                e->label[0] = 0;
+                for (int i = 0; i < count - 2; i++) {
+                    strcat(e->label, i > 0 ? " " : "");
+                    strcat(e->label, words[i]);
+                }
+                strcpy(e->op, words[count - 2]);
+                strcpy(e->value, words[count - 1]);
+                e->lineNr = lineNr;
+                expectCount++;
+            }
+        } else {
+            ok = 0;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "%s:%d: invalid line\n", file, lineNr);
+            fclose(in);
+            return -1;
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+void SIM_ScenarioUpdate(uint64_t now) {
+    while (actionIdx < actionCount && actions[actionIdx].time <= now) {
+        Action *a = &actions[actionIdx++];
+        switch (a->type) {
+            case Action_Press:
+                SIM_SetKeys(keys | a->keys);
+                break;
+            case Action_Release:
+                SIM_SetKeys(keys & ~a->keys);
+                break;
+            case Action_Usb:
+                SIM_USB_Inject((uint8_t*)a->text, strlen(a->text));
+                break;
+            case Action_Ble:
+                SIM_BLE_Inject((uint8_t*)a->text, strlen(a->text));
+                break;
+        }
+    }
+}
+
+uint64_t SIM_ScenarioNextEvent(void) {
+    return actionIdx < actionCount ? actions[actionIdx].time : SIM_NEVER;
+}
+
+double SIM_PositionError(void) {
+    POS_Position pos;
+
+    if (POS_BusRead(LOC_GetPositionBus(), &pos) == 0 || pos.valid != POS_Valid_Flag_Valid) {
+        return -1;
+    }
+    double lat = (pos.latitude.degree + pos.latitude.minute / 60.0) * (pos.latitude.direction == POS_Latitude_Flag_S ? -1 : 1);
+    double lon = (pos.longitude.degree + pos.longitude.minute / 60.0) * (pos.longitude.direction == POS_Longitude_Flag_W ? -1 : 1);
+    return SIM_TruthDistance(lat, lon);
+}
+
+double SIM_TruthDistance(double lat, double lon) {
+    if (!SIM_Config.truthValid) {
+        return -1;
+    }
+
+    //equirectangular approximation, exact enough for a few km
+    double x = (lon - SIM_Config.truthLon) * DEG_TO_RAD * cos(SIM_Config.truthLat * DEG_TO_RAD);
+    double y = (lat - SIM_Config.truthLat) * DEG_TO_RAD;
+    return EARTH_RADIUS * sqrt(x * x + y * y);
+}
+
+uint8_t SIM_KeyPressed(uint8_t key) {
+    return key < SIM_KEY_COUNT && (keys & (1 << key)) != 0;
+}
+
+void SIM_SetKeys(uint8_t mask) {
+    keys = mask;
+    if (sosPressed == SIM_NEVER && (keys & (1 << BTN_SOS_1)) && (keys & (1 << BTN_SOS_2))) {
+        sosPressed = SIM_Now();
+    }
+}
+
+void SIM_Finish(const char *reason) {
+    char buf[16];
+    double host = (double)(clock() - hostStart) / CLOCKS_PER_SEC;
+    double sim = SIM_Now() / 1e6;
+    char *report = 0;
+    size_t reportLen = 0;
+    FILE *out = open_memstream(&report, &reportLen);
+
+    fflush(stdout);
+    fprintf(out, "\n=== WatchPLB simulation report ===\n");
+    fprintf(out, "scenario            %s\n", scenarioFile);
+    fprintf(out, "end                 %s at %s\n", reason, SIM_FormatTime(SIM_Now(), buf));
+    fprintf(out, "simulated time      %.3f s in %.3f s host time (x%.0f)\n", sim, host, host > 0 ? sim / host : 0);
+    SIM_GNSS_Report(out);
+    fprintf(out, "uart overflows      %u bytes\n", SIM_UART_Overflows());
+    fprintf(out, "eeprom words        %u\n", SIM_EEPROM_Words());
+    SIM_BLE_Report(out);
+    if (sosPressed != SIM_NEVER) {
+        fprintf(out, "SOS pressed         %s\n", SIM_FormatTime(sosPressed, buf));
+    }
+    SIM_RADIO_Report(out);
+    SIM_HOMER_Report(out);
+    if (sosPressed != SIM_NEVER && SIM_RADIO_FirstBurst() != SIM_NEVER) {
+        fprintf(out, "SOS to first burst  %.3f s\n", (SIM_RADIO_FirstBurst() - sosPressed) / 1e6);
+    }
+    if (SIM_RADIO_BurstCount() > 0) {
+        fprintf(out, "gnss on per burst   %.3f s\n", SIM_GNSS_OnTime() / 1e6 / SIM_RADIO_BurstCount());
+    }
+
+    static const char *names[SIM_Load_Count] = {"MCU", "GNSS", "radio", "LED", "vibrator", "homer"};
+    double total = 0;
+    fprintf(out, "energy             ");
+    for (uint8_t i = 0; i < SIM_Load_Count; i++) {
+        fprintf(out, " %s %.3f mAh%s", names[i], SIM_GetCharge(i), i + 1 < SIM_Load_Count ? "," : "\n");
+        total += SIM_GetCharge(i);
+    }
+    fprintf(out, "total charge        %.3f mAh (avg %.3f mA)\n", total, sim > 0 ? total * 3600 / sim : 0);
+    if (total > 0) {
+        //at the average current of the run
+        double homer = SIM_GetCharge(SIM_Load_Homer);
+        fprintf(out, "operating time      %.1f h on %.0f mAh, homer %.1f %% of the charge, %.1f h without it\n",
+                SIM_Config.capacity * sim / 3600 / total, SIM_Config.capacity, 100 * homer / total,
+                total > homer ? SIM_Config.capacity * sim / 3600 / (total - homer) : 0);
+    }
+    SIM_REPLAY_Report(out);
+    if (SIM_Config.recordFile != 0) {
+        uint16_t len;
+        const uint8_t *data = REC_GetData(&len);
+        REC_Reader reader;
+        REC_Input input;
+        uint32_t last = REC_GetStartTick();
+        REC_ReaderInit(&reader, data, len, last);
+        while (REC_Next(&reader, &input)) {
+            last = input.tick;
+        }
+        if (SIM_REPLAY_Write(SIM_Config.recordFile) == 0) {
+            fprintf(out, "recording           %u bytes%s covering %.3f s, %u inputs dropped, written to %s\n", len,
+                    REC_IsFull() ? " (full)" : "", (last - REC_GetStartTick()) / 1e3, REC_GetDropped(),
+                    SIM_Config.recordFile);
+        } else {
+            fprintf(out, "recording           cannot write %s\n", SIM_Config.recordFile);
+        }
+    }
+    fclose(out);
+    fputs(report, stdout);
+
+    int failed = checkExpects(report);
+    free(report);
+    exit(SIM_HOMER_Valid() && failed == 0 ? 0 : 1);
+}
+
+static int checkExpects(const char *report) {
+    int failed = 0;
+
+    for (uint32_t i = 0; i < expectCount; i++) {
+        Expect *e = &expects[i];
+        char value[LINE_LEN] = "";
+        char *end;
+        double expected = strtod(e->value, &end);
+        uint8_t number = end != e->value;
+        int found = 0;
+        for (const char *line = report; *line != 0 && !found; line = strchr(line, '\n') + 1) {
+            found = reportValue(line, e->label, number, value);
+        }
+
+        double actual = strtod(value, &end);
+        int ok = found;
+        if (ok && end != value && strcmp(e->op, "<") == 0) {
+            ok = actual < expected;
+        } else if (ok && end != value && strcmp(e->op, "<=") == 0) {
+            ok = actual <= expected;
+        } else if (ok && end != value && strcmp(e->op, ">") == 0) {
+            ok = actual > expected;
+        } else if (ok && end != value && strcmp(e->op, ">=") == 0) {
+            ok = actual >= expected;
+        } else if (ok && strcmp(e->op, "=") == 0) {
+            ok = end != value ? actual == expected : strcmp(value, e->value) == 0;
+        } else if (ok && strcmp(e->op, "!=") == 0) {
+            ok = end != value ? actual != expected : strcmp(value, e->value) != 0;
+        } else {
+            ok = 0;
+        }
+
+        printf("expect              %s %s %s: %s%s\n", e->label, e->op, e->value, found ? value : "no such line",
+                ok ? "" : " FAILED");
+        if (!ok) {
+            fprintf(stderr, "%s:%d: expectation failed\n", scenarioFile, e->lineNr);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+static int reportValue(const char *line, const char *label, uint8_t number, char *value) {
+    char text[LINE_LEN], words[LINE_LEN];
+    size_t len = strcspn(line, "\n");
+    snprintf(text, sizeof(text), "%.*s", (int)(len < sizeof(text) ? len : sizeof(text) - 1), line);
+    snprintf(words, sizeof(words), "%s", label);
+
+    //label words have to appear in order, the first one at the start of the line
+    char *save, *lsave;
+    char *w = strtok_r(text, " \t,()", &save);
+    char *l = strtok_r(words, " ", &lsave);
+    if (w == 0 || l == 0 || strcmp(w, l) != 0) {
+        return 0;
+    }
+    for (l = strtok_r(0, " ", &lsave); l != 0; l = strtok_r(0, " ", &lsave)) {
+        while ((w = strtok_r(0, " \t,()", &save)) != 0 && strcmp(w, l) != 0) {
+        }
+        if (w == 0) {
+            return 0;
+        }
+    }
+
+    //value: next number (units and other words are skipped) or next word
+    value[0] = 0;
+    while ((w = strtok_r(0, " \t,()", &save)) != 0) {
+        char *end;
+        strtod(w, &end);
+        if (!number || end != w) {
+            strcpy(value, w);
+            break;
+        }
+    }
+    return 1;
+}
+
+static int parseTime(const char *text, uint64_t *us) {
+    char *end;
+    double v = strtod(text, &end);
+    if (end == text) {
+        return -1;
+    }
+
+    if (strcmp(end, "us") == 0) {
+        *us = v;
+    } else if (strcmp(end, "ms") == 0) {
+        *us = v * SIM_US_PER_MS;
+    } else if (strcmp(end, "s") == 0 || *end == 0) {
+        *us = v * SIM_US_PER_S;
+    } else if (strcmp(end, "min") == 0) {
+        *us = v * 60 * SIM_US_PER_S;
+    } else if (strcmp(end, "h") == 0) {
+        *us = v * 3600 * SIM_US_PER_S;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static uint8_t parseKeys(char *text) {
+    uint8_t mask = 0;
+
+    for (char *tok = strtok(text, " \t"); tok != 0; tok = strtok(0, " \t")) {
+        int key = atoi(tok);
+        if (key >= 1 && key <= SIM_KEY_COUNT) {
+            mask |= 1 << (key - 1);
+        }
+    }
+    return mask;
+}
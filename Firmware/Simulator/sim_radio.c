@@ -0,0 +1,355 @@
+/**
+ * @file sim_radio.c
+ * @author Paul Götzinger
+ * @brief Host simulator: transceiver model (register interface used by radio.c)
+ * @version 1.0
+ * @date 2019-03-11
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REG_COUNT         0x80
+#define SPI_WRITE         (1 << 7)
+
+#define ADDR_REVISION     0x00
+#define ADDR_PWRMODE      0x02
+#define ADDR_FIFOCTRL     0x04
+#define ADDR_FIFODATA     0x05
+#define ADDR_MODULATION   0x10
+#define ADDR_PLLRANGING   0x2D
+#define ADDR_TXRATEHI     0x31
+#define ADDR_TXRATEMID    0x32
+#define ADDR_TXRATELO     0x33
+
+#define REVISION          0x21
+
+#define PWRMODE_STANDBY   0x05
+#define PWRMODE_SYNTHTX   0x0C
+#define PWRMODE_FULLTX    0x0D
+
+#define MODULATION_OQPSK  0x04
+#define CHIP_PAIRS        4       //chip pairs per fifo byte in OQPSK mode
+
+#define MASK_PLLRANGING_START 0x10
+#define RANGING_TIME      500     //us
+
+#define STATE_FIFO_EMPTY  (1 << 2)
+#define STATE_FIFO_FULL   (1 << 3)
+#define STATE_FIFO_UNDER  (1 << 4)
+#define STATE_FIFO_OVER   (1 << 5)
+#define STATE_PLL_LOCK    (1 << 6)
+
+#define FIFO_DEPTH        4       //fifo entries
+#define FXTAL             16000000ULL
+
+#define BURST_BLOCK       1024    //bursts allocated at once
+
+/**
+ * @brief Recorded burst
+ *
+ */
+typedef struct {
+    uint64_t start;         //switch to full tx
+    uint64_t end;           //switch to standby
+    uint32_t entries;       //fifo entries sent
+    uint32_t underruns;     //fifo ran empty during burst
+    double error;           //error of the published position at burst start in m, negative if unknown
+    uint32_t overflows;     //writes to full fifo
+    uint8_t  chips;         //OQPSK chip mode
+    uint64_t stall;         //longest bus stall (eeprom) overlapping the burst
+} Burst;
+
+static uint8_t reg[REG_COUNT];
+static uint8_t selected;
+static uint8_t byteIdx;
+static uint8_t addr;
+static uint8_t pendingCtrl;     //fifo control written, data entry of 10 bits follows
+
+static uint8_t fifoCount;
+static uint8_t fifoBits[FIFO_DEPTH];
+static uint64_t fifoNext;       //end of current entry
+static uint8_t status;
+static uint64_t rangingEnd;
+
+static Burst *bursts;
+static uint32_t burstCount;
+static uint8_t inBurst;
+static uint64_t firstBurst = SIM_NEVER;
+static uint64_t stallEnd;       //end of last bus stall
+
+/**
+ * @brief Handle register write
+ *
+ * @param a register address
+ * @param data value
+ */
+static void writeReg(uint8_t a, uint8_t data);
+
+/**
+ * @brief Handle register read
+ *
+ * @param a register address
+ * @return uint8_t value
+ */
+static uint8_t readReg(uint8_t a);
+
+/**
+ * @brief Retrieve transmission time of fifo entry
+ *
+ * @param bits bits of entry
+ * @return uint64_t time in us
+ */
+static uint64_t entryTime(uint8_t bits);
+
+/**
+ * @brief Calculate status byte
+ *
+ * @return uint8_t status
+ */
+static uint8_t getStatus(void);
+
+void SIM_RADIO_Init(void) {
+    memset(reg, 0, sizeof(reg));
+    reg[ADDR_REVISION] = REVISION;
+    SIM_SetCurrent(SIM_Load_Radio, SIM_I_RADIO_STANDBY);
+}
+
+void SIM_RADIO_Select(uint8_t active) {
+    selected = active;
+    byteIdx = 0;
+}
+
+uint8_t SIM_RADIO_Transfer(uint8_t tx) {
+    if (!selected) {
+        return 0xFF;
+    }
+
+    if (byteIdx++ == 0) {
+        //address byte, transceiver returns status
+        addr = tx;
+        return getStatus();
+    }
+
+    if (addr & SPI_WRITE) {
+        writeReg(addr & 0x7F, tx);
+        return 0;
+    }
+    return readReg(addr & 0x7F);
+}
+
+void SIM_RADIO_Update(uint64_t now) {
+    //shift out fifo entries while transmitting
+    while (fifoCount > 0 && reg[ADDR_PWRMODE] == PWRMODE_FULLTX && now >= fifoNext) {
+        fifoCount--;
+        memmove(fifoBits, fifoBits + 1, fifoCount);
+        if (fifoCount > 0) {
+            fifoNext += entryTime(fifoBits[0]);
+        } else {
+            //fifo ran empty, an underrun is counted if more data follows
+            status |= STATE_FIFO_UNDER;
+        }
+    }
+
+    if (rangingEnd != 0 && now >= rangingEnd) {
+        reg[ADDR_PLLRANGING] &= ~MASK_PLLRANGING_START;
+        rangingEnd = 0;
+    }
+}
+
+uint64_t SIM_RADIO_NextEvent(void) {
+    uint64_t next = SIM_NEVER;
+
+    if (fifoCount > 0 && reg[ADDR_PWRMODE] == PWRMODE_FULLTX) {
+        next = fifoNext;
+    }
+    if (rangingEnd != 0 && rangingEnd < next) {
+        next = rangingEnd;
+    }
+    return next;
+}
+
+uint8_t SIM_RADIO_FifoFree(void) {
+    return reg[ADDR_PWRMODE] == PWRMODE_FULLTX && fifoCount < FIFO_DEPTH;
+}
+
+uint32_t SIM_RADIO_BurstCount(void) {
+    return burstCount;
+}
+
+void SIM_RADIO_BusStall(uint64_t start, uint64_t end) {
+    stallEnd = end > stallEnd ? end : stallEnd;
+    if (inBurst && end - start > bursts[burstCount].stall) {
+        bursts[burstCount].stall = end - start;
+    }
+}
+
+uint64_t SIM_RADIO_FirstBurst(void) {
+    return firstBurst;
+}
+
+void SIM_RADIO_Report(FILE *out) {
+    char buf[16];
+    uint64_t minLen = SIM_NEVER, maxLen = 0, sumLen = 0;
+    uint64_t maxStall = 0;
+    uint32_t underruns = 0, overflows = 0, chips = 0, errCount = 0, stalled = 0;
+    double errSum = 0, errMax = 0;
+
+    for (uint32_t i = 0; i < burstCount; i++) {
+        uint64_t len = bursts[i].end - bursts[i].start;
+        minLen = len < minLen ? len : minLen;
+        maxLen = len > maxLen ? len : maxLen;
+        sumLen += len;
+        underruns += bursts[i].underruns;
+        overflows += bursts[i].overflows;
+        chips += bursts[i].chips;
+        stalled += bursts[i].stall > 0;
+        maxStall = bursts[i].stall > maxStall ? bursts[i].stall : maxStall;
+        if (bursts[i].error >= 0) {
+            errSum += bursts[i].error;
+            errMax = bursts[i].error > errMax ? bursts[i].error : errMax;
+            errCount++;
+        }
+    }
+
+    fprintf(out, "bursts              %u (%u second generation)\n", burstCount, chips);
+    if (burstCount > 0) {
+        fprintf(out, "first burst         %s\n", SIM_FormatTime(bursts[0].start, buf));
+        fprintf(out, "burst duration      min %.1f ms, avg %.1f ms, max %.1f ms\n",
+                minLen / 1e3, sumLen / 1e3 / burstCount, maxLen / 1e3);
+    }
+    if (burstCount > 1) {
+        uint64_t minGap = SIM_NEVER, maxGap = 0;
+        for (uint32_t i = 1; i < burstCount; i++) {
+            uint64_t gap = bursts[i].start - bursts[i - 1].start;
+            minGap = gap < minGap ? gap : minGap;
+            maxGap = gap > maxGap ? gap : maxGap;
+        }
+        fprintf(out, "burst interval      min %.3f s, avg %.3f s, max %.3f s\n", minGap / 1e6,
+                (bursts[burstCount - 1].start - bursts[0].start) / 1e6 / (burstCount - 1), maxGap / 1e6);
+    }
+    if (errCount > 0) {
+        fprintf(out, "position error      avg %.1f m, max %.1f m (%u bursts)\n", errSum / errCount, errMax, errCount);
+    }
+    fprintf(out, "fifo underruns      %u\n", underruns);
+    fprintf(out, "fifo overflows      %u\n", overflows);
+    fprintf(out, "eeprom in bursts    max %.1f ms stall (%u of %u bursts)\n", maxStall / 1e3, stalled, burstCount);
+
+    if (SIM_Config.burstFile != 0) {
+        FILE *csv = fopen(SIM_Config.burstFile, "w");
+        if (csv != 0) {
+            fprintf(csv, "start_us,end_us,entries,underruns,overflows,chips,error_m\n");
+            for (uint32_t i = 0; i < burstCount; i++) {
+                fprintf(csv, "%llu,%llu,%u,%u,%u,%u,%.1f\n", (unsigned long long)bursts[i].start,
+                        (unsigned long long)bursts[i].end, bursts[i].entries,
+                        bursts[i].underruns, bursts[i].overflows, bursts[i].chips, bursts[i].error);
+            }
+            fclose(csv);
+        }
+    }
+}
+
+static void writeReg(uint8_t a, uint8_t data) {
+    Burst *burst = inBurst ? &bursts[burstCount] : 0;
+
+    switch (a) {
+        case ADDR_PWRMODE:
+            if (data == PWRMODE_FULLTX && !inBurst) {
+                if (burstCount % BURST_BLOCK == 0) {
+                    bursts = realloc(bursts, (burstCount + BURST_BLOCK) * sizeof(Burst));
+                }
+                inBurst = 1;
+                memset(&bursts[burstCount], 0, sizeof(Burst));
+                bursts[burstCount].start = SIM_Now();
+                bursts[burstCount].chips = reg[ADDR_MODULATION] == MODULATION_OQPSK;
+                firstBurst = firstBurst == SIM_NEVER ? SIM_Now() : firstBurst;
+                bursts[burstCount].error = SIM_PositionError();
+                bursts[burstCount].stall = stallEnd > SIM_Now() ? stallEnd - SIM_Now() : 0;
+                fifoNext = SIM_Now() + (fifoCount > 0 ? entryTime(fifoBits[0]) : 0);
+                status &= ~STATE_FIFO_UNDER;
+            } else if (data != PWRMODE_FULLTX && inBurst) {
+                bursts[burstCount++].end = SIM_Now();
+                inBurst = 0;
+                fifoCount = 0;
+            }
+            reg[a] = data;
+            SIM_SetCurrent(SIM_Load_Radio, data == PWRMODE_FULLTX ? SIM_I_RADIO_TX
+                    : data == PWRMODE_SYNTHTX ? SIM_I_RADIO_SYNTH
+                    : data == PWRMODE_STANDBY ? SIM_I_RADIO_STANDBY : SIM_I_RADIO_OFF);
+            break;
+        case ADDR_FIFOCTRL:
+            pendingCtrl = 1;
+            reg[a] = data;
+            break;
+        case ADDR_FIFODATA:
+            if (fifoCount >= FIFO_DEPTH) {
+                status |= STATE_FIFO_OVER;
+                if (burst != 0) {
+                    burst->overflows++;
+                }
+            } else {
+                if (fifoCount == 0) {
+                    if (burst != 0 && (status & STATE_FIFO_UNDER) && burst->entries > 0) {
+                        burst->underruns++;
+                    }
+                    status &= ~STATE_FIFO_UNDER;
+                    fifoNext = SIM_Now() + entryTime(pendingCtrl ? 10 : 8);
+                }
+                fifoBits[fifoCount++] = pendingCtrl ? 10 : 8;
+                if (burst != 0) {
+                    burst->entries++;
+                }
+            }
+            pendingCtrl = 0;
+            break;
+        case ADDR_PLLRANGING:
+            reg[a] = data;
+            if (data & MASK_PLLRANGING_START) {
+                rangingEnd = SIM_Now() + RANGING_TIME;
+            }
+            break;
+        default:
+            reg[a] = data;
+            break;
+    }
+}
+
+static uint8_t readReg(uint8_t a) {
+    if (a == ADDR_FIFOCTRL) {
+        return getStatus();
+    }
+    return reg[a];
+}
+
+static uint64_t entryTime(uint8_t bits) {
+    uint64_t rate = ((uint64_t)reg[ADDR_TXRATEHI] << 16) | (reg[ADDR_TXRATEMID] << 8) | reg[ADDR_TXRATELO];
+    rate = rate * FXTAL >> 24;
+    if (rate == 0) {
+        return SIM_US_PER_MS;
+    }
+
+    if (reg[ADDR_MODULATION] == MODULATION_OQPSK) {
+        //each fifo byte holds interleaved chip pairs
+        return CHIP_PAIRS * SIM_US_PER_S / rate;
+    }
+    return bits * SIM_US_PER_S / rate;
+}
+
+static uint8_t getStatus(void) {
+    uint8_t s = status & (STATE_FIFO_UNDER | STATE_FIFO_OVER);
+
+    if (fifoCount == 0) {
+        s |= STATE_FIFO_EMPTY;
+    }
+    if (fifoCount >= FIFO_DEPTH) {
+        s |= STATE_FIFO_FULL;
+    }
+    if (reg[ADDR_PWRMODE] == PWRMODE_SYNTHTX || reg[ADDR_PWRMODE] == PWRMODE_FULLTX) {
+        s |= STATE_PLL_LOCK;
+    }
+    return s;
+}
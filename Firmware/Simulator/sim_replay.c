@@ -0,0 +1,245 @@
+/**
+ * @file sim_replay.c
+ * @author Paul Götzinger
+ * @brief Host simulator: replay of recorded firmware inputs (Tools/Record)
+ * @version 1.0
+ * @date 2019-03-27
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_LEN      256
+#define INPUT_BLOCK   1024    //inputs allocated at once
+
+static REC_Input *inputs;
+static uint32_t inputCount;
+static uint32_t next;           //next timed input (streams, keys)
+static uint16_t nextPos;        //next byte of a uart stream in inputs[next]
+static uint32_t nextAdc;        //next conversion, consumed in order
+static uint16_t adcRepeats;     //repeats of the current conversion before inputs[nextAdc]
+static int32_t adc;             //current conversion, the recorder starts from 0
+static uint32_t adcMissing;     //conversions after the end of the recording
+static uint8_t active;
+static uint8_t full;
+static uint32_t length;
+
+/**
+ * @brief Search next input of a source
+ *
+ * @param idx start index
+ * @param src source
+ * @return uint32_t index, inputCount if none
+ */
+static uint32_t findNext(uint32_t idx, REC_Source src);
+
+/**
+ * @brief Check if the input is delivered by time (streams and keys)
+ *
+ * @param input input
+ * @return int 1 if timed
+ */
+static int isTimed(const REC_Input *input);
+
+/**
+ * @brief Time an input is delivered
+ *
+ * @param input input
+ * @param pos byte of a uart stream
+ * @return uint64_t time in us
+ */
+static uint64_t deliveryTime(const REC_Input *input, uint16_t pos);
+
+int SIM_REPLAY_Init(const char *file) {
+    FILE *in = fopen(file, "r");
+    if (in == 0) {
+        return -1;
+    }
+
+    //dump of the usb command "record", log lines and simulator timestamps are skipped
+    uint8_t *data = 0;
+    uint32_t len = 0;
+    unsigned long start = 0;
+    int header = 0;
+    char line[LINE_LEN];
+    while (fgets(line, sizeof(line), in) != 0) {
+        char *text = line;
+        unsigned h, m, s, ms;
+        int skip = 0;
+        if (sscanf(text, "%u:%u:%u.%u %n", &h, &m, &s, &ms, &skip) == 4 && skip > 0) {
+            text += skip;
+        }
+
+        unsigned offset;
+        char hex[LINE_LEN];
+        if (sscanf(text, "record %*u bytes, start %lu", &start) == 1) {
+            header = 1;
+            full = strstr(text, ", full") != 0;
+            len = 0;
+        } else if (header && strncmp(text, "end", 3) == 0) {
+            break;
+        } else if (header && sscanf(text, "%x %255s", &offset, hex) == 2 && offset == len) {
+            data = realloc(data, len + strlen(hex) / 2);
+            for (char *p = hex; p[0] != 0 && p[1] != 0; p += 2) {
+                unsigned byte;
+                sscanf(p, "%2x", &byte);
+                data[len++] = byte;
+            }
+        }
+    }
+    fclose(in);
+    if (!header) {
+        free(data);
+        return -1;
+    }
+
+    REC_Reader reader;
+    REC_ReaderInit(&reader, data, len, start);
+    for (;;) {
+        if (inputCount % INPUT_BLOCK == 0) {
+            inputs = realloc(inputs, (inputCount + INPUT_BLOCK) * sizeof(REC_Input));
+        }
+        if (!REC_Next(&reader, &inputs[inputCount])) {
+            break;
+        }
+        inputCount++;
+    }
+    free(data);
+    if (reader.pos != len) {
+        fprintf(stderr, "%s: recording corrupt at byte %u\n", file, reader.pos);
+        return -1;
+    }
+
+    length = len;
+    active = 1;
+    nextAdc = findNext(0, REC_Source_Adc);
+    adcRepeats = nextAdc < inputCount ? inputs[nextAdc].count : 0;
+    adc = 0;
+    next = 0;
+    nextPos = 0;
+    while (next < inputCount && !isTimed(&inputs[next])) {
+        next++;
+    }
+    return 0;
+}
+
+uint8_t SIM_REPLAY_Active(void) {
+    return active;
+}
+
+void SIM_REPLAY_Update(uint64_t now) {
+    while (next < inputCount && deliveryTime(&inputs[next], nextPos) <= now) {
+        REC_Input *input = &inputs[next];
+        switch (input->source) {
+            case REC_Source_Gnss:
+            case REC_Source_Ble:
+                //byte by byte like the receiver sends them, the firmware wakes up as often as recorded
+                SIM_UART_Replay(input->source, &input->data[nextPos++], 1);
+                if (nextPos < input->count) {
+                    continue;
+                }
+                break;
+            case REC_Source_Usb:
+                SIM_USB_Inject(input->data, input->count);
+                break;
+            case REC_Source_Keys:
+                SIM_SetKeys(input->value);
+                break;
+            default:
+                break;
+        }
+        next++;
+        nextPos = 0;
+        while (next < inputCount && !isTimed(&inputs[next])) {
+            next++;
+        }
+    }
+}
+
+uint64_t SIM_REPLAY_NextEvent(void) {
+    return next < inputCount ? deliveryTime(&inputs[next], nextPos) : SIM_NEVER;
+}
+
+uint8_t SIM_REPLAY_Adc(int32_t *value) {
+    if (!active) {
+        return 0;
+    }
+    if (nextAdc >= inputCount) {
+        //the last conversion holds, a full recording does not know later changes
+        adcMissing++;
+    } else if (adcRepeats > 0) {
+        adcRepeats--;
+    } else {
+        adc = inputs[nextAdc].value;
+        nextAdc = findNext(nextAdc + 1, REC_Source_Adc);
+        adcRepeats = nextAdc < inputCount ? inputs[nextAdc].count : 0;
+    }
+    *value = adc;
+    return 1;
+}
+
+void SIM_REPLAY_Report(FILE *out) {
+    if (!active) {
+        return;
+    }
+
+    uint32_t left = 0;
+    for (uint32_t i = next; i < inputCount; i++) {
+        left += isTimed(&inputs[i]);
+    }
+    left += nextAdc < inputCount;
+
+    fprintf(out, "replay              %u bytes, %u inputs%s, %u not consumed\n",
+            length, inputCount, full ? " (recording was full)" : "", left);
+    if (adcMissing != 0) {
+        fprintf(out, "replay ended        %u adc reads beyond the recording repeated the last conversion\n", adcMissing);
+    }
+}
+
+int SIM_REPLAY_Write(const char *file) {
+    FILE *out = fopen(file, "w");
+    if (out == 0) {
+        return -1;
+    }
+
+    //same format as the usb command "record"
+    uint16_t len;
+    const uint8_t *data = REC_GetData(&len);
+    fprintf(out, "record %u bytes, start %u, mask 0x%02x, %u dropped%s%s\n", len, REC_GetStartTick(), REC_GetMask(),
+            REC_GetDropped(), REC_IsRunning() ? "" : ", stopped", REC_IsFull() ? ", full" : "");
+    for (uint16_t i = 0; i < len; i += 16) {
+        fprintf(out, "%04x ", i);
+        for (uint16_t j = i; j < len && j < i + 16; j++) {
+            fprintf(out, "%02x", data[j]);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "end\n");
+    fclose(out);
+    return 0;
+}
+
+static uint32_t findNext(uint32_t idx, REC_Source src) {
+    while (idx < inputCount && inputs[idx].source != src) {
+        idx++;
+    }
+    return idx;
+}
+
+static int isTimed(const REC_Input *input) {
+    return input->source != REC_Source_Adc;
+}
+
+static uint64_t deliveryTime(const REC_Input *input, uint16_t pos) {
+    //at the start of the tick the firmware consumed it, the main loop wakes up and reads it in the same tick;
+    //uart bytes are spread over the span of their record
+    uint32_t tick = input->tick;
+    if ((input->source == REC_Source_Gnss || input->source == REC_Source_Ble) && input->count > 1) {
+        tick -= input->span - input->span * pos / (input->count - 1);
+    }
+    return tick * SIM_US_PER_MS;
+}
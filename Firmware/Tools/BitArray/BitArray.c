@@ -26,7 +26,7 @@ void BITARRAY_AddBit(BitArray_t* bitArr, uint8_t bit) {
     }
 }
 
-void BITARRAY_AddBits(BitArray_t* bitArr, uint16_t bits, uint8_t cnt){
+void BITARRAY_AddBits(BitArray_t* bitArr, uint32_t bits, uint8_t cnt){
     if (bitArr != NULL && bitArr->idx < bitArr->len) {
         for (uint8_t i = 1; i <= cnt; i++) {
         	BITARRAY_AddBit(bitArr, bits >> (cnt - i));
@@ -42,6 +42,6 @@ void BITARRAY_AddBit(BitArray_t* bitArr, uint8_t bit);
  * @param bits   variable containing bits
  * @param cnt    count of bits to add
  */
-void BITARRAY_AddBits(BitArray_t* bitArr, uint16_t bits, uint8_t cnt);
+void BITARRAY_AddBits(BitArray_t* bitArr, uint32_t bits, uint8_t cnt);
 
 #endif //!BITARRY_H
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * @file memory.c
+ * @author Paul Götzinger
+ * @brief Stack high-water mark, stack guard and static RAM budget per module
+ * @version 1.0
+ * @date 2019-03-21
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "memory.h"
+#include "trace.h"
+
+//symbols of the linker script
+extern uint32_t _sdata[], _edata[], _sbss[], _ebss[], _estack[];
+extern uint32_t __noinit_start[], __noinit_end[], __stack_limit[];
+extern uint32_t _sramfunc[], _eramfunc[];
+extern const MEM_Buffer __membuf_start[], __membuf_end[];
+
+#define MEM_SYMBOLS(NAME) extern uint8_t __mem_##NAME##_start[], __mem_##NAME##_end[], __mem_##NAME##_budget[];
+MEM_MODULES(MEM_SYMBOLS)
+
+#define MEM_ENTRY(NAME) {#NAME, __mem_##NAME##_start, __mem_##NAME##_end, __mem_##NAME##_budget},
+
+/**
+ * @brief Module range and budget (absolute symbol, its address is the value)
+ *
+ */
+typedef struct {
+    const char *name;
+    const uint8_t *start;
+    const uint8_t *end;
+    const uint8_t *budget;
+} Module;
+
+static const Module modules[] = {
+    MEM_MODULES(MEM_ENTRY)
+};
+
+#define MODULE_COUNT (sizeof(modules) / sizeof(modules[0]))
+#define SP_MARGIN    16  //words below the stack pointer left unpainted
+
+static uint8_t guardHit;
+
+void MEM_PaintStack(void) {
+    //words below the current stack pointer are unused, keep a margin for this function
+    uint32_t *sp = (uint32_t*)__get_MSP() - SP_MARGIN;
+    for (uint32_t *p = __stack_limit; p < sp; p++) {
+        *p = MEM_STACK_PATTERN;
+    }
+    guardHit = 0;
+}
+
+void MEM_Check(void) {
+    if (guardHit == 0 && MEM_GuardIntact() == 0) {
+        //stack reached the guard (or the heap grew into it), data below may be corrupted
+        guardHit = 1;
+        TRACE_MARK(TRACE_Event_Stack, MEM_GetStackUsage());
+        LOG("[MEM] Stack guard violated, %u of %u bytes used\n", MEM_GetStackUsage(), MEM_GetStackSize());
+    }
+}
+
+uint8_t MEM_GuardIntact(void) {
+    for (uint8_t i = 0; i < MEM_GUARD_SIZE / sizeof(uint32_t); i++) {
+        if (__stack_limit[i] != MEM_STACK_PATTERN) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint16_t MEM_GetStackUsage(void) {
+    //the stack grows down, the first overwritten word from the limit up is the deepest point
+    const uint32_t *p = __stack_limit;
+    while (p < _estack && *p == MEM_STACK_PATTERN) {
+        p++;
+    }
+    return (uint8_t*)_estack - (uint8_t*)p;
+}
+
+uint16_t MEM_GetStackSize(void) {
+    return (uint8_t*)_estack - (uint8_t*)__stack_limit;
+}
+
+void MEM_GetStatic(uint16_t *data, uint16_t *bss, uint16_t *noinit) {
+    *data = (uint8_t*)_edata - (uint8_t*)_sdata;
+    *bss = (uint8_t*)_ebss - (uint8_t*)_sbss;
+    *noinit = (uint8_t*)__noinit_end - (uint8_t*)__noinit_start;
+}
+
+uint16_t MEM_GetRamCode(void) {
+    return (uint8_t*)_eramfunc - (uint8_t*)_sramfunc;
+}
+
+uint8_t MEM_GetModule(uint8_t idx, MEM_Module *module) {
+    if (idx >= MODULE_COUNT || module == 0) {
+        return 0;
+    }
+    module->name = modules[idx].name;
+    module->used = modules[idx].end - modules[idx].start;
+    module->budget = (uintptr_t)modules[idx].budget;
+    return 1;
+}
+
+const MEM_Buffer* MEM_GetBuffer(uint8_t idx) {
+    return idx < __membuf_end - __membuf_start ? &__membuf_start[idx] : 0;
+}
+
+void MEM_LogReport(void) {
+    uint16_t data, bss, noinit;
+    MEM_Module module;
+    const MEM_Buffer *buf;
+
+    MEM_GetStatic(&data, &bss, &noinit);
+    LOG("[MEM] data %u, bss %u, noinit %u, ramfunc %u, stack %u bytes\n", data, bss, noinit, MEM_GetRamCode(),
+            MEM_GetStackSize());
+    for (uint8_t i = 0; MEM_GetModule(i, &module); i++) {
+        LOG("[MEM] %-5s %5u of %5u bytes\n", module.name, module.used, module.budget);
+    }
+    for (uint8_t i = 0; (buf = MEM_GetBuffer(i)) != 0; i++) {
+        LOG("[MEM] %-5s %-16s %5u bytes at %p\n", buf->module, buf->name, buf->size, buf->addr);
+    }
+    LOG("[MEM] Stack high-water mark %u bytes\n", MEM_GetStackUsage());
+}
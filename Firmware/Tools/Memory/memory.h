@@ -0,0 +1,151 @@
+/**
+ * @file memory.h
+ * @author Paul Götzinger
+ * @brief Stack high-water mark, stack guard and static RAM budget per module
+ * @version 1.0
+ * @date 2019-03-21
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+
+#ifndef MEM_RAMFUNC_ENABLE
+#define MEM_RAMFUNC_ENABLE 1            //set to 0 to execute all functions from flash
+#endif
+
+#define MEM_STACK_PATTERN 0xC5C5C5C5UL  //unused stack is painted with this pattern
+#define MEM_GUARD_SIZE    32            //bytes at the stack limit which must stay painted
+
+/**
+ * @brief Modules with a static RAM budget, budgets are set and enforced in the linker script
+ * (.bss of the module objects, see stm32_flash.ld)
+ *
+ */
+#define MEM_MODULES(X) \
+    X(usb) \
+    X(ble) \
+    X(gnss) \
+    X(emc) \
+    X(com) \
+    X(log)
+
+/**
+ * @brief Registered static buffer
+ *
+ */
+typedef struct {
+    const char *module;
+    const char *name;
+    const void *addr;
+    uint16_t size;
+} MEM_Buffer;
+
+/**
+ * @brief RAM usage of a module
+ *
+ */
+typedef struct {
+    const char *name;
+    uint16_t used;      //bytes of .bss
+    uint16_t budget;    //bytes
+} MEM_Module;
+
+/**
+ * @brief Register a static buffer for the RAM report (descriptor is kept in flash)
+ *
+ */
+#define MEM_BUFFER(MODULE, BUF) \
+    static const MEM_Buffer mem_buffer_##BUF __attribute__((section(".membuf"), used)) = \
+        {MODULE, #BUF, &(BUF), sizeof(BUF)}
+
+/**
+ * @brief Execute function from RAM: no flash wait states and no jitter of the flash interface in
+ * the radio refill path, the trace write and SysTick. Only for functions whose callees run from RAM
+ * as well, HAL functions are listed in stm32_flash.ld. Copied by the startup code, calls between
+ * flash and RAM go through linker veneers (RAM budget in stm32_flash.ld)
+ *
+ */
+#if MEM_RAMFUNC_ENABLE && !defined(SIMULATOR)
+#define MEM_RAMFUNC __attribute__((section(".RamFunc"), noinline))
+#else
+#define MEM_RAMFUNC
+#endif
+
+/**
+ * @brief Paint unused stack down to the stack limit, call first in main (interrupts not enabled yet)
+ *
+ */
+void MEM_PaintStack(void);
+
+/**
+ * @brief Check stack guard, call once per main loop pass; a violation is logged and traced once
+ *
+ */
+void MEM_Check(void);
+
+/**
+ * @brief Check if the stack guard is still painted
+ *
+ * @return uint8_t 1 if intact
+ */
+uint8_t MEM_GuardIntact(void);
+
+/**
+ * @brief Retrieve deepest stack usage since boot (high-water mark)
+ *
+ * @return uint16_t bytes
+ */
+uint16_t MEM_GetStackUsage(void);
+
+/**
+ * @brief Retrieve stack size (stack top down to stack limit)
+ *
+ * @return uint16_t bytes
+ */
+uint16_t MEM_GetStackSize(void);
+
+/**
+ * @brief Retrieve size of initialized, zeroed and not initialized static data
+ *
+ * @param data .data bytes
+ * @param bss .bss bytes
+ * @param noinit .noinit bytes
+ */
+void MEM_GetStatic(uint16_t *data, uint16_t *bss, uint16_t *noinit);
+
+/**
+ * @brief Retrieve size of the functions executed from RAM
+ *
+ * @return uint16_t bytes
+ */
+uint16_t MEM_GetRamCode(void);
+
+/**
+ * @brief Retrieve RAM usage of module
+ *
+ * @param idx index of module
+ * @param module usage
+ * @return uint8_t 1 on success, 0 if idx out of range
+ */
+uint8_t MEM_GetModule(uint8_t idx, MEM_Module *module);
+
+/**
+ * @brief Retrieve registered static buffer
+ *
+ * @param idx index of buffer
+ * @return const MEM_Buffer* buffer, 0 if idx out of range
+ */
+const MEM_Buffer* MEM_GetBuffer(uint8_t idx);
+
+/**
+ * @brief Log RAM budget report (static data, modules, buffers, stack)
+ *
+ */
+void MEM_LogReport(void);
+
+#endif //!MEMORY_H
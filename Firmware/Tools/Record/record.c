@@ -0,0 +1,452 @@
+/**
+ * @file record.c
+ * @author Paul Götzinger
+ * @brief Compact recorder of all firmware inputs for deterministic replay in the simulator
+ * @version 1.0
+ * @date 2019-03-27
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "record.h"
+#include "eeprom.h"
+#include "memory.h"
+#include <string.h>
+
+#define REC_MAGIC     0x52454344  //"RECD"
+#define SOURCE_SHIFT  5           //record header: source in bits 7..5, tick delta in bits 4..0
+#define DELTA_INLINE  31          //larger tick deltas follow the header as varint
+#define TOKEN_PREDICT 0x80        //0x00..0x7F: 1..128 literal bytes follow, 0x80..0xFE: 1..127 predicted bytes
+#define TOKEN_END     0xFF        //end of stream record, span of the record (ms) follows as varint
+#define LITERAL_MAX   128
+#define PREDICT_MAX   127
+#define CLOSE_RESERVE 6           //end token and span of an open stream record
+#define NONE          0xFFFF
+
+//tick of the HAL read directly, recording must not change the timing of the firmware
+extern __IO uint32_t uwTick;
+
+/**
+ * @brief Header of the recording saved in data eeprom
+ *
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t start;
+    uint16_t len;
+    uint8_t full;
+    uint8_t reserved;
+} Saved;
+
+/**
+ * @brief Recorder state, inputs are recorded from the main loop only
+ *
+ */
+typedef struct {
+    uint32_t mask;
+    uint32_t start;     //tick of start
+    uint32_t tick;      //tick of last record
+    uint16_t len;
+    uint8_t running;
+    uint8_t full;
+    uint8_t open;       //source of open stream record, REC_Source_Count if none
+    uint16_t token;     //index of last token of open stream record, NONE if none
+    uint16_t count;     //bytes in open stream record
+    uint32_t first;     //tick of first byte in open stream record
+    uint32_t last;      //tick of last byte in open stream record
+    int32_t adc;        //last conversion
+    uint16_t repeats;   //conversions equal to the last one since its record
+    uint8_t keys;       //last key states
+    uint32_t dropped;   //inputs dropped since full
+    REC_Predictor predictor;
+} Recorder;
+
+static Recorder rec;
+static uint8_t recording[REC_SIZE];
+
+MEM_BUFFER("rec", recording);
+
+static const char* const names[REC_Source_Count] = {
+    "gnss", "ble", "usb", "keys", "adc"
+};
+
+/**
+ * @brief Check for space; if full the input is dropped and counted, the recording keeps its beginning
+ * (space for ending a stream record is kept)
+ *
+ * @param n bytes needed
+ * @return uint8_t 1 if recording
+ */
+static uint8_t reserve(uint16_t n);
+
+/**
+ * @brief Write record header
+ *
+ * @param src source
+ * @param tick tick of record
+ */
+static void putHeader(REC_Source src, uint32_t tick);
+
+/**
+ * @brief Write unsigned varint (7 bit per byte, least significant first)
+ *
+ * @param value value
+ */
+static void putVarint(uint32_t value);
+
+/**
+ * @brief End open stream record
+ *
+ */
+static void closeStream(void);
+
+/**
+ * @brief Read unsigned varint
+ *
+ * @param reader decoder state
+ * @param value value
+ * @return uint8_t 1 on success
+ */
+static uint8_t getVarint(REC_Reader *reader, uint32_t *value);
+
+/**
+ * @brief Retrieve predicted next byte of a stream
+ *
+ * @param p predictor
+ * @param src stream
+ * @return uint8_t prediction
+ */
+static inline uint8_t predict(REC_Predictor *p, REC_Source src) {
+    return p->history[p->match[src] & (REC_HISTORY - 1)];
+}
+
+/**
+ * @brief Add byte of a stream to the history and update the prediction
+ *
+ * @param p predictor
+ * @param src stream
+ * @param byte byte
+ * @param hit byte was predicted
+ */
+static void learn(REC_Predictor *p, REC_Source src, uint8_t byte, uint8_t hit);
+
+void REC_Init(void) {
+    rec.mask = REC_MASK_DEFAULT;
+    REC_Restart();
+}
+
+void REC_Restart(void) {
+    memset(&rec.predictor, 0, sizeof(REC_Predictor));
+    rec.start = uwTick;
+    rec.tick = rec.start;
+    rec.len = 0;
+    rec.full = 0;
+    rec.open = REC_Source_Count;
+    rec.adc = 0;
+    rec.repeats = 0;
+    rec.keys = 0;
+    rec.dropped = 0;
+    rec.running = 1;
+}
+
+void REC_Stop(void) {
+    closeStream();
+    rec.running = 0;
+}
+
+void REC_SetMask(uint32_t mask) {
+    rec.mask = mask;
+}
+
+uint32_t REC_GetMask(void) {
+    return rec.mask;
+}
+
+void REC_Byte(REC_Source src, uint8_t byte) {
+    if (!rec.running || src >= REC_STREAMS || (rec.mask & (1UL << src)) == 0) {
+        return;
+    }
+
+    //a stream record ends with a pause, the replay delivers all its bytes at the tick of the last one
+    uint32_t tick = uwTick;
+    if (rec.open != src || rec.count >= REC_STREAM_MAX || tick - rec.last > REC_STREAM_GAP) {
+        closeStream();
+    }
+    if (rec.open == REC_Source_Count) {
+        if (!reserve(CLOSE_RESERVE + 2)) {
+            return;
+        }
+        putHeader(src, tick);
+        rec.open = src;
+        rec.token = NONE;
+        rec.count = 0;
+        rec.first = tick;
+    } else if (!reserve(2)) {
+        return;
+    }
+
+    //predicted bytes (NMEA sentences repeat every epoch) only extend a run
+    uint8_t hit = predict(&rec.predictor, src) == byte;
+    uint8_t *token = rec.token != NONE ? &recording[rec.token] : 0;
+    if (hit) {
+        if (token != 0 && *token >= TOKEN_PREDICT && *token < TOKEN_PREDICT + PREDICT_MAX - 1) {
+            (*token)++;
+        } else {
+            rec.token = rec.len;
+            recording[rec.len++] = TOKEN_PREDICT;
+        }
+    } else {
+        if (token != 0 && *token < LITERAL_MAX - 1) {
+            (*token)++;
+        } else {
+            rec.token = rec.len;
+            recording[rec.len++] = 0;
+        }
+        recording[rec.len++] = byte;
+    }
+    learn(&rec.predictor, src, byte, hit);
+    rec.count++;
+    rec.last = tick;
+
+    //the end of a line is processed at once, its tick matters
+    if (byte == '\n') {
+        closeStream();
+    }
+}
+
+void REC_Key(uint8_t key, uint8_t state) {
+    uint8_t bit = 1 << key;
+    if (!rec.running || key >= 8 || (rec.mask & (1UL << REC_Source_Keys)) == 0
+            || ((rec.keys & bit) != 0) == (state != 0)) {
+        return;
+    }
+
+    closeStream();
+    if (reserve(CLOSE_RESERVE + 1)) {
+        rec.keys ^= bit;
+        putHeader(REC_Source_Keys, uwTick);
+        recording[rec.len++] = rec.keys;
+    }
+}
+
+void REC_Adc(int32_t value) {
+    if (!rec.running || (rec.mask & (1UL << REC_Source_Adc)) == 0) {
+        return;
+    }
+    //conversions follow main loop passes, not time: the replay serves them in order
+    if (value == rec.adc && rec.repeats < NONE) {
+        rec.repeats++;
+        return;
+    }
+
+    closeStream();
+    if (reserve(CLOSE_RESERVE + 8)) {
+        //repeats of the last conversion and the difference to it, zigzag coded (small magnitude, small varint)
+        int32_t diff = value - rec.adc;
+        putHeader(REC_Source_Adc, uwTick);
+        putVarint(rec.repeats);
+        putVarint(((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31));
+        rec.adc = value;
+        rec.repeats = 0;
+    }
+}
+
+const uint8_t* REC_GetData(uint16_t *len) {
+    closeStream();
+    if (len != 0) {
+        *len = rec.len;
+    }
+    return recording;
+}
+
+uint32_t REC_GetStartTick(void) {
+    return rec.start;
+}
+
+uint8_t REC_IsFull(void) {
+    return rec.full;
+}
+
+uint32_t REC_GetDropped(void) {
+    return rec.dropped;
+}
+
+uint8_t REC_IsRunning(void) {
+    return rec.running && !rec.full;
+}
+
+uint8_t REC_Save(void) {
+    Saved saved = { REC_MAGIC, rec.start, rec.len, rec.full, 0 };
+
+    REC_Stop();
+    return EEPROM_Write(REC_EEPROM_OFFSET, (uint8_t*)&saved, sizeof(Saved)) == HAL_OK
+            && EEPROM_Write(REC_EEPROM_OFFSET + sizeof(Saved), recording, rec.len) == HAL_OK;
+}
+
+uint8_t REC_Load(void) {
+    Saved saved;
+
+    REC_Stop();
+    if (EEPROM_Read(REC_EEPROM_OFFSET, (uint8_t*)&saved, sizeof(Saved)) != HAL_OK
+            || saved.magic != REC_MAGIC || saved.len > REC_SIZE
+            || EEPROM_Read(REC_EEPROM_OFFSET + sizeof(Saved), recording, saved.len) != HAL_OK) {
+        return 0;
+    }
+    rec.start = saved.start;
+    rec.len = saved.len;
+    rec.full = saved.full;
+    return 1;
+}
+
+void REC_ReaderInit(REC_Reader *reader, const uint8_t *data, uint16_t len, uint32_t start) {
+    memset(reader, 0, sizeof(REC_Reader));
+    reader->data = data;
+    reader->len = len;
+    reader->tick = start;
+}
+
+uint8_t REC_Next(REC_Reader *reader, REC_Input *input) {
+    uint32_t value;
+
+    if (reader->pos >= reader->len) {
+        return 0;
+    }
+    uint8_t header = reader->data[reader->pos++];
+    uint32_t delta = header & DELTA_INLINE;
+    if (delta == DELTA_INLINE) {
+        if (!getVarint(reader, &value)) {
+            return 0;
+        }
+        delta += value;
+    }
+    reader->tick += delta;
+
+    input->source = header >> SOURCE_SHIFT;
+    input->value = 0;
+    input->span = 0;
+    input->count = 0;
+
+    switch (input->source) {
+        case REC_Source_Gnss:
+        case REC_Source_Ble:
+        case REC_Source_Usb:
+            while (reader->pos < reader->len) {
+                uint8_t token = reader->data[reader->pos++];
+                if (token == TOKEN_END) {
+                    if (!getVarint(reader, &value)) {
+                        return 0;
+                    }
+                    reader->tick += value;
+                    input->tick = reader->tick;
+                    input->span = value;
+                    return 1;
+                }
+
+                uint8_t literal = token < TOKEN_PREDICT;
+                uint8_t n = literal ? token + 1 : token - TOKEN_PREDICT + 1;
+                while (n-- > 0) {
+                    if (input->count >= REC_STREAM_MAX || (literal && reader->pos >= reader->len)) {
+                        return 0;
+                    }
+                    uint8_t byte = literal ? reader->data[reader->pos++] : predict(&reader->predictor, input->source);
+                    learn(&reader->predictor, input->source, byte, !literal);
+                    input->data[input->count++] = byte;
+                }
+            }
+            return 0;
+        case REC_Source_Keys:
+            if (reader->pos >= reader->len) {
+                return 0;
+            }
+            reader->keys = reader->data[reader->pos++];
+            input->value = reader->keys;
+            break;
+        case REC_Source_Adc:
+            if (!getVarint(reader, &value) || value > NONE) {
+                return 0;
+            }
+            input->count = value;
+            if (!getVarint(reader, &value)) {
+                return 0;
+            }
+            reader->adc += (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+            input->value = reader->adc;
+            break;
+        default:
+            return 0;
+    }
+    input->tick = reader->tick;
+    return 1;
+}
+
+const char* REC_GetName(REC_Source src) {
+    return src < REC_Source_Count ? names[src] : 0;
+}
+
+static uint8_t reserve(uint16_t n) {
+    //keep the beginning, a replay has to start at boot; no log, the record points sit in the driver read paths
+    if (rec.full || rec.len + n + CLOSE_RESERVE > REC_SIZE) {
+        closeStream();
+        rec.full = 1;
+        rec.dropped++;
+        return 0;
+    }
+    return 1;
+}
+
+static void putHeader(REC_Source src, uint32_t tick) {
+    uint32_t delta = tick - rec.tick;
+
+    recording[rec.len++] = (src << SOURCE_SHIFT) | (delta < DELTA_INLINE ? delta : DELTA_INLINE);
+    if (delta >= DELTA_INLINE) {
+        putVarint(delta - DELTA_INLINE);
+    }
+    rec.tick = tick;
+}
+
+static void putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        recording[rec.len++] = value | 0x80;
+        value >>= 7;
+    }
+    recording[rec.len++] = value;
+}
+
+static void closeStream(void) {
+    if (rec.open == REC_Source_Count) {
+        return;
+    }
+
+    recording[rec.len++] = TOKEN_END;
+    putVarint(rec.last - rec.first);
+    rec.tick = rec.last;
+    rec.open = REC_Source_Count;
+}
+
+static uint8_t getVarint(REC_Reader *reader, uint32_t *value) {
+    *value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (reader->pos >= reader->len) {
+            return 0;
+        }
+        uint8_t byte = reader->data[reader->pos++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void learn(REC_Predictor *p, REC_Source src, uint8_t byte, uint8_t hit) {
+    uint32_t context = ((p->context[src] << 8) | byte) & 0xFFFFFF;
+    uint16_t idx = (uint32_t)((context | ((uint32_t)src << 24)) * 2654435761UL) >> (32 - REC_TABLE_BITS);
+
+    p->history[p->head & (REC_HISTORY - 1)] = byte;
+    p->head++;
+    //follow the match while it holds, else continue behind the last occurrence of the context
+    p->match[src] = hit ? p->match[src] + 1 : p->table[idx];
+    p->table[idx] = p->head;
+    p->context[src] = context;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file record.h
+ * @author Paul Götzinger
+ * @brief Compact recorder of all firmware inputs for deterministic replay in the simulator
+ * @version 1.0
+ * @date 2019-03-27
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+
+#ifndef REC_ENABLE
+#define REC_ENABLE 1            //set to 0 to remove all record points
+#endif
+
+#ifndef REC_SIZE
+#define REC_SIZE          2048  //bytes of recording (RAM), saved to data eeprom on request
+#endif
+#define REC_STREAM_MAX    128   //bytes per stream record
+#define REC_STREAM_GAP    2     //ms without byte which ends a stream record
+#define REC_HISTORY       512   //bytes of stream history for the predictor (power of 2)
+#define REC_TABLE_BITS    8     //predictor table of 2^n positions
+#define REC_EEPROM_OFFSET 256   //offset of saved recording in data eeprom (behind configuration)
+
+/**
+ * @brief Recorded inputs, at most 8 (3 bit in record header), byte streams first; transceiver reads
+ * are not recorded: they run from RAM during bursts and the simulator models the transceiver
+ *
+ */
+typedef enum {
+    REC_Source_Gnss = 0,    //bytes read from the gnss uart
+    REC_Source_Ble,         //bytes read from the ble uart
+    REC_Source_Usb,         //bytes of command lines received over usb
+    REC_Source_Keys,        //key states (mask), recorded on change
+    REC_Source_Adc,         //adc conversions (battery), recorded on change with the repeats before
+    REC_Source_Count
+} REC_Source;
+
+#define REC_STREAMS      REC_Source_Keys
+#define REC_MASK_DEFAULT ((1UL << REC_Source_Count) - 1)
+
+/**
+ * @brief Decoded input
+ *
+ */
+typedef struct {
+    uint32_t tick;          //HAL tick the input was consumed (streams: last byte)
+    REC_Source source;
+    int32_t value;          //keys: mask, adc: conversion
+    uint32_t span;          //streams: ms from first to last byte
+    uint16_t count;         //streams: bytes in data, adc: repeats of the previous conversion before
+    uint8_t data[REC_STREAM_MAX];
+} REC_Input;
+
+/**
+ * @brief Stream predictor (LZP): a context of 3 bytes points behind its last occurrence
+ * in the history, the bytes found there are predicted until the first miss
+ *
+ */
+typedef struct {
+    uint16_t head;                          //position of next byte (free running)
+    uint32_t context[REC_STREAMS];          //last 3 bytes of each stream
+    uint16_t match[REC_STREAMS];            //position of predicted byte of each stream
+    uint16_t table[1 << REC_TABLE_BITS];    //position behind the last occurrence of a context
+    uint8_t history[REC_HISTORY];           //last bytes of all streams
+} REC_Predictor;
+
+/**
+ * @brief Decoder state, the predictor mirrors the recorder
+ *
+ */
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+    uint16_t pos;
+    uint32_t tick;
+    int32_t adc;
+    uint8_t keys;
+    REC_Predictor predictor;
+} REC_Reader;
+
+#if REC_ENABLE
+#define REC_BYTE(SRC, BYTE)     REC_Byte(SRC, BYTE)
+#define REC_KEY(KEY, STATE)     REC_Key(KEY, STATE)
+#define REC_ADC(VALUE)          REC_Adc(VALUE)
+#else
+#define REC_BYTE(SRC, BYTE)
+#define REC_KEY(KEY, STATE)
+#define REC_ADC(VALUE)
+#endif
+
+/**
+ * @brief Start recording from boot
+ *
+ */
+void REC_Init(void);
+
+/**
+ * @brief Clear recording and record from now on
+ *
+ */
+void REC_Restart(void);
+
+/**
+ * @brief Stop recording (a stopped recording stays until restarted)
+ *
+ */
+void REC_Stop(void);
+
+/**
+ * @brief Select recorded inputs
+ *
+ * @param mask bit n enables source n
+ */
+void REC_SetMask(uint32_t mask);
+
+/**
+ * @brief Retrieve selected inputs
+ *
+ * @return uint32_t mask
+ */
+uint32_t REC_GetMask(void);
+
+/**
+ * @brief Record byte of a stream input (gnss, ble, usb)
+ *
+ * @param src source
+ * @param byte byte consumed by the firmware
+ */
+void REC_Byte(REC_Source src, uint8_t byte);
+
+/**
+ * @brief Record key state, only changes are stored
+ *
+ * @param key key index (0 .. 7)
+ * @param state 1 if pressed
+ */
+void REC_Key(uint8_t key, uint8_t state);
+
+/**
+ * @brief Record adc conversion, only changes are stored
+ *
+ * @param value conversion result
+ */
+void REC_Adc(int32_t value);
+
+/**
+ * @brief Retrieve recording, ends an open stream record
+ *
+ * @param len length of recording
+ * @return const uint8_t* recording
+ */
+const uint8_t* REC_GetData(uint16_t *len);
+
+/**
+ * @brief Retrieve HAL tick the recording started
+ *
+ * @return uint32_t tick
+ */
+uint32_t REC_GetStartTick(void);
+
+/**
+ * @brief Check if recording stopped because the buffer is full
+ *
+ * @return uint8_t 1 if full
+ */
+uint8_t REC_IsFull(void);
+
+/**
+ * @brief Retrieve count of inputs dropped since the buffer is full (stream bytes, key changes, conversions)
+ *
+ * @return uint32_t count
+ */
+uint32_t REC_GetDropped(void);
+
+/**
+ * @brief Check if recording is running
+ *
+ * @return uint8_t 1 if running
+ */
+uint8_t REC_IsRunning(void);
+
+/**
+ * @brief Stop recording and save it to data eeprom
+ *
+ * @return uint8_t 1 on success
+ */
+uint8_t REC_Save(void);
+
+/**
+ * @brief Stop recording and load the recording saved in data eeprom
+ *
+ * @return uint8_t 1 on success, 0 if nothing saved
+ */
+uint8_t REC_Load(void);
+
+/**
+ * @brief Initialize decoder
+ *
+ * @param reader decoder state
+ * @param data recording
+ * @param len length of recording
+ * @param start HAL tick the recording started
+ */
+void REC_ReaderInit(REC_Reader *reader, const uint8_t *data, uint16_t len, uint32_t start);
+
+/**
+ * @brief Decode next input
+ *
+ * @param reader decoder state
+ * @param input decoded input
+ * @return uint8_t 1 on success, 0 at the end or if the recording is corrupt
+ */
+uint8_t REC_Next(REC_Reader *reader, REC_Input *input);
+
+/**
+ * @brief Retrieve source name
+ *
+ * @param src source
+ * @return const char* name, 0 if unknown
+ */
+const char* REC_GetName(REC_Source src);
+
+#endif //!RECORD_H
@@ -0,0 +1,242 @@
+/**
+ * @file storage.c
+ * @author Paul Götzinger
+ * @brief Non-blocking writer of the data eeprom: writes are queued, programmed word by word from
+ * the main loop and held back while a gate (the radio) needs the bus
+ * @version 1.0
+ * @date 2019-04-02
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "storage.h"
+#include "eeprom.h"
+#include "memory.h"
+#include <string.h>
+
+#define WORD_SIZE 4
+
+/**
+ * @brief Queued write, its data is in the byte ring
+ *
+ */
+typedef struct {
+    uint16_t offset;
+    uint16_t len;
+    uint16_t start;         //position of the data in the byte ring
+    uint8_t flags;
+    STORAGE_Callback cb;
+    void *ctx;
+} Write;
+
+static uint8_t data[STORAGE_QUEUE_SIZE];
+static uint16_t dataHead;           //next free byte
+static uint16_t dataUsed;
+
+static Write writes[STORAGE_WRITES];
+static uint8_t writeTail;           //oldest write, the one being programmed
+static uint8_t writeCount;
+
+static uint16_t cursor;             //word of the oldest write to program next
+static uint8_t started;             //word started, verified once the eeprom is idle
+static uint16_t startedOffset;
+static uint32_t startedWord;
+
+static STORAGE_Gate gate;
+static uint8_t held;                //gate closed at the last word start
+static uint32_t deferred;
+
+MEM_BUFFER("storage", data);
+
+/**
+ * @brief Advance the oldest write: verify the started word, skip unchanged words, start the next one
+ *
+ * @param force ignore the gate
+ */
+static void step(uint8_t force);
+
+/**
+ * @brief Remove oldest write and report its result
+ *
+ * @param status result
+ */
+static void finish(HAL_StatusTypeDef status);
+
+/**
+ * @brief Retrieve count of words a write touches
+ *
+ * @param w write
+ * @return uint16_t words
+ */
+static uint16_t wordCount(const Write *w);
+
+/**
+ * @brief Retrieve offset of a word in programming order
+ *
+ * @param w write
+ * @param idx position in programming order
+ * @return uint16_t word aligned offset
+ */
+static uint16_t wordOffset(const Write *w, uint16_t idx);
+
+/**
+ * @brief Merge data of a write into the stored word
+ *
+ * @param w write
+ * @param offset word aligned offset
+ * @param stored stored word, filled
+ * @return uint32_t new word
+ */
+static uint32_t mergeWord(const Write *w, uint16_t offset, uint32_t *stored);
+
+void STORAGE_SetGate(STORAGE_Gate g) {
+    gate = g;
+}
+
+HAL_StatusTypeDef STORAGE_Write(uint16_t offset, const void *src, uint16_t len, uint8_t flags,
+        STORAGE_Callback cb, void *ctx) {
+    if (src == 0 || len == 0 || (uint32_t)offset + len > EEPROM_SIZE) {
+        return HAL_ERROR;
+    }
+    if (writeCount >= STORAGE_WRITES || STORAGE_QUEUE_SIZE - dataUsed < len) {
+        LOG("[STORAGE] Queue full, %u bytes at %u dropped\n", len, offset);
+        return HAL_BUSY;
+    }
+
+    Write *w = &writes[(writeTail + writeCount) % STORAGE_WRITES];
+    w->offset = offset;
+    w->len = len;
+    w->start = dataHead;
+    w->flags = flags;
+    w->cb = cb;
+    w->ctx = ctx;
+
+    const uint8_t *bytes = src;
+    for (uint16_t i = 0; i < len; i++) {
+        data[dataHead] = bytes[i];
+        dataHead = (dataHead + 1) % STORAGE_QUEUE_SIZE;
+    }
+    dataUsed += len;
+    writeCount++;
+    return HAL_OK;
+}
+
+void STORAGE_Process(void) {
+    step(0);
+}
+
+void STORAGE_Flush(void) {
+    while (writeCount > 0) {
+        step(1);
+    }
+}
+
+uint8_t STORAGE_IsIdle(void) {
+    return writeCount == 0;
+}
+
+uint32_t STORAGE_GetDeferred(void) {
+    return deferred;
+}
+
+static void step(uint8_t force) {
+    if (writeCount == 0 || EEPROM_IsBusy()) {
+        return;
+    }
+
+    const Write *w = &writes[writeTail];
+    uint16_t words = wordCount(w);
+    uint32_t stored;
+
+    if (started) {
+        started = 0;
+        EEPROM_Read(startedOffset, (uint8_t*)&stored, WORD_SIZE);
+        if (stored != startedWord) {
+            finish(HAL_ERROR);
+            return;
+        }
+        cursor++;
+    }
+
+    //unchanged words cost a read only
+    uint16_t offset = 0;
+    uint32_t word = 0;
+    for (; cursor < words; cursor++) {
+        offset = wordOffset(w, cursor);
+        word = mergeWord(w, offset, &stored);
+        if (word != stored) {
+            break;
+        }
+    }
+    if (cursor == words) {
+        finish(HAL_OK);
+        return;
+    }
+
+    if (!force && gate != 0 && gate() <= STORAGE_WORD_TIME) {
+        deferred += !held;
+        held = 1;
+        return;
+    }
+    held = 0;
+
+    if (EEPROM_ProgramWord(offset, word) != HAL_OK) {
+        finish(HAL_ERROR);
+        return;
+    }
+    started = 1;
+    startedOffset = offset;
+    startedWord = word;
+}
+
+static void finish(HAL_StatusTypeDef status) {
+    Write w = writes[writeTail];
+
+    writeTail = (writeTail + 1) % STORAGE_WRITES;
+    writeCount--;
+    dataUsed -= w.len;
+    cursor = 0;
+    started = 0;
+
+    if (writeCount == 0) {
+        EEPROM_Lock();
+    }
+    if (status != HAL_OK) {
+        LOG("[STORAGE] Write of %u bytes at %u failed\n", w.len, w.offset);
+    }
+    //last, the callback may queue the next write
+    if (w.cb != 0) {
+        w.cb(w.ctx, status);
+    }
+}
+
+static uint16_t wordCount(const Write *w) {
+    uint16_t first = w->offset & ~(WORD_SIZE - 1);
+    uint16_t end = (w->offset + w->len + WORD_SIZE - 1) & ~(WORD_SIZE - 1);
+    return (end - first) / WORD_SIZE;
+}
+
+static uint16_t wordOffset(const Write *w, uint16_t idx) {
+    if (w->flags & STORAGE_Flag_CommitFirst) {
+        //1, 2, ..., n - 1, then 0: a torn write keeps the old first word
+        idx = (idx + 1) % wordCount(w);
+    }
+    return (w->offset & ~(WORD_SIZE - 1)) + idx * WORD_SIZE;
+}
+
+static uint32_t mergeWord(const Write *w, uint16_t offset, uint32_t *stored) {
+    uint32_t word;
+
+    EEPROM_Read(offset, (uint8_t*)stored, WORD_SIZE);
+    word = *stored;
+
+    uint8_t *bytes = (uint8_t*)&word;
+    for (uint8_t i = 0; i < WORD_SIZE; i++) {
+        uint16_t addr = offset + i;
+        if (addr >= w->offset && addr < w->offset + w->len) {
+            bytes[i] = data[(w->start + addr - w->offset) % STORAGE_QUEUE_SIZE];
+        }
+    }
+    return word;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file storage.h
+ * @author Paul Götzinger
+ * @brief Non-blocking writer of the data eeprom: writes are queued, programmed word by word from
+ * the main loop and held back while a gate (the radio) needs the bus
+ * @version 1.0
+ * @date 2019-04-02
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+
+#define STORAGE_QUEUE_SIZE  128     //bytes of queued write data (a configuration bank and some records)
+#define STORAGE_WRITES      8       //queued writes
+#define STORAGE_WORD_TIME   4       //ms, longest erase and program of a word (3.2 ms typ)
+
+/**
+ * @brief Write flags
+ *
+ */
+typedef enum {
+    STORAGE_Flag_None = 0,
+    STORAGE_Flag_CommitFirst = 1    //first word is programmed last, after all others were verified
+} STORAGE_Flag;
+
+/**
+ * @brief Completion callback of a write, called from \ref STORAGE_Process
+ *
+ * @param ctx context given to \ref STORAGE_Write
+ * @param status HAL_OK if all words were programmed and verified
+ */
+typedef void (*STORAGE_Callback)(void *ctx, HAL_StatusTypeDef status);
+
+/**
+ * @brief Gate of the writer
+ *
+ * @return uint32_t ms the bus may be stalled from now on, 0 while it must not
+ */
+typedef uint32_t (*STORAGE_Gate)(void);
+
+/**
+ * @brief Set gate, a word is only started if it ends before the gate closes
+ *
+ * @param gate gate, 0 to write without restriction
+ */
+void STORAGE_SetGate(STORAGE_Gate gate);
+
+/**
+ * @brief Queue write, the data is copied. Unchanged words are not programmed.
+ *
+ * @param offset offset from start of data eeprom
+ * @param data data to write
+ * @param len count of bytes to write
+ * @param flags STORAGE_Flag
+ * @param cb completion callback, may be 0
+ * @param ctx context of callback
+ * @return HAL_StatusTypeDef HAL_OK if queued, HAL_BUSY if the queue is full, HAL_ERROR if out of range
+ */
+HAL_StatusTypeDef STORAGE_Write(uint16_t offset, const void *data, uint16_t len, uint8_t flags,
+        STORAGE_Callback cb, void *ctx);
+
+/**
+ * @brief Verify the last word and start the next one if the gate allows it
+ *
+ */
+void STORAGE_Process(void);
+
+/**
+ * @brief Program all queued writes, ignoring the gate (before a reset)
+ *
+ */
+void STORAGE_Flush(void);
+
+/**
+ * @brief Check if writes are queued
+ *
+ * @return uint8_t 1 if no write is queued
+ */
+uint8_t STORAGE_IsIdle(void);
+
+/**
+ * @brief Retrieve count of word starts held back by the gate since boot
+ *
+ * @return uint32_t deferred starts
+ */
+uint32_t STORAGE_GetDeferred(void);
+
+#endif //!STORAGE_H
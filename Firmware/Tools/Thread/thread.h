@@ -0,0 +1,150 @@
+/**
+ * @file thread.h
+ * @author Paul Götzinger
+ * @brief Stackless threads (protothreads) for multi-step driver sequences: a sequence is written
+ * linearly and waits without blocking, the thread function returns at each wait and resumes there
+ * at its next call from the main loop (the *_Process functions)
+ * @version 1.0
+ * @date 2019-03-31
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdint.h>
+
+/*
+ * The resume point (local continuation) is the source line of the wait, the thread body is a
+ * switch on it. Therefore:
+ * - local variables do not survive a wait, keep state in static or instance variables
+ * - no switch statement in a thread body may contain a wait
+ * - at most one wait per source line
+ */
+
+#define THREAD_LC_START 0           //resume point at the beginning
+#define THREAD_LC_END   0xFFFF      //thread exited or ended, resumes nowhere
+
+/**
+ * @brief Thread context, one per thread
+ *
+ */
+typedef struct {
+    uint16_t lc;        //resume point (source line)
+    uint32_t since;     //tick the current wait or timer started
+} THREAD_Context;
+
+/**
+ * @brief Result of a thread function
+ *
+ */
+typedef enum {
+    THREAD_Status_Waiting = 0,  //thread waits, call it again
+    THREAD_Status_Exited,       //thread left early (THREAD_EXIT)
+    THREAD_Status_Ended         //thread ran to its end
+} THREAD_Status;
+
+/**
+ * @brief Start (or start over) a thread at its beginning
+ *
+ */
+#define THREAD_INIT(T)              do { (T)->lc = THREAD_LC_START; (T)->since = HAL_GetTick(); } while (0)
+
+/**
+ * @brief Body of a thread function returning THREAD_Status
+ *
+ */
+#define THREAD_BEGIN(T)             switch ((T)->lc) { case THREAD_LC_START:
+#define THREAD_END(T)               } (T)->lc = THREAD_LC_END; return THREAD_Status_Ended
+
+/**
+ * @brief Thread ran to its end or exited
+ *
+ */
+#define THREAD_DONE(T)              ((T)->lc == THREAD_LC_END)
+
+/**
+ * @brief Wait until a condition holds, the condition is evaluated at each call of the thread
+ *
+ */
+#define THREAD_WAIT_UNTIL(T, COND) \
+    do { \
+        (T)->lc = __LINE__; case __LINE__: \
+        if (!(COND)) { \
+            return THREAD_Status_Waiting; \
+        } \
+    } while (0)
+
+#define THREAD_WAIT_WHILE(T, COND)  THREAD_WAIT_UNTIL(T, !(COND))
+
+/**
+ * @brief Return to the main loop once, continue at the next call
+ *
+ */
+#define THREAD_YIELD(T) \
+    do { \
+        (T)->lc = __LINE__; \
+        return THREAD_Status_Waiting; \
+        case __LINE__:; \
+    } while (0)
+
+/**
+ * @brief Timer of the thread (one per thread, restarted by each delay and timeout)
+ *
+ */
+#define THREAD_TIMER_START(T)       ((T)->since = HAL_GetTick())
+#define THREAD_ELAPSED(T)           (HAL_GetTick() - (T)->since)
+
+/**
+ * @brief Wait at least MS milliseconds (more than MS ticks pass, the first one may be partial)
+ *
+ */
+#define THREAD_DELAY(T, MS) \
+    do { \
+        THREAD_TIMER_START(T); \
+        THREAD_WAIT_UNTIL(T, THREAD_ELAPSED(T) > (uint32_t)(MS)); \
+    } while (0)
+
+/**
+ * @brief Wait until a condition holds or MS milliseconds passed, test the condition again to tell which
+ *
+ */
+#define THREAD_WAIT_UNTIL_TIMEOUT(T, COND, MS) \
+    do { \
+        THREAD_TIMER_START(T); \
+        THREAD_WAIT_UNTIL(T, (COND) || THREAD_ELAPSED(T) > (uint32_t)(MS)); \
+    } while (0)
+
+/**
+ * @brief Run a child thread until it exited or ended; the child context is started here
+ *
+ */
+#define THREAD_SPAWN(T, CHILD, CALL) \
+    do { \
+        THREAD_INIT(CHILD); \
+        THREAD_WAIT_UNTIL(T, (CALL) != THREAD_Status_Waiting); \
+    } while (0)
+
+/**
+ * @brief Leave the thread, it stays done until started again
+ *
+ */
+#define THREAD_EXIT(T) \
+    do { \
+        (T)->lc = THREAD_LC_END; \
+        return THREAD_Status_Exited; \
+    } while (0)
+
+/**
+ * @brief Start over at the beginning with the next call
+ *
+ */
+#define THREAD_RESTART(T) \
+    do { \
+        THREAD_INIT(T); \
+        return THREAD_Status_Waiting; \
+    } while (0)
+
+#endif //!THREAD_H
@@ -0,0 +1,170 @@
+/**
+ * @file trace.c
+ * @author Paul Götzinger
+ * @brief Timestamped event trace for interrupts and tasks
+ * @version 1.0
+ * @date 2019-03-20
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include "trace.h"
+#include "memory.h"
+#include <string.h>
+
+#define TRACE_MAGIC   0x54524345  //"TRCE"
+#define TIMER_FREQ    1000000     //1 us resolution, 16 bit counter wraps after 65 ms
+
+/**
+ * @brief Trace state, kept in .noinit to survive a reset after a fault
+ *
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t mask;
+    uint16_t head;      //next entry to write
+    uint16_t count;     //valid entries
+    uint8_t  crash;     //ring holds trace of crash
+    uint8_t  frozen;    //recording stopped
+    TRACE_Entry ring[TRACE_SIZE];
+} Trace;
+
+static Trace trace __attribute__((section(".noinit")));
+static TRACE_Latency latency;
+
+static const char* const names[TRACE_Event_Count] = {
+    "boot", "fault", "usart1", "usart2", "usart4_5", "dma1_ch1", "dma1_ch2_3", "dma1_ch4_7",
+    "tim7", "usb", "stack", "loc", "emc", "com", "ui", "radio"
+};
+
+void TRACE_Init(void) {
+    //the M0+ has no cycle counter, TIM6 (otherwise unused) runs free at 1 MHz
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    TRACE_ClockChanged();
+    TIM6->ARR = 0xFFFF;
+    TIM6->CR1 = TIM_CR1_CEN;
+
+    if (trace.magic != TRACE_MAGIC || trace.crash == 0
+            || trace.count > TRACE_SIZE || trace.head >= TRACE_SIZE) {
+        trace.magic = TRACE_MAGIC;
+        trace.mask = TRACE_MASK_DEFAULT;
+        TRACE_Restart();
+    } else {
+        //keep crash trace until it was read out
+        trace.frozen = 1;
+        LOG("[TRACE] Crash trace with %u entries preserved\n", trace.count);
+    }
+    TRACE_MARK(TRACE_Event_Boot, RCC->CSR >> 24);   //reset flags
+}
+
+void TRACE_ClockChanged(void) {
+    //timers on APB1 run at twice the bus clock if the bus is divided
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        clk *= 2;
+    }
+    TIM6->PSC = clk / TIMER_FREQ - 1;
+    TIM6->EGR = TIM_EGR_UG;     //load prescaler
+}
+
+MEM_RAMFUNC void TRACE_Record(uint16_t event, uint16_t arg) {
+    uint16_t id = event & TRACE_ID_MASK;
+    if (trace.frozen || id >= 32 || (trace.mask & (1UL << id)) == 0) {
+        return;
+    }
+
+    //Cortex-M0+ has no exclusive access, the slot is written with interrupts masked (a few cycles)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    TRACE_Entry *entry = &trace.ring[trace.head];
+    entry->time = TIM6->CNT;
+    entry->tick = HAL_GetTick();
+    entry->event = event;
+    entry->arg = arg;
+    trace.head = (trace.head + 1) & (TRACE_SIZE - 1);
+    if (trace.count < TRACE_SIZE) {
+        trace.count++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+MEM_RAMFUNC void TRACE_Tick(void) {
+    //the counter runs down from LOAD, it was reloaded when the interrupt became pending
+    uint32_t cycles = SysTick->LOAD - SysTick->VAL;
+
+    //no count leading zeros on the M0+
+    uint8_t bin = 0;
+    while (bin < TRACE_LATENCY_BINS - 1 && (cycles >> (bin + 1)) != 0) {
+        bin++;
+    }
+    if (latency.count == 0 || cycles < latency.min) {
+        latency.min = cycles;
+    }
+    if (cycles > latency.max) {
+        latency.max = cycles;
+    }
+    latency.count++;
+    latency.sum += cycles;
+    latency.hist[bin]++;
+}
+
+void TRACE_GetLatency(TRACE_Latency *lat) {
+    __disable_irq();
+    memcpy(lat, &latency, sizeof(TRACE_Latency));
+    __enable_irq();
+}
+
+void TRACE_Crash(void) {
+    TRACE_MARK(TRACE_Event_Fault, 0);
+    trace.crash = 1;
+    trace.frozen = 1;
+}
+
+void TRACE_Restart(void) {
+    __disable_irq();
+    trace.head = 0;
+    trace.count = 0;
+    trace.crash = 0;
+    trace.frozen = 0;
+    memset(&latency, 0, sizeof(latency));
+    __enable_irq();
+}
+
+void TRACE_Freeze(uint8_t freeze) {
+    trace.frozen = freeze;
+}
+
+void TRACE_SetMask(uint32_t mask) {
+    trace.mask = mask;
+}
+
+uint32_t TRACE_GetMask(void) {
+    return trace.mask;
+}
+
+uint8_t TRACE_IsCrashDump(void) {
+    return trace.crash;
+}
+
+uint16_t TRACE_GetCount(void) {
+    return trace.count;
+}
+
+uint8_t TRACE_GetEntry(uint16_t idx, TRACE_Entry *entry) {
+    if (idx >= trace.count || entry == 0) {
+        return 0;
+    }
+
+    //oldest entry is at head once the ring is full
+    uint16_t first = (trace.head + TRACE_SIZE - trace.count) & (TRACE_SIZE - 1);
+    memcpy(entry, &trace.ring[(first + idx) & (TRACE_SIZE - 1)], sizeof(TRACE_Entry));
+    return 1;
+}
+
+const char* TRACE_GetName(uint16_t event) {
+    uint16_t id = event & TRACE_ID_MASK;
+    return id < TRACE_Event_Count ? names[id] : 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file trace.h
+ * @author Paul Götzinger
+ * @brief Timestamped event trace for interrupts and tasks
+ * @version 1.0
+ * @date 2019-03-20
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1          //set to 0 to remove all trace points
+#endif
+
+#define TRACE_SIZE 64           //ring entries (power of 2), 8 bytes each
+
+#define TRACE_FLAG_BEGIN 0x8000 //event starts (interrupt entry, task start)
+#define TRACE_FLAG_END   0x4000 //event ends
+#define TRACE_ID_MASK    0x00FF
+#define TRACE_LATENCY_BINS 16   //log2 bins of the interrupt latency, 1 .. 65535 cycles
+
+/**
+ * @brief Traced events, at most 32 (bit position in trace mask)
+ *
+ */
+typedef enum {
+    TRACE_Event_Boot = 0,
+    TRACE_Event_Fault,
+    TRACE_Event_Usart1,
+    TRACE_Event_Usart2,
+    TRACE_Event_Usart4_5,
+    TRACE_Event_Dma1_Ch1,
+    TRACE_Event_Dma1_Ch2_3,
+    TRACE_Event_Dma1_Ch4_7,
+    TRACE_Event_Tim7,
+    TRACE_Event_Usb,
+    TRACE_Event_Stack,
+    TRACE_Event_Loc,
+    TRACE_Event_Emc,
+    TRACE_Event_Com,
+    TRACE_Event_Ui,
+    TRACE_Event_Radio,
+    TRACE_Event_Count
+} TRACE_Event;
+
+/**
+ * @brief Default mask: interrupts and markers; tasks (loc .. radio) run several
+ * thousand times per second and would flood the ring, enable them over usb
+ *
+ */
+#define TRACE_MASK_DEFAULT ((1UL << TRACE_Event_Loc) - 1)
+
+/**
+ * @brief Trace entry
+ *
+ */
+typedef struct {
+    uint16_t time;      //free running timer (1 us)
+    uint16_t tick;      //HAL tick (1 ms), used to unwrap time
+    uint16_t event;     //event id and begin/end flag
+    uint16_t arg;       //event argument
+} TRACE_Entry;
+
+/**
+ * @brief Interrupt latency: SysTick cycles from its reload to the read at the start of its handler.
+ * SysTick has priority 0 like the uart and dma interrupts, it waits for a running handler and for
+ * sections with interrupts masked; exception entry and handler prologue are a constant part
+ *
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min;       //cycles
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[TRACE_LATENCY_BINS];  //bin n: 2^n .. 2^(n+1)-1 cycles, bin 0 from 0
+} TRACE_Latency;
+
+#if TRACE_ENABLE
+#define TRACE_BEGIN(EVT, ARG)   TRACE_Record((EVT) | TRACE_FLAG_BEGIN, ARG)
+#define TRACE_END(EVT, ARG)     TRACE_Record((EVT) | TRACE_FLAG_END, ARG)
+#define TRACE_MARK(EVT, ARG)    TRACE_Record(EVT, ARG)
+#define TRACE_TICK()            TRACE_Tick()
+#else
+#define TRACE_BEGIN(EVT, ARG)
+#define TRACE_END(EVT, ARG)
+#define TRACE_MARK(EVT, ARG)
+#define TRACE_TICK()
+#endif
+
+/**
+ * @brief Start timer and ring; a trace preserved from a crash stays frozen until restarted
+ *
+ */
+void TRACE_Init(void);
+
+/**
+ * @brief Adapt timer prescaler after the system clock changed
+ *
+ */
+void TRACE_ClockChanged(void);
+
+/**
+ * @brief Record event (interrupt safe)
+ *
+ * @param event event id with TRACE_FLAG_BEGIN/TRACE_FLAG_END
+ * @param arg event argument
+ */
+void TRACE_Record(uint16_t event, uint16_t arg);
+
+/**
+ * @brief Measure interrupt latency, first statement of the SysTick handler
+ *
+ */
+void TRACE_Tick(void);
+
+/**
+ * @brief Retrieve interrupt latency since the last restart
+ *
+ * @param latency copy of statistics
+ */
+void TRACE_GetLatency(TRACE_Latency *latency);
+
+/**
+ * @brief Mark trace as crash dump and stop recording (called from fault handler)
+ *
+ */
+void TRACE_Crash(void);
+
+/**
+ * @brief Clear ring and latency, resume recording
+ *
+ */
+void TRACE_Restart(void);
+
+/**
+ * @brief Stop or resume recording (e.g. while dumping)
+ *
+ * @param freeze 1 to stop recording
+ */
+void TRACE_Freeze(uint8_t freeze);
+
+/**
+ * @brief Select recorded events
+ *
+ * @param mask bit n enables event n
+ */
+void TRACE_SetMask(uint32_t mask);
+
+/**
+ * @brief Retrieve selected events
+ *
+ * @return uint32_t mask
+ */
+uint32_t TRACE_GetMask(void);
+
+/**
+ * @brief Check if the ring holds the trace of a crash before the last reset
+ *
+ * @return uint8_t 1 if crash trace
+ */
+uint8_t TRACE_IsCrashDump(void);
+
+/**
+ * @brief Retrieve number of entries in ring
+ *
+ * @return uint16_t entries
+ */
+uint16_t TRACE_GetCount(void);
+
+/**
+ * @brief Retrieve entry, oldest first
+ *
+ * @param idx index (0 .. TRACE_GetCount()-1)
+ * @param entry copy of entry
+ * @return uint8_t 1 on success
+ */
+uint8_t TRACE_GetEntry(uint16_t idx, TRACE_Entry *entry);
+
+/**
+ * @brief Retrieve event name
+ *
+ * @param event event id
+ * @return const char* name, 0 if unknown
+ */
+const char* TRACE_GetName(uint16_t event);
+
+#endif //!TRACE_H